@@ -208,15 +208,19 @@ void aLRT(t_tree *tree)
   MIXT_Set_Alias_Subpatt(NO,tree);
   Update_Dirs(tree);
   
-  For(i,2*tree->n_otu-3)
-    if((!tree->a_edges[i]->left->tax) && (!tree->a_edges[i]->rght->tax))
-      {
-        /* Compute likelihoods for each of the three configuration */
-        NNI_Neigh_BL(tree->a_edges[i],tree);
-        /* Compute the corresponding statistical support */
-        Compute_Likelihood_Ratio_Test(tree->a_edges[i],tree);
-      }
+  if(NNI_Neigh_Par(tree) == YES) NNI_Neigh_BL_Par(tree);
+  else
+    For(i,2*tree->n_otu-3)
+      if((!tree->a_edges[i]->left->tax) && (!tree->a_edges[i]->rght->tax))
+        {
+          /* Compute likelihoods for each of the three configuration */
+          NNI_Neigh_BL(tree->a_edges[i],tree);
+          /* Compute the corresponding statistical support */
+          Compute_Likelihood_Ratio_Test(tree->a_edges[i],tree);
+        }
   
+  Free_Rell_Cnt(tree);
+
   tree->lock_topo = YES;
   
   Br_Len_Involving_Invar(tree);
@@ -717,6 +721,36 @@ int NNI_Neigh_BL(t_edge *b_fcus, t_tree *tree)
 
 
   //save likelihoods in NNI structures
+  result = NNI_Neigh_Result(b_fcus,lk0,lk1,lk2,tree);
+
+  Free_Scalar_Dbl(len_e1);
+  Free_Scalar_Dbl(len_e2);
+  Free_Scalar_Dbl(len_e3);
+  Free_Scalar_Dbl(len_e4);
+  Free_Scalar_Dbl(l_init);
+  Free_Scalar_Dbl(var_e1);
+  Free_Scalar_Dbl(var_e2);
+  Free_Scalar_Dbl(var_e3);
+  Free_Scalar_Dbl(var_e4);
+  Free_Scalar_Dbl(v_init);
+
+  return result;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/*
+* Save the likelihoods of the three configurations around b_fcus
+* in its NNI structure.
+* return an integer, informative to analyse the results and potential NNIs to do
+*/
+int NNI_Neigh_Result(t_edge *b_fcus, phydbl lk0, phydbl lk1, phydbl lk2, t_tree *tree)
+{
+  int result;
+
+  result = 0;
+
   b_fcus->nni->lk0 = lk0;
   b_fcus->nni->lk1 = lk1;
   b_fcus->nni->lk2 = lk2;
@@ -742,19 +776,319 @@ int NNI_Neigh_BL(t_edge *b_fcus, t_tree *tree)
       else                                    result = 4; //lk2 > lk1 > lk0
     }
 
+  return result;
+}
 
-  Free_Scalar_Dbl(len_e1);
-  Free_Scalar_Dbl(len_e2);
-  Free_Scalar_Dbl(len_e3);
-  Free_Scalar_Dbl(len_e4);
-  Free_Scalar_Dbl(l_init);
-  Free_Scalar_Dbl(var_e1);
-  Free_Scalar_Dbl(var_e2);
-  Free_Scalar_Dbl(var_e3);
-  Free_Scalar_Dbl(var_e4);
-  Free_Scalar_Dbl(v_init);
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
-  return result;
+/* Can the NNI neighbours of the internal edges be evaluated
+   concurrently (see NNI_Neigh_BL_Par)? Same conditions as for the
+   optimisation of edge lengths around regraft points (see
+   Spr_Par_Triple) */
+int NNI_Neigh_Par(t_tree *tree)
+{
+  int i;
+
+  if(Spr_Par_Lk(tree) == NO) return NO;
+  if(tree->io->datatype != NT && tree->io->datatype != AA) return NO;
+
+  For(i,2*tree->n_otu-3) if(tree->a_edges[i]->has_zero_br_len == YES) return NO;
+
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as the loop over internal edges in aLRT, except that the
+   likelihoods of the three configurations around batches of internal
+   edges are obtained concurrently (see NNI_Neigh_BL_Local). The
+   supports are then calculated one edge after the other and in the
+   same order as in the serial version, so that the random draws made
+   by Statistics_To_SH do not depend on the number of threads */
+void NNI_Neigh_BL_Par(t_tree *tree)
+{
+  t_nni_neigh_job job;
+  t_nni_neigh *neigh;
+  t_nni_neigh_buff *buff;
+  int i,j,k,n_threads,n_batch,n_neigh,ns,n_catg,n_patt,dim;
+
+  ns        = tree->mod->ns;
+  n_catg    = tree->mod->ras->n_catg;
+  n_patt    = tree->n_pattern;
+  dim       = n_patt*n_catg*ns;
+  n_threads = THREAD_N_Threads();
+  n_batch   = NNI_NEIGH_BATCH * n_threads;
+
+  neigh = (t_nni_neigh *)mCalloc(n_batch,sizeof(t_nni_neigh));
+  For(j,n_batch) For(k,3) neigh[j].site_lk[k] = (phydbl *)mCalloc(n_patt,sizeof(phydbl));
+
+  buff = (t_nni_neigh_buff *)mCalloc(n_threads,sizeof(t_nni_neigh_buff));
+  For(j,n_threads)
+    {
+      buff[j].plk   = (phydbl *)mCalloc(4*dim,sizeof(phydbl));
+      buff[j].w     = (phydbl *)mCalloc(4*dim,sizeof(phydbl));
+      buff[j].u     = (phydbl *)mCalloc(dim,sizeof(phydbl));
+      buff[j].t     = (phydbl *)mCalloc(dim,sizeof(phydbl));
+      buff[j].coeff = (phydbl *)mCalloc(dim,sizeof(phydbl));
+      buff[j].Pij   = (phydbl *)mCalloc(n_catg*ns*ns,sizeof(phydbl));
+      buff[j].expt  = (phydbl *)mCalloc(ns,sizeof(phydbl));
+      buff[j].uexpt = (phydbl *)mCalloc(ns*ns,sizeof(phydbl));
+      buff[j].expl  = (phydbl *)mCalloc(3*n_catg*ns,sizeof(phydbl));
+      buff[j].r     = (phydbl *)mCalloc(ns,sizeof(phydbl));
+      buff[j].left  = (phydbl *)mCalloc(ns,sizeof(phydbl));
+      buff[j].rght  = (phydbl *)mCalloc(ns,sizeof(phydbl));
+      buff[j].scale = (int *)mCalloc(n_patt*n_catg,sizeof(int));
+      buff[j].skip  = (int *)mCalloc(n_patt,sizeof(int));
+    }
+
+  job.tree  = tree;
+  job.neigh = neigh;
+  job.buff  = buff;
+
+  n_neigh = 0;
+  For(i,2*tree->n_otu-3)
+    {
+      if((!tree->a_edges[i]->left->tax) && (!tree->a_edges[i]->rght->tax))
+        neigh[n_neigh++].b_fcus = tree->a_edges[i];
+
+      if(n_neigh == n_batch || (i == 2*tree->n_otu-4 && n_neigh > 0))
+        {
+          /* Compute likelihoods for each of the three configuration */
+          THREAD_Run(Optimize_NNI_Neighs,&job,n_neigh,1);
+
+          /* Compute the corresponding statistical supports */
+          For(j,n_neigh)
+            {
+              For(k,3) memcpy(tree->log_lks_aLRT[k],neigh[j].site_lk[k],n_patt*sizeof(phydbl));
+              NNI_Neigh_Result(neigh[j].b_fcus,neigh[j].lk[0],neigh[j].lk[1],neigh[j].lk[2],tree);
+              Compute_Likelihood_Ratio_Test(neigh[j].b_fcus,tree);
+            }
+
+          n_neigh = 0;
+        }
+    }
+
+  For(j,n_batch) For(k,3) Free(neigh[j].site_lk[k]);
+  Free(neigh);
+
+  For(j,n_threads)
+    {
+      Free(buff[j].plk);
+      Free(buff[j].w);
+      Free(buff[j].u);
+      Free(buff[j].t);
+      Free(buff[j].coeff);
+      Free(buff[j].Pij);
+      Free(buff[j].expt);
+      Free(buff[j].uexpt);
+      Free(buff[j].expl);
+      Free(buff[j].r);
+      Free(buff[j].left);
+      Free(buff[j].rght);
+      Free(buff[j].scale);
+      Free(buff[j].skip);
+    }
+  Free(buff);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Optimize_NNI_Neighs(int beg, int end, int thread_id, void *arg)
+{
+  t_nni_neigh_job *job;
+  int i;
+
+  job = (t_nni_neigh_job *)arg;
+
+  for(i=beg;i<end;i++) NNI_Neigh_BL_Local(job->neigh+i,job->buff+thread_id,job->tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Optimise the length l of an edge with partial likelihoods plk at one
+   end and pi * a * b at the other end, with the optimiser, number of
+   iterations and tolerance used by Br_Len_Brent in NNI_Neigh_BL (see
+   Generic_Newton_Br_Len). Returns the log-likelihood of the tree */
+static phydbl NNI_Neigh_Br_Len(phydbl *l, int onoff, phydbl *a, phydbl *b, phydbl *plk, t_nni_neigh_buff *buff, t_tree *tree)
+{
+  int site,catg,i,j,m,ns,n_catg;
+  phydbl dl,d2l;
+  phydbl *pi,*U,*V;
+  t_spr_triple_coeff c;
+
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  pi     = tree->mod->e_frq->pi->v;
+  U      = tree->mod->eigen->r_e_vect;
+  V      = tree->mod->eigen->l_e_vect;
+
+  /* Projections on the eigenvectors of the partial likelihoods at
+     both ends of the edge */
+  For(site,tree->n_pattern)
+    {
+      if(buff->skip[site] == YES) continue;
+      For(catg,n_catg)
+        {
+          i = (site*n_catg+catg)*ns;
+
+          For(j,ns) buff->r[j] = pi[j] * a[i+j] * b[i+j];
+
+          For(m,ns)
+            {
+              buff->left[m] = buff->rght[m] = .0;
+              For(j,ns)
+                {
+                  buff->left[m] += buff->r[j] * U[j*ns+m];
+                  buff->rght[m] += V[m*ns+j] * plk[i+j];
+                }
+              buff->coeff[i+m] = buff->left[m] * buff->rght[m];
+            }
+        }
+    }
+
+  if(onoff == OFF) return Spr_Triple_dLk(*l,buff->coeff,buff->scale,buff->skip,buff->expl,&dl,&d2l,tree);
+
+  c.coeff = buff->coeff;
+  c.scale = buff->scale;
+  c.skip  = buff->skip;
+  c.expl  = buff->expl;
+
+  return Generic_Newton_Br_Len(l,
+                               tree->mod->s_opt->brent_it_max,
+                               tree->mod->s_opt->min_diff_lk_local,
+                               Spr_Triple_Newton_dLk,&c,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as NNI_Neigh_BL, with the same branch length optimiser (see
+   NNI_Neigh_Br_Len). The tree is left untouched: the partial likelihoods of the four
+   subtrees around neigh->b_fcus are read from it and the calculations
+   are carried out in the buffers of the calling thread, so that
+   several threads can call this function at the same time */
+void NNI_Neigh_BL_Local(t_nni_neigh *neigh, t_nni_neigh_buff *buff, t_tree *tree)
+{
+  t_edge *b_fcus,*e[4];
+  t_node *v[4];
+  phydbl l[4],lc,lnL,prev_lnL,lk_c,site_lk;
+  phydbl *pi,*plk,*w,*u,*t;
+  int site,catg,c,i,j,k,o,p,round,ns,n_catg,n_patt,dim,min_scale,first_l,first_r;
+
+  /* Subtree found in each of the four positions around b_fcus (slots
+     l_v1 and l_v2 of the left node, r_v1 and r_v2 of the right node)
+     in the initial configuration and after each of the two swaps made
+     in NNI_Neigh_BL */
+  const int sub[3][4] = {{0,1,2,3},{0,2,1,3},{0,3,2,1}};
+
+  b_fcus = neigh->b_fcus;
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  n_patt = tree->n_pattern;
+  dim    = n_patt*n_catg*ns;
+  pi     = tree->mod->e_frq->pi->v;
+  plk    = buff->plk;
+  w      = buff->w;
+  u      = buff->u;
+  t      = buff->t;
+
+  v[0] = b_fcus->left->v[b_fcus->l_v1];
+  v[1] = b_fcus->left->v[b_fcus->l_v2];
+  v[2] = b_fcus->rght->v[b_fcus->r_v1];
+  v[3] = b_fcus->rght->v[b_fcus->r_v2];
+
+  e[0] = b_fcus->left->b[b_fcus->l_v1];
+  e[1] = b_fcus->left->b[b_fcus->l_v2];
+  e[2] = b_fcus->rght->b[b_fcus->r_v1];
+  e[3] = b_fcus->rght->b[b_fcus->r_v2];
+
+  /* Edges on each side are optimised in the order of the slots (see NNI_Neigh_BL) */
+  first_l = (b_fcus->l_v1 < b_fcus->l_v2)?(0):(1);
+  first_r = (b_fcus->r_v1 < b_fcus->r_v2)?(2):(3);
+
+  For(site,n_patt)
+    {
+      buff->skip[site] = (tree->data->wght[site] < SMALL)?(YES):(NO);
+      if(buff->skip[site] == YES) continue;
+
+      For(catg,n_catg)
+        {
+          buff->scale[site*n_catg+catg] = 0;
+          For(k,4) buff->scale[site*n_catg+catg] += Spr_Site_P_Lk(e[k],v[k],site,catg,plk+k*dim+(site*n_catg+catg)*ns,tree);
+        }
+    }
+
+  For(c,3)
+    {
+      For(p,4)
+        {
+          l[p] = e[sub[c][p]]->l->v;
+          Spr_Triple_Transfer(l[p],plk+sub[c][p]*dim,w+p*dim,buff->Pij,buff->expt,buff->uexpt,buff->skip,tree);
+        }
+      lc = b_fcus->l->v;
+
+      lnL = UNLIKELY;
+      For(round,NNI_NEIGH_MAX_ROUNDS)
+        {
+          prev_lnL = lnL;
+
+          /* Edges on the left side */
+          For(i,dim) u[i] = w[2*dim+i] * w[3*dim+i];
+          Spr_Triple_Transfer(lc,u,t,buff->Pij,buff->expt,buff->uexpt,buff->skip,tree);
+
+          For(o,2)
+            {
+              p = (o == 0)?(first_l):(1-first_l);
+              lnL = NNI_Neigh_Br_Len(l+p,e[sub[c][p]]->l->onoff,w+(1-p)*dim,t,plk+sub[c][p]*dim,buff,tree);
+              Spr_Triple_Transfer(l[p],plk+sub[c][p]*dim,w+p*dim,buff->Pij,buff->expt,buff->uexpt,buff->skip,tree);
+            }
+
+          /* b_fcus */
+          lnL = NNI_Neigh_Br_Len(&lc,b_fcus->l->onoff,w+0*dim,w+1*dim,u,buff,tree);
+
+          /* Edges on the right side */
+          For(i,dim) u[i] = w[0*dim+i] * w[1*dim+i];
+          Spr_Triple_Transfer(lc,u,t,buff->Pij,buff->expt,buff->uexpt,buff->skip,tree);
+
+          For(o,2)
+            {
+              p = (o == 0)?(first_r):(5-first_r);
+              lnL = NNI_Neigh_Br_Len(l+p,e[sub[c][p]]->l->onoff,w+(5-p)*dim,t,plk+sub[c][p]*dim,buff,tree);
+              Spr_Triple_Transfer(l[p],plk+sub[c][p]*dim,w+p*dim,buff->Pij,buff->expt,buff->uexpt,buff->skip,tree);
+            }
+
+          if(FABS(lnL-prev_lnL) <= tree->mod->s_opt->min_diff_lk_global) break;
+        }
+
+      /* Log-likelihood of every site pattern, at the right node */
+      lnL = .0;
+      For(site,n_patt)
+        {
+          neigh->site_lk[c][site] = .0;
+          if(buff->skip[site] == YES) continue;
+
+          min_scale = INT_MAX;
+          For(catg,n_catg) min_scale = MIN(min_scale,buff->scale[site*n_catg+catg]);
+
+          site_lk = .0;
+          For(catg,n_catg)
+            {
+              i = (site*n_catg+catg)*ns;
+              lk_c = .0;
+              For(j,ns) lk_c += pi[j] * t[i+j] * w[2*dim+i+j] * w[3*dim+i+j];
+              site_lk += tree->mod->ras->gamma_r_proba->v[catg] * ldexp(lk_c,-(buff->scale[site*n_catg+catg]-min_scale));
+            }
+
+          neigh->site_lk[c][site] = tree->data->wght[site] * Spr_Log_Site_Lk(site_lk,min_scale,site,tree);
+          lnL += neigh->site_lk[c][site];
+        }
+
+      neigh->lk[c] = lnL;
+    }
 }
 
 //////////////////////////////////////////////////////////////
@@ -1071,45 +1405,31 @@ phydbl Statistics_To_Probabilities(phydbl in)
 phydbl Statistics_to_RELL(t_tree *tree)
 {
   int i;
-  int occurence=1000;
+  int occurence=N_RELL_ALRT;
   phydbl nb=0.0;
-  phydbl res,*pi;
-  int site;
+  phydbl res;
   phydbl lk0=0.0;
   phydbl lk1=0.0;
   phydbl lk2=0.0;
-  int position = -1;
-  t_tree *buff_tree;
+  phydbl *lnL;
+
+  /*! Log-likelihoods of the three positions under each replicate */
+  lnL = (phydbl *)mCalloc(3*occurence,sizeof(phydbl));
+  Rell_Lk(lnL,tree);
 
   /*! 1000 times */
   For(i,occurence)
     {
-      lk0=0.0;
-      lk1=0.0;
-      lk2=0.0;
+      lk0=lnL[0*occurence+i];
+      lk1=lnL[1*occurence+i];
+      lk2=lnL[2*occurence+i];
 
-      /*! Shuffle the data and increment the support, if needed */
-      buff_tree = tree;
-      do
-        {
-          pi = (phydbl *)mCalloc(tree->data->crunch_len,sizeof(phydbl));
-          For(site,tree->n_pattern) pi[site] = tree->data->wght[site] / (phydbl)tree->data->init_len;
-
-          For(site, tree->data->init_len)
-            {
-              position = Sample_i_With_Proba_pi(pi,tree->n_pattern);
-              lk0+=tree->log_lks_aLRT[0][position];
-              lk1+=tree->log_lks_aLRT[1][position];
-              lk2+=tree->log_lks_aLRT[2][position];
-            }
-          if (lk0>=lk1 && lk0>=lk2) nb++;
-          tree = tree->next_mixt;
-          Free(pi);
-        }
-      while(tree);
-      tree = buff_tree;
+      /*! Increment the support, if needed */
+      if (lk0>=lk1 && lk0>=lk2) nb++;
     }
 
+  Free(lnL);
+
   res= nb/(phydbl)occurence;
 
   return res;
@@ -1124,7 +1444,7 @@ phydbl Statistics_to_RELL(t_tree *tree)
 phydbl Statistics_To_SH(t_tree *tree)
 {
   int i;
-  int occurence=1000;
+  int occurence=N_RELL_ALRT;
   phydbl nb=0.0;
   phydbl res;
   int site;
@@ -1134,11 +1454,10 @@ phydbl Statistics_To_SH(t_tree *tree)
   phydbl c0=0.0;
   phydbl c1=0.0;
   phydbl c2=0.0;
-  int position=-1;
   phydbl delta_local=-1.;
   phydbl delta=0.0;
   t_tree *buff_tree;
-  phydbl *pi;
+  phydbl *lnL;
 
 
   /*! Compute the total log-lk of each NNI position */
@@ -1191,38 +1510,17 @@ phydbl Statistics_To_SH(t_tree *tree)
         }
     }
 
+  /*! Log-likelihoods of each NNI position under the resampled data */
+  lnL = (phydbl *)mCalloc(3*occurence,sizeof(phydbl));
+  Rell_Lk(lnL,tree);
+
   /*! 1000 times */
   For(i,occurence)
     {
-      lk0=0.0;
-      lk1=0.0;
-      lk2=0.0;
-
-      buff_tree = tree;
-      do
-        {
-          pi = (phydbl *)mCalloc(tree->data->crunch_len,sizeof(phydbl));
-          For(site,tree->n_pattern) pi[site] = tree->data->wght[site] / (phydbl)tree->data->init_len;
-
-          /*! Shuffle the data */
-          For(site, tree->data->init_len)
-            {
-              position = Sample_i_With_Proba_pi(pi,tree->n_pattern);
-              lk0+=tree->log_lks_aLRT[0][position];
-              lk1+=tree->log_lks_aLRT[1][position];
-              lk2+=tree->log_lks_aLRT[2][position];
-            }
-
-          tree = tree->next_mixt;
-          Free(pi);
-        }
-      while(tree);
-      tree = buff_tree;
-
       /*! return to null hypothesis */
-      lk0=lk0-c0;
-      lk1=lk1-c1;
-      lk2=lk2-c2;
+      lk0=lnL[0*occurence+i]-c0;
+      lk1=lnL[1*occurence+i]-c1;
+      lk2=lnL[2*occurence+i]-c2;
 
       /*! compute results and increment if needed */
       delta_local=0.0;
@@ -1267,6 +1565,8 @@ phydbl Statistics_To_SH(t_tree *tree)
         }
     }
 
+  Free(lnL);
+
   res= nb/occurence;
 
   return res;
@@ -1275,6 +1575,177 @@ phydbl Statistics_To_SH(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Draw the RELL replicates used by Statistics_To_SH, once for all the
+   edges of the tree: every replicate is a sample with replacement of
+   the sites of the alignment of each tree in the chain, recorded as
+   numbers of occurrences of the site patterns. A count can not exceed
+   the number of sites, so that unsigned shorts are used unless the
+   alignment has more than USHRT_MAX sites */
+void Make_Rell_Cnt(t_tree *tree)
+{
+  int *site_num;
+  int b,i,j,k,n_site;
+
+  do
+    {
+      n_site = 0;
+      For(i,tree->n_pattern) n_site += (int)tree->data->wght[i];
+
+      if(n_site <= USHRT_MAX)
+        tree->rell_cnt_aLRT = (unsigned short *)mCalloc(tree->n_pattern*N_RELL_ALRT,sizeof(unsigned short));
+      else
+        tree->rell_cnt_aLRT_int = (int *)mCalloc(tree->n_pattern*N_RELL_ALRT,sizeof(int));
+
+      if(n_site > 0)
+        {
+          site_num = (int *)mCalloc(n_site,sizeof(int));
+
+          n_site = 0;
+          For(i,tree->n_pattern) For(j,(int)tree->data->wght[i]) site_num[n_site++] = i;
+
+          For(b,N_RELL_ALRT)
+            For(j,n_site)
+              {
+                k = site_num[Rand_Int(0,n_site-1)]*N_RELL_ALRT+b;
+                if(tree->rell_cnt_aLRT != NULL) tree->rell_cnt_aLRT[k]++;
+                else                            tree->rell_cnt_aLRT_int[k]++;
+              }
+
+          Free(site_num);
+        }
+
+      tree = tree->next_mixt;
+    }
+  while(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Amount of memory taken by the RELL replicates of the tree and of the
+   other trees in the chain (see Make_Rell_Cnt) */
+long int Rell_Cnt_Bytes(t_tree *tree)
+{
+  long int nbytes;
+  int i,n_site;
+
+  nbytes = 0;
+  do
+    {
+      n_site = 0;
+      For(i,tree->data->crunch_len) n_site += (int)tree->data->wght[i];
+
+      nbytes += (long int)tree->data->crunch_len * N_RELL_ALRT * ((n_site <= USHRT_MAX)?(sizeof(unsigned short)):(sizeof(int)));
+
+      tree = tree->next_mixt;
+    }
+  while(tree);
+
+  return nbytes;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Free_Rell_Cnt(t_tree *tree)
+{
+  do
+    {
+      if(tree->rell_cnt_aLRT != NULL) Free(tree->rell_cnt_aLRT);
+      if(tree->rell_cnt_aLRT_int != NULL) Free(tree->rell_cnt_aLRT_int);
+      tree->rell_cnt_aLRT = NULL;
+      tree->rell_cnt_aLRT_int = NULL;
+      tree = tree->next_mixt;
+    }
+  while(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Log-likelihoods of the three configurations around the latest
+   tested branch (tree->log_lks_aLRT) under each RELL replicate,
+   i.e., the product of the matrix of site pattern counts by these
+   site log-likelihoods. The replicates are drawn the first time
+   this function is called (see Make_Rell_Cnt) */
+void Rell_Lk(phydbl *lnL, t_tree *tree)
+{
+  t_rell_job job;
+
+  if(tree->rell_cnt_aLRT == NULL && tree->rell_cnt_aLRT_int == NULL) Make_Rell_Cnt(tree);
+
+  job.tree = tree;
+  job.lnL  = lnL;
+
+  THREAD_Run(Rell_Lk_Job,&job,N_RELL_ALRT/RELL_BLOCK,RELL_CHUNK);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* RELL log-likelihoods for the blocks of replicates beg to end-1. The
+   number of replicates in a block is fixed, so that the compiler can
+   turn the innermost loop into vector instructions */
+void Rell_Lk_Job(int beg, int end, int thread_id, void *arg)
+{
+  t_rell_job *job;
+  t_tree *tree;
+  phydbl *lnL0,*lnL1,*lnL2;
+  phydbl l0,l1,l2;
+  unsigned short *cnt;
+  int *cnt_int;
+  int blk,site,k;
+
+  job  = (t_rell_job *)arg;
+  tree = job->tree;
+  lnL0 = job->lnL + 0*N_RELL_ALRT;
+  lnL1 = job->lnL + 1*N_RELL_ALRT;
+  lnL2 = job->lnL + 2*N_RELL_ALRT;
+
+  for(blk=beg;blk<end;blk++)
+    For(k,RELL_BLOCK) lnL0[blk*RELL_BLOCK+k] = lnL1[blk*RELL_BLOCK+k] = lnL2[blk*RELL_BLOCK+k] = .0;
+
+  do
+    {
+      For(site,tree->n_pattern)
+        {
+          if(tree->data->wght[site] < SMALL) continue;
+
+          l0 = tree->log_lks_aLRT[0][site];
+          l1 = tree->log_lks_aLRT[1][site];
+          l2 = tree->log_lks_aLRT[2][site];
+
+          if(tree->rell_cnt_aLRT != NULL)
+            for(blk=beg;blk<end;blk++)
+              {
+                cnt = tree->rell_cnt_aLRT + site*N_RELL_ALRT + blk*RELL_BLOCK;
+                For(k,RELL_BLOCK)
+                  {
+                    lnL0[blk*RELL_BLOCK+k] += l0 * cnt[k];
+                    lnL1[blk*RELL_BLOCK+k] += l1 * cnt[k];
+                    lnL2[blk*RELL_BLOCK+k] += l2 * cnt[k];
+                  }
+              }
+          else
+            for(blk=beg;blk<end;blk++)
+              {
+                cnt_int = tree->rell_cnt_aLRT_int + site*N_RELL_ALRT + blk*RELL_BLOCK;
+                For(k,RELL_BLOCK)
+                  {
+                    lnL0[blk*RELL_BLOCK+k] += l0 * cnt_int[k];
+                    lnL1[blk*RELL_BLOCK+k] += l1 * cnt_int[k];
+                    lnL2[blk*RELL_BLOCK+k] += l2 * cnt_int[k];
+                  }
+              }
+        }
+      tree = tree->next_mixt;
+    }
+  while(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 /**
 * deprecated
 * Compute one side likelihood
@@ -21,16 +21,80 @@ the GNU public licence.  See http://www.opensource.org for details.
 #include "models.h"
 #include "free.h"
 #include "simu.h"
+#include "spr.h"
+#include "thread.h"
+
+/*! Number of internal edges per thread whose NNI neighbours are
+    evaluated before their supports are calculated (see NNI_Neigh_BL_Par) */
+#define NNI_NEIGH_BATCH      8
+/*! Largest number of rounds over the five edges around an internal edge */
+#define NNI_NEIGH_MAX_ROUNDS 100
+
+/*! Number of RELL replicates drawn for the SH-like supports (a multiple of RELL_BLOCK) */
+#define N_RELL_ALRT          1000
+/*! Number of RELL replicates processed together (see Rell_Lk_Job) */
+#define RELL_BLOCK           8
+/*! Number of blocks of replicates processed by a thread at once */
+#define RELL_CHUNK           16
+
+/*! Likelihoods of the three configurations around an internal edge
+    (see NNI_Neigh_BL_Local) */
+typedef struct __NNI_Neigh {
+  t_edge         *b_fcus;
+  phydbl           lk[3]; /*! initial configuration and the two NNIs, as lk0, lk1 and lk2 in NNI_Neigh_BL */
+  phydbl     *site_lk[3]; /*! log-likelihood of every site pattern (as in tree->log_lks_aLRT) */
+}t_nni_neigh;
+
+/*! Private buffers of a thread that evaluates NNI neighbours */
+typedef struct __NNI_Neigh_Buff {
+  phydbl            *plk; /*! partial likelihoods of the four subtrees around the edge */
+  phydbl              *w; /*! same, at the other end of the edges that lead to these subtrees */
+  phydbl              *u; /*! product of the partial likelihoods of the two subtrees on one side of the edge */
+  phydbl              *t; /*! u at the other end of the edge */
+  phydbl          *coeff;
+  phydbl            *Pij;
+  phydbl           *expt;
+  phydbl          *uexpt;
+  phydbl           *expl;
+  phydbl              *r;
+  phydbl           *left;
+  phydbl           *rght;
+  int             *scale;
+  int              *skip;
+}t_nni_neigh_buff;
+
+/*! Arguments passed to the threads that calculate RELL log-likelihoods */
+typedef struct __Rell_Job {
+  t_tree            *tree;
+  phydbl             *lnL; /*! lnL[k*N_RELL_ALRT+b]: log-likelihood of configuration k under the replicate b */
+}t_rell_job;
+
+/*! Arguments passed to the threads that evaluate NNI neighbours */
+typedef struct __NNI_Neigh_Job {
+  t_tree            *tree;
+  t_nni_neigh      *neigh;
+  t_nni_neigh_buff  *buff; /*! one per thread */
+}t_nni_neigh_job;
 
 
 void aLRT(t_tree *tree);
 int Check_NNI_Five_Branches(t_tree *tree);
 int Compute_Likelihood_Ratio_Test(t_edge *tested_edge, t_tree *tree);
 int NNI_Neigh_BL(t_edge *b_fcus, t_tree *tree);
+int NNI_Neigh_Result(t_edge *b_fcus, phydbl lk0, phydbl lk1, phydbl lk2, t_tree *tree);
+int NNI_Neigh_Par(t_tree *tree);
+void NNI_Neigh_BL_Par(t_tree *tree);
+void Optimize_NNI_Neighs(int beg, int end, int thread_id, void *arg);
+void NNI_Neigh_BL_Local(t_nni_neigh *neigh, t_nni_neigh_buff *buff, t_tree *tree);
 void Make_Target_Swap(t_tree *tree, t_edge *b_fcus, int swaptodo);
 phydbl Statistics_To_Probabilities(phydbl in);
 phydbl Statistics_To_RELL(t_tree *tree);
 phydbl Statistics_To_SH(t_tree *tree);
+void Make_Rell_Cnt(t_tree *tree);
+long int Rell_Cnt_Bytes(t_tree *tree);
+void Free_Rell_Cnt(t_tree *tree);
+void Rell_Lk(phydbl *lnL, t_tree *tree);
+void Rell_Lk_Job(int beg, int end, int thread_id, void *arg);
 phydbl Update_Lk_At_Given_Edge_Excluding(t_edge *b_fcus, t_tree *tree, t_node *exclude);
 
 #endif
@@ -126,6 +126,16 @@ int Read_Command_Line(option *io, int argc, char **argv)
       {"coord_file",          required_argument,NULL,77},
       {"json_trace",          no_argument,NULL,78},
       {"weights",             required_argument,NULL,79},
+      {"threads",             required_argument,NULL,80},
+      {"lk_kernel",           required_argument,NULL,81},
+      {"max_memory",          required_argument,NULL,83},
+      {"max-memory",          required_argument,NULL,83},
+      {"scratch_dir",         required_argument,NULL,85},
+      {"pars_starts",         required_argument,NULL,86},
+      {"time_budget",         required_argument,NULL,87},
+      {"time-budget",         required_argument,NULL,87},
+      {"ufboot",              required_argument,NULL,88},
+      {"topo_memo",           no_argument,NULL,89},
       {0,0,0,0}
     };
 
@@ -139,11 +149,125 @@ int Read_Command_Line(option *io, int argc, char **argv)
 
     do
     {     
-      c = getopt_long(argc,argv,"qi:d:m:b:n:t:f:zk:v:c:a:u:ho:s:x:g:l:ep",longopts,&idx);
+      c = getopt_long(argc,argv,"qi:d:m:b:n:t:f:zk:v:c:a:u:ho:s:x:g:l:epT:",longopts,&idx);
 
       switch(c)
 	{
 
+        case 89:
+          {
+            io->mod->s_opt->topo_memo = YES;
+            break;
+          }
+        case 88:
+          {
+            io->n_ufboot = (int)atoi(optarg);
+            if(io->n_ufboot < 1)
+              {
+                PhyML_Printf("\n== The number of RELL bootstrap replicates must be a positive integer.");
+                Exit("\n");
+              }
+            break;
+          }
+        case 87:
+          {
+            char *end;
+
+            io->time_budget = (phydbl)strtod(optarg,&end);
+
+            if(end == optarg || io->time_budget <= 0.0)
+              {
+                PhyML_Printf("\n== The time budget must be a positive number (e.g., 90s, 30m or 12h).");
+                Exit("\n");
+              }
+
+            /* Default unit is the second */
+            switch(*end)
+              {
+              case '\0' : case 's' : case 'S' : { break; }
+              case 'm' : case 'M' : { io->time_budget *= 60.; break; }
+              case 'h' : case 'H' : { io->time_budget *= 3600.; break; }
+              case 'd' : case 'D' : { io->time_budget *= 86400.; break; }
+              default :
+                {
+                  PhyML_Printf("\n== Unknown time unit in '%s' (valid units are s, m, h and d).",optarg);
+                  Exit("\n");
+                }
+              }
+            break;
+          }
+        case 86:
+          {
+            io->mod->s_opt->n_pars_starts = (int)atoi(optarg);
+            if(io->mod->s_opt->n_pars_starts < 1)
+              {
+                PhyML_Printf("\n== The number of stepwise addition trees must be a positive integer.");
+                Exit("\n");
+              }
+            break;
+          }
+        case 85:
+          {
+            if(strlen(optarg) > T_MAX_FILE-20)
+              {
+                PhyML_Printf("\n== Name of the scratch directory is too long.");
+                Exit("\n");
+              }
+            strcpy(io->scratch_dir,optarg);
+            break;
+          }
+        case 83:
+          {
+            char *end;
+
+            io->max_memory = (phydbl)strtod(optarg,&end);
+
+            if(end == optarg || io->max_memory <= 0.0)
+              {
+                PhyML_Printf("\n== The amount of memory must be a positive number (e.g., 512M or 8G).");
+                Exit("\n");
+              }
+
+            /* Default unit is the megabyte */
+            switch(*end)
+              {
+              case '\0' : case 'm' : case 'M' : { break; }
+              case 'k' : case 'K' : { io->max_memory /= 1024.; break; }
+              case 'g' : case 'G' : { io->max_memory *= 1024.; break; }
+              case 't' : case 'T' : { io->max_memory *= 1024.*1024.; break; }
+              default :
+                {
+                  PhyML_Printf("\n== Unknown memory unit in '%s' (valid units are K, M, G and T).",optarg);
+                  Exit("\n");
+                }
+              }
+            break;
+          }
+        case 81:
+          {
+            if(!strcmp(optarg,"auto"))         io->lk_kernel = LK_KERNEL_AUTO;
+            else if(!strcmp(optarg,"scalar"))  io->lk_kernel = LK_KERNEL_SCALAR;
+            else if(!strcmp(optarg,"sse3"))    io->lk_kernel = LK_KERNEL_SSE3;
+            else if(!strcmp(optarg,"avx"))     io->lk_kernel = LK_KERNEL_AVX;
+            else if(!strcmp(optarg,"avx512"))  io->lk_kernel = LK_KERNEL_AVX512;
+            else
+              {
+                PhyML_Printf("\n== Unknown likelihood kernel '%s'.",optarg);
+                PhyML_Printf("\n== Valid values are 'auto', 'scalar', 'sse3', 'avx' and 'avx512'.");
+                Exit("\n");
+              }
+            break;
+          }
+        case 'T': case 80:
+          {
+            io->n_threads = (int)atoi(optarg);
+            if(io->n_threads < 1)
+              {
+                PhyML_Printf("\n== The number of threads must be a positive integer.");
+                Exit("\n");
+              }
+            break;
+          }
         case 79:
           {
             io->has_io_weights = YES;
@@ -221,12 +345,20 @@ int Read_Command_Line(option *io, int argc, char **argv)
 
 #elif defined(PHYML)
            
+            /* The analysis is run from here, so main() does not get to
+               set up the thread pool and likelihood kernels. Options
+               given after --xml are not read */
+            THREAD_Init_Pool(io->n_threads);
+            Init_Lk_Kernel(io->lk_kernel);
+
             Free_Optimiz(io->mod->s_opt);
             M4_Free_M4_Model(io->mod->m4mod);
             Free_Model_Basic(io->mod);
             Free_Input(io);
             io = PhyML_XML(optarg);
             Free(io);
+
+            THREAD_Free_Pool();
             return 0;
 
 #elif defined(DATE)
@@ -1461,6 +1593,13 @@ int Read_Command_Line(option *io, int argc, char **argv)
     }
 
   
+  if(io->time_budget > 0.0)
+    {
+      strcpy(io->out_budget_file,io->in_align_file);
+      strcat(io->out_budget_file,"_phyml_best_tree.txt");
+      if(io->append_run_ID) { strcat(io->out_budget_file,"_"); strcat(io->out_budget_file,io->run_id_string); }
+    }
+
   if(io->mod->s_opt->random_input_tree)
     {
       strcpy(io->out_trees_file,io->in_align_file);
@@ -1469,6 +1608,20 @@ int Read_Command_Line(option *io, int argc, char **argv)
       io->fp_out_trees = Openfile(io->out_trees_file,1);
     }
   
+  if(io->n_ufboot > 0 && io->mod->bootstrap > 0)
+    {
+      PhyML_Printf("\n== Options --ufboot and -b (with a positive number of replicates) cannot be combined.");
+      Exit("\n");
+    }
+
+  if((io->print_boot_trees) && (io->n_ufboot > 0))
+    {
+      strcpy(io->out_boot_tree_file,io->in_align_file);
+      strcat(io->out_boot_tree_file,"_phyml_boot_trees.txt");
+      if(io->append_run_ID) { strcat(io->out_boot_tree_file,"_"); strcat(io->out_boot_tree_file,io->run_id_string); }
+      io->fp_out_boot_tree = Openfile(io->out_boot_tree_file,1);
+    }
+
   if((io->print_boot_trees) && (io->mod->bootstrap > 0))
     {
       strcpy(io->out_boot_tree_file,io->in_align_file);
@@ -181,6 +181,8 @@ void Free_Tree(t_tree *mixt_tree)
       if(tree->mutmap)  Free(tree->mutmap);
       Free_Bip(tree);
       Free(tree->curr_path);
+      /* Tree shares the pool of partial likelihoods of another one */
+      if(tree->lowmem != NULL && tree->lowmem->tree == tree) LOWMEM_Detach(tree);
       tree = tree->next;
     }
   while(tree);
@@ -219,6 +221,25 @@ void Free_Bip(t_tree *tree)
     }
     }
   tree->has_bip = NO;
+
+  Free_Bip_Bits(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Free_Bip_Bits(t_tree *tree)
+{
+  int i;
+
+  if(tree->bip_n_words == 0) return;
+
+  For(i,2*tree->n_otu-3)
+    {
+      Free(tree->a_edges[i]->bip_bits);
+      tree->a_edges[i]->bip_bits = NULL;
+    }
+  tree->bip_n_words = 0;
 }
 
 //////////////////////////////////////////////////////////////
@@ -321,6 +342,7 @@ void Free_Tree_Pars(t_tree *mixt_tree)
     {
       Free(tree->step_mat);
       Free(tree->site_pars);
+      Free(tree->pars_wght_bits);
 
       For(i,2*tree->n_otu-3) 
         {
@@ -351,6 +373,7 @@ void Free_Edge_Pars_Left(t_edge *b)
   if(b->pars_l)          Free(b->pars_l);
   if(b->ui_l)            Free(b->ui_l);
   if(b->p_pars_l)        Free(b->p_pars_l);
+  if(b->pars_bits_l)     Free(b->pars_bits_l);
   if(b->n_diff_states_l) Free(b->n_diff_states_l);
 }
 
@@ -362,6 +385,7 @@ void Free_Edge_Pars_Rght(t_edge *b)
   if(b->pars_r)   Free(b->pars_r);
   if(b->ui_r)     Free(b->ui_r);
   if(b->p_pars_r) Free(b->p_pars_r);
+  if(b->pars_bits_r) Free(b->pars_bits_r);
   if(b->n_diff_states_r) Free(b->n_diff_states_r);
 }
 
@@ -387,8 +411,13 @@ void Free_Tree_Lk(t_tree *mixt_tree)
     {
       Free(tree->c_lnL_sorted);
       Free(tree->cur_site_lk);
+#if defined(PLK_FLOAT)
+      Free(tree->plk_guard);
+#endif
       Free(tree->old_site_lk);
       Free(tree->site_lk_cat);
+      if(tree->site_lk_cat_thr != NULL)   Free(tree->site_lk_cat_thr);
+      if(tree->sum_scale_cat_thr != NULL) Free(tree->sum_scale_cat_thr);
       Free(tree->fact_sum_scale);
       Free(tree->eigen_lr_left);
       Free(tree->eigen_lr_rght);
@@ -402,6 +431,8 @@ void Free_Tree_Lk(t_tree *mixt_tree)
   
       if(tree->is_mixt_tree == NO)
         {
+          LOWMEM_Free(tree);
+          LOWMEM_Map_Free(tree);
           For(i,2*tree->n_otu-3) Free_Edge_Lk(tree->a_edges[i]);
           For(i,2*tree->n_otu-3) Free_Edge_Loc(tree->a_edges[i]);
           
@@ -409,6 +440,10 @@ void Free_Tree_Lk(t_tree *mixt_tree)
             {
               Free(tree->n_root->b[1]->Pij_rr);
               Free(tree->n_root->b[2]->Pij_rr);
+              Free(tree->n_root->b[1]->Pij_rr_old);
+              Free(tree->n_root->b[2]->Pij_rr_old);
+              Free(tree->n_root->b[1]->tip_lk);
+              Free(tree->n_root->b[2]->tip_lk);
               Free_Edge_Lk_Left(tree->n_root->b[1]);
               Free_Edge_Lk_Left(tree->n_root->b[2]);
               Free_Edge_Loc_Left(tree->n_root->b[1]);
@@ -446,11 +481,8 @@ void Free_Edge_Lk_Rght(t_edge *b)
 {
   Free(b->div_post_pred_rght);
 
-  if(b->p_lk_rght)
-    {
-      Free(b->p_lk_rght);
-      if(b->sum_scale_rght) Free(b->sum_scale_rght);
-    }
+  if(b->p_lk_rght)      Free(b->p_lk_rght);
+  if(b->sum_scale_rght) Free(b->sum_scale_rght);
 
   if(b->p_lk_tip_r)         Free(b->p_lk_tip_r);
   if(b->sum_scale_rght_cat) Free(b->sum_scale_rght_cat);
@@ -465,11 +497,8 @@ void Free_Edge_Lk_Left(t_edge *b)
 
   Free(b->div_post_pred_left);
 
-  if(b->p_lk_left)
-    {
-      Free(b->p_lk_left);
-      if(b->sum_scale_left) Free(b->sum_scale_left);
-    }
+  if(b->p_lk_left)      Free(b->p_lk_left);
+  if(b->sum_scale_left) Free(b->sum_scale_left);
 
   if(b->p_lk_tip_l)         Free(b->p_lk_tip_l);
   if(b->sum_scale_left_cat) Free(b->sum_scale_left_cat);
@@ -482,6 +511,8 @@ void Free_Edge_Lk_Left(t_edge *b)
 void Free_Edge_Lk(t_edge *b)
 {
   Free(b->Pij_rr);
+  Free(b->Pij_rr_old);
+  Free(b->tip_lk);
   Free_Edge_Lk_Left(b);
   Free_Edge_Lk_Rght(b);
 }
@@ -809,7 +840,7 @@ void Free_Model(t_mod *mod)
 
 void Free(void *p)
 {
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
   free(p);
 #else
@@ -854,6 +885,8 @@ void Free_Input(option *io)
       Free(io->nt_or_cd);
       Free(io->run_id_string);
       Free(io->clade_list_file);
+      Free(io->scratch_dir);
+      Free(io->out_budget_file);
       For(i,T_MAX_ALPHABET) Free(io->alphabet[i]);
       Free(io->alphabet);
       if(io->short_tax_names)
@@ -977,6 +1010,18 @@ void Free_Spr_List(t_tree *mixt_tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+void Free_Topo_Memo(t_topo_memo *memo)
+{
+  Free(memo->key);
+  Free(memo->lnL);
+  Free(memo->tax);
+  Free(memo->side);
+  Free(memo);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 void Free_Triplet(triplet *t)
 {
   int i,j,k;
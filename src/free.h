@@ -23,6 +23,7 @@ void Free_Mat(matrix *mat);
 void Free_Partial_Lk(phydbl *p_lk,int len,int n_catg);
 void Free_Tree(t_tree *tree);
 void Free_Bip(t_tree *tree);
+void Free_Bip_Bits(t_tree *tree);
 void Free_Edge_Labels(t_edge *b);
 void Free_Edge(t_edge *b);
 void Free_Node(t_node *n);
@@ -51,6 +52,7 @@ void Free_St(supert_tree *st);
 void Free_Eigen(eigen *eigen_struct);
 void Free_One_Spr(t_spr *this_spr);
 void Free_Spr_List(t_tree *tree);
+void Free_Topo_Memo(t_topo_memo *memo);
 void Free_Triplet(triplet *t);
 void Free_Actual_CSeq(calign *data);
 void Free_Prefix_Tree(pnode *n,int size);
@@ -198,14 +198,9 @@ int GEO_Simulate_Estimate(int argc, char **argv)
   
   Random_SPRs_On_Rooted_Tree(tree);
   
-  Free_Bip(ori_tree);
-  Alloc_Bip(ori_tree);  
-  Get_Bip(ori_tree->a_nodes[0],ori_tree->a_nodes[0]->v[0],ori_tree);
-  
-  Free_Bip(tree);
-  Alloc_Bip(tree);  
-  Get_Bip(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
   Match_Tip_Numbers(tree,ori_tree);
+  Get_Bip_Bits(ori_tree,NULL,ori_tree->n_otu);
+  Get_Bip_Bits(tree,NULL,tree->n_otu);
   
   rf = (phydbl)Compare_Bip(ori_tree,tree,NO)/(tree->n_otu-3);
   PhyML_Printf("\n. rf: %f",rf);
@@ -126,6 +126,13 @@ void Usage()
   PhyML_Printf("\t\t%sint%s = -4: SH-like branch supports alone.\n",LINE,FLAT);
   PhyML_Printf("\t\t%sint%s = -5: (default) approximate Bayes branch supports.\n",LINE,FLAT);
   PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--ufboot %sint%s\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%sint%s is the number of RELL bootstrap replicates. For each replicate, the most likely\n",LINE,FLAT);
+  PhyML_Printf("\t\t%sof the trees examined during the tree search is recorded, using site likelihoods\n",FLAT);
+  PhyML_Printf("\t\t%sreweighted according to the replicate. Branch supports are computed from these trees,\n",FLAT);
+  PhyML_Printf("\t\t%swithout searching trees on each replicate. Cannot be combined with -b.\n",FLAT);
+  PhyML_Printf("\n");
   #endif
 
 
@@ -257,6 +264,20 @@ void Usage()
   PhyML_Printf("\t\tnum%s is the number of initial random trees to be used.\n",FLAT);
   PhyML_Printf("\t\tIt is only valid if SPR searches are to be performed.\n");
   PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--pars_starts %snum%s (default=1)\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\tnum%s is the number of stepwise addition trees, with random orders of\n",FLAT);
+  PhyML_Printf("\t\taddition of the taxa, built for each parsimony starting tree. The most\n");
+  PhyML_Printf("\t\tparsimonious one is kept. These trees are built in parallel (see --threads).\n");
+  PhyML_Printf("\t\tIt is only valid if SPR searches are to be performed.\n");
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--topo_memo%s\n",BOLD,FLAT);
+  PhyML_Printf("\t\t%sThe SPR search does not examine again the topologies that it already found no\n",FLAT);
+  PhyML_Printf("\t\tbetter than the current one. Faster, but these topologies are compared on the score\n");
+  PhyML_Printf("\t\tof their regraft position before branch length optimisation, possibly obtained from\n");
+  PhyML_Printf("\t\tanother starting tree, so that the search may end on a different tree.\n");
+  PhyML_Printf("\n");
   #endif
 
   PhyML_Printf("%s\n\t--r_seed %snum%s\n",BOLD,LINE,FLAT);
@@ -288,13 +309,45 @@ void Usage()
   PhyML_Printf("\n");
 
 
+  #ifndef PHYTIME
+  PhyML_Printf("%s\n\t-T (or --threads) %snb_threads%s (default=1)\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%snb_threads%s is the number of threads used to compute partial and site likelihoods.\n",LINE,FLAT);
+  PhyML_Printf("\t\t%sSite patterns are split into chunks that are processed in parallel.\n",FLAT);
+  PhyML_Printf("\t\t%sThe log-likelihood does not depend on the number of threads.\n",FLAT);
+  PhyML_Printf("\t\t%sBootstrap replicates are also analysed in parallel, one per thread.\n",FLAT);
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--lk_kernel %skernel%s (default=auto)\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%skernel%s = auto, scalar, sse3, avx or avx512. Instruction set used in likelihood\n",LINE,FLAT);
+  PhyML_Printf("\t\t%scalculations. With 'auto', the fastest one supported by the processor is used.\n",FLAT);
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--max_memory %samount%s (e.g., 512M or 8G)\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%sMaximum amount of memory used to store partial likelihoods. When all of them do not fit,\n",FLAT);
+  PhyML_Printf("\t\t%sthe least recently used ones are discarded and recomputed when needed. Slower, but\n",FLAT);
+  PhyML_Printf("\t\t%smakes it possible to analyse very large data sets. Not available with mixture models.\n",FLAT);
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--scratch_dir %sdirectory%s\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%sStore partial likelihoods in a memory-mapped scratch file created in %sdirectory%s\n",FLAT,LINE,FLAT);
+  PhyML_Printf("\t\t%s(preferably on a fast local disk) instead of main memory. The file is removed on exit.\n",FLAT);
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--time_budget %sduration%s (e.g., 90s, 30m or 12h)\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%sWall-clock time allotted to the tree search. The time left is shared between SPR\n",FLAT);
+  PhyML_Printf("\t\t%sand NNI rounds, model and branch length optimisation, and convergence criteria are\n",FLAT);
+  PhyML_Printf("\t\t%srelaxed as the end of the budget gets near. The best tree found so far and its\n",FLAT);
+  PhyML_Printf("\t\t%slog-likelihood are kept up to date in file *_phyml_best_tree.txt.\n",FLAT);
+  PhyML_Printf("\n");
+  #endif
+
   PhyML_Printf("%s\n\t--no_memory_check%s\n",BOLD,FLAT);
   PhyML_Printf("\t\t%sNo interactive question for memory usage (for running in batch mode). Normal output otherwise.\n",FLAT);
   PhyML_Printf("\n");
 
   #ifndef PHYTIME
   PhyML_Printf("%s\n\t--alias_subpatt%s\n",BOLD,FLAT);
-  PhyML_Printf("\t\t%sSite aliasing is generalized at the subtree level. Sometimes lead to faster calculations.\n",FLAT);
+  PhyML_Printf("\t\t%sSite aliasing is generalized at the subtree level. Faster calculations on alignments with many similar or gappy sequences.\n",FLAT);
   PhyML_Printf("\t\t%sSee Kosakovsky Pond SL, Muse SV, Sytematic Biology (2004) for an example.\n",FLAT);
   PhyML_Printf("\n");
   #endif
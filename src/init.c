@@ -114,12 +114,14 @@ void Init_Tree(t_tree *tree, int n_otu)
   tree->geo                       = NULL;
   tree->xml_root                  = NULL;
   tree->ghost_tree                = NULL;
+  tree->topo_memo                 = NULL;
   tree->verbose                   = VL3;
 
   tree->is_mixt_tree              = NO;
   tree->tree_num                  = 0;
   tree->depth_curr_path           = 0;
   tree->has_bip                   = NO;
+  tree->bip_n_words               = 0;
   tree->n_moves                   = 0;
   tree->n_improvements            = 0;
   tree->bl_from_node_stamps       = 0;
@@ -148,10 +150,13 @@ void Init_Tree(t_tree *tree, int n_otu)
   tree->br_len_recorded           = NO;
   tree->max_spr_depth             = 0;
   tree->apply_lk_scaling          = YES;
+  tree->lowmem                    = NULL;
+  tree->plk_map                   = NULL;
   tree->dp                        = 0;
   tree->ignore_root               = YES;
   tree->annealing_temp            = 0.;
   tree->both_sides                = NO;
+  tree->incr_lk                   = NO;
   tree->json_num                  = 0;
   tree->update_eigen_lr           = NO;
   tree->use_eigen_lr              = NO;
@@ -172,6 +177,7 @@ void Init_Edge_Light(t_edge *b, int num)
 {
   b->num                  = num;
   b->bip_score            = 0;
+  b->bip_bits             = NULL;
   b->dist_btw_edges       = .0;
   b->topo_dist_btw_edges  = 0;
   b->has_zero_br_len      = NO;
@@ -192,6 +198,11 @@ void Init_Edge_Light(t_edge *b, int num)
   b->p_lk_loc_left        = NULL;
   b->p_lk_loc_rght        = NULL;
   b->Pij_rr               = NULL;
+  b->Pij_rr_old           = NULL;
+  b->tip_lk               = NULL;
+  b->update_tip_lk        = YES;
+  b->valid_left           = NO;
+  b->valid_rght           = NO;
   b->labels               = NULL;
 
   b->pars_l               = NULL;
@@ -200,6 +211,8 @@ void Init_Edge_Light(t_edge *b, int num)
   b->ui_r                 = NULL;
   b->p_pars_l             = NULL;
   b->p_pars_r             = NULL;
+  b->pars_bits_l          = NULL;
+  b->pars_bits_r          = NULL;
   b->n_diff_states_l      = NULL;
   b->n_diff_states_r      = NULL;
 
@@ -590,6 +603,13 @@ void Set_Defaults_Input(option* io)
   io->ancestral                  = NO;
   io->use_xml                    = NO;
   io->has_io_weights             = NO;
+  io->n_threads                  = 1;
+  io->lk_kernel                  = LK_KERNEL_AUTO;
+  io->max_memory                 = 0.0;
+  io->time_budget                = -1.0;
+  io->budget_best_lnL            = UNLIKELY;
+  io->n_ufboot                   = 0;
+  io->ufboot                     = NULL;
 #ifdef BEAGLE
   io->beagle_resource            = 0;
 #endif
@@ -706,6 +726,8 @@ void Set_Defaults_Optimiz(t_opt *s_opt)
   s_opt->topo_search          = NNI_MOVE;
   s_opt->random_input_tree    = 0;
   s_opt->n_rand_starts        = 5;
+  s_opt->n_pars_starts        = 1;
+  s_opt->topo_memo            = NO;
   s_opt->brent_it_max         = BRENT_IT_MAX;
   s_opt->steph_spr            = YES;
   s_opt->opt_br_len_mult      = NO;
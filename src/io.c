@@ -3153,7 +3153,10 @@ void Print_Settings(option *io)
 
   PhyML_Printf("\n                . Nb of bootstrapped data sets:\t\t\t %d", io->mod->bootstrap);
 
-  if (io->mod->bootstrap > 0)
+  if(io->n_ufboot > 0)
+    PhyML_Printf("\n                . Nb of RELL bootstrap replicates:\t\t %d", io->n_ufboot);
+
+  if (io->mod->bootstrap > 0 || io->n_ufboot > 0)
     PhyML_Printf("\n                . Compute approximate likelihood ratio test:\t no");
   else
     {
@@ -3270,20 +3273,17 @@ void Print_Settings(option *io)
   PhyML_Printf("\n                . Subtree patterns aliasing:\t\t\t %s",io->do_alias_subpatt?"yes":"no");
   PhyML_Printf("\n                . Version:\t\t\t\t\t %s", VERSION);
   PhyML_Printf("\n                . Byte alignment:\t\t\t\t %d",BYTE_ALIGN);
-  PhyML_Printf("\n                . AVX enabled:\t\t\t\t\t %s",
-#if defined(__AVX__)
-               "yes"
-#else
-               "no"
-#endif
-               );
-  PhyML_Printf("\n                . SSE3 enabled:\t\t\t\t\t %s",
-#if defined(__SSE3__)
-               "yes"
-#else
-               "no"
+  PhyML_Printf("\n                . Likelihood kernels:\t\t\t\t %s",Lk_Kernel_Name(Get_Lk_Kernel()));
+#if defined(PLK_FLOAT)
+  PhyML_Printf("\n                . Partial likelihoods storage:\t\t\t single precision");
 #endif
-               );
+  PhyML_Printf("\n                . Number of threads:\t\t\t\t %d",io->n_threads);
+  if(io->max_memory > 0.0)
+    PhyML_Printf("\n                . Memory for partial likelihoods:\t\t %g MB",io->max_memory);
+  if(strlen(io->scratch_dir) > 0)
+    PhyML_Printf("\n                . Scratch directory:\t\t\t\t %s",io->scratch_dir);
+  if(io->time_budget > 0.0)
+    PhyML_Printf("\n                . Time budget of the tree search:\t\t %g s",io->time_budget);
 
 
   PhyML_Printf("\n\n oooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooo\n");
@@ -3637,9 +3637,11 @@ void Print_Edge_Likelihoods(t_tree* tree, t_edge* b, bool scientific/*Print in s
 {
   int catg, site, j;
   char* fmt = scientific ? "[%d,%d,%d]%e ":"[%d,%d,%d]%f "; //rate category, site, state, likelihood
+
+  LOWMEM_Fetch_Edge(b,tree);
   
-  phydbl* lk_left = b->p_lk_left;
-  phydbl* lk_right = b->p_lk_rght;
+  phyplk* lk_left = b->p_lk_left;
+  phyplk* lk_right = b->p_lk_rght;
   
   fprintf(stdout,"\n");fflush(stdout);
   if(NULL!=lk_left)//not a tip?
@@ -3685,6 +3687,8 @@ void Print_Edge_Likelihoods(t_tree* tree, t_edge* b, bool scientific/*Print in s
                 fprintf(stdout,"[%d,%d]%d ",site,j,b->p_lk_tip_r[site*tree->mod->ns + j]);
         fflush(stdout);
     }
+
+  LOWMEM_Release_Edge(b,tree);
 }
 
 //////////////////////////////////////////////////////////////
@@ -4673,36 +4677,9 @@ option *PhyML_XML(char *xml_filename)
           Random_Tree(mixt_tree);
         }
   
-      MIXT_Connect_Cseqs_To_Nodes(mixt_tree);
       MIXT_Init_T_Beg(mixt_tree);
-      Prepare_Tree_For_Lk(mixt_tree);
-      MIXT_Chain_All(mixt_tree);
-      MIXT_Check_Edge_Lens_In_All_Elem(mixt_tree);
-      MIXT_Turn_Branches_OnOff_In_All_Elem(ON,mixt_tree);
-      MIXT_Check_Invar_Struct_In_Each_Partition_Elem(mixt_tree);
-      MIXT_Check_RAS_Struct_In_Each_Partition_Elem(mixt_tree);
-      Br_Len_Not_Involving_Invar(mixt_tree);
-      Unscale_Br_Len_Multiplier_Tree(mixt_tree);
-      Set_Both_Sides(YES,mixt_tree);
-      
-      if(mixt_tree->mod->s_opt->opt_topo)
-        {
-          if(mixt_tree->mod->s_opt->topo_search      == NNI_MOVE) Simu_Loop(mixt_tree);
-          else if(mixt_tree->mod->s_opt->topo_search == SPR_MOVE) Speed_Spr_Loop(mixt_tree);
-          else                                                    Best_Of_NNI_And_SPR(mixt_tree);
-        }
-      else
-        {
-          if(mixt_tree->mod->s_opt->opt_subst_param ||
-             mixt_tree->mod->s_opt->opt_bl)
-            {
-              Round_Optimize(mixt_tree,ROUND_MAX);
-            }
-          else
-            {
-              Lk(NULL,mixt_tree);
-            }
-        }
+      MIXT_Prepare_Search(mixt_tree);
+      MIXT_Search(mixt_tree);
 
 
       PhyML_Printf("\n\n. Log-likelihood = %f",mixt_tree->c_lnL);
@@ -4750,13 +4727,13 @@ option *PhyML_XML(char *xml_filename)
       Free_Tree_Lk(mixt_tree);
     }
 
+  /*! Bootstrap analysis */
+  most_likely_tree = MIXT_Bootstrap(most_likely_tree,mixt_tree);
+
   /*! Print the most likely tree in the output file */
   if(!mixt_tree->io->quiet) PhyML_Printf("\n\n. Printing the most likely tree in file '%s'...\n", Basename(mixt_tree->io->out_tree_file));
   PhyML_Fprintf(mixt_tree->io->fp_out_tree,"%s\n",most_likely_tree);
 
-  /*! Bootstrap analysis */
-  MIXT_Bootstrap(most_likely_tree,xml_root);
-
   while(io->prev != NULL) io = io->prev;
 
   Free(most_likely_tree);
@@ -20,7 +20,7 @@ the GNU public licence. See http://www.opensource.org for details.
 //////////////////////////////////////////////////////////////
 
 
-void Init_Tips_At_One_Site_Nucleotides_Float(char state, int pos, phydbl *p_lk)
+void Init_Tips_At_One_Site_Nucleotides_Float(char state, int pos, phyplk *p_lk)
 {
   switch(state)
     {
@@ -117,7 +117,7 @@ void Init_Tips_At_One_Site_Nucleotides_Int(char state, int pos, short int *p_par
 //////////////////////////////////////////////////////////////
 
 
-void Init_Tips_At_One_Site_AA_Float(char aa, int pos, phydbl *p_lk)
+void Init_Tips_At_One_Site_AA_Float(char aa, int pos, phyplk *p_lk)
 {
   int i;
 
@@ -207,7 +207,7 @@ void Init_Tips_At_One_Site_AA_Int(char aa, int pos, short int *p_pars)
 //////////////////////////////////////////////////////////////
 
 
-void Init_Tips_At_One_Site_Generic_Float(char *state, int ns, int state_len, int pos, phydbl *p_lk)
+void Init_Tips_At_One_Site_Generic_Float(char *state, int ns, int state_len, int pos, phyplk *p_lk)
 {
   int i;
   int state_int;
@@ -315,6 +315,7 @@ void Get_All_Partial_Lk_Scale(t_tree *tree, t_edge *b_fcus, t_node *a, t_node *d
 void Post_Order_Lk(t_node *a, t_node *d, t_tree *tree)
 {
   int i,dir;
+  t_node *next_a,*next_d;
 
   dir = -1;
   
@@ -327,12 +328,18 @@ void Post_Order_Lk(t_node *a, t_node *d, t_tree *tree)
           return;
         }
 
+      /* Out-of-core mode: update that follows the one of d */
+      LOWMEM_Map_Get_Next(&next_a,&next_d,tree);
+
       if(tree->n_root)
         {
           For(i,3)
             {
               if(d->v[i] != a && d->b[i] != tree->e_root)
-                Post_Order_Lk(d,d->v[i],tree);
+                {
+                  LOWMEM_Map_Next_Post(a,d,i,tree);
+                  Post_Order_Lk(d,d->v[i],tree);
+                }
               else dir = i;
             }
         }
@@ -341,7 +348,10 @@ void Post_Order_Lk(t_node *a, t_node *d, t_tree *tree)
           For(i,3)
             {
               if(d->v[i] != a)
-                Post_Order_Lk(d,d->v[i],tree);
+                {
+                  LOWMEM_Map_Next_Post(a,d,i,tree);
+                  Post_Order_Lk(d,d->v[i],tree);
+                }
               else dir = i;
             }
         }
@@ -361,6 +371,8 @@ void Post_Order_Lk(t_node *a, t_node *d, t_tree *tree)
         }
       assert(dir > -1);
 
+      LOWMEM_Map_Prefetch_Node(next_a,next_d,tree);
+
       if(tree->ignore_root == NO && d->b[dir] == tree->e_root)
         {
           if(d == tree->n_root->v[1]) Get_All_Partial_Lk_Scale(tree,tree->n_root->b[1],tree->n_root,d);
@@ -379,6 +391,7 @@ void Post_Order_Lk(t_node *a, t_node *d, t_tree *tree)
 void Pre_Order_Lk(t_node *a, t_node *d, t_tree *tree)
 {
   int i;
+  t_node *next_a,*next_d;
 
   if(d->tax) return;
   else
@@ -389,12 +402,16 @@ void Pre_Order_Lk(t_node *a, t_node *d, t_tree *tree)
           return;
         }
 
+      /* Out-of-core mode: update that follows the subtree of d */
+      LOWMEM_Map_Get_Next(&next_a,&next_d,tree);
+
       if(tree->n_root)
         {
           For(i,3)
             {
               if(d->v[i] != a && d->b[i] != tree->e_root)
                 {
+                  LOWMEM_Map_Next_Pre(a,d,i,next_a,next_d,tree);
                   Get_All_Partial_Lk_Scale(tree,d->b[i],d->v[i],d);
                   Pre_Order_Lk(d,d->v[i],tree);
                 }
@@ -406,6 +423,7 @@ void Pre_Order_Lk(t_node *a, t_node *d, t_tree *tree)
             {
               if(d->v[i] != a)
                 {
+                  LOWMEM_Map_Next_Pre(a,d,i,next_a,next_d,tree);
                   Get_All_Partial_Lk_Scale(tree,d->b[i],d->v[i],d);
                   Pre_Order_Lk(d,d->v[i],tree);
                 }
@@ -462,9 +480,23 @@ void Update_All_P_Lk(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Can Lk only recompute the partial likelihoods that are not up to
+   date? Rooted trees evaluated at the root node and mixture models
+   always go through a complete traversal */
+static int Use_Incr_Lk(t_tree *tree)
+{
+  if(tree->incr_lk == NO) return NO;
+  if(tree->is_mixt_tree == YES || tree->mixt_tree != NULL) return NO;
+  if(tree->n_root != NULL && tree->ignore_root == NO) return NO;
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 phydbl Lk(t_edge *b, t_tree *tree)
 {
-  int br,catg,state;
+  int br,catg,state,site;
   phydbl len,*expl;
 
   if(tree->eval_alnL == NO) return UNLIKELY;
@@ -510,6 +542,13 @@ if(tree->rates && tree->io->lk_approx == NORMAL)
 
   if(b == NULL) Set_Model_Parameters(tree->mod);
     
+#if defined(PLK_FLOAT)
+  /* All partial likelihoods are about to be recomputed: clear the flags
+     set by the single precision guard */
+  if(!b && tree->both_sides == YES && tree->mod->s_opt->skip_tree_traversal == NO && Use_Incr_Lk(tree) == NO)
+    For(site,tree->n_pattern) tree->plk_guard[site] = NO;
+#endif
+
   if(tree->mod->s_opt->skip_tree_traversal == NO)
     {
       if(!b)//Update PMat for all edges
@@ -526,7 +565,21 @@ if(tree->rates && tree->io->lk_approx == NORMAL)
           if(tree->use_eigen_lr == NO) Update_PMat_At_Given_Edge(b,tree);
         }
       
-      if(!b)
+      if(Use_Incr_Lk(tree) == YES)
+        {
+          /* Only recompute what is not up to date */
+          if(!b && tree->both_sides == YES) Update_All_Invalid_P_Lk(tree);
+          else
+            {
+              t_edge *e;
+
+              e = b;
+              if(!e) e = (tree->n_root != NULL)?(tree->e_root):(tree->a_nodes[0]->b[0]);
+              Update_Invalid_P_Lk(e,e->left,tree);
+              Update_Invalid_P_Lk(e,e->rght,tree);
+            }
+        }
+      else if(!b)
         {
           if(tree->n_root != NULL)
             {
@@ -585,6 +638,10 @@ if(tree->rates && tree->io->lk_approx == NORMAL)
   calc_edgelks_beagle(b, tree);
 #else
 
+  LOWMEM_Fetch_Edge(b,tree);
+  LOWMEM_Map_Prefetch(b,b->left,tree);
+  LOWMEM_Map_Prefetch(b,b->rght,tree);
+
   if(tree->update_eigen_lr == YES) Update_Eigen_Lr(b,tree);
  
   if(tree->use_eigen_lr == YES)
@@ -603,9 +660,79 @@ if(tree->rates && tree->io->lk_approx == NORMAL)
     }
 
 
-  int n_patterns,ambiguity_check;
-  n_patterns = tree->n_pattern;
-  For(tree->curr_site,n_patterns)
+  t_lk_job job;
+
+  Bind_Lk_Kernels(tree);
+  Lk_Thread_Scratch(tree);
+
+  job.tree = tree;
+  job.b    = b;
+  job.d    = NULL;
+  job.expl = expl;
+
+  THREAD_Run(Lk_Sites,&job,tree->n_pattern,THREAD_Site_Chunk(tree));
+
+  if(THREAD_N_Threads() > 1)
+    {
+      /* Sum over sites in the same order as in the single-threaded
+         case so that lnL does not depend on the number of threads */
+      For(site,tree->n_pattern)
+        if(tree->data->wght[site] > SMALL)
+          tree->c_lnL += tree->c_lnL_sorted[site];
+      tree->curr_site = tree->n_pattern;
+    }
+
+#if defined(PLK_FLOAT)
+  Lk_Guarded_Sites(b,tree);
+#endif
+
+  LOWMEM_Release_Edge(b,tree);
+#endif
+
+  if(tree->use_eigen_lr == YES) Free(expl);
+
+  return tree->c_lnL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+#ifndef BEAGLE
+/* Log-likelihood at sites site_beg to site_end-1 (see Lk). When
+   several threads are used, Lk_Core works on private copies of the
+   tree and edge structures so that the per-site scratch (curr_site,
+   site_lk_cat, sum_scale_*_cat) is not shared between threads. Site
+   likelihoods are stored in tree->c_lnL_sorted and summed up by the
+   caller. The private scratch arrays are slices of
+   tree->site_lk_cat_thr and tree->sum_scale_cat_thr (see
+   Lk_Thread_Scratch). */
+void Lk_Sites(int site_beg, int site_end, int thread_id, void *arg)
+{
+  t_lk_job *job;
+  t_tree *tree,tree_loc;
+  t_edge *b,b_loc;
+  int state,ambiguity_check,n_catg;
+
+  job  = (t_lk_job *)arg;
+  tree = job->tree;
+  b    = job->b;
+
+  if(THREAD_N_Threads() > 1)
+    {
+      n_catg = MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes);
+
+      tree_loc = *tree;
+      b_loc    = *b;
+
+      tree_loc.site_lk_cat     = tree->site_lk_cat_thr + thread_id*n_catg;
+      b_loc.sum_scale_left_cat = tree->sum_scale_cat_thr + 2*thread_id*n_catg;
+      b_loc.sum_scale_rght_cat = tree->sum_scale_cat_thr + (2*thread_id+1)*n_catg;
+
+      tree = &tree_loc;
+      b    = &b_loc;
+    }
+
+  for(tree->curr_site=site_beg;tree->curr_site<site_end;tree->curr_site++)
     {
       ambiguity_check = -1;
       state           = -1;
@@ -623,21 +750,200 @@ if(tree->rates && tree->io->lk_approx == NORMAL)
 
           if(tree->mod->use_m4mod) ambiguity_check = YES;
           
-#if (defined(__AVX__))
-          AVX_Lk_Core(state,ambiguity_check,b,tree);
-#elif (defined(__SSE3__))
-          SSE_Lk_Core(state,ambiguity_check,b,tree);
-#else
-          Lk_Core(state,ambiguity_check,YES,b,expl,tree);
-#endif
+          if(tree->lk_core != NULL) tree->lk_core(state,ambiguity_check,b,tree);
+          else                      Lk_Core(state,ambiguity_check,YES,b,job->expl,tree);
         }
     }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Allocate the per-thread copies of the per-site scratch arrays
+   used by Lk_Sites. They are (re)allocated when the pool has more
+   threads than they were made for, i.e., only once per tree in
+   practice. Must be called before THREAD_Run. */
+void Lk_Thread_Scratch(t_tree *tree)
+{
+  int n_catg,n_threads;
+
+  n_threads = THREAD_N_Threads();
+  if(n_threads < 2 || tree->n_thr_scratch >= n_threads) return;
+
+  n_catg = MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes);
+
+  if(tree->site_lk_cat_thr != NULL)   Free(tree->site_lk_cat_thr);
+  if(tree->sum_scale_cat_thr != NULL) Free(tree->sum_scale_cat_thr);
+
+  tree->site_lk_cat_thr   = (phydbl *)mCalloc(n_threads*n_catg,sizeof(phydbl));
+  tree->sum_scale_cat_thr = (int *)mCalloc(2*n_threads*n_catg,sizeof(int));
+  tree->n_thr_scratch     = n_threads;
+}
 #endif
 
-  if(tree->use_eigen_lr == YES) Free(expl);
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
-  return tree->c_lnL;
+#if defined(PLK_FLOAT)
+/* Partial likelihoods at site 'site' of the subtree rooted at d and
+   looking away from a (b is the edge between a and d), computed in
+   double precision from the tip vectors. plk has n_catg*ns elements.
+   Each rate class is rescaled on the way up so that the true partial
+   likelihoods are plk[catg*ns+i] * 2^-scale[catg] */
+void Site_P_Lk_Double(t_node *a, t_node *d, t_edge *b, int site, phydbl *plk, int *scale, t_tree *tree)
+{
+  int i,j,k,catg,ns,n_catg,exponent;
+  phydbl *plk_v,*Pij,sum,largest;
+  int *scale_v;
+
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+
+  if(d->tax == YES)
+    {
+      For(catg,n_catg)
+        {
+          For(j,ns) plk[catg*ns+j] = (phydbl)d->b[0]->p_lk_tip_r[site*ns+j];
+          scale[catg] = 0;
+        }
+      return;
+    }
+
+  plk_v   = (phydbl *)mCalloc(n_catg*ns,sizeof(phydbl));
+  scale_v = (int *)mCalloc(n_catg,sizeof(int));
+
+  For(j,n_catg*ns) plk[j]   = 1.0;
+  For(catg,n_catg) scale[catg] = 0;
+
+  For(i,3)
+    {
+      if(d->v[i] == a || d->v[i] == NULL) continue;
+
+      Site_P_Lk_Double(d,d->v[i],d->b[i],site,plk_v,scale_v,tree);
+
+      For(catg,n_catg)
+        {
+          Pij = d->b[i]->Pij_rr + catg*ns*ns;
+          For(j,ns)
+            {
+              sum = .0;
+              For(k,ns) sum += Pij[j*ns+k] * plk_v[catg*ns+k];
+              plk[catg*ns+j] *= sum;
+            }
+          scale[catg] += scale_v[catg];
+        }
+    }
+
+  /* Bring the largest partial likelihood of each class in [0.5,1) */
+  For(catg,n_catg)
+    {
+      largest = .0;
+      For(j,ns) largest = MAX(largest,plk[catg*ns+j]);
+      if(largest > .0)
+        {
+          frexp(largest,&exponent);
+          For(j,ns) plk[catg*ns+j] = ldexp(plk[catg*ns+j],-exponent);
+          scale[catg] -= exponent;
+        }
+    }
+
+  Free(plk_v);
+  Free(scale_v);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Log-likelihood at site 'site', computed on edge b in double precision
+   without using the stored (single precision) partial likelihoods */
+phydbl Lk_Site_Double(t_edge *b, int site, t_tree *tree)
+{
+  int i,j,catg,ns,n_catg,min_scale;
+  phydbl *plk_l,*plk_r,*lk_cat,*Pij,*pi,sum,site_lk,log_site_lk,log_inv_lk,pinv;
+  int *scale_l,*scale_r;
+
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  pi     = tree->mod->e_frq->pi->v;
+
+  plk_l   = (phydbl *)mCalloc(n_catg*ns,sizeof(phydbl));
+  plk_r   = (phydbl *)mCalloc(n_catg*ns,sizeof(phydbl));
+  lk_cat  = (phydbl *)mCalloc(n_catg,sizeof(phydbl));
+  scale_l = (int *)mCalloc(n_catg,sizeof(int));
+  scale_r = (int *)mCalloc(n_catg,sizeof(int));
+
+  Site_P_Lk_Double(b->rght,b->left,b,site,plk_l,scale_l,tree);
+  Site_P_Lk_Double(b->left,b->rght,b,site,plk_r,scale_r,tree);
+
+  min_scale = INT_MAX;
+  For(catg,n_catg)
+    {
+      Pij = b->Pij_rr + catg*ns*ns;
+      lk_cat[catg] = .0;
+      For(i,ns)
+        {
+          sum = .0;
+          For(j,ns) sum += Pij[i*ns+j] * plk_r[catg*ns+j];
+          lk_cat[catg] += pi[i] * plk_l[catg*ns+i] * sum;
+        }
+      scale_l[catg] += scale_r[catg];
+      min_scale = MIN(min_scale,scale_l[catg]);
+    }
+
+  site_lk = .0;
+  For(catg,n_catg)
+    site_lk += tree->mod->ras->gamma_r_proba->v[catg] * ldexp(lk_cat[catg],-(scale_l[catg]-min_scale));
+
+  log_site_lk = LOG(site_lk) - (phydbl)LOG2 * min_scale;
+
+  if(tree->mod->ras->invar == YES)
+    {
+      pinv = tree->mod->ras->pinvar->v;
+      log_site_lk += LOG(1.-pinv);
+      if(tree->data->invar[site] > -0.5)
+        {
+          log_inv_lk = LOG(pinv * pi[tree->data->invar[site]]);
+          log_site_lk = MAX(log_site_lk,log_inv_lk) + LOG(1.+EXP(MIN(log_site_lk,log_inv_lk)-MAX(log_site_lk,log_inv_lk)));
+        }
+    }
+
+  Free(plk_l);
+  Free(plk_r);
+  Free(lk_cat);
+  Free(scale_l);
+  Free(scale_r);
+
+  return log_site_lk;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Replace the log-likelihood at sites flagged by the single precision
+   guard (see P_Lk_Scaler_Pow) with its value computed in double
+   precision. Not available for mixtures, Markov-modulated models,
+   greedy mode and rooted trees evaluated with the root */
+void Lk_Guarded_Sites(t_edge *b, t_tree *tree)
+{
+  int site;
+  phydbl log_site_lk;
+
+  if(tree->mixt_tree != NULL || tree->mod->use_m4mod == YES || tree->mod->s_opt->greedy == YES) return;
+  if(tree->n_root != NULL && tree->ignore_root == NO) return;
+
+  For(site,tree->n_pattern)
+    {
+      if(tree->plk_guard[site] == NO || tree->data->wght[site] < SMALL) continue;
+
+      log_site_lk = Lk_Site_Double(b,site,tree);
+
+      tree->c_lnL -= tree->c_lnL_sorted[site];
+      tree->c_lnL_sorted[site] = tree->data->wght[site]*log_site_lk;
+      tree->c_lnL += tree->c_lnL_sorted[site];
+      tree->cur_site_lk[site] = EXP(log_site_lk);
+    }
 }
+#endif
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
@@ -666,6 +972,10 @@ phydbl dLk(phydbl *l, t_edge *b, t_tree *tree)
       return MIXT_dLk(l,b,tree);
     }
     
+  LOWMEM_Fetch_Edge(b,tree);
+  LOWMEM_Map_Prefetch(b,b->left,tree);
+  LOWMEM_Map_Prefetch(b,b->rght,tree);
+
   if(tree->update_eigen_lr == YES) Update_Eigen_Lr(b,tree);
   
   expl   = (phydbl *)mCalloc(tree->mod->ras->n_catg*tree->mod->ns,sizeof(phydbl));
@@ -785,14 +1095,10 @@ phydbl dLk(phydbl *l, t_edge *b, t_tree *tree)
             For(catg,tree->mod->ras->n_catg)
               {
                 tree->use_eigen_lr = YES;
-                site_lk_cat = Lk_Core_One_Class(tree->eigen_lr_left + site*dim1 + catg*dim2,
-                                                tree->eigen_lr_rght + site*dim1 + catg*dim2,
-                                                NULL,
-                                                NULL,
-                                                expl + catg*ns,
-                                                ns,
-                                                -1,-1,
-                                                b,tree);
+                site_lk_cat = Lk_Core_Eigen_Lr(tree->eigen_lr_left + site*dim1 + catg*dim2,
+                                               tree->eigen_lr_rght + site*dim1 + catg*dim2,
+                                               expl + catg*ns,
+                                               ns);
                 PhyML_Printf("\n== site_lk_cat: %G",site_lk_cat);
 
                 tree->use_eigen_lr = NO;
@@ -800,7 +1106,6 @@ phydbl dLk(phydbl *l, t_edge *b, t_tree *tree)
                                                 b->p_lk_rght + (site*dim1) + (catg*dim2),
                                                 b->Pij_rr + (catg*dim3),
                                                 b->p_lk_tip_r + site*dim2,
-                                                NULL,
                                                 ns,YES,-1,
                                                 b,tree);
 
@@ -835,6 +1140,7 @@ phydbl dLk(phydbl *l, t_edge *b, t_tree *tree)
   tree->c_d2lnL = d2lnlk;
   tree->c_lnL   = c_lnL;
 
+  LOWMEM_Release_Edge(b,tree);
 
   Free(expl);
   Free(expld);
@@ -893,14 +1199,10 @@ phydbl Lk_Core(int state, int ambiguity_check, short int returnlog, t_edge *b, p
           if(tree->use_eigen_lr == YES)
             {
 
-              site_lk_cat = Lk_Core_One_Class(tree->eigen_lr_left + site*dim1 + catg*dim2,
-                                              tree->eigen_lr_rght + site*dim1 + catg*dim2,
-                                              NULL,
-                                              NULL,
-                                              expl + catg*dim2,
-                                              ns,
-                                              -1,-1,
-                                              b,tree);
+              site_lk_cat = Lk_Core_Eigen_Lr(tree->eigen_lr_left + site*dim1 + catg*dim2,
+                                             tree->eigen_lr_rght + site*dim1 + catg*dim2,
+                                             expl + catg*dim2,
+                                             ns);
 
               /* if(Global_myRank == 0 && site_lk_cat < 1.E-50 && site_lk_cat > -1.E-50) printf("\n. ??????? %G [%G %G %G %G] [%G %G %G %G] [%G %G %G %G]", */
               /*                                                                                site_lk_cat, */
@@ -923,7 +1225,6 @@ phydbl Lk_Core(int state, int ambiguity_check, short int returnlog, t_edge *b, p
                                               b->p_lk_rght + (site*dim1) + (catg*dim2),
                                               b->Pij_rr + (catg*dim3),
                                               b->p_lk_tip_r + site*dim2,
-                                              NULL,
                                               ns,ambiguity_check,state,
                                               b,tree);
             }
@@ -1193,10 +1494,36 @@ void Rate_Correction(int exponent, phydbl *site_lk_cat)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
  
-phydbl Lk_Core_One_Class(phydbl *p_lk_left, phydbl *p_lk_rght, 
+/* Likelihood of one class at one site when tree->use_eigen_lr == YES,
+   i.e., using the products of the left and right matrices of eigenvectors
+   by the partial likelihood vectors on both sides of the edge (see
+   Update_Eigen_Lr). These products are always kept in double precision */
+phydbl Lk_Core_Eigen_Lr(phydbl *eigen_lr_left, phydbl *eigen_lr_rght, phydbl *expl, int ns)
+{
+  phydbl lk;
+  int l;
+
+#ifdef SAFEMODE
+  assert(expl);
+#endif
+
+  lk = 0.0;
+  For(l,ns) // Likelihood calculation in O(ns) complexity instead of O(ns^2)! 
+    {
+      lk += 
+        eigen_lr_left[l] *
+        eigen_lr_rght[l] *
+        expl[l];
+    }
+  return lk;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+ 
+phydbl Lk_Core_One_Class(phyplk *p_lk_left, phyplk *p_lk_rght, 
                          phydbl *Pij,
                          short int *p_lk_tip_r,
-                         phydbl *expl, 
                          int ns, int ambiguity_check, int state,
                          t_edge *b, t_tree *tree)
 {
@@ -1208,65 +1535,45 @@ phydbl Lk_Core_One_Class(phydbl *p_lk_left, phydbl *p_lk_rght,
 #endif
 
   lk = 0.0;
-       
-  if(tree->use_eigen_lr == YES)
+
+  /* b is an external edge */
+  if((b->rght->tax == YES) && (tree->mod->s_opt->greedy == NO)) /* By convention, tips are always on the right of an external edge */
     {
-#ifdef SAFEMODE
-      assert(expl);
-#endif
-      
-      lk = 0.0;
-      For(l,ns) // Likelihood calculation in O(ns) complexity instead of O(ns^2)! 
+      if(ambiguity_check == NO)/* If the character observed at the tip is NOT ambiguous: ns x 1 terms to consider */
+        {
+          sum = .0;
+          For(l,ns) sum += Pij[state*ns+l] * p_lk_left[l];               
+          lk += sum * tree->mod->e_frq->pi->v[state];
+        }
+      else /* If the character observed at the tip is ambiguous: ns x ns terms to consider */
         {
-          lk += 
-            p_lk_left[l] *
-            p_lk_rght[l] *
-            expl[l];
+          For(k,ns)
+            {
+              if(p_lk_tip_r[k] > .0) /* Only bother ascending into the subtrees if the likelihood of state k, at site "site*dim2" is > 0 */
+                {
+                  sum = .0;
+                  For(l,ns) sum += Pij[k*ns+l] * p_lk_left[l];                       
+                  lk += sum * tree->mod->e_frq->pi->v[k] * p_lk_tip_r[k];
+                }
+            }
         }
-      return lk;
     }
-   else // tree->use_eigen_lr == NO
-     {
-       /* b is an external edge */
-       if((b->rght->tax == YES) && (tree->mod->s_opt->greedy == NO)) /* By convention, tips are always on the right of an external edge */
-         {
-           if(ambiguity_check == NO)/* If the character observed at the tip is NOT ambiguous: ns x 1 terms to consider */
-             {
-               sum = .0;
-               For(l,ns) sum += Pij[state*ns+l] * p_lk_left[l];               
-               lk += sum * tree->mod->e_frq->pi->v[state];
-             }
-           else /* If the character observed at the tip is ambiguous: ns x ns terms to consider */
-             {
-               For(k,ns)
-                 {
-                   if(p_lk_tip_r[k] > .0) /* Only bother ascending into the subtrees if the likelihood of state k, at site "site*dim2" is > 0 */
-                     {
-                       sum = .0;
-                       For(l,ns) sum += Pij[k*ns+l] * p_lk_left[l];                       
-                       lk += sum * tree->mod->e_frq->pi->v[k] * p_lk_tip_r[k];
-                     }
-                 }
-             }
-         }
-       else /* b is an internal edge: ns x ns terms to consider */
-         {
+  else /* b is an internal edge: ns x ns terms to consider */
+    {
 #ifdef SAFEMODE
-           assert(p_lk_rght);
+      assert(p_lk_rght);
 #endif
-           For(k,ns)
-             {
-               if(p_lk_rght[k] > .0) // Only bother descending into the subtrees if the likelihood of state k is > 0
-                 {
-                   sum = .0;
-                   For(l,ns) sum += Pij[k*ns+l] * p_lk_left[l];                   
-                   lk += sum * tree->mod->e_frq->pi->v[k] * p_lk_rght[k];
-                 }
-             }
-         }
-       return lk;
-     }
-   return INFINITY;
+      For(k,ns)
+        {
+          if(p_lk_rght[k] > .0) // Only bother descending into the subtrees if the likelihood of state k is > 0
+            {
+              sum = .0;
+              For(l,ns) sum += Pij[k*ns+l] * p_lk_left[l];                   
+              lk += sum * tree->mod->e_frq->pi->v[k] * p_lk_rght[k];
+            }
+        }
+    }
+  return lk;
 }
  
 //////////////////////////////////////////////////////////////
@@ -1329,6 +1636,86 @@ phydbl Invariant_Lk(int fact_sum_scale, int site, int *num_prec_issue, t_tree *t
    node d lies.
 */
 
+/* Kernels used in likelihood calculations, as selected by Init_Lk_Kernel */
+static int LK_kernel = LK_KERNEL_AUTO;
+
+#if defined(CPU_DISPATCH)
+#define LK_CPU_SUPPORTS(isa) (__builtin_cpu_supports(isa)?YES:NO)
+#else
+#define LK_CPU_SUPPORTS(isa) YES
+#endif
+
+/* Select the family of kernels used in likelihood calculations. With
+   LK_KERNEL_AUTO, the fastest family supported by both the binary and
+   the CPU is chosen */
+void Init_Lk_Kernel(int kernel)
+{
+  if(kernel == LK_KERNEL_AUTO)
+    {
+      kernel = LK_KERNEL_AVX512;
+      while(kernel > LK_KERNEL_SCALAR && Lk_Kernel_Supported(kernel) == NO) kernel--;
+    }
+  else if(Lk_Kernel_Supported(kernel) == NO)
+    {
+      PhyML_Printf("\n== %s likelihood kernels are not available on this computer",Lk_Kernel_Name(kernel));
+      PhyML_Printf("\n== (or were not compiled in this binary).");
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  LK_kernel = kernel;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+int Get_Lk_Kernel()
+{
+  if(LK_kernel == LK_KERNEL_AUTO) Init_Lk_Kernel(LK_KERNEL_AUTO);
+  return LK_kernel;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* YES if the kernels in family 'kernel' were compiled in and can run
+   on this CPU */
+int Lk_Kernel_Supported(int kernel)
+{
+  switch(kernel)
+    {
+    case LK_KERNEL_SCALAR : return YES;
+#if defined(SSE_KERNELS)
+    case LK_KERNEL_SSE3   : return LK_CPU_SUPPORTS("sse3");
+#endif
+#if defined(AVX_KERNELS)
+    case LK_KERNEL_AVX    : return LK_CPU_SUPPORTS("avx");
+#endif
+#if defined(AVX512_KERNELS)
+    case LK_KERNEL_AVX512 : return LK_CPU_SUPPORTS("avx512f");
+#endif
+    default : return NO;
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+char *Lk_Kernel_Name(int kernel)
+{
+  switch(kernel)
+    {
+    case LK_KERNEL_SCALAR : return "scalar";
+    case LK_KERNEL_SSE3   : return "SSE3";
+    case LK_KERNEL_AVX    : return "AVX";
+    case LK_KERNEL_AVX512 : return "AVX-512";
+    default : return "auto";
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 void Update_P_Lk(t_tree *tree, t_edge *b, t_node *d)
 {
   if(tree->eval_alnL == NO) return;
@@ -1341,8 +1728,9 @@ void Update_P_Lk(t_tree *tree, t_edge *b, t_node *d)
   
   assert(tree->is_mixt_tree == NO);
 
-  if((tree->io->do_alias_subpatt == YES) &&
-     (tree->update_alias_subpatt == YES))
+  /* Distinct subtree patterns are cheap to find, so they are kept up
+     to date at every update, not only when update_alias_subpatt is set */
+  if(tree->io->do_alias_subpatt == YES)
     Alias_One_Subpatt((d==b->left)?(b->rght):(b->left),d,tree);
 
   if(d->tax) return;
@@ -1351,38 +1739,40 @@ void Update_P_Lk(t_tree *tree, t_edge *b, t_node *d)
 #ifdef BEAGLE
   update_beagle_partials(tree, b, d);
 #else
-  if(tree->mod->use_m4mod == NO)
-    {
-      if(tree->io->datatype == NT)
-        {
-#if (defined(__AVX__))
-          AVX_Update_P_Lk_Nucl(tree,b,d);
-#elif (defined(__SSE3__))
-          SSE_Update_P_Lk_Nucl(tree,b,d);
-#else
-          Update_P_Lk_Nucl(tree,b,d);
-#endif
-        }
-      else if(tree->io->datatype == AA)
-        {
-#if (defined(__AVX__))
-          AVX_Update_P_Lk_AA(tree,b,d);
-#elif (defined(__SSE3__))
-          SSE_Update_P_Lk_AA(tree,b,d);
-#else
-          Update_P_Lk_AA(tree,b,d);
+  t_lk_job job;
+
+  job.tree = tree;
+  job.b    = b;
+  job.d    = d;
+  job.expl = NULL;
+
+  Bind_Lk_Kernels(tree);
+  job.update_p_lk = tree->update_p_lk;
+
+  LOWMEM_Prepare_Update(b,d,tree);
+  LOWMEM_Map_Prefetch_Update(b,d,tree);
+
+  Update_Tip_Lk_Around(d,tree);
+
+  THREAD_Run(Update_P_Lk_Sites,&job,tree->n_pattern,THREAD_Site_Chunk(tree));
+
+  if(tree->io->do_alias_subpatt == YES)
+    THREAD_Run(Scatter_P_Lk_Repeats,&job,tree->n_pattern,THREAD_Site_Chunk(tree));
+
+  LOWMEM_Release_Update(b,d,tree);
 #endif
-        }
-      else
-        {
-          Update_P_Lk_Generic(tree,b,d);
-        }
-    }
-  else
+
+  /* Up to date only if computed from up to date partial likelihoods */
+  if(b->num < 2*tree->n_otu-3 && d != tree->n_root)
     {
-      Update_P_Lk_Generic(tree,b,d);
+      int i,valid;
+
+      valid = YES;
+      For(i,3) if(d->b[i] != b && P_Lk_Is_Valid(d->b[i],d->v[i]) == NO) valid = NO;
+
+      if(d == b->left) b->valid_left = valid;
+      else             b->valid_rght = valid;
     }
-#endif
 //  Print_Edge_Likelihoods(tree, b, false);
 }
 
@@ -1390,33 +1780,138 @@ void Update_P_Lk(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 
 #ifndef BEAGLE
-void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
+/* Update partial likelihoods at sites site_beg to site_end-1. Sites
+   processed by different threads never overlap, so the partial
+   likelihoods and scaling factors do not need to be merged. */
+void Update_P_Lk_Sites(int site_beg, int site_end, int thread_id, void *arg)
 {
-/*
-           |
-           |<- b
-           |
-           d
-          / \
-         /   \
-        /     \
-    n_v1   n_v2
-*/
-  t_node *n_v1, *n_v2;
-  phydbl p1_lk1,p2_lk2;
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;
-  phydbl *Pij1,*Pij2;
-  int *sum_scale, *sum_scale_v1, *sum_scale_v2;
-  int sum_scale_v1_val, sum_scale_v2_val;
-  int i,j;
-  int catg,site;
-  int n_patterns;
+  t_lk_job *job;
+
+  job = (t_lk_job *)arg;
+
+  job->update_p_lk(job->tree,job->b,job->d,site_beg,site_end);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Kernels only process the first site of each distinct subtree
+   pattern (see Alias_One_Subpatt). Once they are all done, copy their
+   partial likelihoods and scaling factors to the other sites with the
+   same subtree pattern */
+void Scatter_P_Lk_Repeats(int site_beg, int site_end, int thread_id, void *arg)
+{
+  t_lk_job *job;
+  t_node *n_v1,*n_v2;
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;
+  phydbl *Pij1,*Pij2;
+  int *sum_scale,*sum_scale_v1,*sum_scale_v2;
+  int *p_lk_loc;
+  int site;
+
+  job = (t_lk_job *)arg;
+
+  Set_All_P_Lk(&n_v1,&n_v2,
+               &p_lk,&sum_scale,&p_lk_loc,
+               &Pij1,&p_lk_v1,&sum_scale_v1,
+               &Pij2,&p_lk_v2,&sum_scale_v2,
+               job->d,job->b,job->tree);
+
+  for(site=site_beg;site<site_end;site++)
+    {
+      if(p_lk_loc[site] < site)
+        {
+          Copy_P_Lk(p_lk,p_lk_loc[site],site,job->tree);
+          Copy_Scale(sum_scale,p_lk_loc[site],site,job->tree);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Set tree->update_p_lk and tree->lk_core according to the selected
+   family of kernels and the type of data. Vectorized kernels only
+   deal with nucleotides and amino-acids. Kernels are bound anew at
+   each call as tree->mod may be swapped (e.g., with M4 models) */
+void Bind_Lk_Kernels(t_tree *tree)
+{
+  int kernel;
+
+  kernel = Get_Lk_Kernel();
+
+  if(tree->mod->use_m4mod == YES || (tree->io->datatype != NT && tree->io->datatype != AA))
+    {
+      tree->update_p_lk = Update_P_Lk_Generic;
+      tree->lk_core     = NULL;
+      return;
+    }
+
+  switch(kernel)
+    {
+#if defined(AVX512_KERNELS)
+    case LK_KERNEL_AVX512 :
+      {
+        tree->update_p_lk = (tree->io->datatype == NT)?(AVX512_Update_P_Lk_Nucl):(AVX512_Update_P_Lk_AA);
+        tree->lk_core     = AVX512_Lk_Core;
+        break;
+      }
+#endif
+#if defined(AVX_KERNELS)
+    case LK_KERNEL_AVX :
+      {
+        tree->update_p_lk = (tree->io->datatype == NT)?(AVX_Update_P_Lk_Nucl):(AVX_Update_P_Lk_AA);
+        tree->lk_core     = AVX_Lk_Core;
+        break;
+      }
+#endif
+#if defined(SSE_KERNELS)
+    case LK_KERNEL_SSE3 :
+      {
+        tree->update_p_lk = (tree->io->datatype == NT)?(SSE_Update_P_Lk_Nucl):(SSE_Update_P_Lk_AA);
+        tree->lk_core     = SSE_Lk_Core;
+        break;
+      }
+#endif
+    default :
+      {
+        tree->update_p_lk = (tree->io->datatype == NT)?(Update_P_Lk_Nucl):(Update_P_Lk_AA);
+        tree->lk_core     = NULL;
+        break;
+      }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
+{
+/*
+           |
+           |<- b
+           |
+           d
+          / \
+         /   \
+        /     \
+    n_v1   n_v2
+*/
+  t_node *n_v1, *n_v2;
+  phydbl p1_lk1,p2_lk2;
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;
+  phydbl *Pij1,*Pij2;
+  int *sum_scale, *sum_scale_v1, *sum_scale_v2;
+  int sum_scale_v1_val, sum_scale_v2_val;
+  int i,j;
+  int catg,site;
+  int n_patterns;
   short int ambiguity_check_v1,ambiguity_check_v2;
   int state_v1,state_v2;
   int NsNg, Ns, NsNs;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
+  phydbl smallest_p_lk,largest_p_lk;
   int *p_lk_loc;
 
 
@@ -1458,7 +1953,7 @@ void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
                d,b,tree);
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
       state_v1 = state_v2 = -1;
       ambiguity_check_v1 = ambiguity_check_v2 = NO;
@@ -1492,8 +1987,7 @@ void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
 
       if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -1503,6 +1997,7 @@ void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
               if(tree->mod->ras->skip_rate_cat[catg] == YES) continue;
 
               smallest_p_lk  =  BIG;
+              largest_p_lk   =  .0;
 
               /* For all the states at node d */
               For(i,tree->mod->ns)
@@ -1585,6 +2080,7 @@ void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
                   /* 	      PhyML_Printf("\n+ %G",p_lk[site*NsNg+catg*Ns+i]); */
 
                   if(p_lk[site*NsNg+catg*Ns+i] < smallest_p_lk) smallest_p_lk = p_lk[site*NsNg+catg*Ns+i] ;
+                  if(p_lk[site*NsNg+catg*Ns+i] > largest_p_lk)  largest_p_lk  = p_lk[site*NsNg+catg*Ns+i] ;
                 }
 
               /* Current scaling values at that site */
@@ -1598,9 +2094,9 @@ void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < (phydbl)P_LK_LIM_INF)
+              curr_scaler_pow = P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
 
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -1633,7 +2129,7 @@ void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
+void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
 {
 /*
            |
@@ -1647,7 +2143,7 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 */
   t_node *n_v1, *n_v2;//d's "left" and "right" neighbor nodes
   phydbl p1_lk1,p2_lk2;//Partial likelihood at d's "left" neighbor, d's "right" neighbor
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
   phydbl *Pij1,*Pij2;
   int *sum_scale, *sum_scale_v1, *sum_scale_v2;
   int sum_scale_v1_val, sum_scale_v2_val;
@@ -1659,9 +2155,9 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
   int dim1, dim2, dim3;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
-  phydbl p_lk_lim_inf;
+  phydbl smallest_p_lk,largest_p_lk;
   phydbl p0,p1,p2,p3;
+  phydbl *tip_lk_v1,*tip_lk_v2;
   int *p_lk_loc;//Suppose site j, of a certain subtree, has "A" on one tip, and "C" on the other. If you come across this pattern again at site i<j, then you can simply copy the partial likelihoods
 
 
@@ -1693,7 +2189,6 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 
   n_patterns = tree->n_pattern;
 
-  p_lk_lim_inf                = (phydbl)P_LK_LIM_INF;
   n_v1 = n_v2                 = NULL;
   p_lk = p_lk_v1 = p_lk_v2    = NULL;
   Pij1 = Pij2                 = NULL;
@@ -1707,7 +2202,7 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
       state_v1 = state_v2 = -1;
       ambiguity_check_v1 = ambiguity_check_v2 = NO;
@@ -1751,10 +2246,12 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
         }
 
 
-      if(p_lk_loc[site] < site)
+      tip_lk_v1 = (ambiguity_check_v1 == YES && n_v1 && n_v1->tax)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (ambiguity_check_v2 == YES && n_v2 && n_v2->tax)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -1762,6 +2259,7 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
           For(catg,tree->mod->ras->n_catg)
             {
               smallest_p_lk  =  BIG;
+              largest_p_lk   =  .0;
 
               /* For all states at node d */
               For(i,tree->mod->ns)
@@ -1790,6 +2288,11 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                               if(isinf(p1_lk1) || isnan(p1_lk1)) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
                               #endif
                             }
+                          else if(tip_lk_v1 != NULL)
+                            {
+                              /* Fully ambiguous character: use the tip lookup table */
+                              p1_lk1 = tip_lk_v1[catg*dim2+i];
+                            }
                           else
                             {
                               /* For all the states at node n_v1 */
@@ -1850,6 +2353,11 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                               p2_lk2 = Pij2[catg*dim3+i*dim2+state_v2];
                               if(isinf(p2_lk2) || isnan(p2_lk2)) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
                             }
+                          else if(tip_lk_v2 != NULL)
+                            {
+                              /* Fully ambiguous character: use the tip lookup table */
+                              p2_lk2 = tip_lk_v2[catg*dim2+i];
+                            }
                           else
                             {
                               /* For all the states at node n_v2 */
@@ -1899,6 +2407,7 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                   p_lk[site*dim1+catg*dim2+i] = p1_lk1 * p2_lk2;
                   
                   if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i] ;
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i] ;
 
                   if(tree->mod->augmented == YES) break;
 
@@ -1915,9 +2424,9 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < p_lk_lim_inf && tree->mod->augmented == NO)
+              curr_scaler_pow = (tree->mod->augmented == NO)?(P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree)):(0);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
                   
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -1953,7 +2462,7 @@ void Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
+void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
 {
 /*
            |
@@ -1967,7 +2476,7 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 */
   t_node *n_v1, *n_v2;
   phydbl p1_lk1,p2_lk2;
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;
   phydbl *Pij1,*Pij2;
   int *sum_scale, *sum_scale_v1, *sum_scale_v2;
   int sum_scale_v1_val, sum_scale_v2_val;
@@ -1979,8 +2488,9 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
   int dim1, dim2, dim3;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
+  phydbl smallest_p_lk,largest_p_lk;
   phydbl p0,p1,p2,p3,p4,p5,p6,p7,p8,p9,p10,p11,p12,p13,p14,p15,p16,p17,p18,p19;
+  phydbl *tip_lk_v1,*tip_lk_v2;
   int *p_lk_loc;
 
   assert(tree);
@@ -2026,7 +2536,7 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                d,b,tree);
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
       state_v1 = state_v2 = -1;
       ambiguity_check_v1 = ambiguity_check_v2 = NO;
@@ -2057,10 +2567,12 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
           ambiguity_check_v2 = YES;
         }
       
-      if(p_lk_loc[site] < site)
+      tip_lk_v1 = (ambiguity_check_v1 == YES && n_v1 && n_v1->tax)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (ambiguity_check_v2 == YES && n_v2 && n_v2->tax)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -2068,6 +2580,7 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
           For(catg,tree->mod->ras->n_catg)
             {
               smallest_p_lk  =  BIG;
+              largest_p_lk   =  .0;
               
               /* For all the state at node d */
               For(i,tree->mod->ns)
@@ -2085,6 +2598,11 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                               p1_lk1 = Pij1[catg*dim3+i*dim2+state_v1];
                               if(isinf(p1_lk1) || isnan(p1_lk1)) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
                             }
+                          else if(tip_lk_v1 != NULL)
+                            {
+                              /* Fully ambiguous character: use the tip lookup table */
+                              p1_lk1 = tip_lk_v1[catg*dim2+i];
+                            }
                           else
                             {
                               /* For all the states at node n_v1 */
@@ -2159,6 +2677,11 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                               p2_lk2 = Pij2[catg*dim3+i*dim2+state_v2];
                               if(isinf(p2_lk2) || isnan(p2_lk2)) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
                             }
+                          else if(tip_lk_v2 != NULL)
+                            {
+                              /* Fully ambiguous character: use the tip lookup table */
+                              p2_lk2 = tip_lk_v2[catg*dim2+i];
+                            }
                           else
                             {
                               /* For all the states at node n_v2 */
@@ -2222,6 +2745,7 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                   p_lk[site*dim1+catg*dim2+i] = p1_lk1 * p2_lk2;
                   
                   if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i] ;
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i] ;
                 }
               
               /* Current scaling values at that site */
@@ -2234,9 +2758,9 @@ void Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < (phydbl)P_LK_LIM_INF)
+              curr_scaler_pow = P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
                                     
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -2406,7 +2930,7 @@ phydbl Lk_Given_Two_Seq(calign *data, int numseq1, int numseq2, phydbl dist, t_m
   phydbl site_lk,log_site_lk;
   int i,j,k,l;
 /*   phydbl **p_lk_l,**p_lk_r; */
-  phydbl *p_lk_l,*p_lk_r;
+  phyplk *p_lk_l,*p_lk_r;
   phydbl len;
   int dim1,dim2;
 
@@ -2420,8 +2944,8 @@ phydbl Lk_Given_Two_Seq(calign *data, int numseq1, int numseq2, phydbl dist, t_m
   seq2 = data->c_seq[numseq2];
 
 
-  p_lk_l = (phydbl *)mCalloc(data->c_seq[0]->len * mod->ns,sizeof(phydbl));
-  p_lk_r = (phydbl *)mCalloc(data->c_seq[0]->len * mod->ns,sizeof(phydbl));
+  p_lk_l = (phyplk *)mCalloc(data->c_seq[0]->len * mod->ns,sizeof(phyplk));
+  p_lk_r = (phyplk *)mCalloc(data->c_seq[0]->len * mod->ns,sizeof(phyplk));
 
 
   For(i,mod->ras->n_catg)
@@ -2679,7 +3203,7 @@ void Init_P_Lk_Tips_Int(t_tree *tree)
 
 void Update_PMat_At_Given_Edge(t_edge *b_fcus, t_tree *tree)
 {
-  int i;
+  int i,n_pij;
   phydbl len;
   phydbl l_min, l_max;
   phydbl shape, scale, mean, var;
@@ -2705,6 +3229,11 @@ void Update_PMat_At_Given_Edge(t_edge *b_fcus, t_tree *tree)
   if(b_fcus->l->v < l_min) b_fcus->l->v = l_min;
   if(b_fcus->l->v > l_max) b_fcus->l->v = l_max;
 
+  /* Keep the current matrices to find out whether the partial
+     likelihoods that depend on them have to be recomputed */
+  n_pij = tree->mod->ras->n_catg*tree->mod->ns*tree->mod->ns;
+  if(b_fcus->Pij_rr_old != NULL) memcpy(b_fcus->Pij_rr_old,b_fcus->Pij_rr,n_pij*sizeof(phydbl));
+
   For(i,tree->mod->ras->n_catg)
     {
       if(tree->mod->ras->skip_rate_cat[i] == YES) continue;
@@ -2757,6 +3286,10 @@ void Update_PMat_At_Given_Edge(t_edge *b_fcus, t_tree *tree)
           }
     }
 
+  b_fcus->update_tip_lk = YES;
+
+  if(b_fcus->Pij_rr_old == NULL || memcmp(b_fcus->Pij_rr_old,b_fcus->Pij_rr,n_pij*sizeof(phydbl)) != 0) Set_P_Lk_Invalid_Br_Len(b_fcus,tree);
+
 #ifdef BEAGLE
   int whichmodel = tree->mod->whichmodel;
   //Only for some models we use Beagle to compute/update the P-matrices, for other models
@@ -2809,6 +3342,215 @@ void Update_PMat_At_Given_Edge(t_edge *b_fcus, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Are the partial likelihoods of the subtree rooted at d (looking
+   away from b) up to date? */
+int P_Lk_Is_Valid(t_edge *b, t_node *d)
+{
+  if(d->tax == YES) return YES;
+  return (d == b->left)?(b->valid_left):(b->valid_rght);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Flag the partial likelihoods of the subtree rooted at d (looking
+   away from b) as invalid, together with those of every subtree that
+   contains it. A partial likelihood flagged as invalid is never part
+   of a valid one. Unless force == YES, the recursion therefore stops
+   at the first one that is already invalid. After a change of
+   topology, this no longer holds and force has to be set to YES */
+static void Set_P_Lk_Invalid_Recur(t_edge *b, t_node *d, int force, t_tree *tree)
+{
+  t_node *a;
+  int i;
+
+  if(d == b->left)
+    {
+      if(b->valid_left == NO && force == NO) return;
+      b->valid_left = NO;
+      a = b->rght;
+    }
+  else
+    {
+      if(b->valid_rght == NO && force == NO) return;
+      b->valid_rght = NO;
+      a = b->left;
+    }
+
+  if(a == NULL || a->tax == YES || a == tree->n_root) return;
+
+  For(i,3)
+    if(a->b[i] != NULL && a->b[i] != b)
+      Set_P_Lk_Invalid_Recur(a->b[i],a,force,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* The neighbours of x have changed (Prune_Subtree, Graft_Subtree,
+   Swap). Flag the partial likelihoods of the subtrees rooted at x as
+   invalid, except the one that looks away from b (if not NULL) */
+void Set_P_Lk_Invalid_Around(t_node *x, t_edge *b, t_tree *tree)
+{
+  int i;
+
+  if(x == NULL || x->tax == YES || x == tree->n_root) return;
+
+  For(i,3)
+    if(x->b[i] != NULL && x->b[i] != b && x->b[i]->num < 2*tree->n_otu-3)
+      Set_P_Lk_Invalid_Recur(x->b[i],x,YES,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Transition probabilities along b have changed. Partial likelihoods
+   of the subtrees that contain b are not valid anymore */
+void Set_P_Lk_Invalid_Br_Len(t_edge *b, t_tree *tree)
+{
+  int i;
+
+  if(b->num >= 2*tree->n_otu-3) return;
+
+  if(b->left != NULL && b->left->tax == NO)
+    For(i,3)
+      if(b->left->b[i] != NULL && b->left->b[i] != b)
+        Set_P_Lk_Invalid_Recur(b->left->b[i],b->left,NO,tree);
+
+  if(b->rght != NULL && b->rght->tax == NO)
+    For(i,3)
+      if(b->rght->b[i] != NULL && b->rght->b[i] != b)
+        Set_P_Lk_Invalid_Recur(b->rght->b[i],b->rght,NO,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Set_All_P_Lk_Invalid(t_tree *tree)
+{
+  int i;
+
+  For(i,2*tree->n_otu-1)
+    {
+      tree->a_edges[i]->valid_left = NO;
+      tree->a_edges[i]->valid_rght = NO;
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Recompute the partial likelihoods of the subtree rooted at d (looking
+   away from b) if they are flagged as invalid, starting with those of
+   the subtrees underneath that are invalid too */
+void Update_Invalid_P_Lk(t_edge *b, t_node *d, t_tree *tree)
+{
+  int i;
+
+  if(P_Lk_Is_Valid(b,d) == YES) return;
+
+  For(i,3)
+    if(d->b[i] != b)
+      Update_Invalid_P_Lk(d->b[i],d->v[i],tree);
+
+  Update_P_Lk(tree,b,d);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Update_All_Invalid_P_Lk(t_tree *tree)
+{
+  int i;
+
+  For(i,2*tree->n_otu-3)
+    {
+      Update_Invalid_P_Lk(tree->a_edges[i],tree->a_edges[i]->left,tree);
+      Update_Invalid_P_Lk(tree->a_edges[i],tree->a_edges[i]->rght,tree);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Fill the tip lookup table of edge b. For a tip with (unambiguous)
+   state s, the partial likelihood of state i at the other end of b is
+   Pij_rr[i][s], i.e., tip_lk[s][i]. Row ns holds the sum over s, which
+   corresponds to a fully ambiguous character (e.g., a gap) */
+void Update_Tip_Lk(t_edge *b, t_tree *tree)
+{
+  int i,j,catg,ns,n_catg;
+  phydbl *Pij,sum;
+
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+
+  For(catg,n_catg)
+    {
+      Pij = b->Pij_rr + catg*ns*ns;
+      For(i,ns)
+        {
+          sum = .0;
+          For(j,ns)
+            {
+              b->tip_lk[j*n_catg*ns+catg*ns+i] = Pij[i*ns+j];
+              sum += Pij[i*ns+j];
+            }
+          b->tip_lk[ns*n_catg*ns+catg*ns+i] = sum;
+        }
+    }
+
+  b->update_tip_lk = NO;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Tip lookup tables of the edges leading to the tips next to d */
+void Update_Tip_Lk_Around(t_node *d, t_tree *tree)
+{
+  int i;
+  t_edge *b;
+
+  For(i,3)
+    {
+      if(d->v[i] == NULL || d->v[i]->tax == NO) continue;
+      b = d->v[i]->b[0];
+      if(b->tip_lk != NULL && b->update_tip_lk == YES) Update_Tip_Lk(b,tree);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Rows of the tip lookup table (one row per rate class) that give
+   Pij times the tip vector of 'tip' at site 'site'. Returns NULL when
+   the table cannot be used, i.e., for partially ambiguous characters
+   or when Pij is not the matrix of the edge leading to the tip */
+phydbl *Tip_Lk_Row(t_node *tip, phydbl *Pij, int site, t_tree *tree)
+{
+  t_edge *b;
+  short int *tip_v;
+  int i,ns;
+
+  b = tip->b[0];
+
+  if(b->tip_lk == NULL || b->update_tip_lk == YES || b->Pij_rr != Pij) return NULL;
+  if(tree->mod->s_opt->greedy == YES || tree->mod->use_m4mod == YES || tree->mod->augmented == YES) return NULL;
+
+  ns = tree->mod->ns;
+
+  if(tip->c_seq->is_ambigu[site] == NO) return b->tip_lk + tip->c_seq->d_state[site]*tree->mod->ras->n_catg*ns;
+
+  tip_v = b->p_lk_tip_r + site*ns;
+  For(i,ns) if(tip_v[i] == 0) return NULL;
+
+  return b->tip_lk + ns*tree->mod->ras->n_catg*ns;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 
 /* void Update_P_Lk_On_A_Path(t_node *a, t_node *d, t_edge *b, t_node *target_one_side, t_node *target_other_side, t_tree *tree) */
 /* { */
@@ -3042,14 +3784,12 @@ void Alias_Subpatt(t_tree *tree)
 
 void Alias_One_Subpatt(t_node *a, t_node *d, t_tree *tree)
 {
-  int i,j;
+  int i;
   int *patt_id_v1, *patt_id_v2, *patt_id_d;
-  int *p_lk_loc_d, *p_lk_loc_v1, *p_lk_loc_v2;
+  int *p_lk_loc_d;
+  int *state;
   t_node *v1, *v2;
   t_edge *b0, *b1, *b2;
-  int curr_patt_id_v1, curr_patt_id_v2;
-  int curr_p_lk_loc_v1, curr_p_lk_loc_v2;
-  int num_subpatt;
 
   b0 = b1 = b2 = NULL;
 
@@ -3058,22 +3798,10 @@ void Alias_One_Subpatt(t_node *a, t_node *d, t_tree *tree)
       patt_id_d  = (d == d->b[0]->left)?(d->b[0]->patt_id_left):(d->b[0]->patt_id_rght);
       p_lk_loc_d = (d == d->b[0]->left)?(d->b[0]->p_lk_loc_left):(d->b[0]->p_lk_loc_rght);
 
-      For(i,tree->n_pattern)
-    {
-      For(j,tree->n_pattern)
-        {
-          if(patt_id_d[i] == patt_id_d[j])
-        {
-          p_lk_loc_d[i] = j;
-          break;
-        }
-          if(j > i)
-        {
-          PhyML_Printf("\n. Err in file %s at line %d\n\n",__FILE__,__LINE__);
-          Warn_And_Exit("");
-        }
-        }
-    }
+      state = (int *)mCalloc(tree->n_pattern,sizeof(int));
+      For(i,tree->n_pattern) state[i] = (int)d->c_seq->state[i];
+      Site_Repeats(state,NULL,p_lk_loc_d,patt_id_d,tree->n_pattern);
+      Free(state);
       return;
     }
   else
@@ -3097,59 +3825,69 @@ void Alias_One_Subpatt(t_node *a, t_node *d, t_tree *tree)
       patt_id_v2  = (v2 == b2->left)?(b2->patt_id_left):(b2->patt_id_rght);
       patt_id_d   = (d  == b0->left)?(b0->patt_id_left):(b0->patt_id_rght);
       p_lk_loc_d  = (d  == b0->left)?(b0->p_lk_loc_left):(b0->p_lk_loc_rght);
-      p_lk_loc_v1 = (v1 == b1->left)?(b1->p_lk_loc_left):(b1->p_lk_loc_rght);
-      p_lk_loc_v2 = (v2 == b2->left)?(b2->p_lk_loc_left):(b2->p_lk_loc_rght);
 
-      num_subpatt = 0;
-      For(i,tree->n_pattern)
+      /* The subtree pattern at d is given by the pair of subtree
+         patterns at v1 and v2 */
+      Site_Repeats(patt_id_v1,patt_id_v2,p_lk_loc_d,patt_id_d,tree->n_pattern);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Number the distinct pairs (key1[site],key2[site]) in order of first
+   occurrence, using an open addressing hash table. On output, first[site]
+   is the first site with the same pair of keys and id[site] is the number
+   of that pair. key2 may be NULL, in which case only key1 is considered.
+   Returns the number of distinct pairs */
+int Site_Repeats(int *key1, int *key2, int *first, int *id, int n_sites)
+{
+  int *table;
+  int site,j,k1,k2;
+  int n_ids;
+  unsigned int size,h;
+
+  size = 1;
+  while(size < 2*(unsigned int)n_sites) size <<= 1;
+
+  /* table[h] is 1 + the first site hashed at h, or 0 if empty */
+  table = (int *)mCalloc(size,sizeof(int));
+
+  n_ids = 0;
+  for(site=0;site<n_sites;site++)
     {
-      curr_patt_id_v1  = patt_id_v1[i];
-      curr_patt_id_v2  = patt_id_v2[i];
-      curr_p_lk_loc_v1 = p_lk_loc_v1[i];
-      curr_p_lk_loc_v2 = p_lk_loc_v2[i];
+      k1 = key1[site];
+      k2 = (key2)?(key2[site]):(0);
 
-      p_lk_loc_d[i] = i;
+      h = ((unsigned int)k1 * 2654435761U) ^ ((unsigned int)k2 * 2246822519U);
+      h = (h ^ (h >> 15)) & (size-1);
 
-      if((curr_p_lk_loc_v1 == i) || (curr_p_lk_loc_v2 == i))
+      j = -1;
+      while(table[h] != 0)
         {
-          p_lk_loc_d[i] = i;
-          patt_id_d[i] = num_subpatt;
-          num_subpatt++;
+          j = table[h]-1;
+          if(key1[j] == k1 && (!key2 || key2[j] == k2)) break;
+          j = -1;
+          h = (h+1) & (size-1);
         }
-      else
-        if(curr_p_lk_loc_v1 == curr_p_lk_loc_v2)
-          {
-        p_lk_loc_d[i] = curr_p_lk_loc_v1;
-        patt_id_d[i] = patt_id_d[curr_p_lk_loc_v1];
-          }
-        else
-          {
-        for(j=MAX(curr_p_lk_loc_v1,curr_p_lk_loc_v2);j<tree->n_pattern;j++)
-          {
-            if((patt_id_v1[j] == curr_patt_id_v1) &&
-               (patt_id_v2[j] == curr_patt_id_v2))
-              {
-            p_lk_loc_d[i] = j;
 
-            if(j == i)
-              {
-                patt_id_d[i] = num_subpatt;
-                num_subpatt++;
-              }
-            else patt_id_d[i] = patt_id_d[j];
-            break;
-              }
-            if(j > i)
-              {
-            PhyML_Printf("\n. Err in file %s at line %d\n\n",__FILE__,__LINE__);
-            Warn_And_Exit("");
-              }
-          }
-          }
-    }
+      if(j < 0)
+        {
+          table[h]    = site+1;
+          first[site] = site;
+          id[site]    = n_ids++;
+        }
+      else
+        {
+          first[site] = j;
+          id[site]    = id[j];
+        }
     }
-}
 
+  Free(table);
+
+  return n_ids;
+}
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
@@ -3198,7 +3936,7 @@ void Alias_Subpatt_Pre(t_node *a, t_node *d, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void Copy_P_Lk(phydbl *p_lk, int site_from, int site_to, t_tree *tree)
+void Copy_P_Lk(phyplk *p_lk, int site_from, int site_to, t_tree *tree)
 {
   int i,j;
   int dim1,dim2;
@@ -3228,18 +3966,43 @@ void Copy_Scale(int *scale, int site_from, int site_to, t_tree *tree)
       scale[i*tree->n_pattern+site_to] = scale[i*tree->n_pattern+site_from];
 /*       PhyML_Printf("\n. %d",scale[i*tree->n_pattern+site_to]); */
     }
+
+#if defined(PLK_FLOAT)
+  if(tree->plk_guard[site_from] == YES) tree->plk_guard[site_to] = YES;
+#endif
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void Init_P_Lk_Loc(t_tree *tree)
-{
-  int i,j;
-  t_node *d;
-  int *patt_id_d;
+/* Scaling power applied to the partial likelihoods of one rate class at
+   one site. In double precision, partials are scaled when the smallest of
+   them falls below P_LK_LIM_INF. When partials are stored in single
+   precision, the largest of them is brought back in [0.5,1) as soon as it
+   falls below PLK_FLT_LIM_INF, and the site is flagged for recomputation
+   in double precision (see Lk_Guarded_Sites) whenever a partial likelihood
+   falls below the smallest normalized float */
 
-  For(i,2*tree->n_otu-1)
+int P_Lk_Scaler_Pow(phydbl smallest_p_lk, phydbl largest_p_lk, int site, t_tree *tree)
+{
+#if defined(PLK_FLOAT)
+  if(smallest_p_lk < (phydbl)PLK_FLT_GUARD) tree->plk_guard[site] = YES;
+  if(largest_p_lk > .0 && largest_p_lk < (phydbl)PLK_FLT_LIM_INF) return -ilogb(largest_p_lk)-1;
+  return 0;
+#else
+  if(smallest_p_lk < (phydbl)P_LK_LIM_INF) return (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
+  return 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Init_P_Lk_Loc(t_tree *tree)
+{
+  int i,j;
+
+  For(i,2*tree->n_otu-1)
     {
       For(j,tree->n_pattern)
         {
@@ -3248,15 +4011,9 @@ void Init_P_Lk_Loc(t_tree *tree)
         }
     }
   
-  For(i,tree->n_otu)
-    {
-      d = tree->a_nodes[i];
-      patt_id_d = (d == d->b[0]->left)?(d->b[0]->patt_id_left):(d->b[0]->patt_id_rght);
-      For(j,tree->n_pattern)
-        {
-          patt_id_d[j] = (int)tree->a_nodes[d->num]->c_seq->state[j];
-        }
-    }
+  /* Subtree patterns at the tips do not depend on the tree. Set them
+     once for all so that nodes with tips as children always see them */
+  For(i,tree->n_otu) Alias_One_Subpatt(tree->a_nodes[i]->v[0],tree->a_nodes[i],tree);
 }
 
 //////////////////////////////////////////////////////////////
@@ -3545,7 +4302,7 @@ void Sample_Ancestral_Seq_Pre(t_node *a, t_node *d, t_edge *b,
   int i,j;
   int sa,sd;
   phydbl *Pij;
-  phydbl *p_lk;
+  phyplk *p_lk;
   int dim1, dim2, dim3;
   phydbl sum;
   phydbl u;
@@ -3589,6 +4346,8 @@ void Sample_Ancestral_Seq_Pre(t_node *a, t_node *d, t_edge *b,
       sum  = 0.0;
             
       Pij  = b->Pij_rr;
+
+      LOWMEM_Fetch(b,d,tree);
       
       if(d == b->left)
         p_lk = b->p_lk_left;
@@ -3968,7 +4727,7 @@ void Ancestral_Sequences_One_Node(t_node *d, t_tree *tree, int print)
           phydbl p0, p1, p2;
           phydbl *p;
           int site,csite;
-          phydbl *p_lk0, *p_lk1, *p_lk2;
+          phyplk *p_lk0, *p_lk1, *p_lk2;
           int *sum_scale0, *sum_scale1, *sum_scale2;
           phydbl sum_probas;
           phydbl *Pij0, *Pij1, *Pij2;
@@ -3985,6 +4744,12 @@ void Ancestral_Sequences_One_Node(t_node *d, t_tree *tree, int print)
           NsNg = Ns*tree->mod->ras->n_catg;
           
           p = (phydbl *)mCalloc(Ns,sizeof(phydbl));
+
+          For(i,3)
+            {
+              LOWMEM_Fetch(d->b[i],d->v[i],tree);
+              LOWMEM_Pin(*LOWMEM_Field(d->b[i],d->v[i],tree),+1,tree);
+            }
               
           For(site,tree->data->init_len) // For each site in the current partition element
             {
@@ -4132,6 +4897,9 @@ void Ancestral_Sequences_One_Node(t_node *d, t_tree *tree, int print)
                 }
 
             }
+
+          For(i,3) LOWMEM_Pin(*LOWMEM_Field(d->b[i],d->v[i],tree),-1,tree);
+
           Free(p);
         }
     }
@@ -4354,7 +5122,12 @@ void Stepwise_Add_Lk(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-#if defined(__AVX__)
+#if defined(AVX_KERNELS)
+
+#if defined(CPU_DISPATCH)
+#pragma GCC push_options
+#pragma GCC target("avx")
+#endif
 __m256d AVX_Horizontal_Add(__m256d x[4])
 {
   __m256d y[2],z[2];
@@ -4453,12 +5226,12 @@ phydbl AVX_Lk_Core_Nucl(int state, int ambiguity_check, t_edge *b, t_tree *tree)
 
           // Partial likelihood vector on righthand side of b
           if(b->rght->tax == NO)
-            _plk_r = _mm256_load_pd(b->p_lk_rght + site*dim1+catg*dim2);
+            _plk_r = AVX_LOAD_PLK(b->p_lk_rght + site*dim1+catg*dim2);
           else
             _plk_r = _mm256_load_pd(tip_v);
 
           // Partial likelihood vector on lefthand side of b
-          _plk_l = _mm256_load_pd(b->p_lk_left + site*dim1+catg*dim2);
+          _plk_l = AVX_LOAD_PLK(b->p_lk_left + site*dim1+catg*dim2);
 
           For(i,4) _pplk[i] = _mm256_mul_pd(_p[i],_plk_r);
           
@@ -4676,7 +5449,7 @@ phydbl AVX_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree)
           // Partial likelihood vector on righthand side of b
           if(b->rght->tax == NO)
             {
-              For(i,5) _plk_r[i] = _mm256_load_pd(b->p_lk_rght + site*dim1 + catg*dim2 + i*4);
+              For(i,5) _plk_r[i] = AVX_LOAD_PLK(b->p_lk_rght + site*dim1 + catg*dim2 + i*4);
               /* _plk_r[0] = _mm256_load_pd(b->p_lk_rght + site*dim1 + catg*dim2 + 0); */
               /* _plk_r[1] = _mm256_load_pd(b->p_lk_rght + site*dim1 + catg*dim2 + 4); */
               /* _plk_r[2] = _mm256_load_pd(b->p_lk_rght + site*dim1 + catg*dim2 + 8); */
@@ -4694,7 +5467,7 @@ phydbl AVX_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree)
             }
 
           // Partial likelihood vector on lefthand side of b
-          For(i,5) _plk_l[i] = _mm256_load_pd(b->p_lk_left + site*dim1 + catg*dim2 + i*4);
+          For(i,5) _plk_l[i] = AVX_LOAD_PLK(b->p_lk_left + site*dim1 + catg*dim2 + i*4);
           /* _plk_l[0] = _mm256_load_pd(b->p_lk_left + site*dim1 + catg*dim2 + 0); */
           /* _plk_l[1] = _mm256_load_pd(b->p_lk_left + site*dim1 + catg*dim2 + 4); */
           /* _plk_l[2] = _mm256_load_pd(b->p_lk_left + site*dim1 + catg*dim2 + 8); */
@@ -4867,7 +5640,7 @@ phydbl AVX_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
+void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
 {
 /*
            |
@@ -4880,7 +5653,7 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
     n_v1   n_v2
 */
   t_node *n_v1, *n_v2;//d's "left" and "right" neighbor nodes
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
   phydbl *Pij1,*Pij2;
   int *sum_scale, *sum_scale_v1, *sum_scale_v2;
   int sum_scale_v1_val, sum_scale_v2_val;
@@ -4890,10 +5663,10 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
   int dim1, dim2, dim3;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
-  phydbl p_lk_lim_inf;
+  phydbl smallest_p_lk,largest_p_lk;
   int *p_lk_loc;//Suppose site j, of a certain subtree, has "A" on one tip, and "C" on the other. If you come across this pattern again at site i<j, then you can simply copy the partial likelihoods
   phydbl tip_v1[4],tip_v2[4];
+  phydbl *tip_lk_v1,*tip_lk_v2;
   
 
   if(tree->n_root && tree->ignore_root == YES &&
@@ -4921,7 +5694,6 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 
   n_patterns = tree->n_pattern;
 
-  p_lk_lim_inf                = (phydbl)P_LK_LIM_INF;
   n_v1 = n_v2                 = NULL;
   p_lk = p_lk_v1 = p_lk_v2    = NULL;
   Pij1 = Pij2                 = NULL;
@@ -4941,9 +5713,12 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
     }
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
-      if(n_v1->tax == YES)
+      tip_lk_v1 = (n_v1->tax == YES)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (n_v2->tax == YES)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(n_v1->tax == YES && tip_lk_v1 == NULL)
         {
           tip_v1[0] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v1[1] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+1];
@@ -4951,7 +5726,7 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
           tip_v1[3] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+3];
         }
 
-      if(n_v2->tax == YES)
+      if(n_v2->tax == YES && tip_lk_v2 == NULL)
         {
           tip_v2[0] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v2[1] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+1];
@@ -4959,10 +5734,9 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
           tip_v2[3] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+3];
         }
 
-      if(p_lk_loc[site] < site)
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -4975,45 +5749,33 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 	      __m256d _plk1,_plk2; // sister partial likelihood vectors
 	      __m256d _p1[4],_p2[4]; // matrices of transition probabilities
 	      __m256d _pplk1[4],_pplk2[4]; // dot product of _p1[i] & _plk1 (resp. _p2[i] & _plk2)
+              __m256d _pv1,_pv2; // Pij1 x _plk1 and Pij2 x _plk2
 
-              For(i,4) _p1[i] = _mm256_load_pd(Pij1 + catg*dim3 + i*dim2);
-	      /* _p1[0] = _mm256_load_pd(Pij1 + catg*dim3+0*dim2); */
-	      /* _p1[1] = _mm256_load_pd(Pij1 + catg*dim3+1*dim2); */
-	      /* _p1[2] = _mm256_load_pd(Pij1 + catg*dim3+2*dim2); */
-	      /* _p1[3] = _mm256_load_pd(Pij1 + catg*dim3+3*dim2); */
-
-              For(i,4) _p2[i] = _mm256_load_pd(Pij2 + catg*dim3 + i*dim2);
-	      /* _p2[0] = _mm256_load_pd(Pij2 + catg*dim3+0*dim2); */
-	      /* _p2[1] = _mm256_load_pd(Pij2 + catg*dim3+1*dim2); */
-	      /* _p2[2] = _mm256_load_pd(Pij2 + catg*dim3+2*dim2); */
-	      /* _p2[3] = _mm256_load_pd(Pij2 + catg*dim3+3*dim2); */
-	      
-
-	      if(n_v1->tax == NO)
-                _plk1 = _mm256_load_pd(p_lk_v1 + site*dim1+catg*dim2);
-	      else
-                _plk1 = _mm256_load_pd(tip_v1);
-
-	      if(n_v2->tax == NO)
-                _plk2 = _mm256_load_pd(p_lk_v2 + site*dim1+catg*dim2);
-	      else
-                _plk2 = _mm256_load_pd(tip_v2);
-              
-              For(i,4) _pplk1[i] = _mm256_mul_pd(_p1[i],_plk1);
-              /* _pplk1[0] = _mm256_mul_pd(_p1[0],_plk1); */
-              /* _pplk1[1] = _mm256_mul_pd(_p1[1],_plk1); */
-              /* _pplk1[2] = _mm256_mul_pd(_p1[2],_plk1); */
-              /* _pplk1[3] = _mm256_mul_pd(_p1[3],_plk1); */
-
-              For(i,4) _pplk2[i] = _mm256_mul_pd(_p2[i],_plk2);
-              /* _pplk2[0] = _mm256_mul_pd(_p2[0],_plk2); */
-              /* _pplk2[1] = _mm256_mul_pd(_p2[1],_plk2); */
-              /* _pplk2[2] = _mm256_mul_pd(_p2[2],_plk2); */
-              /* _pplk2[3] = _mm256_mul_pd(_p2[3],_plk2); */
-              
-              _plk = _mm256_mul_pd(AVX_Horizontal_Add(_pplk1),AVX_Horizontal_Add(_pplk2)); 
+              if(tip_lk_v1 != NULL) /* Tip lookup table */
+                _pv1 = _mm256_load_pd(tip_lk_v1 + catg*dim2);
+              else
+                {
+                  For(i,4) _p1[i] = _mm256_load_pd(Pij1 + catg*dim3 + i*dim2);
+                  if(n_v1->tax == NO) _plk1 = AVX_LOAD_PLK(p_lk_v1 + site*dim1+catg*dim2);
+                  else                _plk1 = _mm256_load_pd(tip_v1);
+                  For(i,4) _pplk1[i] = _mm256_mul_pd(_p1[i],_plk1);
+                  _pv1 = AVX_Horizontal_Add(_pplk1);
+                }
+
+              if(tip_lk_v2 != NULL)
+                _pv2 = _mm256_load_pd(tip_lk_v2 + catg*dim2);
+              else
+                {
+                  For(i,4) _p2[i] = _mm256_load_pd(Pij2 + catg*dim3 + i*dim2);
+                  if(n_v2->tax == NO) _plk2 = AVX_LOAD_PLK(p_lk_v2 + site*dim1+catg*dim2);
+                  else                _plk2 = _mm256_load_pd(tip_v2);
+                  For(i,4) _pplk2[i] = _mm256_mul_pd(_p2[i],_plk2);
+                  _pv2 = AVX_Horizontal_Add(_pplk2);
+                }
+
+              _plk = _mm256_mul_pd(_pv1,_pv2);
                                    
-              _mm256_store_pd(p_lk+site*dim1+catg*dim2,_plk);
+              AVX_STORE_PLK(p_lk+site*dim1+catg*dim2,_plk);
 
               For(i,4) 
                 {
@@ -5025,9 +5787,12 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                 }
 
               smallest_p_lk = BIG;
-              For(i,4) 
-                if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) 
-                  smallest_p_lk = p_lk[site*dim1+catg*dim2+i] ;
+              largest_p_lk  = .0;
+              For(i,4)
+                {
+                  if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i];
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i];
+                }
 
               /* Current scaling values at that site */
               sum_scale_v1_val = (sum_scale_v1)?(sum_scale_v1[catg*n_patterns+site]):(0);
@@ -5039,9 +5804,9 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < p_lk_lim_inf && tree->mod->augmented == NO)
+              curr_scaler_pow = (tree->mod->augmented == NO)?(P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree)):(0);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
                   
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -5074,7 +5839,7 @@ void AVX_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
+void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
 {
 /*
            |
@@ -5087,7 +5852,7 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
     n_v1   n_v2
 */
   t_node *n_v1, *n_v2;//d's "left" and "right" neighbor nodes
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
   phydbl *Pij1,*Pij2;
   int *sum_scale, *sum_scale_v1, *sum_scale_v2;
   int sum_scale_v1_val, sum_scale_v2_val;
@@ -5097,10 +5862,10 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
   int dim1, dim2, dim3;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
-  phydbl p_lk_lim_inf;
+  phydbl smallest_p_lk,largest_p_lk;
   int *p_lk_loc;//Suppose site j, of a certain subtree, has "A" on one tip, and "C" on the other. If you come across this pattern again at site i<j, then you can simply copy the partial likelihoods
   phydbl tip_v1[20],tip_v2[20];
+  phydbl *tip_lk_v1,*tip_lk_v2;
   
 
   if(tree->n_root && tree->ignore_root == YES &&
@@ -5128,7 +5893,6 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 
   n_patterns = tree->n_pattern;
 
-  p_lk_lim_inf                = (phydbl)P_LK_LIM_INF;
   n_v1 = n_v2                 = NULL;
   p_lk = p_lk_v1 = p_lk_v2    = NULL;
   Pij1 = Pij2                 = NULL;
@@ -5149,9 +5913,12 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
     }
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
-      if(n_v1->tax == YES)
+      tip_lk_v1 = (n_v1->tax == YES)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (n_v2->tax == YES)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(n_v1->tax == YES && tip_lk_v1 == NULL)
         {
           tip_v1[0]  = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v1[1]  = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+1];
@@ -5175,7 +5942,7 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 	  tip_v1[19] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+19];
 	}
 
-      if(n_v2->tax == YES)
+      if(n_v2->tax == YES && tip_lk_v2 == NULL)
         {
           tip_v2[0]  = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v2[1]  = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+1];
@@ -5199,10 +5966,9 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 	  tip_v2[19] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+19];
 	}
 
-      if(p_lk_loc[site] < site)
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -5215,92 +5981,50 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
               __m256d _plk1[5],_plk2[5]; // sister partial likelihood vectors
               __m256d _p1[4],_p2[4]; // vector of transition probabilities
               __m256d _pplk1[4],_pplk2[4]; // dot product of _p1[i] & _plk1 (resp. _p2[i] & _plk2)
+              __m256d _pv1,_pv2; // Pij1 x _plk1 and Pij2 x _plk2
 
-              if(n_v1->tax == NO)
-                {
-                  For(i,5) _plk1[i] = _mm256_load_pd(p_lk_v1 + site*dim1 + catg*dim2 + i*4);
-                  /* _plk1[0] = _mm256_load_pd(p_lk_v1 + site*dim1+catg*dim2+0); */
-                  /* _plk1[1] = _mm256_load_pd(p_lk_v1 + site*dim1+catg*dim2+4); */
-		  /* _plk1[2] = _mm256_load_pd(p_lk_v1 + site*dim1+catg*dim2+8); */
-		  /* _plk1[3] = _mm256_load_pd(p_lk_v1 + site*dim1+catg*dim2+12); */
-		  /* _plk1[4] = _mm256_load_pd(p_lk_v1 + site*dim1+catg*dim2+16); */
-		}
-              else
+              if(tip_lk_v1 == NULL)
                 {
-                  For(i,5) _plk1[i] = _mm256_load_pd(tip_v1 + i*4);
-                  /* _plk1[0] = _mm256_load_pd(tip_v1+0); */
-		  /* _plk1[1] = _mm256_load_pd(tip_v1+4); */
-		  /* _plk1[2] = _mm256_load_pd(tip_v1+8); */
-		  /* _plk1[3] = _mm256_load_pd(tip_v1+12); */
-		  /* _plk1[4] = _mm256_load_pd(tip_v1+16); */
-		}
+                  if(n_v1->tax == NO) For(i,5) _plk1[i] = AVX_LOAD_PLK(p_lk_v1 + site*dim1 + catg*dim2 + i*4);
+                  else                For(i,5) _plk1[i] = _mm256_load_pd(tip_v1 + i*4);
+                }
 
-              if(n_v2->tax == NO)
+              if(tip_lk_v2 == NULL)
                 {
-                  For(i,5) _plk2[i] = _mm256_load_pd(p_lk_v2 + site*dim1 + catg*dim2 + i*4);
-                  /* _plk2[0] = _mm256_load_pd(p_lk_v2 + site*dim1+catg*dim2+0); */
-                  /* _plk2[1] = _mm256_load_pd(p_lk_v2 + site*dim1+catg*dim2+4); */
-		  /* _plk2[2] = _mm256_load_pd(p_lk_v2 + site*dim1+catg*dim2+8); */
-		  /* _plk2[3] = _mm256_load_pd(p_lk_v2 + site*dim1+catg*dim2+12); */
-		  /* _plk2[4] = _mm256_load_pd(p_lk_v2 + site*dim1+catg*dim2+16); */
-		}
-              else
-                {
-                  For(i,5) _plk2[i] = _mm256_load_pd(tip_v2 + i*4);
-                  /* _plk2[0] = _mm256_load_pd(tip_v2+0); */
-                  /* _plk2[1] = _mm256_load_pd(tip_v2+4); */
-		  /* _plk2[2] = _mm256_load_pd(tip_v2+8); */
-		  /* _plk2[3] = _mm256_load_pd(tip_v2+12); */
-		  /* _plk2[4] = _mm256_load_pd(tip_v2+16); */
-		}
-
+                  if(n_v2->tax == NO) For(i,5) _plk2[i] = AVX_LOAD_PLK(p_lk_v2 + site*dim1 + catg*dim2 + i*4);
+                  else                For(i,5) _plk2[i] = _mm256_load_pd(tip_v2 + i*4);
+                }
 
               For(j,5)
                 {
-                  For(i,4) _pplk1[i] = _mm256_setzero_pd();
-                  For(i,4) _pplk2[i] = _mm256_setzero_pd();
-
-                  /* _pplk1[0] = _mm256_setzero_pd(); */
-                  /* _pplk1[1] = _mm256_setzero_pd(); */
-                  /* _pplk1[2] = _mm256_setzero_pd(); */
-                  /* _pplk1[3] = _mm256_setzero_pd(); */
-                  
-                  /* _pplk2[0] = _mm256_setzero_pd(); */
-                  /* _pplk2[1] = _mm256_setzero_pd(); */
-                  /* _pplk2[2] = _mm256_setzero_pd(); */
-                  /* _pplk2[3] = _mm256_setzero_pd(); */
-                  
-                  For(i,5)
+                  if(tip_lk_v1 != NULL) /* Tip lookup table */
+                    _pv1 = _mm256_load_pd(tip_lk_v1 + catg*dim2 + j*4);
+                  else
                     {
-                      For(k,4) _p1[k] = _mm256_load_pd(Pij1 + catg*dim3 + j*80 + i*4 + k*20);
-                      For(k,4) _p2[k] = _mm256_load_pd(Pij2 + catg*dim3 + j*80 + i*4 + k*20);
-
-                      /* _p1[0] = _mm256_load_pd(Pij1 + catg*dim3 + j*80 + i*4 + 0); */
-                      /* _p1[1] = _mm256_load_pd(Pij1 + catg*dim3 + j*80 + i*4 + 20); */
-                      /* _p1[2] = _mm256_load_pd(Pij1 + catg*dim3 + j*80 + i*4 + 40); */
-                      /* _p1[3] = _mm256_load_pd(Pij1 + catg*dim3 + j*80 + i*4 + 60); */
-                      
-                      /* _p2[0] = _mm256_load_pd(Pij2 + catg*dim3 + j*80 + i*4 + 0); */
-                      /* _p2[1] = _mm256_load_pd(Pij2 + catg*dim3 + j*80 + i*4 + 20); */
-                      /* _p2[2] = _mm256_load_pd(Pij2 + catg*dim3 + j*80 + i*4 + 40); */
-                      /* _p2[3] = _mm256_load_pd(Pij2 + catg*dim3 + j*80 + i*4 + 60); */
+                      For(k,4) _pplk1[k] = _mm256_setzero_pd();
+                      For(i,5)
+                        {
+                          For(k,4) _p1[k] = _mm256_load_pd(Pij1 + catg*dim3 + j*80 + i*4 + k*20);
+                          For(k,4) _pplk1[k] = _mm256_add_pd(_pplk1[k],_mm256_mul_pd(_p1[k],_plk1[i]));
+                        }
+                      _pv1 = AVX_Horizontal_Add(_pplk1);
+                    }
 
-                      For(k,4) _pplk1[k] = _mm256_add_pd(_pplk1[k],_mm256_mul_pd(_p1[k],_plk1[i]));
-                      For(k,4) _pplk2[k] = _mm256_add_pd(_pplk2[k],_mm256_mul_pd(_p2[k],_plk2[i]));
-                      
-                      /* _pplk1[0] = _mm256_add_pd(_pplk1[0],_mm256_mul_pd(_p1[0],_plk1[i])); */
-                      /* _pplk1[1] = _mm256_add_pd(_pplk1[1],_mm256_mul_pd(_p1[1],_plk1[i])); */
-                      /* _pplk1[2] = _mm256_add_pd(_pplk1[2],_mm256_mul_pd(_p1[2],_plk1[i])); */
-                      /* _pplk1[3] = _mm256_add_pd(_pplk1[3],_mm256_mul_pd(_p1[3],_plk1[i])); */
-                      
-                      /* _pplk2[0] = _mm256_add_pd(_pplk2[0],_mm256_mul_pd(_p2[0],_plk2[i])); */
-                      /* _pplk2[1] = _mm256_add_pd(_pplk2[1],_mm256_mul_pd(_p2[1],_plk2[i])); */
-                      /* _pplk2[2] = _mm256_add_pd(_pplk2[2],_mm256_mul_pd(_p2[2],_plk2[i])); */
-                      /* _pplk2[3] = _mm256_add_pd(_pplk2[3],_mm256_mul_pd(_p2[3],_plk2[i])); */
+                  if(tip_lk_v2 != NULL)
+                    _pv2 = _mm256_load_pd(tip_lk_v2 + catg*dim2 + j*4);
+                  else
+                    {
+                      For(k,4) _pplk2[k] = _mm256_setzero_pd();
+                      For(i,5)
+                        {
+                          For(k,4) _p2[k] = _mm256_load_pd(Pij2 + catg*dim3 + j*80 + i*4 + k*20);
+                          For(k,4) _pplk2[k] = _mm256_add_pd(_pplk2[k],_mm256_mul_pd(_p2[k],_plk2[i]));
+                        }
+                      _pv2 = AVX_Horizontal_Add(_pplk2);
                     }
-                  
-                  _plk = _mm256_mul_pd(AVX_Horizontal_Add(_pplk1),AVX_Horizontal_Add(_pplk2));
-                  _mm256_store_pd(p_lk+site*dim1+catg*dim2+j*4,_plk);
+
+                  _plk = _mm256_mul_pd(_pv1,_pv2);
+                  AVX_STORE_PLK(p_lk+site*dim1+catg*dim2+j*4,_plk);
 
                   /* printf("\n. %d %d -- %f %f %f %f", */
                   /*        site, */
@@ -5320,9 +6044,12 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                 }
 
               smallest_p_lk = BIG;
-              For(i,20) 
-                if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) 
-                  smallest_p_lk = p_lk[site*dim1+catg*dim2+i] ;
+              largest_p_lk  = .0;
+              For(i,20)
+                {
+                  if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i];
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i];
+                }
 
               /* Current scaling values at that site */
               sum_scale_v1_val = (sum_scale_v1)?(sum_scale_v1[catg*n_patterns+site]):(0);
@@ -5334,9 +6061,9 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < p_lk_lim_inf && tree->mod->augmented == NO)
+              curr_scaler_pow = (tree->mod->augmented == NO)?(P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree)):(0);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
                   
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -5369,7 +6096,20 @@ void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-#elif (defined (__SSE3__)) // __SSE3__
+#if defined(CPU_DISPATCH)
+#pragma GCC pop_options
+#endif
+#endif // AVX_KERNELS
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+#if defined(SSE_KERNELS)
+
+#if defined(CPU_DISPATCH)
+#pragma GCC push_options
+#pragma GCC target("sse3")
+#endif
 
 phydbl SSE_Lk_Core(int state, int ambiguity_check, t_edge *b, t_tree *tree)
 {
@@ -5441,7 +6181,7 @@ phydbl SSE_Lk_Core_Nucl(int state, int ambiguity_check, t_edge *b, t_tree *tree)
           // Partial likelihood vector on righthand side of b
           if(b->rght->tax == NO)
             {
-              For(i,2) _plk_r[i] = _mm_load_pd(b->p_lk_rght + site*dim1 + catg*dim2 + i*2);
+              For(i,2) _plk_r[i] = SSE_LOAD_PLK(b->p_lk_rght + site*dim1 + catg*dim2 + i*2);
             }
           else
             {
@@ -5449,7 +6189,7 @@ phydbl SSE_Lk_Core_Nucl(int state, int ambiguity_check, t_edge *b, t_tree *tree)
             }
 
           // Partial likelihood vector on lefthand side of b
-          For(i,2) _plk_l[i] = _mm_load_pd(b->p_lk_left + site*dim1 + catg*dim2 + i*2);
+          For(i,2) _plk_l[i] = SSE_LOAD_PLK(b->p_lk_left + site*dim1 + catg*dim2 + i*2);
 
           For(j,2)
             {
@@ -5670,7 +6410,7 @@ phydbl SSE_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree)
           // Partial likelihood vector on righthand side of b
           if(b->rght->tax == NO)
             {
-              For(i,10) _plk_r[i] = _mm_load_pd(b->p_lk_rght + site*dim1 + catg*dim2 + i*2);
+              For(i,10) _plk_r[i] = SSE_LOAD_PLK(b->p_lk_rght + site*dim1 + catg*dim2 + i*2);
             }
           else
             {
@@ -5678,7 +6418,7 @@ phydbl SSE_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree)
             }
 
           // Partial likelihood vector on lefthand side of b
-          For(i,10) _plk_l[i] = _mm_load_pd(b->p_lk_left + site*dim1 + catg*dim2 + i*2);
+          For(i,10) _plk_l[i] = SSE_LOAD_PLK(b->p_lk_left + site*dim1 + catg*dim2 + i*2);
 
           For(j,10)
             {
@@ -5836,7 +6576,7 @@ phydbl SSE_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
+void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
 {
 /*
            |
@@ -5849,7 +6589,7 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
     n_v1   n_v2
 */
   t_node *n_v1, *n_v2;//d's "left" and "right" neighbor nodes
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
   phydbl *Pij1,*Pij2;
   int *sum_scale, *sum_scale_v1, *sum_scale_v2;
   int sum_scale_v1_val, sum_scale_v2_val;
@@ -5859,10 +6599,10 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
   int dim1, dim2, dim3;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
-  phydbl p_lk_lim_inf;
+  phydbl smallest_p_lk,largest_p_lk;
   int *p_lk_loc;//Suppose site j, of a certain subtree, has "A" on one tip, and "C" on the other. If you come across this pattern again at site i<j, then you can simply copy the partial likelihoods
   phydbl tip_v1[4],tip_v2[4];
+  phydbl *tip_lk_v1,*tip_lk_v2;
   
 
   if(tree->n_root && tree->ignore_root == YES &&
@@ -5890,7 +6630,6 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 
   n_patterns = tree->n_pattern;
 
-  p_lk_lim_inf                = (phydbl)P_LK_LIM_INF;
   n_v1 = n_v2                 = NULL;
   p_lk = p_lk_v1 = p_lk_v2    = NULL;
   Pij1 = Pij2                 = NULL;
@@ -5910,9 +6649,12 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
     }
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
-      if(n_v1->tax == YES)
+      tip_lk_v1 = (n_v1->tax == YES)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (n_v2->tax == YES)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(n_v1->tax == YES && tip_lk_v1 == NULL)
         {
           tip_v1[0] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v1[1] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+1];
@@ -5920,7 +6662,7 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
           tip_v1[3] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+3];
         }
 
-      if(n_v2->tax == YES)
+      if(n_v2->tax == YES && tip_lk_v2 == NULL)
         {
           tip_v2[0] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v2[1] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+1];
@@ -5928,10 +6670,9 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
           tip_v2[3] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+3];
         }
 
-      if(p_lk_loc[site] < site)
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -5944,51 +6685,62 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 	      __m128d _plk1[2],_plk2[2];
 	      __m128d _p1[2],_p2[2];
 	      __m128d _pplk1[2],_pplk2[2];
+	      __m128d _pv1,_pv2;
 
-	      if(n_v1->tax == NO)
-		{         
-		  For(i,2) _plk1[i] = _mm_load_pd(p_lk_v1 + site*dim1 + catg*dim2 + i*2);
-		}
-	      else
+	      if(tip_lk_v1 == NULL)
 		{
-		  For(i,2) _plk1[i] = _mm_load_pd(tip_v1 + i*2);
+		  if(n_v1->tax == NO) For(i,2) _plk1[i] = SSE_LOAD_PLK(p_lk_v1 + site*dim1 + catg*dim2 + i*2);
+		  else                For(i,2) _plk1[i] = _mm_load_pd(tip_v1 + i*2);
 		}
 
-	      if(n_v2->tax == NO)
-		{
-		  For(i,2) _plk2[i] = _mm_load_pd(p_lk_v2 + site*dim1 + catg*dim2 + i*2);
-		}
-	      else
+	      if(tip_lk_v2 == NULL)
 		{
-		  For(i,2) _plk2[i] = _mm_load_pd(tip_v2 + i*2);
+		  if(n_v2->tax == NO) For(i,2) _plk2[i] = SSE_LOAD_PLK(p_lk_v2 + site*dim1 + catg*dim2 + i*2);
+		  else                For(i,2) _plk2[i] = _mm_load_pd(tip_v2 + i*2);
 		}
 
 
               For(j,2)
                 {
-                  For(i,2) _pplk1[i] = _mm_setzero_pd();
-                  For(i,2) _pplk2[i] = _mm_setzero_pd();
-
-                  For(i,2)
+                  if(tip_lk_v1 != NULL) /* Tip lookup table */
+                    _pv1 = _mm_load_pd(tip_lk_v1 + catg*dim2 + j*2);
+                  else
                     {
-                      For(k,2) _p1[k] = _mm_load_pd(Pij1 + catg*dim3 + j*8 + i*2 + k*4);
-                      For(k,2) _p2[k] = _mm_load_pd(Pij2 + catg*dim3 + j*8 + i*2 + k*4);
+                      For(i,2) _pplk1[i] = _mm_setzero_pd();
+                      For(i,2)
+                        {
+                          For(k,2) _p1[k] = _mm_load_pd(Pij1 + catg*dim3 + j*8 + i*2 + k*4);
+                          For(k,2) _pplk1[k] = _mm_hadd_pd(_pplk1[k],_mm_mul_pd(_p1[k],_plk1[i]));
+                        }
+                      _pv1 = _mm_hadd_pd(_pplk1[0],_pplk1[1]);
+                    }
 
-                      For(k,2) _pplk1[k] = _mm_hadd_pd(_pplk1[k],_mm_mul_pd(_p1[k],_plk1[i]));
-                      For(k,2) _pplk2[k] = _mm_hadd_pd(_pplk2[k],_mm_mul_pd(_p2[k],_plk2[i]));
+                  if(tip_lk_v2 != NULL)
+                    _pv2 = _mm_load_pd(tip_lk_v2 + catg*dim2 + j*2);
+                  else
+                    {
+                      For(i,2) _pplk2[i] = _mm_setzero_pd();
+                      For(i,2)
+                        {
+                          For(k,2) _p2[k] = _mm_load_pd(Pij2 + catg*dim3 + j*8 + i*2 + k*4);
+                          For(k,2) _pplk2[k] = _mm_hadd_pd(_pplk2[k],_mm_mul_pd(_p2[k],_plk2[i]));
+                        }
+                      _pv2 = _mm_hadd_pd(_pplk2[0],_pplk2[1]);
                     }
 
-                  _plk = _mm_mul_pd(_mm_hadd_pd(_pplk1[0],_pplk1[1]),
-                                    _mm_hadd_pd(_pplk2[0],_pplk2[1]));
+                  _plk = _mm_mul_pd(_pv1,_pv2);
 
-                  _mm_store_pd(p_lk + site*dim1 + catg*dim2 + j*2,_plk);
+                  SSE_STORE_PLK(p_lk + site*dim1 + catg*dim2 + j*2,_plk);
                 }
                                                  
 
               smallest_p_lk = BIG;
-              For(i,4) 
-                if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) 
-                  smallest_p_lk = p_lk[site*dim1+catg*dim2+i] ;
+              largest_p_lk  = .0;
+              For(i,4)
+                {
+                  if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i];
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i];
+                }
 
               /* Current scaling values at that site */
               sum_scale_v1_val = (sum_scale_v1)?(sum_scale_v1[catg*n_patterns+site]):(0);
@@ -6000,9 +6752,9 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < p_lk_lim_inf && tree->mod->augmented == NO)
+              curr_scaler_pow = (tree->mod->augmented == NO)?(P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree)):(0);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
                   
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -6035,7 +6787,7 @@ void SSE_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
+void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
 {
 /*
            |
@@ -6048,7 +6800,7 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
     n_v1   n_v2
 */
   t_node *n_v1, *n_v2;//d's "left" and "right" neighbor nodes
-  phydbl *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;//Partial likelihood vector of node d, d's "left" neighbor, d's "right" neighbor. We fill *p_lk, and assume *p_lk_v1 and *p_lk_v2 are already filled.
   phydbl *Pij1,*Pij2;
   int *sum_scale, *sum_scale_v1, *sum_scale_v2;
   int sum_scale_v1_val, sum_scale_v2_val;
@@ -6058,10 +6810,10 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
   int dim1, dim2, dim3;
   phydbl curr_scaler;
   int curr_scaler_pow, piecewise_scaler_pow;
-  phydbl smallest_p_lk;
-  phydbl p_lk_lim_inf;
+  phydbl smallest_p_lk,largest_p_lk;
   int *p_lk_loc;//Suppose site j, of a certain subtree, has "A" on one tip, and "C" on the other. If you come across this pattern again at site i<j, then you can simply copy the partial likelihoods
   phydbl tip_v1[20],tip_v2[20];
+  phydbl *tip_lk_v1,*tip_lk_v2;
   
 
   if(tree->n_root && tree->ignore_root == YES &&
@@ -6089,7 +6841,6 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 
   n_patterns = tree->n_pattern;
 
-  p_lk_lim_inf                = (phydbl)P_LK_LIM_INF;
   n_v1 = n_v2                 = NULL;
   p_lk = p_lk_v1 = p_lk_v2    = NULL;
   Pij1 = Pij2                 = NULL;
@@ -6110,9 +6861,12 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
     }
 
   /* For every site in the alignment */
-  For(site,n_patterns)
+  for(site=site_beg;site<site_end;site++)
     {
-      if(n_v1->tax == YES)
+      tip_lk_v1 = (n_v1->tax == YES)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (n_v2->tax == YES)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(n_v1->tax == YES && tip_lk_v1 == NULL)
         {
           tip_v1[0]  = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v1[1]  = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+1];
@@ -6136,7 +6890,7 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 	  tip_v1[19] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+19];
 	}
 
-      if(n_v2->tax == YES)
+      if(n_v2->tax == YES && tip_lk_v2 == NULL)
         {
           tip_v2[0]  = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+0];
           tip_v2[1]  = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+1];
@@ -6160,10 +6914,9 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 	  tip_v2[19] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+19];
 	}
 
-      if(p_lk_loc[site] < site)
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
         {
-          Copy_P_Lk(p_lk,p_lk_loc[site],site,tree);
-          Copy_Scale(sum_scale,p_lk_loc[site],site,tree);
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
         }
       else
         {
@@ -6176,52 +6929,63 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 	      __m128d _plk1[10],_plk2[10];
 	      __m128d _p1[2],_p2[2];
 	      __m128d _pplk1[2],_pplk2[2];
+	      __m128d _pv1,_pv2;
 
-	      if(n_v1->tax == NO)
-		{         
-		  For(i,10) _plk1[i] = _mm_load_pd(p_lk_v1 + site*dim1 + catg*dim2 + i*2);
-		}
-	      else
+	      if(tip_lk_v1 == NULL)
 		{
-		  For(i,10) _plk1[i] = _mm_load_pd(tip_v1 + i*2);
+		  if(n_v1->tax == NO) For(i,10) _plk1[i] = SSE_LOAD_PLK(p_lk_v1 + site*dim1 + catg*dim2 + i*2);
+		  else                For(i,10) _plk1[i] = _mm_load_pd(tip_v1 + i*2);
 		}
 
-	      if(n_v2->tax == NO)
-		{
-		  For(i,10) _plk2[i] = _mm_load_pd(p_lk_v2 + site*dim1 + catg*dim2 + i*2);
-		}
-	      else
+	      if(tip_lk_v2 == NULL)
 		{
-		  For(i,10) _plk2[i] = _mm_load_pd(tip_v2 + i*2);
+		  if(n_v2->tax == NO) For(i,10) _plk2[i] = SSE_LOAD_PLK(p_lk_v2 + site*dim1 + catg*dim2 + i*2);
+		  else                For(i,10) _plk2[i] = _mm_load_pd(tip_v2 + i*2);
 		}
 
 
               For(j,10)
                 {
-                  For(i,2) _pplk1[i] = _mm_setzero_pd();
-                  For(i,2) _pplk2[i] = _mm_setzero_pd();
-
-                  For(i,10)
+                  if(tip_lk_v1 != NULL) /* Tip lookup table */
+                    _pv1 = _mm_load_pd(tip_lk_v1 + catg*dim2 + j*2);
+                  else
                     {
-                      For(k,2) _p1[k] = _mm_load_pd(Pij1 + catg*dim3 + j*40 + i*2 + k*20);
-                      For(k,2) _p2[k] = _mm_load_pd(Pij2 + catg*dim3 + j*40 + i*2 + k*20);
+                      For(i,2) _pplk1[i] = _mm_setzero_pd();
+                      For(i,10)
+                        {
+                          For(k,2) _p1[k] = _mm_load_pd(Pij1 + catg*dim3 + j*40 + i*2 + k*20);
+                          For(k,2) _pplk1[k] = _mm_hadd_pd(_pplk1[k],_mm_mul_pd(_p1[k],_plk1[i]));
+                        }
+                      _pv1 = _mm_hadd_pd(_pplk1[0],_pplk1[1]);
+                    }
 
-                      For(k,2) _pplk1[k] = _mm_hadd_pd(_pplk1[k],_mm_mul_pd(_p1[k],_plk1[i]));
-                      For(k,2) _pplk2[k] = _mm_hadd_pd(_pplk2[k],_mm_mul_pd(_p2[k],_plk2[i]));
+                  if(tip_lk_v2 != NULL)
+                    _pv2 = _mm_load_pd(tip_lk_v2 + catg*dim2 + j*2);
+                  else
+                    {
+                      For(i,2) _pplk2[i] = _mm_setzero_pd();
+                      For(i,10)
+                        {
+                          For(k,2) _p2[k] = _mm_load_pd(Pij2 + catg*dim3 + j*40 + i*2 + k*20);
+                          For(k,2) _pplk2[k] = _mm_hadd_pd(_pplk2[k],_mm_mul_pd(_p2[k],_plk2[i]));
+                        }
+                      _pv2 = _mm_hadd_pd(_pplk2[0],_pplk2[1]);
                     }
 
-                  _plk = _mm_mul_pd(_mm_hadd_pd(_pplk1[0],_pplk1[1]),
-                                    _mm_hadd_pd(_pplk2[0],_pplk2[1]));
+                  _plk = _mm_mul_pd(_pv1,_pv2);
 
-                  _mm_store_pd(p_lk + site*dim1 + catg*dim2 + j*2,_plk);
+                  SSE_STORE_PLK(p_lk + site*dim1 + catg*dim2 + j*2,_plk);
                 }
                                                  
 
 
               smallest_p_lk = BIG;
-              For(i,20) 
-                if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) 
-                  smallest_p_lk = p_lk[site*dim1+catg*dim2+i] ;
+              largest_p_lk  = .0;
+              For(i,20)
+                {
+                  if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i];
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i];
+                }
 
               /* Current scaling values at that site */
               sum_scale_v1_val = (sum_scale_v1)?(sum_scale_v1[catg*n_patterns+site]):(0);
@@ -6233,9 +6997,9 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
                  smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
                  each element in the partial likelihood vector will be multiplied by
                  2^100. */
-              if(smallest_p_lk < p_lk_lim_inf && tree->mod->augmented == NO)
+              curr_scaler_pow = (tree->mod->augmented == NO)?(P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree)):(0);
+              if(curr_scaler_pow > 0)
                 {
-                  curr_scaler_pow = (int)(-500.*LOG2-LOG(smallest_p_lk))/LOG2;
                   curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
                   
                   sum_scale[catg*n_patterns+site] += curr_scaler_pow;
@@ -6268,11 +7032,679 @@ void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-#endif 
+#if defined(CPU_DISPATCH)
+#pragma GCC pop_options
+#endif
+#endif // SSE_KERNELS
+
+
+
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+#if defined(AVX512_KERNELS)
+
+#if defined(CPU_DISPATCH)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+// Sum of the elements in each of the eight vectors x[0],...,x[7]. The i-th
+// element of the returned vector is the sum of the elements in x[i]
+__m512d AVX512_Horizontal_Add(__m512d x[8])
+{
+  __m512d t[4],u[2];
+
+  // t[0] = [x00+x01;x10+x11;x02+x03;x12+x13;x04+x05;x14+x15;x06+x07;x16+x17]
+  t[0] = _mm512_add_pd(_mm512_unpacklo_pd(x[0],x[1]),_mm512_unpackhi_pd(x[0],x[1]));
+  t[1] = _mm512_add_pd(_mm512_unpacklo_pd(x[2],x[3]),_mm512_unpackhi_pd(x[2],x[3]));
+  t[2] = _mm512_add_pd(_mm512_unpacklo_pd(x[4],x[5]),_mm512_unpackhi_pd(x[4],x[5]));
+  t[3] = _mm512_add_pd(_mm512_unpacklo_pd(x[6],x[7]),_mm512_unpackhi_pd(x[6],x[7]));
+
+  // Sum of the 128-bit lanes, two by two
+  u[0] = _mm512_add_pd(_mm512_shuffle_f64x2(t[0],t[1],_MM_SHUFFLE(2,0,2,0)),
+                       _mm512_shuffle_f64x2(t[0],t[1],_MM_SHUFFLE(3,1,3,1)));
+  u[1] = _mm512_add_pd(_mm512_shuffle_f64x2(t[2],t[3],_MM_SHUFFLE(2,0,2,0)),
+                       _mm512_shuffle_f64x2(t[2],t[3],_MM_SHUFFLE(3,1,3,1)));
+
+  return(_mm512_add_pd(_mm512_shuffle_f64x2(u[0],u[1],_MM_SHUFFLE(2,0,2,0)),
+                       _mm512_shuffle_f64x2(u[0],u[1],_MM_SHUFFLE(3,1,3,1))));
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Product of two 4x4 matrices of transition probabilities (P1 and P2,
+// stored row by row) with a vector holding the partial likelihoods for
+// two successive rate classes ([v1;v2]). Returns [P1.v1;P2.v2]
+__m512d AVX512_Matrix_Vect_Nucl(phydbl *P1, phydbl *P2, __m512d v)
+{
+  __m512d x[4],t[2],s;
+  int i;
+
+  For(i,4) x[i] = _mm512_mul_pd(_mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_loadu_pd(P1+i*4)),
+                                                    _mm256_loadu_pd(P2+i*4),1),v);
+
+  t[0] = _mm512_add_pd(_mm512_unpacklo_pd(x[0],x[1]),_mm512_unpackhi_pd(x[0],x[1]));
+  t[1] = _mm512_add_pd(_mm512_unpacklo_pd(x[2],x[3]),_mm512_unpackhi_pd(x[2],x[3]));
+
+  // s = [P1.v1[0,1];P2.v2[0,1];P1.v1[2,3];P2.v2[2,3]]
+  s = _mm512_add_pd(_mm512_shuffle_f64x2(t[0],t[1],_MM_SHUFFLE(2,0,2,0)),
+                    _mm512_shuffle_f64x2(t[0],t[1],_MM_SHUFFLE(3,1,3,1)));
+
+  return(_mm512_shuffle_f64x2(s,s,_MM_SHUFFLE(3,1,2,0)));
+}
 
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
+// Product of a 20x20 matrix of transition probabilities P (stored row
+// by row) with the vector v. v and the result are held in three registers,
+// the last one holding the last four elements only (upper elements set to zero)
+void AVX512_Matrix_Vect_AA(phydbl *P, __m512d *v, __m512d *res)
+{
+  __m512d x[8];
+  int i,j,n;
 
+  For(j,3)
+    {
+      n = (j < 2)?(8):(4);
+      For(i,8)
+        {
+          if(i < n)
+            {
+              x[i] = _mm512_mul_pd(_mm512_loadu_pd(P+(j*8+i)*20),v[0]);
+              x[i] = _mm512_fmadd_pd(_mm512_loadu_pd(P+(j*8+i)*20+8),v[1],x[i]);
+              x[i] = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(0x0F,P+(j*8+i)*20+16),v[2],x[i]);
+            }
+          else x[i] = _mm512_setzero_pd();
+        }
+      res[j] = AVX512_Horizontal_Add(x);
+    }
+}
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+phydbl AVX512_Lk_Core(int state, int ambiguity_check, t_edge *b, t_tree *tree)
+{
+  phydbl log_site_lk;
+  phydbl site_lk, inv_site_lk;
+  int fact_sum_scale;
+  int catg,site;
+  int exponent;
+  int num_prec_issue;
+
+  log_site_lk     = .0;
+  site_lk         = .0;
+  site            = tree->curr_site;
+
+  /* Skip this if no tree traveral was required, i.e. likelihood in each class of the mixture is already up to date */
+  if(tree->mod->s_opt->skip_tree_traversal == NO)
+    {
+      if(tree->io->datatype == NT) AVX512_Lk_Core_Nucl(b,tree);
+      else                         AVX512_Lk_Core_AA(b,tree);
+
+      For(catg,tree->mod->ras->n_catg)
+        if(isinf(tree->site_lk_cat[catg]) || isnan(tree->site_lk_cat[catg]))
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+
+      Pull_Scaling_Factors(site,b,tree);
+    }
+  
+  fact_sum_scale = tree->fact_sum_scale[site];
+  
+  //Likelihood of the site is the sum of the individual rate specific likelihoods
+  site_lk = .0;
+  For(catg,tree->mod->ras->n_catg)
+    {
+      site_lk +=
+        tree->unscaled_site_lk_cat[catg*tree->n_pattern + site]* 
+        tree->mod->ras->gamma_r_proba->v[catg]; //density
+    }
+  
+
+  if(tree->mod->ras->invar == YES)
+    {
+      num_prec_issue = NO;
+      inv_site_lk = Invariant_Lk(fact_sum_scale,site,&num_prec_issue,tree);
+      
+      if(num_prec_issue == YES) // inv_site_lk >> site_lk
+        {
+          site_lk = inv_site_lk * tree->mod->ras->pinvar->v;
+        }
+      else
+        {
+          site_lk = site_lk * (1. - tree->mod->ras->pinvar->v) + inv_site_lk * tree->mod->ras->pinvar->v;
+        }
+    }
+  
+  log_site_lk = LOG(site_lk) - (phydbl)LOG2 * fact_sum_scale; // log_site_lk =  log(site_lk_scaled / 2^(left_subtree+right_subtree))      
+
+  // Calculation of the site likelihood (using scaling factors)...
+  int piecewise_exponent;
+  phydbl multiplier;
+  if(fact_sum_scale >= 0)
+    {
+      tree->cur_site_lk[site] = site_lk;
+      exponent = -fact_sum_scale;
+      do
+        {
+          piecewise_exponent = MAX(exponent,-63);
+          multiplier = 1. / (phydbl)((unsigned long long)(1) << -piecewise_exponent);
+          tree->cur_site_lk[site] *= multiplier;
+          exponent -= piecewise_exponent;
+        }
+      while(exponent != 0);
+    }
+  else
+    {
+      //In some cases fact_sum_scale can be negative. If you rescale the partials of two independent subtrees and make some of
+      //these numbers large in order to avoid underflow, then there is a chance that when multiplied them together you will
+      //get an overflow, in which case fact_sum_scale can become negative.
+      
+      tree->cur_site_lk[site] = site_lk;
+      exponent = fact_sum_scale;
+      do
+        {
+          piecewise_exponent = MIN(exponent,63);
+          multiplier = (phydbl)((unsigned long long)(1) << piecewise_exponent);
+          tree->cur_site_lk[site] *= multiplier;
+          exponent -= piecewise_exponent;
+        }
+      while(exponent != 0);
+    }
+  
+  // ... or using the log-likelihood
+  if(isinf(site_lk) || isnan(site_lk))
+    {
+      tree->cur_site_lk[site] = EXP(log_site_lk);
+    }
+  
+  if(isinf(log_site_lk) || isnan(log_site_lk))
+    {
+      PhyML_Printf("\n== Site = %d",site);
+      PhyML_Printf("\n== Invar = %d",tree->data->invar[site]);
+      PhyML_Printf("\n== Mixt = %d",tree->is_mixt_tree);
+      PhyML_Printf("\n== Lk = %G log(Lk) = %f < %G",site_lk,log_site_lk,-BIG);
+      For(catg,tree->mod->ras->n_catg) PhyML_Printf("\n== rr=%f p=%f",tree->mod->ras->gamma_rr->v[catg],tree->mod->ras->gamma_r_proba->v[catg]);
+      PhyML_Printf("\n== Pinv = %G",tree->mod->ras->pinvar->v);
+      PhyML_Printf("\n== Bl mult = %G",tree->mod->br_len_mult->v);
+      PhyML_Printf("\n== fact_sum_scale = %d",fact_sum_scale);
+      PhyML_Printf("\n== n_catg: %d",tree->mod->ras->n_catg);
+      Print_Site(tree->data,site,tree->n_otu,"\n",tree->mod->io->state_len,stdout);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+/* Multiply log likelihood by the number of times this site pattern is found in the data */
+  tree->c_lnL_sorted[site] = tree->data->wght[site]*log_site_lk;
+  
+  tree->c_lnL += tree->data->wght[site]*log_site_lk;
+
+  return log_site_lk;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Likelihood at site tree->curr_site for every rate class, with
+// nucleotide data. Two rate classes are processed at once. Results
+// are stored in tree->site_lk_cat
+void AVX512_Lk_Core_Nucl(t_edge *b, t_tree *tree)
+{
+  int catg,site,i;
+  int dim1,dim2,dim3;
+  __mmask8 mask;
+  __m512d _plk,_plk_l,_plk_r,_pi;
+  phydbl tip_v[8];
+  phydbl *Pij2;
+
+  dim1 = tree->mod->ras->n_catg * tree->mod->ns;
+  dim2 = tree->mod->ns;
+  dim3 = tree->mod->ns * tree->mod->ns;
+  site = tree->curr_site;
+
+  assert(dim2 == 4);
+
+  if(b->rght->tax == YES) For(i,8) tip_v[i] = (phydbl)b->p_lk_tip_r[site*dim2+i%4];
+
+  _pi = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_loadu_pd(tree->mod->e_frq->pi->v)),
+                           _mm256_loadu_pd(tree->mod->e_frq->pi->v),1);
+
+  for(catg=0;catg<tree->mod->ras->n_catg;catg+=2)
+    {
+      // Only one rate class left?
+      mask = (catg+1 < tree->mod->ras->n_catg)?(0xFF):(0x0F);
+      Pij2 = (mask == 0xFF)?(b->Pij_rr + (catg+1)*dim3):(b->Pij_rr + catg*dim3);
+
+      // Partial likelihood vector on righthand side of b
+      if(b->rght->tax == NO)
+        _plk_r = AVX512_MASKZ_LOADU_PLK(mask,b->p_lk_rght + site*dim1 + catg*dim2);
+      else
+        _plk_r = _mm512_maskz_loadu_pd(mask,tip_v);
+
+      // Partial likelihood vector on lefthand side of b
+      _plk_l = AVX512_MASKZ_LOADU_PLK(mask,b->p_lk_left + site*dim1 + catg*dim2);
+
+      _plk = AVX512_Matrix_Vect_Nucl(b->Pij_rr + catg*dim3,Pij2,_plk_r);
+      _plk = _mm512_mul_pd(_mm512_mul_pd(_plk,_plk_l),_pi);
+
+      tree->site_lk_cat[catg] = _mm512_mask_reduce_add_pd(0x0F,_plk);
+      if(mask == 0xFF) tree->site_lk_cat[catg+1] = _mm512_mask_reduce_add_pd(0xF0,_plk);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Likelihood at site tree->curr_site for every rate class, with
+// amino-acid data. Results are stored in tree->site_lk_cat
+void AVX512_Lk_Core_AA(t_edge *b, t_tree *tree)
+{
+  int catg,site,i;
+  int dim1,dim2,dim3;
+  __m512d _plk[3],_plk_l[3],_plk_r[3],_pi[3];
+  phydbl tip_v[20];
+
+  dim1 = tree->mod->ras->n_catg * tree->mod->ns;
+  dim2 = tree->mod->ns;
+  dim3 = tree->mod->ns * tree->mod->ns;
+  site = tree->curr_site;
+
+  assert(dim2 == 20);
+
+  if(b->rght->tax == YES) For(i,20) tip_v[i] = (phydbl)b->p_lk_tip_r[site*dim2+i];
+
+  _pi[0] = _mm512_loadu_pd(tree->mod->e_frq->pi->v);
+  _pi[1] = _mm512_loadu_pd(tree->mod->e_frq->pi->v+8);
+  _pi[2] = _mm512_maskz_loadu_pd(0x0F,tree->mod->e_frq->pi->v+16);
+
+  For(catg,tree->mod->ras->n_catg)
+    {
+      // Partial likelihood vector on righthand side of b
+      if(b->rght->tax == NO)
+        {
+          _plk_r[0] = AVX512_LOADU_PLK(b->p_lk_rght + site*dim1 + catg*dim2);
+          _plk_r[1] = AVX512_LOADU_PLK(b->p_lk_rght + site*dim1 + catg*dim2 + 8);
+          _plk_r[2] = AVX512_MASKZ_LOADU_PLK(0x0F,b->p_lk_rght + site*dim1 + catg*dim2 + 16);
+        }
+      else
+        {
+          _plk_r[0] = _mm512_loadu_pd(tip_v);
+          _plk_r[1] = _mm512_loadu_pd(tip_v+8);
+          _plk_r[2] = _mm512_maskz_loadu_pd(0x0F,tip_v+16);
+        }
+
+      // Partial likelihood vector on lefthand side of b
+      _plk_l[0] = AVX512_LOADU_PLK(b->p_lk_left + site*dim1 + catg*dim2);
+      _plk_l[1] = AVX512_LOADU_PLK(b->p_lk_left + site*dim1 + catg*dim2 + 8);
+      _plk_l[2] = AVX512_MASKZ_LOADU_PLK(0x0F,b->p_lk_left + site*dim1 + catg*dim2 + 16);
+
+      AVX512_Matrix_Vect_AA(b->Pij_rr + catg*dim3,_plk_r,_plk);
+
+      For(i,3) _plk[i] = _mm512_mul_pd(_mm512_mul_pd(_plk[i],_plk_l[i]),_pi[i]);
+
+      tree->site_lk_cat[catg] = _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(_plk[0],_plk[1]),_plk[2]));
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void AVX512_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
+{
+/*
+           |
+           |<- b
+           |
+           d
+          / \
+         /   \
+        /     \
+    n_v1   n_v2
+*/
+  t_node *n_v1, *n_v2;
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;
+  phydbl *Pij1,*Pij2;
+  int *sum_scale, *sum_scale_v1, *sum_scale_v2;
+  int sum_scale_v1_val, sum_scale_v2_val;
+  int i,c;
+  int catg,site;
+  int n_patterns;
+  int dim1, dim2, dim3;
+  phydbl curr_scaler;
+  int curr_scaler_pow, piecewise_scaler_pow;
+  phydbl smallest_p_lk,largest_p_lk;
+  int *p_lk_loc;
+  phydbl tip_v1[8],tip_v2[8];
+  phydbl *tip_lk_v1,*tip_lk_v2;
+  __mmask8 mask;
+  __m512d _plk,_plk1,_plk2;
+
+  dim1 = tree->mod->ras->n_catg * tree->mod->ns;
+  dim2 = tree->mod->ns;
+  dim3 = tree->mod->ns * tree->mod->ns;
+
+  sum_scale_v1_val = sum_scale_v2_val = 0;
+  curr_scaler = .0;
+  curr_scaler_pow = piecewise_scaler_pow = 0;
+
+  if(d->tax)
+    {
+      PhyML_Printf("\n== t_node %d is a leaf...",d->num);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  n_patterns = tree->n_pattern;
+
+  n_v1 = n_v2                 = NULL;
+  p_lk = p_lk_v1 = p_lk_v2    = NULL;
+  Pij1 = Pij2                 = NULL;
+  sum_scale_v1 = sum_scale_v2 = NULL;
+  p_lk_loc                    = NULL;
+  Set_All_P_Lk(&n_v1,&n_v2,
+               &p_lk,&sum_scale,&p_lk_loc,
+               &Pij1,&p_lk_v1,&sum_scale_v1,
+               &Pij2,&p_lk_v2,&sum_scale_v2,
+               d,b,tree);
+  
+  if(tree->mod->augmented == YES)
+    {
+      PhyML_Printf("\n== AVX-512 version of the Update_Partial_Lk function does not");
+      PhyML_Printf("\n== allow augmented data.");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  /* For every site in the alignment */
+  for(site=site_beg;site<site_end;site++)
+    {
+      tip_lk_v1 = (n_v1 && n_v1->tax == YES)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (n_v2 && n_v2->tax == YES)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(n_v1 && n_v1->tax == YES && tip_lk_v1 == NULL) For(i,8) tip_v1[i] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+i%4];
+      if(n_v2 && n_v2->tax == YES && tip_lk_v2 == NULL) For(i,8) tip_v2[i] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+i%4];
+
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
+        {
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
+        }
+      else
+        {
+          /* Two rate classes at a time */
+          for(catg=0;catg<tree->mod->ras->n_catg;catg+=2)
+            {
+              mask = (catg+1 < tree->mod->ras->n_catg)?(0xFF):(0x0F);
+              c    = (mask == 0xFF)?(catg+1):(catg);
+
+              if(n_v1 == NULL) _plk1 = _mm512_set1_pd(1.0);
+              else if(tip_lk_v1 != NULL) _plk1 = _mm512_maskz_loadu_pd(mask,tip_lk_v1 + catg*dim2); /* Tip lookup table */
+              else
+                {
+                  if(n_v1->tax == NO) _plk1 = AVX512_MASKZ_LOADU_PLK(mask,p_lk_v1 + site*dim1 + catg*dim2);
+                  else                _plk1 = _mm512_maskz_loadu_pd(mask,tip_v1);
+                  _plk1 = AVX512_Matrix_Vect_Nucl(Pij1 + catg*dim3,Pij1 + c*dim3,_plk1);
+                }
+
+              if(n_v2 == NULL) _plk2 = _mm512_set1_pd(1.0);
+              else if(tip_lk_v2 != NULL) _plk2 = _mm512_maskz_loadu_pd(mask,tip_lk_v2 + catg*dim2); /* Tip lookup table */
+              else
+                {
+                  if(n_v2->tax == NO) _plk2 = AVX512_MASKZ_LOADU_PLK(mask,p_lk_v2 + site*dim1 + catg*dim2);
+                  else                _plk2 = _mm512_maskz_loadu_pd(mask,tip_v2);
+                  _plk2 = AVX512_Matrix_Vect_Nucl(Pij2 + catg*dim3,Pij2 + c*dim3,_plk2);
+                }
+
+              _plk = _mm512_mul_pd(_plk1,_plk2);
+              AVX512_MASK_STOREU_PLK(p_lk + site*dim1 + catg*dim2,mask,_plk);
+            }
+
+          For(catg,tree->mod->ras->n_catg)
+            {
+              smallest_p_lk = BIG;
+              largest_p_lk  = .0;
+              For(i,4)
+                {
+                  if(p_lk[site*dim1+catg*dim2+i] < smallest_p_lk) smallest_p_lk = p_lk[site*dim1+catg*dim2+i];
+                  if(p_lk[site*dim1+catg*dim2+i] > largest_p_lk)  largest_p_lk  = p_lk[site*dim1+catg*dim2+i];
+                }
+
+              if(isinf(smallest_p_lk) || isnan(smallest_p_lk)) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+
+              /* Current scaling values at that site */
+              sum_scale_v1_val = (sum_scale_v1)?(sum_scale_v1[catg*n_patterns+site]):(0);
+              sum_scale_v2_val = (sum_scale_v2)?(sum_scale_v2[catg*n_patterns+site]):(0);
+              
+              sum_scale[catg*n_patterns+site] = sum_scale_v1_val + sum_scale_v2_val;
+              
+              /* Scaling. We have p_lk_lim_inf = 2^-500. Consider for instance that
+                 smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
+                 each element in the partial likelihood vector will be multiplied by
+                 2^100. */
+              curr_scaler_pow = P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree);
+              if(curr_scaler_pow > 0)
+                {
+                  curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
+                  
+                  sum_scale[catg*n_patterns+site] += curr_scaler_pow;
+                  
+                  do
+                    {
+                      piecewise_scaler_pow = MIN(curr_scaler_pow,63);
+                      curr_scaler = (phydbl)((unsigned long long)(1) << piecewise_scaler_pow);
+                      For(i,tree->mod->ns)
+                        {
+                          p_lk[site*dim1+catg*dim2+i] *= curr_scaler;
+                          
+                          if(p_lk[site*dim1+catg*dim2+i] > BIG)
+                            {
+                              PhyML_Printf("\n== curr_scaler_pow = %d",curr_scaler_pow);
+                              PhyML_Printf("\n== Err. in file %s at line %d (function '%s').",__FILE__,__LINE__,__FUNCTION__);
+                              Exit("\n");
+                            }
+                        }
+                      curr_scaler_pow -= piecewise_scaler_pow;
+                    }
+                  while(curr_scaler_pow != 0);
+                }
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void AVX512_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end)
+{
+/*
+           |
+           |<- b
+           |
+           d
+          / \
+         /   \
+        /     \
+    n_v1   n_v2
+*/
+  t_node *n_v1, *n_v2;
+  phyplk *p_lk,*p_lk_v1,*p_lk_v2;
+  phydbl *Pij1,*Pij2;
+  int *sum_scale, *sum_scale_v1, *sum_scale_v2;
+  int sum_scale_v1_val, sum_scale_v2_val;
+  int i;
+  int catg,site;
+  int n_patterns;
+  int dim1, dim2, dim3;
+  phydbl curr_scaler;
+  int curr_scaler_pow, piecewise_scaler_pow;
+  phydbl smallest_p_lk,largest_p_lk;
+  int *p_lk_loc;
+  phydbl tip_v1[20],tip_v2[20];
+  phydbl *tip_lk_v1,*tip_lk_v2;
+  __m512d _plk[3],_plk1[3],_plk2[3],_v[3];
+
+  dim1 = tree->mod->ras->n_catg * tree->mod->ns;
+  dim2 = tree->mod->ns;
+  dim3 = tree->mod->ns * tree->mod->ns;
+
+  sum_scale_v1_val = sum_scale_v2_val = 0;
+  curr_scaler = .0;
+  curr_scaler_pow = piecewise_scaler_pow = 0;
+
+  if(d->tax)
+    {
+      PhyML_Printf("\n== t_node %d is a leaf...",d->num);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  n_patterns = tree->n_pattern;
+
+  n_v1 = n_v2                 = NULL;
+  p_lk = p_lk_v1 = p_lk_v2    = NULL;
+  Pij1 = Pij2                 = NULL;
+  sum_scale_v1 = sum_scale_v2 = NULL;
+  p_lk_loc                    = NULL;
+  Set_All_P_Lk(&n_v1,&n_v2,
+               &p_lk,&sum_scale,&p_lk_loc,
+               &Pij1,&p_lk_v1,&sum_scale_v1,
+               &Pij2,&p_lk_v2,&sum_scale_v2,
+               d,b,tree);
+
+  if(tree->mod->augmented == YES)
+    {
+      PhyML_Printf("\n== AVX-512 version of the Update_Partial_Lk function does not");
+      PhyML_Printf("\n== allow augmented data.");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  /* For every site in the alignment */
+  for(site=site_beg;site<site_end;site++)
+    {
+      tip_lk_v1 = (n_v1 && n_v1->tax == YES)?(Tip_Lk_Row(n_v1,Pij1,site,tree)):(NULL);
+      tip_lk_v2 = (n_v2 && n_v2->tax == YES)?(Tip_Lk_Row(n_v2,Pij2,site,tree)):(NULL);
+
+      if(n_v1 && n_v1->tax == YES && tip_lk_v1 == NULL) For(i,20) tip_v1[i] = (phydbl)n_v1->b[0]->p_lk_tip_r[site*dim2+i];
+      if(n_v2 && n_v2->tax == YES && tip_lk_v2 == NULL) For(i,20) tip_v2[i] = (phydbl)n_v2->b[0]->p_lk_tip_r[site*dim2+i];
+
+      if(p_lk_loc[site] < site) /* Have we seen this pattern before? */
+        {
+          /* Yes: copied from its first occurrence in Scatter_P_Lk_Repeats */
+        }
+      else
+        {
+          /* For all rate classes */
+          For(catg,tree->mod->ras->n_catg)
+            {
+              if(n_v1 == NULL) For(i,3) _plk1[i] = _mm512_set1_pd(1.0);
+              else if(tip_lk_v1 != NULL) /* Tip lookup table */
+                {
+                  _plk1[0] = _mm512_loadu_pd(tip_lk_v1 + catg*dim2);
+                  _plk1[1] = _mm512_loadu_pd(tip_lk_v1 + catg*dim2 + 8);
+                  _plk1[2] = _mm512_maskz_loadu_pd(0x0F,tip_lk_v1 + catg*dim2 + 16);
+                }
+              else
+                {
+                  if(n_v1->tax == NO)
+                    {
+                      _v[0] = AVX512_LOADU_PLK(p_lk_v1 + site*dim1 + catg*dim2);
+                      _v[1] = AVX512_LOADU_PLK(p_lk_v1 + site*dim1 + catg*dim2 + 8);
+                      _v[2] = AVX512_MASKZ_LOADU_PLK(0x0F,p_lk_v1 + site*dim1 + catg*dim2 + 16);
+                    }
+                  else
+                    {
+                      _v[0] = _mm512_loadu_pd(tip_v1);
+                      _v[1] = _mm512_loadu_pd(tip_v1+8);
+                      _v[2] = _mm512_maskz_loadu_pd(0x0F,tip_v1+16);
+                    }
+                  AVX512_Matrix_Vect_AA(Pij1 + catg*dim3,_v,_plk1);
+                }
+
+              if(n_v2 == NULL) For(i,3) _plk2[i] = _mm512_set1_pd(1.0);
+              else if(tip_lk_v2 != NULL) /* Tip lookup table */
+                {
+                  _plk2[0] = _mm512_loadu_pd(tip_lk_v2 + catg*dim2);
+                  _plk2[1] = _mm512_loadu_pd(tip_lk_v2 + catg*dim2 + 8);
+                  _plk2[2] = _mm512_maskz_loadu_pd(0x0F,tip_lk_v2 + catg*dim2 + 16);
+                }
+              else
+                {
+                  if(n_v2->tax == NO)
+                    {
+                      _v[0] = AVX512_LOADU_PLK(p_lk_v2 + site*dim1 + catg*dim2);
+                      _v[1] = AVX512_LOADU_PLK(p_lk_v2 + site*dim1 + catg*dim2 + 8);
+                      _v[2] = AVX512_MASKZ_LOADU_PLK(0x0F,p_lk_v2 + site*dim1 + catg*dim2 + 16);
+                    }
+                  else
+                    {
+                      _v[0] = _mm512_loadu_pd(tip_v2);
+                      _v[1] = _mm512_loadu_pd(tip_v2+8);
+                      _v[2] = _mm512_maskz_loadu_pd(0x0F,tip_v2+16);
+                    }
+                  AVX512_Matrix_Vect_AA(Pij2 + catg*dim3,_v,_plk2);
+                }
+
+              For(i,3) _plk[i] = _mm512_mul_pd(_plk1[i],_plk2[i]);
+
+              AVX512_STOREU_PLK(p_lk + site*dim1 + catg*dim2,_plk[0]);
+              AVX512_STOREU_PLK(p_lk + site*dim1 + catg*dim2 + 8,_plk[1]);
+              AVX512_MASK_STOREU_PLK(p_lk + site*dim1 + catg*dim2 + 16,0x0F,_plk[2]);
+
+              smallest_p_lk = _mm512_reduce_min_pd(_mm512_min_pd(_mm512_min_pd(_plk[0],_plk[1]),
+                                                                 _mm512_mask_blend_pd(0x0F,_mm512_set1_pd(BIG),_plk[2])));
+              largest_p_lk  = _mm512_reduce_max_pd(_mm512_max_pd(_mm512_max_pd(_plk[0],_plk[1]),
+                                                                 _mm512_maskz_mov_pd(0x0F,_plk[2])));
+
+              if(isinf(smallest_p_lk) || isnan(smallest_p_lk)) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+
+              /* Current scaling values at that site */
+              sum_scale_v1_val = (sum_scale_v1)?(sum_scale_v1[catg*n_patterns+site]):(0);
+              sum_scale_v2_val = (sum_scale_v2)?(sum_scale_v2[catg*n_patterns+site]):(0);
+              
+              sum_scale[catg*n_patterns+site] = sum_scale_v1_val + sum_scale_v2_val;
+              
+              /* Scaling. We have p_lk_lim_inf = 2^-500. Consider for instance that
+                 smallest_p_lk = 2^-600, then curr_scaler_pow will be equal to 100, and
+                 each element in the partial likelihood vector will be multiplied by
+                 2^100. */
+              curr_scaler_pow = P_Lk_Scaler_Pow(smallest_p_lk,largest_p_lk,site,tree);
+              if(curr_scaler_pow > 0)
+                {
+                  curr_scaler     = (phydbl)((unsigned long long)(1) << curr_scaler_pow);
+                  
+                  sum_scale[catg*n_patterns+site] += curr_scaler_pow;
+                  
+                  do
+                    {
+                      piecewise_scaler_pow = MIN(curr_scaler_pow,63);
+                      curr_scaler = (phydbl)((unsigned long long)(1) << piecewise_scaler_pow);
+                      For(i,tree->mod->ns)
+                        {
+                          p_lk[site*dim1+catg*dim2+i] *= curr_scaler;
+                          
+                          if(p_lk[site*dim1+catg*dim2+i] > BIG)
+                            {
+                              PhyML_Printf("\n== curr_scaler_pow = %d",curr_scaler_pow);
+                              PhyML_Printf("\n== Err. in file %s at line %d (function '%s').",__FILE__,__LINE__,__FUNCTION__);
+                              Exit("\n");
+                            }
+                        }
+                      curr_scaler_pow -= piecewise_scaler_pow;
+                    }
+                  while(curr_scaler_pow != 0);
+                }
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+#if defined(CPU_DISPATCH)
+#pragma GCC pop_options
+#endif
+#endif // AVX512_KERNELS
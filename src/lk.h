@@ -21,10 +21,20 @@ the GNU public licence.  See http://www.opensource.org for details.
 #include "free.h"
 #include "times.h"
 #include "mixt.h"
+#include "thread.h"
+
+/*! Arguments passed to the threads that process a range of site patterns */
+typedef struct __Lk_Job {
+  void (*update_p_lk)(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end);
+  t_tree        *tree;
+  t_edge           *b;
+  t_node           *d;
+  phydbl        *expl;
+}t_lk_job;
 
 void Update_All_P_Lk(t_tree *tree);
-void Init_Tips_At_One_Site_Nucleotides_Float(char state, int pos, phydbl *p_lk);
-void Init_Tips_At_One_Site_AA_Float(char aa, int pos, phydbl *p_lk);
+void Init_Tips_At_One_Site_Nucleotides_Float(char state, int pos, phyplk *p_lk);
+void Init_Tips_At_One_Site_AA_Float(char aa, int pos, phyplk *p_lk);
 void Get_All_Partial_Lk(t_tree *tree,t_edge *b_fcus,t_node *a,t_node *d);
 void Get_All_Partial_Lk_Scale(t_tree *tree,t_edge *b_fcus,t_node *a,t_node *d);
 void Post_Order_Lk(t_node *pere, t_node *fils, t_tree *tree);
@@ -37,13 +47,31 @@ matrix *ML_Dist(calign *data, t_mod *mod);
 phydbl Lk_Given_Two_Seq(calign *data, int numseq1, int numseq2, phydbl dist, t_mod *mod, phydbl *loglk);
 void Unconstraint_Lk(t_tree *tree);
 void Update_P_Lk(t_tree *tree,t_edge *b_fcus,t_node *n);
-void Update_P_Lk_Generic(t_tree *tree,t_edge *b_fcus,t_node *n);
-void Update_P_Lk_AA(t_tree *tree,t_edge *b_fcus,t_node *n);
-void Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n);
+void Update_P_Lk_Generic(t_tree *tree,t_edge *b_fcus,t_node *n,int site_beg,int site_end);
+void Update_P_Lk_AA(t_tree *tree,t_edge *b_fcus,t_node *n,int site_beg,int site_end);
+void Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n,int site_beg,int site_end);
+void Update_P_Lk_Sites(int site_beg, int site_end, int thread_id, void *arg);
+void Scatter_P_Lk_Repeats(int site_beg, int site_end, int thread_id, void *arg);
+void Init_Lk_Kernel(int kernel);
+int Get_Lk_Kernel();
+int Lk_Kernel_Supported(int kernel);
+char *Lk_Kernel_Name(int kernel);
+void Bind_Lk_Kernels(t_tree *tree);
+void Lk_Sites(int site_beg, int site_end, int thread_id, void *arg);
+void Lk_Thread_Scratch(t_tree *tree);
 void Init_P_Lk_Tips_Double(t_tree *tree);
 void Init_P_Lk_Tips_Int(t_tree *tree);
 void Init_P_Lk_At_One_Node(t_node *a, t_tree *tree);
 void Update_PMat_At_Given_Edge(t_edge *b_fcus, t_tree *tree);
+int P_Lk_Is_Valid(t_edge *b, t_node *d);
+void Set_P_Lk_Invalid_Around(t_node *x, t_edge *b, t_tree *tree);
+void Set_P_Lk_Invalid_Br_Len(t_edge *b, t_tree *tree);
+void Set_All_P_Lk_Invalid(t_tree *tree);
+void Update_Invalid_P_Lk(t_edge *b, t_node *d, t_tree *tree);
+void Update_All_Invalid_P_Lk(t_tree *tree);
+void Update_Tip_Lk(t_edge *b, t_tree *tree);
+void Update_Tip_Lk_Around(t_node *d, t_tree *tree);
+phydbl *Tip_Lk_Row(t_node *tip, phydbl *Pij, int site, t_tree *tree);
 void Sort_Sites_Based_On_Lk(t_tree *tree);
 void Get_Partial_Lk_Scale(t_tree *tree, t_edge *b_fcus, t_node *a, t_node *d);
 void Get_Partial_Lk(t_tree *tree, t_edge *b_fcus, t_node *a, t_node *d);
@@ -60,13 +88,20 @@ void Print_Lk_Given_Edge_Recurr(t_node *a, t_node *d, t_edge *b, t_tree *tree);
 phydbl *Post_Prob_Rates_At_Given_Edge(t_edge *b, phydbl *post_prob, t_tree *tree);
 phydbl Lk_With_MAP_Branch_Rates(t_tree *tree);
 void Init_Tips_At_One_Site_Generic_Int(char *state, int ns, int state_len, int pos, short int *p_pars);
-void Init_Tips_At_One_Site_Generic_Float(char *state, int ns, int state_len, int pos, phydbl *p_lk);
+void Init_Tips_At_One_Site_Generic_Float(char *state, int ns, int state_len, int pos, phyplk *p_lk);
 void Alias_Subpatt(t_tree *tree);
 void Alias_One_Subpatt(t_node *a, t_node *d, t_tree *tree);
+int Site_Repeats(int *key1, int *key2, int *first, int *id, int n_sites);
 void Alias_Subpatt_Post(t_node *a, t_node *d, t_tree *tree);
 void Alias_Subpatt_Pre(t_node *a, t_node *d, t_tree *tree);
-void Copy_P_Lk(phydbl *p_lk, int site_from, int site_to, t_tree *tree);
+void Copy_P_Lk(phyplk *p_lk, int site_from, int site_to, t_tree *tree);
 void Copy_Scale(int *scale, int site_from, int site_to, t_tree *tree);
+int P_Lk_Scaler_Pow(phydbl smallest_p_lk, phydbl largest_p_lk, int site, t_tree *tree);
+#if defined(PLK_FLOAT)
+void Site_P_Lk_Double(t_node *a, t_node *d, t_edge *b, int site, phydbl *plk, int *scale, t_tree *tree);
+phydbl Lk_Site_Double(t_edge *b, int site, t_tree *tree);
+void Lk_Guarded_Sites(t_edge *b, t_tree *tree);
+#endif
 void Init_P_Lk_Loc(t_tree *tree);
 phydbl Lk_Normal_Approx(t_tree *tree);
 phydbl Wrap_Lk(t_edge *b, t_tree *tree, supert_tree *stree);
@@ -94,28 +129,77 @@ void Pull_Scaling_Factors(int site, t_edge *b, t_tree *tree);
 void Stepwise_Add_Lk(t_tree *tree);
 void Update_Eigen_Lr(t_edge *b, t_tree *tree);
 phydbl dLk(phydbl *l, t_edge *b, t_tree *tree);
-phydbl Lk_Core_One_Class(phydbl *p_lk_left, phydbl *p_lk_rght, 
+phydbl Lk_Core_Eigen_Lr(phydbl *eigen_lr_left, phydbl *eigen_lr_rght, phydbl *expl, int ns);
+phydbl Lk_Core_One_Class(phyplk *p_lk_left, phyplk *p_lk_rght, 
                          phydbl *Pij,
                          short int *p_lk_tip_r,
-                         phydbl *expl, 
                          int ns, int ambiguity_check, int state,
                          t_edge *b, t_tree *tree);
 
 
 
-#if defined(__AVX__)
+#if defined(AVX_KERNELS)
+/* Vector loads and stores of partial likelihoods. With PLK_FLOAT,
+   single precision values are widened to double precision on load
+   and narrowed back on store, so that the kernels below compute in
+   double precision whatever the storage type */
+#if defined(PLK_FLOAT)
+#define AVX_LOAD_PLK(p)       _mm256_cvtps_pd(_mm_loadu_ps(p))
+#define AVX_LOADU_PLK(p)      _mm256_cvtps_pd(_mm_loadu_ps(p))
+#define AVX_STORE_PLK(p,v)    _mm_storeu_ps(p,_mm256_cvtpd_ps(v))
+#define AVX_STOREU_PLK(p,v)   _mm_storeu_ps(p,_mm256_cvtpd_ps(v))
+#else
+#define AVX_LOAD_PLK(p)       _mm256_load_pd(p)
+#define AVX_LOADU_PLK(p)      _mm256_loadu_pd(p)
+#define AVX_STORE_PLK(p,v)    _mm256_store_pd(p,v)
+#define AVX_STOREU_PLK(p,v)   _mm256_storeu_pd(p,v)
+#endif
 __m256d AVX_Horizontal_Add(__m256d x[4]);
 phydbl AVX_Lk_Core(int state, int ambiguity_check, t_edge *b, t_tree *tree);
 phydbl AVX_Lk_Core_Nucl(int state, int ambiguity_check, t_edge *b, t_tree *tree);
 phydbl AVX_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree);
-void AVX_Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n);
-void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d);
-#elif defined(__SSE__)
+void AVX_Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n,int site_beg,int site_end);
+void AVX_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end);
+#endif
+
+#if defined(SSE_KERNELS)
+/* See AVX_LOAD_PLK */
+#if defined(PLK_FLOAT)
+#define SSE_LOAD_PLK(p)       _mm_cvtps_pd(_mm_loadl_pi(_mm_setzero_ps(),(__m64 const *)(p)))
+#define SSE_STORE_PLK(p,v)    _mm_storel_pi((__m64 *)(p),_mm_cvtpd_ps(v))
+#else
+#define SSE_LOAD_PLK(p)       _mm_load_pd(p)
+#define SSE_STORE_PLK(p,v)    _mm_store_pd(p,v)
+#endif
 phydbl SSE_Lk_Core(int state, int ambiguity_check, t_edge *b, t_tree *tree);
 phydbl SSE_Lk_Core_Nucl(int state, int ambiguity_check, t_edge *b, t_tree *tree);
 phydbl SSE_Lk_Core_AA(int state, int ambiguity_check, t_edge *b, t_tree *tree);
-void SSE_Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n);
-void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d);
+void SSE_Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n,int site_beg,int site_end);
+void SSE_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end);
+#endif
+
+#if defined(AVX512_KERNELS)
+/* See AVX_LOAD_PLK. Masked versions operate on the first elements of
+   the vector only (mask is an __mmask8) */
+#if defined(PLK_FLOAT)
+#define AVX512_LOADU_PLK(p)             _mm512_cvtps_pd(_mm256_loadu_ps(p))
+#define AVX512_MASKZ_LOADU_PLK(m,p)     _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps((__mmask16)(m),p)))
+#define AVX512_STOREU_PLK(p,v)          _mm256_storeu_ps(p,_mm512_cvtpd_ps(v))
+#define AVX512_MASK_STOREU_PLK(p,m,v)   _mm512_mask_storeu_ps(p,(__mmask16)(m),_mm512_castps256_ps512(_mm512_cvtpd_ps(v)))
+#else
+#define AVX512_LOADU_PLK(p)             _mm512_loadu_pd(p)
+#define AVX512_MASKZ_LOADU_PLK(m,p)     _mm512_maskz_loadu_pd(m,p)
+#define AVX512_STOREU_PLK(p,v)          _mm512_storeu_pd(p,v)
+#define AVX512_MASK_STOREU_PLK(p,m,v)   _mm512_mask_storeu_pd(p,m,v)
+#endif
+__m512d AVX512_Horizontal_Add(__m512d x[8]);
+__m512d AVX512_Matrix_Vect_Nucl(phydbl *P1, phydbl *P2, __m512d v);
+void AVX512_Matrix_Vect_AA(phydbl *P, __m512d *v, __m512d *res);
+phydbl AVX512_Lk_Core(int state, int ambiguity_check, t_edge *b, t_tree *tree);
+void AVX512_Lk_Core_Nucl(t_edge *b, t_tree *tree);
+void AVX512_Lk_Core_AA(t_edge *b, t_tree *tree);
+void AVX512_Update_P_Lk_Nucl(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end);
+void AVX512_Update_P_Lk_AA(t_tree *tree, t_edge *b, t_node *d, int site_beg, int site_end);
 #endif
 
 
@@ -0,0 +1,810 @@
+/*
+
+PHYML :  a program that  computes maximum likelihood  phylogenies from
+DNA or AA homologous sequences
+
+Copyright (C) Stephane Guindon. Oct 2003 onward
+
+All parts of  the source except where indicated  are distributed under
+the GNU public licence.  See http://www.opensource.org for details.
+
+*/
+
+/*
+
+Low-memory mode (--max_memory). When the partial likelihood vectors
+of internal nodes do not fit in the memory budget, edges do not own
+their vectors anymore. Vectors are taken from a bounded pool instead
+and a NULL p_lk_left (p_lk_rght) on an internal side of an edge means
+that the corresponding vector was recycled. When the pool is full,
+the least recently used vector that is not pinned is recycled. A
+vector that is needed again (in Update_P_Lk, Lk or dLk) is recomputed
+from the vectors (or tips) underneath, recursively. Recomputed vectors
+reflect the current branch lengths and model parameters.
+
+Vectors are identified by their address. Functions that swap
+p_lk_left/p_lk_rght pointers between edges (e.g., Swap, Prune_Subtree)
+therefore need not know about the pool. Likelihoods of rooted trees
+evaluated at the root node are not supported, as the edges that
+connect the root node share their vectors with the root edge.
+
+*/
+
+#include "lowmem.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static phyplk *LOWMEM_Alloc_Buff(size_t size)
+{
+  phyplk *p_lk;
+
+  p_lk = NULL;
+
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
+#ifndef WIN32
+  if(posix_memalign((void **)&p_lk,BYTE_ALIGN,size*sizeof(phyplk))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+#else
+  p_lk = _aligned_malloc(size*sizeof(phyplk),BYTE_ALIGN);
+#endif
+#else
+  p_lk = (phyplk *)mCalloc(size,sizeof(phyplk));
+#endif
+
+  return p_lk;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Index of p_lk in the pool, -1 if p_lk does not come from the pool */
+static int LOWMEM_Index(phyplk *p_lk, t_lowmem *pool)
+{
+  int i;
+
+  if(p_lk == NULL) return -1;
+  For(i,pool->n_buff) if(pool->buff[i] == p_lk) return i;
+  return -1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Add a new vector to the pool and return its index */
+static int LOWMEM_New_Buff(t_lowmem *pool)
+{
+  if(pool->n_buff == pool->size_buff)
+    {
+      pool->size_buff *= 2;
+      pool->buff  = (phyplk **)realloc(pool->buff,pool->size_buff*sizeof(phyplk *));
+      pool->owner = (phyplk ***)realloc(pool->owner,pool->size_buff*sizeof(phyplk **));
+      pool->stamp = (unsigned long int *)realloc(pool->stamp,pool->size_buff*sizeof(unsigned long int));
+      pool->pin   = (int *)realloc(pool->pin,pool->size_buff*sizeof(int));
+      if(!pool->buff || !pool->owner || !pool->stamp || !pool->pin) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  pool->buff[pool->n_buff]  = LOWMEM_Alloc_Buff(pool->buff_size);
+  pool->owner[pool->n_buff] = NULL;
+  pool->stamp[pool->n_buff] = 0;
+  pool->pin[pool->n_buff]   = 0;
+
+  return pool->n_buff++;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Take vector i away from the edge that holds it */
+static void LOWMEM_Evict(int i, t_tree *tree)
+{
+  t_lowmem *pool;
+  t_edge *b;
+  int j;
+
+  pool = tree->lowmem;
+
+  assert(pool->pin[i] == 0);
+
+  if(pool->owner[i] == NULL) return;
+
+  if(*(pool->owner[i]) == pool->buff[i]) *(pool->owner[i]) = NULL;
+  else
+    {
+      /* Vector was moved to another edge since it was last used */
+      For(j,2*tree->n_otu-3)
+        {
+          b = tree->a_edges[j];
+          if(b->p_lk_left == pool->buff[i]) b->p_lk_left = NULL;
+          if(b->p_lk_rght == pool->buff[i]) b->p_lk_rght = NULL;
+        }
+    }
+
+  pool->owner[i] = NULL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Make sure *field points to a vector of the pool. The content of
+   the vector is not defined if it had to be taken from the pool */
+static void LOWMEM_Acquire(phyplk **field, t_tree *tree)
+{
+  t_lowmem *pool;
+  int i,best;
+
+  pool = tree->lowmem;
+
+  best = LOWMEM_Index(*field,pool);
+
+  if(best < 0)
+    {
+      /* Free vector first, then new vector if budget allows, then least
+         recently used vector that is not pinned */
+      For(i,pool->n_buff) if(pool->owner[i] == NULL && pool->pin[i] == 0) { best = i; break; }
+
+      if(best < 0 && pool->n_buff < pool->max_buff) best = LOWMEM_New_Buff(pool);
+
+      if(best < 0)
+        {
+          For(i,pool->n_buff)
+            if(pool->pin[i] == 0 && (best < 0 || pool->stamp[i] < pool->stamp[best]))
+              best = i;
+
+          if(best > -1) LOWMEM_Evict(best,tree);
+        }
+
+      if(best < 0)
+        {
+          /* All vectors are in use. Go beyond the budget rather than fail */
+          if(pool->n_buff == pool->max_buff && !tree->io->quiet)
+            PhyML_Printf("\n. WARNING: memory budget for partial likelihoods exceeded (%d vectors in use).\n",pool->n_buff+1);
+          best = LOWMEM_New_Buff(pool);
+        }
+
+      *field = pool->buff[best];
+    }
+
+  pool->owner[best] = field;
+  pool->stamp[best] = ++pool->clock;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Set up a pool of partial likelihood vectors for tree if the memory
+   budget given with --max_memory is too small to store all of them.
+   Must be called before the edge structures are made */
+void LOWMEM_Init(t_tree *tree)
+{
+  t_lowmem *pool;
+  size_t buff_size;
+  phydbl buff_mb;
+  int n_vect,max_buff;
+
+  tree->lowmem = NULL;
+
+  if(tree->io == NULL || tree->io->max_memory <= 0.0) return;
+
+#ifdef BEAGLE
+  PhyML_Printf("\n. WARNING: option '--max_memory' is not available with BEAGLE.\n");
+  return;
+#endif
+
+  if(tree->is_mixt_tree == YES || tree->mixt_tree != NULL ||
+     tree->mod->use_m4mod == YES || tree->mod->s_opt->greedy == YES)
+    {
+      if(!tree->io->quiet) PhyML_Printf("\n. WARNING: option '--max_memory' is ignored with this model.\n");
+      return;
+    }
+
+  /* Vectors on the internal sides of the 2n-3 edges */
+  n_vect    = 2*(2*tree->n_otu-3) - tree->n_otu;
+  buff_size = (size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns;
+  buff_mb   = (phydbl)(buff_size*sizeof(phyplk))/(1024.*1024.);
+
+  if(n_vect*buff_mb <= tree->io->max_memory) return;
+
+  max_buff = (int)(tree->io->max_memory/buff_mb);
+
+  if(max_buff < LOWMEM_MIN_BUFF)
+    {
+      if(!tree->io->quiet)
+        PhyML_Printf("\n. WARNING: memory budget is too small. Keeping %d partial likelihood vectors (%.1f MB).\n",
+                     LOWMEM_MIN_BUFF,LOWMEM_MIN_BUFF*buff_mb);
+      max_buff = LOWMEM_MIN_BUFF;
+    }
+
+  pool = (t_lowmem *)mCalloc(1,sizeof(t_lowmem));
+
+  pool->tree      = tree;
+  pool->max_buff  = max_buff;
+  pool->size_buff = max_buff;
+  pool->buff_size = buff_size;
+  pool->n_buff    = 0;
+  pool->clock     = 0;
+  pool->buff      = (phyplk **)mCalloc(pool->size_buff,sizeof(phyplk *));
+  pool->owner     = (phyplk ***)mCalloc(pool->size_buff,sizeof(phyplk **));
+  pool->stamp     = (unsigned long int *)mCalloc(pool->size_buff,sizeof(unsigned long int));
+  pool->pin       = (int *)mCalloc(pool->size_buff,sizeof(int));
+
+  tree->lowmem = pool;
+
+  if(!tree->io->quiet)
+    PhyML_Printf("\n. Partial likelihoods: keeping at most %d of %d vectors (%.1f MB) in memory, the others are recomputed when needed.\n",
+                 max_buff,n_vect,max_buff*buff_mb);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void LOWMEM_Free(t_tree *tree)
+{
+  t_lowmem *pool;
+  int i;
+
+  pool = tree->lowmem;
+  if(pool == NULL) return;
+
+  if(pool->tree != NULL) LOWMEM_Detach(pool->tree);
+
+  For(i,pool->n_buff) Free(pool->buff[i]);
+  Free(pool->buff);
+  Free(pool->owner);
+  Free(pool->stamp);
+  Free(pool->pin);
+  Free(pool);
+
+  tree->lowmem = NULL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Edges of tree do not hold vectors of the pool anymore */
+void LOWMEM_Detach(t_tree *tree)
+{
+  t_lowmem *pool;
+  t_edge *b;
+  int i;
+
+  pool = tree->lowmem;
+  if(pool == NULL) return;
+
+  For(i,2*tree->n_otu-3)
+    {
+      b = tree->a_edges[i];
+      if(LOWMEM_Index(b->p_lk_left,pool) > -1) b->p_lk_left = NULL;
+      if(LOWMEM_Index(b->p_lk_rght,pool) > -1) b->p_lk_rght = NULL;
+    }
+
+  For(i,pool->n_buff)
+    {
+      pool->owner[i] = NULL;
+      pool->pin[i]   = 0;
+    }
+
+  if(pool->tree == tree) pool->tree = NULL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Hand the pool over to tree (e.g., a bootstrap tree that shares the
+   likelihood structures of the original one, see Share_Lk_Struct).
+   All vectors have to be recomputed */
+void LOWMEM_Attach(t_tree *tree)
+{
+  t_lowmem *pool;
+
+  pool = tree->lowmem;
+  if(pool == NULL || pool->tree == tree) return;
+
+  if(pool->tree != NULL) LOWMEM_Detach(pool->tree);
+  LOWMEM_Detach(tree);
+
+  pool->tree = tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Are the partial likelihoods on edge b taken from the pool? */
+int LOWMEM_Is_Pooled(t_edge *b, t_tree *tree)
+{
+  if(tree->lowmem == NULL) return NO;
+  if(b->num >= 2*tree->n_otu-3) return NO;
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static void LOWMEM_Check_Unrooted(t_tree *tree)
+{
+  if(tree->n_root != NULL && tree->ignore_root == NO)
+    {
+      PhyML_Printf("\n== Option '--max_memory' cannot be used when the likelihood is evaluated at the root node.");
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Field of edge b that holds the partial likelihoods of the subtree
+   rooted at d */
+phyplk **LOWMEM_Field(t_edge *b, t_node *d, t_tree *tree)
+{
+  return (d == b->left)?(&b->p_lk_left):(&b->p_lk_rght);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void LOWMEM_Pin(phyplk *p_lk, int incr, t_tree *tree)
+{
+  int i;
+
+  if(tree->lowmem == NULL) return;
+
+  i = LOWMEM_Index(p_lk,tree->lowmem);
+  if(i < 0) return;
+
+  tree->lowmem->pin[i] += incr;
+  assert(tree->lowmem->pin[i] >= 0);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Make sure the partial likelihoods of the subtree rooted at d
+   (looking away from edge b) are available, recomputing them if
+   needed */
+void LOWMEM_Fetch(t_edge *b, t_node *d, t_tree *tree)
+{
+  t_lowmem *pool;
+  phyplk **field;
+  int i;
+
+  pool = tree->lowmem;
+
+  if(pool == NULL || d->tax == YES || LOWMEM_Is_Pooled(b,tree) == NO) return;
+
+  if(pool->tree != tree) LOWMEM_Attach(tree);
+
+  field = LOWMEM_Field(b,d,tree);
+
+  if(*field != NULL)
+    {
+      i = LOWMEM_Index(*field,pool);
+      assert(i > -1);
+      pool->owner[i] = field;
+      pool->stamp[i] = ++pool->clock;
+      return;
+    }
+
+  Update_P_Lk(tree,b,d);
+  pool->n_recomp++;
+
+  assert(*field != NULL);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Partial likelihoods on both sides of b, kept until
+   LOWMEM_Release_Edge is called */
+void LOWMEM_Fetch_Edge(t_edge *b, t_tree *tree)
+{
+  if(tree->lowmem == NULL) return;
+
+  LOWMEM_Check_Unrooted(tree);
+
+  LOWMEM_Fetch(b,b->left,tree);
+  LOWMEM_Pin(b->p_lk_left,+1,tree);
+  LOWMEM_Fetch(b,b->rght,tree);
+  LOWMEM_Pin(b->p_lk_rght,+1,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void LOWMEM_Release_Edge(t_edge *b, t_tree *tree)
+{
+  if(tree->lowmem == NULL) return;
+
+  LOWMEM_Pin(b->p_lk_left,-1,tree);
+  LOWMEM_Pin(b->p_lk_rght,-1,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Before Update_P_Lk(tree,b,d): fetch the partial likelihoods of the
+   two subtrees underneath d and get a vector to store the result */
+void LOWMEM_Prepare_Update(t_edge *b, t_node *d, t_tree *tree)
+{
+  int i;
+
+  if(tree->lowmem == NULL) return;
+
+  LOWMEM_Check_Unrooted(tree);
+
+  if(tree->lowmem->tree != tree) LOWMEM_Attach(tree);
+
+  For(i,3)
+    if(d->b[i] != b)
+      {
+        LOWMEM_Fetch(d->b[i],d->v[i],tree);
+        LOWMEM_Pin(*LOWMEM_Field(d->b[i],d->v[i],tree),+1,tree);
+      }
+
+  if(LOWMEM_Is_Pooled(b,tree) == YES) LOWMEM_Acquire(LOWMEM_Field(b,d,tree),tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void LOWMEM_Release_Update(t_edge *b, t_node *d, t_tree *tree)
+{
+  int i;
+
+  if(tree->lowmem == NULL) return;
+
+  For(i,3)
+    if(d->b[i] != b)
+      LOWMEM_Pin(*LOWMEM_Field(d->b[i],d->v[i],tree),-1,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/*
+
+Out-of-core mode (--scratch_dir). The partial likelihoods and scaling
+factors of the internal sides of edges are stored in a scratch file
+that is mapped in memory. The operating system pages them in and out
+as they are needed, so that the memory footprint is bounded by what a
+traversal of the tree touches. Before a vector is used, madvise tells
+the kernel to start reading it in (LOWMEM_Map_Prefetch). The file is
+unlinked as soon as it is created, so it does not outlive the process.
+
+*/
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static size_t LOWMEM_Map_Round(size_t nbytes, size_t block)
+{
+  return ((nbytes + block - 1) / block) * block;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Create the scratch file (if --scratch_dir was given) and map it in
+   memory. Must be called after LOWMEM_Init and before the edge
+   structures are made */
+void LOWMEM_Map_Init(t_tree *tree)
+{
+  tree->plk_map = NULL;
+
+  if(tree->io == NULL || strlen(tree->io->scratch_dir) == 0) return;
+
+#if defined(HAVE_SYS_MMAN_H) && !defined(WIN32) && !defined(BEAGLE)
+  t_plk_map *map;
+  char *filename;
+  size_t plk_bytes,scale_bytes,size;
+  int n_catg,n_vect,fd;
+  void *addr;
+
+  if(tree->is_mixt_tree == YES || tree->mixt_tree != NULL || tree->mod->s_opt->greedy == YES)
+    {
+      if(!tree->io->quiet) PhyML_Printf("\n. WARNING: option '--scratch_dir' is ignored with this model.\n");
+      return;
+    }
+
+  n_catg      = MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes);
+  n_vect      = 2*(2*tree->n_otu-3) - tree->n_otu;
+  plk_bytes   = (size_t)tree->data->crunch_len*n_catg*tree->mod->ns*sizeof(phyplk);
+  scale_bytes = (size_t)tree->data->crunch_len*n_catg*sizeof(int);
+
+  map = (t_plk_map *)mCalloc(1,sizeof(t_plk_map));
+  map->block = (size_t)MAX(BYTE_ALIGN,sysconf(_SC_PAGESIZE));
+
+  /* Vectors taken from the pool of the low-memory mode stay in memory */
+  size = (size_t)n_vect*LOWMEM_Map_Round(scale_bytes,map->block);
+  if(tree->lowmem == NULL) size += (size_t)n_vect*LOWMEM_Map_Round(plk_bytes,map->block);
+
+  filename = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+  sprintf(filename,"%s/phyml_plk_XXXXXX",tree->io->scratch_dir);
+
+  fd = mkstemp(filename);
+  if(fd < 0)
+    {
+      PhyML_Printf("\n== Could not create a scratch file in directory '%s'.",tree->io->scratch_dir);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+  unlink(filename);
+
+  if(ftruncate(fd,(off_t)size) != 0)
+    {
+      PhyML_Printf("\n== Could not allocate %.0f MB in scratch file '%s'.",(phydbl)size/(1024.*1024.),filename);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  addr = mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+
+  if(addr == MAP_FAILED)
+    {
+      PhyML_Printf("\n== Could not map scratch file '%s' in memory.",filename);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  map->addr = (char *)addr;
+  map->size = size;
+  map->used = 0;
+
+  tree->plk_map = map;
+
+  if(!tree->io->quiet)
+    PhyML_Printf("\n. Partial likelihoods are stored in a %.0f MB scratch file in '%s'.\n",
+                 (phydbl)size/(1024.*1024.),tree->io->scratch_dir);
+
+  Free(filename);
+#else
+  PhyML_Printf("\n. WARNING: option '--scratch_dir' is not available on this platform.\n");
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static int LOWMEM_Map_Has(void *p, t_plk_map *map)
+{
+  return (p != NULL && (char *)p >= map->addr && (char *)p < map->addr + map->size)?(YES):(NO);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* nbytes (zeroed) from the scratch file for edge b. NULL if there is no
+   scratch file or no room left, in which case the caller allocates the
+   array in memory */
+void *LOWMEM_Map_Alloc(t_edge *b, size_t nbytes, t_tree *tree)
+{
+  t_plk_map *map;
+  void *p;
+
+  map = tree->plk_map;
+
+  if(map == NULL || b->num >= 2*tree->n_otu-3) return NULL;
+
+  nbytes = LOWMEM_Map_Round(nbytes,map->block);
+  if(map->used + nbytes > map->size) return NULL;
+
+  p = map->addr + map->used;
+  map->used += nbytes;
+
+  return p;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Unmap the scratch file. Edge fields that point to it are set to NULL
+   so that Free_Edge_Lk leaves them alone */
+void LOWMEM_Map_Free(t_tree *tree)
+{
+  t_plk_map *map;
+  t_edge *b;
+  int i;
+
+  map = tree->plk_map;
+  if(map == NULL) return;
+
+  For(i,2*tree->n_otu-3)
+    {
+      b = tree->a_edges[i];
+      if(LOWMEM_Map_Has(b->p_lk_left,map) == YES)      b->p_lk_left      = NULL;
+      if(LOWMEM_Map_Has(b->p_lk_rght,map) == YES)      b->p_lk_rght      = NULL;
+      if(LOWMEM_Map_Has(b->sum_scale_left,map) == YES) b->sum_scale_left = NULL;
+      if(LOWMEM_Map_Has(b->sum_scale_rght,map) == YES) b->sum_scale_rght = NULL;
+    }
+
+#if defined(HAVE_SYS_MMAN_H) && !defined(WIN32)
+  munmap(map->addr,map->size);
+#endif
+
+  Free(map);
+  tree->plk_map = NULL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static void LOWMEM_Map_Advise(void *p, size_t nbytes, t_plk_map *map)
+{
+#if defined(HAVE_SYS_MMAN_H) && !defined(WIN32)
+  if(LOWMEM_Map_Has(p,map) == NO) return;
+  madvise(p,LOWMEM_Map_Round(nbytes,map->block),MADV_WILLNEED);
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Ask the kernel to start reading in the partial likelihoods and
+   scaling factors of the subtree rooted at d (looking away from b) */
+void LOWMEM_Map_Prefetch(t_edge *b, t_node *d, t_tree *tree)
+{
+  t_plk_map *map;
+  int n_catg;
+
+  map = tree->plk_map;
+  if(map == NULL || d->tax == YES) return;
+
+  n_catg = MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes);
+
+  LOWMEM_Map_Advise(*LOWMEM_Field(b,d,tree),(size_t)tree->data->crunch_len*n_catg*tree->mod->ns*sizeof(phyplk),map);
+  LOWMEM_Map_Advise((d == b->left)?(b->sum_scale_left):(b->sum_scale_rght),(size_t)tree->data->crunch_len*n_catg*sizeof(int),map);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Prefetch the vectors read and written by Update_P_Lk(tree,b,d) */
+void LOWMEM_Map_Prefetch_Update(t_edge *b, t_node *d, t_tree *tree)
+{
+  int i;
+
+  if(tree->plk_map == NULL) return;
+
+  For(i,3)
+    if(d->b[i] != b)
+      LOWMEM_Map_Prefetch(d->b[i],d->v[i],tree);
+
+  LOWMEM_Map_Prefetch(b,d,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Prefetch the vectors of the update of the partial likelihoods of d
+   looking away from its neighbour a (nothing if a and d are not
+   neighbours anymore) */
+void LOWMEM_Map_Prefetch_Node(t_node *a, t_node *d, t_tree *tree)
+{
+  int i;
+
+  if(tree->plk_map == NULL || a == NULL || d == NULL || d->tax == YES) return;
+
+  For(i,3)
+    if(d->v[i] == a)
+      {
+        if(tree->n_root != NULL && d->b[i] == tree->e_root) return;
+        LOWMEM_Map_Prefetch_Update(d->b[i],d,tree);
+        return;
+      }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* YES if Post_Order_Lk and Pre_Order_Lk go from d to its neighbour
+   v[i] when a is the neighbour d is reached from */
+static int LOWMEM_Map_Is_Child(t_node *a, t_node *d, int i, t_tree *tree)
+{
+  if(d->v[i] == NULL || d->v[i] == a) return NO;
+  if(tree->n_root != NULL && d->b[i] == tree->e_root) return NO;
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Update that follows the current one in the traversal (NULL if
+   unknown) */
+void LOWMEM_Map_Get_Next(t_node **a, t_node **d, t_tree *tree)
+{
+  *a = *d = NULL;
+  if(tree->plk_map == NULL) return;
+  *a = tree->plk_map->next_a;
+  *d = tree->plk_map->next_d;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Called by Post_Order_Lk(a,d,tree) before it goes down to d->v[i].
+   The last update in that subtree is followed by the first update in
+   the subtree of the next child of d, i.e., by the update of its left-
+   most internal node whose children are tips, or by the update of d
+   itself. Record it so that it is prefetched in time */
+void LOWMEM_Map_Next_Post(t_node *a, t_node *d, int i, t_tree *tree)
+{
+  t_plk_map *map;
+  t_node *na,*nd;
+  int j,k;
+
+  map = tree->plk_map;
+  if(map == NULL) return;
+
+  map->next_a = a;
+  map->next_d = d;
+
+  for(j=i+1;j<3;j++) if(LOWMEM_Map_Is_Child(a,d,j,tree) == YES && d->v[j]->tax == NO) break;
+  if(j == 3) return;
+
+  na = d;
+  nd = d->v[j];
+  do
+    {
+      For(k,3) if(LOWMEM_Map_Is_Child(na,nd,k,tree) == YES && nd->v[k]->tax == NO) break;
+      if(k < 3)
+        {
+          na = nd;
+          nd = nd->v[k];
+        }
+    }
+  while(k < 3);
+
+  map->next_a = na;
+  map->next_d = nd;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Called by Pre_Order_Lk(a,d,tree) before it updates the partial
+   likelihoods of d looking away from d->v[i] and goes down to
+   d->v[i]. (next_a,next_d) is the update that follows the subtree of
+   d. Record the update that follows the subtree of d->v[i] (the one
+   for the next child of d) and prefetch the update that comes right
+   after the current one */
+void LOWMEM_Map_Next_Pre(t_node *a, t_node *d, int i, t_node *next_a, t_node *next_d, t_tree *tree)
+{
+  t_plk_map *map;
+  t_node *c;
+  int j;
+
+  map = tree->plk_map;
+  if(map == NULL) return;
+
+  map->next_a = next_a;
+  map->next_d = next_d;
+
+  for(j=i+1;j<3;j++)
+    if(LOWMEM_Map_Is_Child(a,d,j,tree) == YES)
+      {
+        map->next_a = d->v[j];
+        map->next_d = d;
+        break;
+      }
+
+  c = d->v[i];
+  if(c->tax == NO)
+    {
+      For(j,3)
+        if(LOWMEM_Map_Is_Child(d,c,j,tree) == YES)
+          {
+            LOWMEM_Map_Prefetch_Node(c->v[j],c,tree);
+            return;
+          }
+    }
+
+  LOWMEM_Map_Prefetch_Node(map->next_a,map->next_d,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
@@ -0,0 +1,45 @@
+/*
+
+PHYML :  a program that  computes maximum likelihood  phylogenies from
+DNA or AA homologous sequences
+
+Copyright (C) Stephane Guindon. Oct 2003 onward
+
+All parts of  the source except where indicated  are distributed under
+the GNU public licence.  See http://www.opensource.org for details.
+
+*/
+
+#include <config.h>
+
+#ifndef LOWMEM_H
+#define LOWMEM_H
+
+#include "utilities.h"
+
+/*! Smallest number of partial likelihood vectors in a pool */
+#define LOWMEM_MIN_BUFF  8
+
+void LOWMEM_Init(t_tree *tree);
+void LOWMEM_Free(t_tree *tree);
+void LOWMEM_Attach(t_tree *tree);
+void LOWMEM_Detach(t_tree *tree);
+int LOWMEM_Is_Pooled(t_edge *b, t_tree *tree);
+phyplk **LOWMEM_Field(t_edge *b, t_node *d, t_tree *tree);
+void LOWMEM_Fetch(t_edge *b, t_node *d, t_tree *tree);
+void LOWMEM_Fetch_Edge(t_edge *b, t_tree *tree);
+void LOWMEM_Release_Edge(t_edge *b, t_tree *tree);
+void LOWMEM_Prepare_Update(t_edge *b, t_node *d, t_tree *tree);
+void LOWMEM_Release_Update(t_edge *b, t_node *d, t_tree *tree);
+void LOWMEM_Pin(phyplk *p_lk, int incr, t_tree *tree);
+void LOWMEM_Map_Init(t_tree *tree);
+void *LOWMEM_Map_Alloc(t_edge *b, size_t nbytes, t_tree *tree);
+void LOWMEM_Map_Free(t_tree *tree);
+void LOWMEM_Map_Prefetch(t_edge *b, t_node *d, t_tree *tree);
+void LOWMEM_Map_Prefetch_Update(t_edge *b, t_node *d, t_tree *tree);
+void LOWMEM_Map_Prefetch_Node(t_node *a, t_node *d, t_tree *tree);
+void LOWMEM_Map_Get_Next(t_node **a, t_node **d, t_tree *tree);
+void LOWMEM_Map_Next_Post(t_node *a, t_node *d, int i, t_tree *tree);
+void LOWMEM_Map_Next_Pre(t_node *a, t_node *d, int i, t_node *next_a, t_node *next_d, t_tree *tree);
+
+#endif
@@ -51,6 +51,7 @@ int main(int argc, char **argv)
   int r_seed;
   char *most_likely_tree=NULL;
   int orig_random_input_tree;
+  unsigned int rand_start_seed;
 
 #ifdef MPI
   int rc;
@@ -85,7 +86,14 @@ int main(int argc, char **argv)
   io->colalias = NO;
 #endif
 
+  THREAD_Init_Pool(io->n_threads);
+  Init_Lk_Kernel(io->lk_kernel);
+
   r_seed = (io->r_seed < 0)?(time(NULL)):(io->r_seed);
+#ifdef MPI
+  /* Every process uses the seed of process 0 */
+  MPI_Bcast(&r_seed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
   srand(r_seed);
   io->r_seed = r_seed;
 
@@ -107,6 +115,8 @@ int main(int argc, char **argv)
   For(num_data_set,io->n_data_sets)
     {
       best_lnL = UNLIKELY;
+      time(&(io->t_budget_beg));
+      io->budget_best_lnL = UNLIKELY;
       Get_Seq(io);
       Make_Model_Complete(io->mod);
       Set_Model_Name(io->mod);
@@ -121,6 +131,8 @@ int main(int argc, char **argv)
 
           Free_Seq(io->data,cdata->n_otu);
 
+          if(io->n_ufboot > 0) io->ufboot = UFBOOT_Make(cdata,io->n_ufboot,io->r_seed);
+
           for(num_tree=(io->n_trees == 1)?(0):(num_data_set);num_tree < io->n_trees;num_tree++)
             {
               if(io->mod->s_opt->random_input_tree == NO) io->mod->s_opt->n_rand_starts = 1;
@@ -131,8 +143,21 @@ int main(int argc, char **argv)
                   Exit("\n");
                 }
 
-              For(num_rand_tree,io->mod->s_opt->n_rand_starts)
+              if(Rand_Starts_Threadable(io) == YES)
                 {
+                  time(&t_beg);
+                  most_likely_tree = Rand_Starts_Threaded(cdata,mod,io,num_data_set,num_tree,&best_lnL,most_likely_tree);
+                }
+              else For(num_rand_tree,io->mod->s_opt->n_rand_starts)
+                {
+                  /* As in Rand_Starts_Threaded, each start draws from its own
+                     stream, so that the results only depend on --r_seed */
+                  if(orig_random_input_tree == YES)
+                    {
+                      rand_start_seed = (unsigned int)Rand_Stream_Seed(io->r_seed,num_rand_tree);
+                      Rand_Set_Thread_Seed(&rand_start_seed);
+                    }
+
                   if((io->mod->s_opt->random_input_tree) && (io->mod->s_opt->topo_search != NNI_MOVE))
                     if(!io->quiet) PhyML_Printf("\n\n. [Random start %3d/%3d]",num_rand_tree+1,io->mod->s_opt->n_rand_starts);
 
@@ -273,6 +298,7 @@ int main(int argc, char **argv)
 
                   Set_Both_Sides(YES,tree);
                   Lk(NULL,tree);
+                  UFBOOT_Update(NULL,tree);
                   Pars(NULL,tree);
                   Get_Tree_Size(tree);
                   PhyML_Printf("\n\n. Log likelihood of the current tree: %f.",tree->c_lnL);
@@ -311,6 +337,8 @@ int main(int argc, char **argv)
                       most_likely_tree = Write_Tree(tree,NO);
                     }
 
+                  Time_Budget_Save(tree,YES);
+
                   time(&t_end);
 
                   Print_Fp_Out(io->fp_out_stats,t_beg,t_end,tree,
@@ -335,13 +363,23 @@ int main(int argc, char **argv)
                   Free_Tree_Pars(tree);
                   Free_Tree_Lk(tree);
                   Free_Tree(tree);
+
+                  Rand_Set_Thread_Seed(NULL);
                 } //Tree done
 
+              Rand_Set_Thread_Seed(NULL);
+
               /* Launch bootstrap analysis */
               if(mod->bootstrap)
                 {
+                  phydbl time_budget;
+
                   if(!io->quiet) PhyML_Printf("\n\n. Launch bootstrap analysis on the most likely tree...");
 
+                  /* The time budget only applies to the search for the most likely tree */
+                  time_budget     = io->time_budget;
+                  io->time_budget = -1.0;
+
 #ifdef MPI
                   MPI_Bcast (most_likely_tree, strlen(most_likely_tree)+1, MPI_CHAR, 0, MPI_COMM_WORLD);
                   if(!io->quiet)  PhyML_Printf("\n\n. The bootstrap analysis will use %d CPUs.",Global_numTask);
@@ -349,8 +387,14 @@ int main(int argc, char **argv)
                   
                   most_likely_tree = Bootstrap_From_String(most_likely_tree,cdata,mod,io);
 
+                  io->time_budget = time_budget;
+
                   PhyML_Printf("\n\n. Completed the bootstrap analysis succesfully."); fflush(NULL);
                 }
+              else if(io->ufboot != NULL)
+                {
+                  most_likely_tree = UFBOOT_From_String(most_likely_tree,cdata,mod,io);
+                }
               else
                 if(io->ratio_test != NO)
                   {
@@ -365,6 +409,13 @@ int main(int argc, char **argv)
 
               if(io->n_trees > 1 && io->n_data_sets > 1) break;
             }
+
+            if(io->ufboot != NULL)
+              {
+                UFBOOT_Free(io->ufboot);
+                io->ufboot = NULL;
+              }
+
             Free_Calign(cdata);
         }
     else
@@ -393,10 +444,13 @@ int main(int argc, char **argv)
   if(io->fp_out_stats)          fclose(io->fp_out_stats);
   if(io->fp_out_trace)          fclose(io->fp_out_trace);
   if(io->fp_out_json_trace)     fclose(io->fp_out_json_trace);
+  if(io->n_ufboot > 0 && io->fp_out_boot_tree) fclose(io->fp_out_boot_tree);
 
   if(io->fp_in_constraint_tree != NULL) Free_Tree(io->cstr_tree);
   Free_Input(io);
 
+  THREAD_Free_Pool();
+
   time(&t_end);
   Print_Time_Info(t_beg,t_end);
 
@@ -20,12 +20,15 @@ void Make_Tree_4_Lk(t_tree *tree, calign *cdata, int n_site)
 
   tree->c_lnL_sorted         = (phydbl *)mCalloc(tree->n_pattern,sizeof(phydbl));
   tree->cur_site_lk          = (phydbl *)mCalloc(tree->n_pattern,sizeof(phydbl));
+#if defined(PLK_FLOAT)
+  tree->plk_guard            = (short int *)mCalloc(tree->n_pattern,sizeof(short int));
+#endif
   tree->old_site_lk          = (phydbl *)mCalloc(tree->n_pattern,sizeof(phydbl));
   tree->site_lk_cat          = (phydbl *)mCalloc(MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(phydbl));
   tree->unscaled_site_lk_cat = (phydbl *)mCalloc(MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->n_pattern,sizeof(phydbl));
   tree->fact_sum_scale       = (int *)mCalloc(tree->n_pattern,sizeof(int));
 
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
   if(posix_memalign((void **)&tree->eigen_lr_left,BYTE_ALIGN,(size_t)tree->n_pattern*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
@@ -35,7 +38,7 @@ void Make_Tree_4_Lk(t_tree *tree, calign *cdata, int n_site)
   tree->eigen_lr_left = (phydbl *)mCalloc(tree->n_pattern * MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes) * tree->mod->ns,sizeof(phydbl));
 #endif
 
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
   if(posix_memalign((void **)&tree->eigen_lr_rght,BYTE_ALIGN,(size_t)tree->n_pattern*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
@@ -52,6 +55,10 @@ void Make_Tree_4_Lk(t_tree *tree, calign *cdata, int n_site)
 
   if(tree->is_mixt_tree == NO)
     {
+      /* The memory budget and the scratch file are set before the
+         partial likelihoods are allocated */
+      LOWMEM_Init(tree);
+      LOWMEM_Map_Init(tree);
       For(i,2*tree->n_otu-1) Make_Edge_Lk(tree->a_edges[i],tree);
       For(i,2*tree->n_otu-2) Make_Node_Lk(tree->a_nodes[i]);
       For(i,2*tree->n_otu-1) Make_Edge_Loc(tree->a_edges[i],tree);
@@ -82,6 +89,7 @@ void Make_Tree_4_Pars(t_tree *tree, calign *cdata, int n_site)
   int i;
   tree->site_pars = (int *)mCalloc(tree->n_pattern,sizeof(int));
   tree->step_mat = (int *)mCalloc(tree->mod->ns * tree->mod->ns,sizeof(int));
+  tree->pars_wght_bits = (pars_word *)mCalloc(PARS_MAX_WGHT_PLANES*PARS_N_WORDS(tree->data->crunch_len),sizeof(pars_word));
 
   For(i,2*tree->n_otu-1) Make_Edge_Pars(tree->a_edges[i],tree);
   Init_Ui_Tips(tree);
@@ -202,6 +210,7 @@ void Make_Edge_Pars_Left(t_edge *b, t_tree *tree)
   b->pars_l = (int *)mCalloc(tree->data->crunch_len,sizeof(int));
   b->ui_l = (unsigned int *)mCalloc(tree->data->crunch_len,sizeof(unsigned int));
   b->p_pars_l = (int *)mCalloc(tree->data->crunch_len*tree->mod->ns,sizeof(int ));
+  b->pars_bits_l = (pars_word *)mCalloc(PARS_N_WORDS(tree->data->crunch_len)*tree->mod->ns+1,sizeof(pars_word));
   b->n_diff_states_l = (int *)mCalloc(tree->mod->ns,sizeof(int ));
 }
 
@@ -213,6 +222,7 @@ void Make_Edge_Pars_Rght(t_edge *b, t_tree *tree)
   b->pars_r = (int *)mCalloc(tree->data->crunch_len,sizeof(int));
   b->ui_r = (unsigned int *)mCalloc(tree->data->crunch_len,sizeof(unsigned int));
   b->p_pars_r = (int *)mCalloc(tree->data->crunch_len*tree->mod->ns,sizeof(int ));
+  b->pars_bits_r = (pars_word *)mCalloc(PARS_N_WORDS(tree->data->crunch_len)*tree->mod->ns+1,sizeof(pars_word));
   b->n_diff_states_r = (int *)mCalloc(tree->mod->ns,sizeof(int ));
 }
 
@@ -229,7 +239,7 @@ void Make_Edge_Lk(t_edge *b, t_tree *tree)
 
   b->l_old->v = b->l->v;
 
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
   if(posix_memalign((void *)&b->Pij_rr,BYTE_ALIGN,(size_t)tree->mod->ras->n_catg*tree->mod->ns*tree->mod->ns*sizeof(phydbl))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
@@ -239,6 +249,19 @@ void Make_Edge_Lk(t_edge *b, t_tree *tree)
   b->Pij_rr = (phydbl *)mCalloc(tree->mod->ras->n_catg*tree->mod->ns*tree->mod->ns,sizeof(phydbl));
 #endif
 
+  b->Pij_rr_old = (phydbl *)mCalloc(tree->mod->ras->n_catg*tree->mod->ns*tree->mod->ns,sizeof(phydbl));
+
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
+#ifndef WIN32
+  if(posix_memalign((void *)&b->tip_lk,BYTE_ALIGN,(size_t)(tree->mod->ns+1)*tree->mod->ras->n_catg*tree->mod->ns*sizeof(phydbl))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+#else
+  b->tip_lk = _aligned_malloc((tree->mod->ns+1)*tree->mod->ras->n_catg*tree->mod->ns*sizeof(phydbl),BYTE_ALIGN);
+#endif
+#else
+  b->tip_lk = (phydbl *)mCalloc((tree->mod->ns+1)*tree->mod->ras->n_catg*tree->mod->ns,sizeof(phydbl));
+#endif
+  b->update_tip_lk = YES;
+
   Make_Edge_Lk_Left(b,tree);
   Make_Edge_Lk_Rght(b,tree);
 }
@@ -255,23 +278,39 @@ void Make_Edge_Lk_Left(t_edge *b, t_tree *tree)
   b->sum_scale_left_cat = (int *)mCalloc(MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
 
   if(b->left && !b->left->tax)
-    b->sum_scale_left = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
+    {
+      b->sum_scale_left = (int *)LOWMEM_Map_Alloc(b,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*sizeof(int),tree);
+      if(b->sum_scale_left == NULL)
+        b->sum_scale_left = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
+    }
   else
     b->sum_scale_left = NULL;
 
   if(b->left)
     {
-      if((!b->left->tax) || (tree->mod->s_opt->greedy))
+      if(LOWMEM_Is_Pooled(b,tree) == YES && !b->left->tax)
         {
-#if (defined(__AVX__) || defined(__SSE3__))
+          /* Vector is taken from the pool when needed */
+          b->p_lk_left  = NULL;
+          b->p_lk_tip_l = NULL;
+        }
+      else if((!b->left->tax) || (tree->mod->s_opt->greedy))
+        {
+          /* Vector is stored in the scratch file (--scratch_dir), if any */
+          b->p_lk_left = (phyplk *)LOWMEM_Map_Alloc(b,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk),tree);
+
+          if(b->p_lk_left == NULL)
+            {
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
-          if(posix_memalign((void **)&b->p_lk_left,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+              if(posix_memalign((void **)&b->p_lk_left,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
-          b->p_lk_left = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phydbl),BYTE_ALIGN);
+              b->p_lk_left = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk),BYTE_ALIGN);
 #endif
 #else
-          b->p_lk_left = (phydbl *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phydbl));
+              b->p_lk_left = (phyplk *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phyplk));
 #endif
+            }
           b->p_lk_tip_l = NULL;
         }
       else if(b->left->tax)
@@ -290,14 +329,14 @@ void Make_Edge_Lk_Left(t_edge *b, t_tree *tree)
     {
       b->sum_scale_left = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
 
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
-      if(posix_memalign((void **)&b->p_lk_left,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+      if(posix_memalign((void **)&b->p_lk_left,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
-      b->p_lk_left = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phydbl),BYTE_ALIGN);
+      b->p_lk_left = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk),BYTE_ALIGN);
 #endif
 #else
-      b->p_lk_left      = (phydbl *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phydbl));
+      b->p_lk_left      = (phyplk *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phyplk));
 #endif
     }
 
@@ -316,24 +355,40 @@ void Make_Edge_Lk_Rght(t_edge *b, t_tree *tree)
   b->sum_scale_rght_cat = (int *)mCalloc(MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
 
   if(b->rght && !b->rght->tax)
-    b->sum_scale_rght = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
+    {
+      b->sum_scale_rght = (int *)LOWMEM_Map_Alloc(b,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*sizeof(int),tree);
+      if(b->sum_scale_rght == NULL)
+        b->sum_scale_rght = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
+    }
   else
     b->sum_scale_rght = NULL;
 
 
   if(b->rght)
     {
-      if((!b->rght->tax) || (tree->mod->s_opt->greedy))
+      if(LOWMEM_Is_Pooled(b,tree) == YES && !b->rght->tax)
         {
-#if (defined(__AVX__) || defined(__SSE3__))
+          /* Vector is taken from the pool when needed */
+          b->p_lk_rght  = NULL;
+          b->p_lk_tip_r = NULL;
+        }
+      else if((!b->rght->tax) || (tree->mod->s_opt->greedy))
+        {
+          /* Vector is stored in the scratch file (--scratch_dir), if any */
+          b->p_lk_rght = (phyplk *)LOWMEM_Map_Alloc(b,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk),tree);
+
+          if(b->p_lk_rght == NULL)
+            {
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
-	  if(posix_memalign((void **)&b->p_lk_rght,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
-#else          
-          b->p_lk_rght = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phydbl),BYTE_ALIGN);
+              if(posix_memalign((void **)&b->p_lk_rght,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+#else
+              b->p_lk_rght = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk),BYTE_ALIGN);
 #endif
 #else
-          b->p_lk_rght = (phydbl *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phydbl));
+              b->p_lk_rght = (phyplk *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phyplk));
 #endif
+            }
           b->p_lk_tip_r = NULL;
         }
       else if(b->rght->tax)
@@ -351,16 +406,16 @@ void Make_Edge_Lk_Rght(t_edge *b, t_tree *tree)
   if(b->num >= 2*tree->n_otu-3)
     {
       b->sum_scale_rght = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
-      if(posix_memalign((void **)&b->p_lk_rght,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+      if(posix_memalign((void **)&b->p_lk_rght,BYTE_ALIGN,(size_t)tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
-      b->p_lk_rght      = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phydbl),BYTE_ALIGN);
+      b->p_lk_rght      = _aligned_malloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns*sizeof(phyplk),BYTE_ALIGN);
 #endif
 
 
 #else
-      b->p_lk_rght      = (phydbl *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phydbl));
+      b->p_lk_rght      = (phyplk *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phyplk));
 #endif
     }
 
@@ -745,7 +800,7 @@ void Make_Model_Complete(t_mod *mod)
   mod->Pij_rr = (vect_dbl *)mCalloc(1,sizeof(vect_dbl));
   Init_Vect_Dbl(0,mod->Pij_rr);
 
-#if (defined(__AVX__) || defined(__SSE3__))
+#if (defined(__AVX__) || defined(__SSE3__) || defined(CPU_DISPATCH))
 #ifndef WIN32
   if(posix_memalign((void **)&mod->Pij_rr->v,BYTE_ALIGN,(size_t)mod->ras->n_catg*mod->ns*mod->ns*sizeof(double))) Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
 #else
@@ -930,6 +985,8 @@ option *Make_Input()
   io->nt_or_cd                          = (char *)mCalloc(T_MAX_FILE,sizeof(char));
   io->run_id_string                     = (char *)mCalloc(T_MAX_OPTION,sizeof(char));
   io->clade_list_file                   = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+  io->scratch_dir                       = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+  io->out_budget_file                   = (char *)mCalloc(T_MAX_FILE,sizeof(char));
   io->alphabet                          = (char **)mCalloc(T_MAX_ALPHABET,sizeof(char *));
   For(i,T_MAX_ALPHABET) io->alphabet[i] = (char *)mCalloc(T_MAX_STATE,sizeof(char ));
   io->treelist                          = (t_treelist *)mCalloc(1,sizeof(t_treelist));
@@ -1128,6 +1185,31 @@ t_spr *Make_One_Spr(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+t_topo_memo *Make_Topo_Memo(t_tree *tree)
+{
+  t_topo_memo *memo;
+  int i;
+
+  memo       = (t_topo_memo *)mCalloc(1,sizeof(t_topo_memo));
+  memo->size = TOPO_MEMO_MIN_SIZE;
+  memo->key  = (unsigned long long *)mCalloc(memo->size,sizeof(unsigned long long));
+  memo->lnL  = (phydbl *)mCalloc(memo->size,sizeof(phydbl));
+  memo->tax  = (unsigned long long *)mCalloc(tree->n_otu,sizeof(unsigned long long));
+  memo->side = (unsigned long long *)mCalloc(2*tree->n_otu-1,sizeof(unsigned long long));
+
+  memo->all = 0;
+  For(i,tree->n_otu)
+    {
+      memo->tax[i] = Topo_Memo_Mix((unsigned long long)(i+1)*0x9E3779B97F4A7C15ULL);
+      memo->all ^= memo->tax[i];
+    }
+
+  return memo;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 t_rate *RATES_Make_Rate_Struct(int n_otu)
 {
   t_rate *rates;
@@ -55,6 +55,7 @@ t_ras *Make_RAS_Basic();
 void Make_Best_Spr(t_tree *tree);
 void Make_Spr_List(t_tree *tree);
 t_spr *Make_One_Spr(t_tree *tree);
+t_topo_memo *Make_Topo_Memo(t_tree *tree);
 void Make_Tree_4_Pars(t_tree *tree, calign *cdata, int n_site);
 t_string *Make_String(int len);
 t_mcmc *MCMC_Make_MCMC_Struct();
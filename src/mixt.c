@@ -862,14 +862,10 @@ phydbl MIXT_Lk(t_edge *mixt_b, t_tree *mixt_tree)
                           For(l,tree->mod->ns) expl[l] = (phydbl)POW(tree->mod->eigen->e_val[l],len);
                         }
 
-                      site_lk_cat = Lk_Core_One_Class(tree->eigen_lr_left + site,
-                                                      tree->eigen_lr_rght + site,
-                                                      NULL,
-                                                      NULL,
-                                                      expl,
-                                                      tree->mod->ns,
-                                                      -1,-1,
-                                                      b,tree);
+                      site_lk_cat = Lk_Core_Eigen_Lr(tree->eigen_lr_left + site,
+                                                     tree->eigen_lr_rght + site,
+                                                     expl,
+                                                     tree->mod->ns);
                     }
                   else // tree->use_eigen_lr == NO
                     {
@@ -877,7 +873,6 @@ phydbl MIXT_Lk(t_edge *mixt_b, t_tree *mixt_tree)
                                                       b->p_lk_rght + site*mixt_tree->mod->ns,
                                                       b->Pij_rr,
                                                       b->p_lk_tip_r + site*mixt_tree->mod->ns,
-                                                      NULL,
                                                       tree->mod->ns,ambiguity_check,state,
                                                       b,tree);
                     }
@@ -1943,168 +1938,258 @@ int MIXT_Pars(t_edge *mixt_b, t_tree *mixt_tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void MIXT_Bootstrap(char *best_tree, xml_node *root)
-{
-  xml_node *n,*p_elem;
-  char *bootstrap;
+/*! Non parametric bootstrap on the chained partition/mixture
+  structure built from the XML file. Sites are resampled within each
+  partition element and the tree search is repeated in memory, so
+  that no intermediate alignment or XML file is written.
+  The replicate trees are printed in the '_phyml_boot_trees.txt' file
+  and the most likely tree, with its bootstrap supports, is returned.
+*/
+char *MIXT_Bootstrap(char *best_tree, t_tree *mixt_tree)
+{
+  xml_node *n;
+  char *bootstrap,*s;
+  int n_boot,replicate,n_part,i,j,k,n_site;
+  int **site_num;
+  calign **orig_data;
+  t_tree *tree,*ref_tree,*boot_tree;
+  option *io;
+  int quiet,print_trace,print_json_trace;
 
-  assert(root);
-  
-  n = XML_Search_Node_Name("phyml",NO,root);
+  assert(mixt_tree);
+  assert(mixt_tree->xml_root);
+
+  n = XML_Search_Node_Name("phyml",NO,mixt_tree->xml_root);
 
   bootstrap = XML_Get_Attribute_Value(n,"bootstrap");
 
-  if(!bootstrap) return;
-  else
-    {
-      int n_boot,i,j,k;
-      xml_attr *boot_attr,*seqfile_attr,*out_attr,*boot_out_attr;
-      char *orig_align,*boot_out_file_name,*xml_boot_file_name,*buff;
-      FILE *boot_fp_in_align,*xml_boot_file_fp;
-      option *io,*dum;
-      align **boot_data,**orig_data;
-      int position,elem;
-      xml_node *boot_root;
-      int pid;
-      char *s;
-
-      orig_align = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-
-      xml_boot_file_name = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-      strcpy(xml_boot_file_name,"phyml_boot_config.");
-      pid = (int)getpid();
-      sprintf(xml_boot_file_name+strlen(xml_boot_file_name),"%d",pid);
-      strcat(xml_boot_file_name,".xml");
-
-      out_attr = XML_Search_Attribute(root,"output.file");
-      assert(out_attr);
-      boot_out_file_name = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-      strcpy(boot_out_file_name,out_attr->value);
-      s = XML_Get_Attribute_Value(root,"run.id");
-      if(s)
-        {
-          strcat(boot_out_file_name,"_");
-          strcat(boot_out_file_name,s);
-        }
-
-      n_boot = atoi(bootstrap);
-
-      io = NULL;
-      For(i,n_boot)
-        {
-          boot_root = XML_Copy_XML_Graph(root);
-
-          /*! Set the number of bootstrap repeats to 0
-            in each generated XML file */
-          boot_attr = XML_Search_Attribute(boot_root,"bootstrap");
-          assert(boot_attr);
-          strcpy(boot_attr->value,"0");
-
-          /*! Set the output file name for each bootstrap analysis */
-          boot_out_attr = XML_Search_Attribute(boot_root,"output.file");
-          assert(boot_out_attr);
-          buff = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-          strcpy(buff,boot_out_attr->value);
-          Free(boot_out_attr->value);
-          boot_out_attr->value = buff;
-          sprintf(boot_out_attr->value+strlen(boot_out_attr->value),"_boot.%d",pid);
-
-          p_elem = boot_root;
-          elem   = 0;
-          do
-            {
-              p_elem = XML_Search_Node_Name("partitionelem",YES,p_elem);
-              if(!p_elem) break;
+  if(!bootstrap) return best_tree;
 
-              io = (option *)Make_Input();
-              Set_Defaults_Input(io);
+  n_boot = atoi(bootstrap);
 
-              /*! Get the original sequence file name and the corresponding
-                attribute in the XML graph
-              */
-              seqfile_attr = NULL;
-              seqfile_attr = XML_Search_Attribute(p_elem,"file.name");
-              assert(seqfile_attr);
+  if(n_boot < 1) return best_tree;
 
-              strcpy(orig_align,seqfile_attr->value);
+  io = mixt_tree->io;
 
-              /*! Open the original sequence file */
-              io->fp_in_align = Openfile(orig_align,0);
+  strcpy(io->out_boot_tree_file,io->out_file);
+  if(io->append_run_ID) { strcat(io->out_boot_tree_file,"_"); strcat(io->out_boot_tree_file,io->run_id_string); }
+  strcat(io->out_boot_tree_file,"_phyml_boot_trees.txt");
+  io->fp_out_boot_tree = Openfile(io->out_boot_tree_file,1);
 
-              /*! Read in the original sequence file */
-              orig_data       = Get_Seq(io);
-              rewind(io->fp_in_align);
+  /*! Sites of each partition element, listed by pattern. During the
+    bootstrap, each partition element works on a copy of its data
+    that only holds the resampled patterns */
+  n_part = 0;
+  tree = mixt_tree;
+  do { n_part++; tree = tree->next_mixt; } while(tree);
 
-              /*! Read in the original sequence file and put
-               it in 'boot_data' structure */
-              boot_data       = Get_Seq(io);
+  site_num  = (int **)mCalloc(n_part,sizeof(int *));
+  orig_data = (calign **)mCalloc(n_part,sizeof(calign *));
 
-              fclose(io->fp_in_align);
+  i = 0;
+  tree = mixt_tree;
+  do
+    {
+      site_num[i] = (int *)mCalloc(tree->data->init_len,sizeof(int));
 
-              /*! Bootstrap resampling: sample from original and put in boot */
-              For(j,boot_data[0]->len)
-                {
-                  position = Rand_Int(0,(int)(boot_data[0]->len-1.0));
-                  For(k,io->n_otu)
-                    {
-                      boot_data[k]->state[j] = orig_data[k]->state[position];
-                    }
-                }
+      n_site = 0;
+      For(j,tree->data->crunch_len) For(k,(int)tree->data->wght[j]) site_num[i][n_site++] = j;
+      assert(n_site == tree->data->init_len);
 
-              /*! Modify the sequence file attribute in the original XML
-                graph */
-              buff = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-              Free(seqfile_attr->value);
-              seqfile_attr->value = buff;
-              sprintf(seqfile_attr->value,"%s_%d_%d",orig_align,elem,i);
+      orig_data[i] = tree->data;
+      MIXT_Set_Data(Copy_Cseq(orig_data[i],tree->io),tree);
 
-              /*! Open a new sequence file with the modified attribute name */
-              boot_fp_in_align = Openfile(seqfile_attr->value,1);
+      i++;
+      tree = tree->next_mixt;
+    }
+  while(tree);
 
-              /*! Print the bootstrap data set in it */
-              Print_Seq(boot_fp_in_align,boot_data,io->n_otu);
-              fclose(boot_fp_in_align);
+  /*! Reference tree, on which supports are collected */
+  ref_tree = Read_Tree(&best_tree);
+  ref_tree->n_root         = NULL;
+  ref_tree->e_root         = NULL;
+  ref_tree->mod            = mixt_tree->mod;
+  ref_tree->io             = io;
+  ref_tree->data           = mixt_tree->data;
+  ref_tree->n_pattern      = mixt_tree->data->crunch_len;
+  ref_tree->print_boot_val = YES;
+  ref_tree->print_alrt_val = NO;
 
+  Get_Bip_Bits(ref_tree,NULL,ref_tree->n_otu);
+  For(i,2*ref_tree->n_otu-3) ref_tree->a_edges[i]->bip_score = 0;
 
-              Free_Seq(orig_data,io->n_otu);
-              Free_Seq(boot_data,io->n_otu);
+  quiet            = io->quiet;
+  print_trace      = io->print_trace;
+  print_json_trace = io->print_json_trace;
 
+  io->quiet            = YES;
+  io->print_trace      = NO;
+  io->print_json_trace = NO;
 
-              Free_Input(io);
-              elem++;
-            }
-          while(p_elem);
+  PhyML_Printf("\n\n. Non parametric bootstrap analysis \n\n");
+  PhyML_Printf("  [");
 
-          /*! Open bootstrap XML file in writing mode */
-          xml_boot_file_fp = Openfile(xml_boot_file_name,1);
+  For(replicate,n_boot)
+    {
+      MIXT_Bootstrap_Resample(mixt_tree,orig_data,site_num);
 
-          /*! Write the bootstrap XML graph */
-          XML_Write_XML_Graph(xml_boot_file_fp,boot_root);
-          fclose(xml_boot_file_fp);
+      MIXT_Init_Model(mixt_tree);
+      tree = MIXT_Starting_Tree(mixt_tree);
+      Copy_Tree(tree,mixt_tree);
+      Free_Tree(tree);
 
-          /*! Reconstruct the tree */
-          dum = PhyML_XML(xml_boot_file_name);
-          Free(dum);
+      MIXT_Prepare_Search(mixt_tree);
+      MIXT_Search(mixt_tree);
 
-          /*! Remove the bootstrap alignment files */
-          p_elem = boot_root;
-          do
-            {
-              p_elem = XML_Search_Node_Name("partitionelem",YES,p_elem);
-              if(!p_elem) break;
-              seqfile_attr = XML_Search_Attribute(p_elem,"file.name");
-              /* unlink(seqfile_attr->value); */
-            }
-          while(p_elem);
+      Br_Len_Involving_Invar(mixt_tree);
+      Rescale_Br_Len_Multiplier_Tree(mixt_tree);
 
-          XML_Free_XML_Tree(boot_root);
+      s = Write_Tree(mixt_tree,NO);
+      PhyML_Fprintf(io->fp_out_boot_tree,"%s\n",s);
+      fflush(io->fp_out_boot_tree);
+
+      boot_tree = Read_Tree(&s);
+      Match_Tip_Numbers(ref_tree,boot_tree);
+      Get_Bip_Bits(boot_tree,NULL,boot_tree->n_otu);
+      Compare_Bip(ref_tree,boot_tree,NO);
+      Free_Tree(boot_tree);
+      Free(s);
+
+      Free_Spr_List(mixt_tree);
+      Free_Triplet(mixt_tree->triplet_struct);
+      Free_Tree_Pars(mixt_tree);
+      Free_Tree_Lk(mixt_tree);
+
+      PhyML_Printf(".");
+      if(!((replicate+1)%io->boot_prog_every))
+        {
+          PhyML_Printf("] %4d/%4d\n  ",replicate+1,n_boot);
+          if(replicate != n_boot-1) PhyML_Printf("[");
         }
+    }
+
+  if(n_boot%io->boot_prog_every) PhyML_Printf("] %4d/%4d\n ",n_boot,n_boot);
+
+  io->quiet            = quiet;
+  io->print_trace      = print_trace;
+  io->print_json_trace = print_json_trace;
+
+  /*! Put the original data back */
+  i = 0;
+  tree = mixt_tree;
+  do
+    {
+      Free_Calign(tree->data);
+      MIXT_Set_Data(orig_data[i],tree);
+      Free(site_num[i]);
+      i++;
+      tree = tree->next_mixt;
+    }
+  while(tree);
+
+  MIXT_Connect_Cseqs_To_Nodes(mixt_tree);
+
+  Free(site_num);
+  Free(orig_data);
+
+  fclose(io->fp_out_boot_tree);
+  io->fp_out_boot_tree = NULL;
+
+  Free(best_tree);
+  best_tree = Write_Tree(ref_tree,NO);
+  Free_Tree(ref_tree);
+
+  return best_tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/*! Resample the sites of each partition element. orig_data[i] and
+  site_num[i] are the original data of the i-th partition element and
+  the pattern of each of its sites. The resampled data replace the
+  content of the copy attached to the partition element. */
+void MIXT_Bootstrap_Resample(t_tree *mixt_tree, calign **orig_data, int **site_num)
+{
+  t_tree *tree;
+  int i;
 
-      Free(xml_boot_file_name);
-      Free(orig_align);
-      Free(boot_out_file_name);
+  i = 0;
+  tree = mixt_tree;
+  do
+    {
+      Bootstrap_Resample(orig_data[i],tree->data,site_num[i],tree->io);
+      MIXT_Set_Data(tree->data,tree);
+      i++;
+      tree = tree->next_mixt;
     }
+  while(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/*! Attach data to the partition element that starts with mixt_tree */
+void MIXT_Set_Data(calign *data, t_tree *mixt_tree)
+{
+  t_tree *tree;
+
+  assert(mixt_tree->is_mixt_tree == YES);
+
+  mixt_tree->io->cdata = data;
+
+  tree = mixt_tree;
+  do
+    {
+      tree->data      = data;
+      tree->n_pattern = data->crunch_len;
+      tree = tree->next;
+    }
+  while(tree && tree->is_mixt_tree == NO);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/*! Get the chained trees ready for likelihood calculations once a
+  starting topology has been copied into mixt_tree */
+void MIXT_Prepare_Search(t_tree *mixt_tree)
+{
+  MIXT_Connect_Cseqs_To_Nodes(mixt_tree);
+  Prepare_Tree_For_Lk(mixt_tree);
+  MIXT_Chain_All(mixt_tree);
+  MIXT_Check_Edge_Lens_In_All_Elem(mixt_tree);
+  MIXT_Turn_Branches_OnOff_In_All_Elem(ON,mixt_tree);
+  MIXT_Check_Invar_Struct_In_Each_Partition_Elem(mixt_tree);
+  MIXT_Check_RAS_Struct_In_Each_Partition_Elem(mixt_tree);
+  Br_Len_Not_Involving_Invar(mixt_tree);
+  Unscale_Br_Len_Multiplier_Tree(mixt_tree);
+  Set_Both_Sides(YES,mixt_tree);
+}
 
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void MIXT_Search(t_tree *mixt_tree)
+{
+  if(mixt_tree->mod->s_opt->opt_topo)
+    {
+      if(mixt_tree->mod->s_opt->topo_search      == NNI_MOVE) Simu_Loop(mixt_tree);
+      else if(mixt_tree->mod->s_opt->topo_search == SPR_MOVE) Speed_Spr_Loop(mixt_tree);
+      else                                                    Best_Of_NNI_And_SPR(mixt_tree);
+    }
+  else
+    {
+      if(mixt_tree->mod->s_opt->opt_subst_param ||
+         mixt_tree->mod->s_opt->opt_bl)
+        {
+          Round_Optimize(mixt_tree,ROUND_MAX);
+        }
+      else
+        {
+          Lk(NULL,mixt_tree);
+        }
+    }
 }
 
 //////////////////////////////////////////////////////////////
@@ -2572,7 +2657,7 @@ void MIXT_Ancestral_Sequences_One_Node(t_node *mixt_d, t_tree *mixt_tree, int pr
       t_node *d,*curr_mixt_d;
       t_tree *tree, *curr_mixt_tree;
       int site,csite;
-      phydbl *p_lk0, *p_lk1, *p_lk2;
+      phyplk *p_lk0, *p_lk1, *p_lk2;
       int *sum_scale0, *sum_scale1, *sum_scale2;
       phydbl r_mat_weight_sum, e_frq_weight_sum, sum_probas;
       phydbl *Pij0, *Pij1, *Pij2;
@@ -2919,32 +3004,20 @@ phydbl MIXT_dLk(phydbl *l, t_edge *mixt_b, t_tree *mixt_tree)
 
               if(tree->mod->ras->invar == NO && tree->data->wght[tree->curr_site] > SMALL)
                 {                  
-                  d2lk[class] = Lk_Core_One_Class(tree->eigen_lr_left + site*ns,
-                                                  tree->eigen_lr_rght + site*ns,
-                                                  NULL,
-                                                  NULL,
-                                                  expld2 + class*ns,
-                                                  tree->mod->ns,
-                                                  -1,-1,
-                                                  b,tree);
-                                    
-                  dlk[class] = Lk_Core_One_Class(tree->eigen_lr_left + site*ns,
+                  d2lk[class] = Lk_Core_Eigen_Lr(tree->eigen_lr_left + site*ns,
                                                  tree->eigen_lr_rght + site*ns,
-                                                 NULL,
-                                                 NULL,
-                                                 expld + class*ns,
-                                                 tree->mod->ns,
-                                                 -1,-1,
-                                                 b,tree);
-                  
-                  lk[class] = Lk_Core_One_Class(tree->eigen_lr_left + site*ns,
+                                                 expld2 + class*ns,
+                                                 tree->mod->ns);
+                                    
+                  dlk[class] = Lk_Core_Eigen_Lr(tree->eigen_lr_left + site*ns,
                                                 tree->eigen_lr_rght + site*ns,
-                                                NULL,
-                                                NULL,
-                                                expl + class*ns,
-                                                tree->mod->ns,
-                                                -1,-1,
-                                                b,tree);
+                                                expld + class*ns,
+                                                tree->mod->ns);
+                  
+                  lk[class] = Lk_Core_Eigen_Lr(tree->eigen_lr_left + site*ns,
+                                               tree->eigen_lr_rght + site*ns,
+                                               expl + class*ns,
+                                               tree->mod->ns);
                   
                   /* printf("\n\n. site: %d",site); */
                   /* printf("\n. lr_left: %G %G %G %G",tree->eigen_lr_left[site],tree->eigen_lr_left[site+1],tree->eigen_lr_left[site+2],tree->eigen_lr_left[site+3]); fflush(NULL); */
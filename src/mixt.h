@@ -51,7 +51,11 @@ void MIXT_Check_Single_Edge_Lens(t_tree *mixt_tree);
 void MIXT_Update_Eigen(t_mod *mixt_mod);
 int MIXT_Pars(t_edge *mixt_b, t_tree *mixt_tree);
 void MIXT_Set_Pars_Thresh(t_tree *mixt_tree);
-void MIXT_Bootstrap(char *best_tree, xml_node *root);
+char *MIXT_Bootstrap(char *best_tree, t_tree *mixt_tree);
+void MIXT_Bootstrap_Resample(t_tree *mixt_tree, calign **orig_data, int **site_num);
+void MIXT_Set_Data(calign *data, t_tree *mixt_tree);
+void MIXT_Prepare_Search(t_tree *mixt_tree);
+void MIXT_Search(t_tree *mixt_tree);
 void MIXT_Chain_All(t_tree *mixt_tree);
 void MIXT_Chain_String(t_string *curr, t_string *next);
 void MIXT_Chain_Scalar_Dbl(scalar_dbl *curr, scalar_dbl *next);
@@ -252,16 +252,24 @@ phydbl Get_Lambda_F84(phydbl *pi, phydbl *kappa)
 /********************************************************************/
 
 void PMat_Empirical(phydbl l, t_mod *mod, int pos, phydbl *Pij)
+{
+  PMat_Empirical_Buff(l,mod,pos,Pij,mod->eigen->e_val_im,mod->eigen->r_e_vect_im);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as PMat_Empirical, with the scratch vector expt (ns elements)
+   and matrix uexpt (ns x ns) provided by the caller instead of those
+   in mod->eigen. Threads that compute transition probabilities
+   concurrently must each use their own */
+void PMat_Empirical_Buff(phydbl l, t_mod *mod, int pos, phydbl *Pij, phydbl *expt, phydbl *uexpt)
 {
   int n = mod->ns;
   int i, j, k;
   phydbl *U,*V,*R;
-  phydbl *expt;
-  phydbl *uexpt;
   phydbl sum;
 
-  expt  = mod->eigen->e_val_im;
-  uexpt = mod->eigen->r_e_vect_im;
   U     = mod->eigen->r_e_vect;
   V     = mod->eigen->l_e_vect;
   R     = mod->eigen->e_val; /* exponential of the eigen value matrix */
@@ -25,6 +25,7 @@ void PMat(phydbl l, t_mod *mod, int pos, phydbl *Pij);
 void  PMat_K80(phydbl l,phydbl kappa, int pos, phydbl *Pij);
 void  PMat_TN93(phydbl l, t_mod *mod, int pos, phydbl *Pij);
 void  PMat_Empirical(phydbl l, t_mod *mod, int pos, phydbl *Pij);
+void  PMat_Empirical_Buff(phydbl l, t_mod *mod, int pos, phydbl *Pij, phydbl *expt, phydbl *uexpt);
 void PMat_Zero_Br_Len(t_mod *mod, int pos, phydbl *Pij);
 void PMat_Gamma(phydbl l, t_mod *mod, int pos, phydbl *Pij);
 int GetDaa (phydbl *daa, phydbl *pi, char *file_name);
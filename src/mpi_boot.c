@@ -14,42 +14,41 @@ the GNU public licence. See http://www.opensource.org for details.
 
 /* #ifdef MPI */
 
+int Global_numTask, Global_myRank;
+
 /*********************************************************/
 
+/* Bootstrap replicates are scheduled on demand. Process 0 hands out
+   replicate indices to the other processes, collects the trees they
+   get back and writes them in replicate order. It also analyses
+   replicates itself whenever no result is waiting, so that no process
+   is left idle. Each replicate is analysed from its own seed, so that
+   the output does not depend on the number of processes nor on which
+   process analyses which replicate. With a single process,
+   process 0 analyses all the replicates itself. */
+
 void Bootstrap_MPI(t_tree *tree)
 {
   int *site_num, n_site;
-  int replicate,j,k;
-  int position, init_len, nbRep;
-
-  calign *boot_data;
-  t_tree *boot_tree;
-  t_mod *boot_mod;
-  matrix *boot_mat;
-  char *s;
-
-  MPI_Status Stat;
-  int randomRecv, bootRecv, nbElem, i;
+  int j,k,i;
   int *score_par, *score_tot;
-  char *bootStr, *t;
   
+  /* Partition/mixture analyses are only set up from XML files, whose
+     bootstrap replicates are analysed by MIXT_Bootstrap (see PhyML_XML),
+     in the MPI build too. The trees passed here come from
+     Bootstrap_From_String and are never mixture trees */
   if(tree->is_mixt_tree == YES)
     {
-      PhyML_Printf("\n== Bootstrap option not yet available for partition/mixture analysis.");
+      PhyML_Printf("\n== Partition/mixture analyses are bootstrapped by MIXT_Bootstrap.");
       Generic_Exit(__FILE__,__LINE__,__FUNCTION__);    
     }
 
-  randomRecv = nbElem = bootRecv = 0;
-
   tree->print_boot_val       = 1;
   tree->print_alrt_val       = 0;
-  boot_tree                  = NULL;
 
   site_num = (int *)mCalloc(tree->data->init_len,sizeof(int));
   
-  Free_Bip(tree);
-  Alloc_Bip(tree);
-  Get_Bip(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
+  Get_Bip_Bits(tree,NULL,tree->n_otu);
 
   n_site = 0;
   For(j,tree->data->crunch_len) For(k,tree->data->wght[j])
@@ -58,328 +57,307 @@ void Bootstrap_MPI(t_tree *tree)
       n_site++;
     }
 
-  boot_data = Copy_Cseq(tree->data,tree->io);
+  tree->io->print_site_lnl   = NO;
+  tree->io->print_trace      = NO;
+  tree->io->print_json_trace = NO;
 
-  if (Global_myRank == 0)
-    PhyML_Printf("\n. Non parametric bootstrap analysis \n");
-  
-  //number of bootstraps for each process
-  if (tree->mod->bootstrap%Global_numTask != 0) 
+  For(i,2*tree->n_otu-3) tree->a_edges[i]->bip_score = 0;
+
+  PhyML_Printf("\n. Non parametric bootstrap analysis \n");
+  PhyML_Printf("\n  [");
+
+  if(Global_numTask == 1)          Bootstrap_MPI_Serial(tree,site_num);
+  else if(Global_myRank == 0)      Bootstrap_MPI_Master(tree,site_num);
+  else                             Bootstrap_MPI_Worker(tree,site_num);
+
+  //Each process sends its Bip score sum. The sums are summed.
+  score_par = (int *)mCalloc((2*tree->n_otu - 3),sizeof(int));
+  score_tot = (int *)mCalloc((2*tree->n_otu - 3),sizeof(int));
+
+  For(i,2*tree->n_otu-3) score_par[i] = tree->a_edges[i]->bip_score;
+
+  MPI_Reduce(score_par, score_tot, 2*tree->n_otu - 3, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if (Global_myRank == 0) For(i,2*tree->n_otu-3) tree->a_edges[i]->bip_score = score_tot[i];
+
+  Free(score_tot);
+  Free(score_par);
+
+  if(tree->mod->bootstrap%tree->io->boot_prog_every) PhyML_Printf("] %4d/%4d\n ",tree->mod->bootstrap,tree->mod->bootstrap);
+
+  tree->lock_topo = 1; /* Topology should not be modified afterwards */
+
+  if(tree->io->print_boot_trees)
     {
-      nbRep = (tree->mod->bootstrap / Global_numTask) + 1;
-      tree->mod->bootstrap = nbRep * Global_numTask;
-      if (Global_myRank == 0) {
-        PhyML_Printf("\n. The number of replicates is not a multiple of %d CPUs.\n", Global_numTask);
-        PhyML_Printf("\n. Will run %d replicates.\n", tree->mod->bootstrap);
-      }
+      fclose(tree->io->fp_out_boot_tree);
+      fclose(tree->io->fp_out_boot_stats);
     }
-  else
-    nbRep = tree->mod->bootstrap/Global_numTask;
-  
-  //Bip score
-  if (Global_myRank == 0) 
+
+  Free(site_num);
+}
+
+/*********************************************************/
+
+void Bootstrap_MPI_Serial(t_tree *tree, int *site_num)
+{
+  int replicate;
+  char *s_tree, *s_stat;
+
+  For(replicate,tree->mod->bootstrap)
     {
-      score_tot = (int *)mCalloc((2*tree->n_otu - 3),sizeof(int));
-      For(i,2*tree->n_otu-3)
-        score_tot[i] = 0;
+      s_tree = s_stat = NULL;
+      Bootstrap_MPI_Replicate(tree,site_num,replicate,Bootstrap_MPI_Seed(tree->io->r_seed,replicate),&s_tree,&s_stat);
+      Bootstrap_MPI_Write(tree,s_tree,s_stat);
+      Bootstrap_MPI_Progress(tree,replicate+1);
     }
-  else
-    score_tot = NULL;
+}
 
-  score_par = (int *)mCalloc((2*tree->n_otu - 3),sizeof(int));
-  For(i,2*tree->n_otu-3)
-    score_par[i] = 0;
+/*********************************************************/
+
+/* Process 0 schedules replicates and writes results. Every other
+   process holds up to BOOT_MPI_IN_FLIGHT replicates, so that it can
+   go on with the next one while process 0 is busy analysing a
+   replicate of its own. Each replicate reported as done is answered
+   with a new one or, once all of them have been handed out, with -1,
+   which tells the process to stop when it is done. Trees that come
+   back ahead of their turn are kept until all the replicates before
+   them have been written. */
+
+void Bootstrap_MPI_Master(t_tree *tree, int *site_num)
+{
+  int n_boot, n_sent, n_done, n_written;
+  int replicate, worker, pending, i;
+  int *done, *stopped;
+  char **a_tree, **a_stat;
+  MPI_Status Stat;
 
-  if (Global_myRank == 0)
-    PhyML_Printf("\n  [");
+  n_boot = tree->mod->bootstrap;
 
-  For(replicate, nbRep)
+  done    = (int *)mCalloc(n_boot,sizeof(int));
+  stopped = (int *)mCalloc(Global_numTask,sizeof(int));
+  a_tree  = (char **)mCalloc(n_boot,sizeof(char *));
+  a_stat  = (char **)mCalloc(n_boot,sizeof(char *));
+
+  n_sent = n_done = n_written = 0;
+
+  For(i,BOOT_MPI_IN_FLIGHT)
+    for(worker=1;worker<Global_numTask;worker++)
+      if(stopped[worker] == NO) Bootstrap_MPI_Send_Job(tree,worker,&n_sent,stopped);
+
+  while(n_done < n_boot)
     {
-      For(j,boot_data->crunch_len) boot_data->wght[j] = 0;
+      MPI_Iprobe(MPI_ANY_SOURCE, BootDoneTag, MPI_COMM_WORLD, &pending, &Stat);
 
-      // Send random data to other process
-      if (Global_myRank == 0) 
+      if(pending == NO && n_sent < n_boot)
         {
-          // Compute number of data to send
-          if (tree->mod->bootstrap - randomRecv > Global_numTask)
-            nbElem = Global_numTask;
-          else
-            nbElem = tree->mod->bootstrap - randomRecv;
-          
-          For(i,nbElem) 
-            {
-              For(j,boot_data->crunch_len) boot_data->wght[j] = 0;
-
-              init_len = 0;
-              // Create random data
-              For(j,boot_data->init_len)
-                {
-                  position = Rand_Int(0,(int)(tree->data->init_len-1.0));
-                  boot_data->wght[site_num[position]] += 1;
-                  init_len++;
-                }
-              
-
-              if (init_len != tree->data->init_len) 
-                {
-                  PhyML_Printf("\n== thread: %d || init: %d %d here\n",Global_myRank,init_len,tree->data->init_len);
-                  fflush(NULL);
-                  Generic_Exit(__FILE__,__LINE__,__FUNCTION__);    
-                }
-              
-              // Send random data to other process, not to current process
-              if (i < nbElem-1)
-                {
-                  MPI_Ssend (boot_data->wght, boot_data->crunch_len, MPI_DOUBLE, i+1, Global_myRank, MPI_COMM_WORLD);
-#ifdef MPI_DEBUG
-                  fprintf (stderr, "\ntask %d, sending random to %d done\n", Global_myRank, i+1);
-                  fflush(stderr);
-#endif
-                }
-              randomRecv++;
-            }
+          /* Nothing to collect: analyse the next replicate here */
+          replicate = n_sent++;
+          Bootstrap_MPI_Replicate(tree,site_num,replicate,Bootstrap_MPI_Seed(tree->io->r_seed,replicate),a_tree+replicate,a_stat+replicate);
         }
-      else 
+      else
         {
-          MPI_Recv(boot_data->wght, boot_data->crunch_len, MPI_DOUBLE, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &Stat);
+          MPI_Recv(&replicate, 1, MPI_INT, MPI_ANY_SOURCE, BootDoneTag, MPI_COMM_WORLD, &Stat);
+          worker = Stat.MPI_SOURCE;
 #ifdef MPI_DEBUG
-          fprintf (stderr, "\ntask %d, receiving random from task %d done\n", Global_myRank, Stat.MPI_SOURCE);
+          fprintf (stderr, "\ntask %d, replicate %d done by task %d\n", Global_myRank, replicate, worker);
           fflush(stderr);
 #endif
+          assert(replicate >= 0 && replicate < n_boot && done[replicate] == NO);
 
+          if(tree->io->print_boot_trees)
+            {
+              a_tree[replicate] = Bootstrap_MPI_Recv_String(worker,BootTreeTag);
+              a_stat[replicate] = Bootstrap_MPI_Recv_String(worker,BootStatTag);
+            }
 
+          if(stopped[worker] == NO) Bootstrap_MPI_Send_Job(tree,worker,&n_sent,stopped);
         }
 
-      init_len = 0;
-      For(j,boot_data->crunch_len) init_len += boot_data->wght[j];
-
+      done[replicate] = YES;
+      n_done++;
+      Bootstrap_MPI_Progress(tree,n_done);
 
-      if(init_len != tree->data->init_len) 
+      while(n_written < n_boot && done[n_written] == YES)
         {
-          printf("\n== thread: %d init: %d %d\n",Global_myRank,init_len,tree->data->init_len);
-          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);    
+          Bootstrap_MPI_Write(tree,a_tree[n_written],a_stat[n_written]);
+          a_tree[n_written] = a_stat[n_written] = NULL;
+          n_written++;
         }
-      
+    }
 
-      (tree->mod->io->datatype == NT)?
-        (Get_Base_Freqs(boot_data)):
-        (Get_AA_Freqs(boot_data));
+  assert(n_written == n_boot);
+  for(worker=1;worker<Global_numTask;worker++) assert(stopped[worker] == YES);
 
+  Free(done);
+  Free(stopped);
+  Free(a_tree);
+  Free(a_stat);
+}
 
-      if(tree->io->random_boot_seq_order) Randomize_Sequence_Order(boot_data);
+/*********************************************************/
 
-      Set_D_States(boot_data,tree->io->datatype,tree->io->state_len);
+/* Send the next replicate to worker or, when all of them have been
+   handed out, tell it to stop */
 
-      boot_mod        = Copy_Model(tree->mod);
-      boot_mod->s_opt = tree->mod->s_opt; /* WARNING: re-using the same address here instead of creating a copying
-					     requires to leave the value of s_opt unchanged during the boostrap. */
-      boot_mod->io    = tree->io; /* WARNING: re-using the same address here instead of creating a copying
-				     requires to leave the value of io unchanged during the boostrap. */
-      Init_Model(boot_data,boot_mod,tree->io);
+void Bootstrap_MPI_Send_Job(t_tree *tree, int worker, int *n_sent, int *stopped)
+{
+  int job[2];
 
-      if(tree->io->mod->use_m4mod) M4_Init_Model(boot_mod->m4mod,boot_data,boot_mod);
+  if(*n_sent < tree->mod->bootstrap)
+    {
+      job[0] = *n_sent;
+      job[1] = Bootstrap_MPI_Seed(tree->io->r_seed,*n_sent);
+      (*n_sent)++;
+    }
+  else
+    {
+      job[0] = job[1] = -1;
+      stopped[worker] = YES;
+    }
 
-      if(tree->io->in_tree == 2)
-        {
-	  switch(tree->io->tree_file_format)
-	    {
-	    case PHYLIP: 
-	      {
-		rewind(tree->io->fp_in_tree);
-		boot_tree = Read_Tree_File_Phylip(tree->io->fp_in_tree);
-		break;
-	      }
-	    case NEXUS:
-	      {
-		PhyML_Printf("\n. Unfortunately, PhyML cannot read NEXUS files and perform a bootstrap analysis."); 
-		PhyML_Printf("\n. Please use the PHYLIP format.."); 
-		PhyML_Printf("\n. Err in file %s at line %d\n",__FILE__,__LINE__);
-		Warn_And_Exit("");
-		break;
-	      }
-	    default:
-	      {
-		PhyML_Printf("\n. Err in file %s at line %d\n",__FILE__,__LINE__);
-		Warn_And_Exit("");
-		break;
-	      }
-	    }
-	}
-      else
-        {
-          boot_mat = ML_Dist(boot_data,boot_mod);
-          boot_mat->tree = Make_Tree_From_Scratch(boot_data->n_otu,boot_data);
-          Fill_Missing_Dist(boot_mat);
-          Bionj(boot_mat);
-          boot_tree = boot_mat->tree;
-          boot_tree->mat = boot_mat;
-        }
+  MPI_Send(job, 2, MPI_INT, worker, BootWorkTag, MPI_COMM_WORLD);
+}
+
+/*********************************************************/
 
-      boot_tree->mod                = boot_mod;
-      boot_tree->io                 = tree->io;
-      boot_tree->data               = boot_data;
-      boot_tree->verbose            = VL0;
-      boot_tree->n_pattern          = boot_tree->data->crunch_len;
-      boot_tree->io->print_site_lnl = 0;
-      boot_tree->io->print_trace    = 0;
-
-      Set_Both_Sides(YES,boot_tree);
-      
-      if((boot_tree->mod->s_opt->random_input_tree) && (boot_tree->mod->s_opt->topo_search == SPR_MOVE)) Random_Tree(boot_tree);
-
-      Connect_CSeqs_To_Nodes(boot_data,boot_tree->io,boot_tree);
-      Share_Lk_Struct(tree,boot_tree);
-      Share_Spr_Struct(tree,boot_tree);
-      Share_Pars_Struct(tree,boot_tree);
-      Fill_Dir_Table(boot_tree);
-      Update_Dirs(boot_tree);
-
-      if(tree->mod->s_opt->greedy) Init_P_Lk_Tips_Double(boot_tree);
-      else                         Init_P_Lk_Tips_Int(boot_tree);
-      Init_Ui_Tips(boot_tree);
-      Init_P_Pars_Tips(boot_tree);
-      Br_Len_Not_Involving_Invar(boot_tree);
-      
-      if(boot_tree->mod->s_opt->opt_topo)
+void Bootstrap_MPI_Worker(t_tree *tree, int *site_num)
+{
+  int replicate, job[2];
+  char *s_tree, *s_stat;
+  MPI_Status Stat;
+
+  do
+    {
+      MPI_Recv(job, 2, MPI_INT, 0, BootWorkTag, MPI_COMM_WORLD, &Stat);
+      replicate = job[0];
+
+      if(replicate >= 0)
         {
-          if(boot_tree->mod->s_opt->topo_search == NNI_MOVE) 
-            {
-              Simu_Loop(boot_tree);
-            }
-          else if((boot_tree->mod->s_opt->topo_search == SPR_MOVE) ||
-                  (boot_tree->mod->s_opt->topo_search == BEST_OF_NNI_AND_SPR))
+          s_tree = s_stat = NULL;
+
+          Bootstrap_MPI_Replicate(tree,site_num,replicate,job[1],&s_tree,&s_stat);
+
+          MPI_Send(&replicate, 1, MPI_INT, 0, BootDoneTag, MPI_COMM_WORLD);
+
+          if(tree->io->print_boot_trees)
             {
-              Speed_Spr_Loop(boot_tree);
+              MPI_Send(s_tree, strlen(s_tree)+1, MPI_CHAR, 0, BootTreeTag, MPI_COMM_WORLD);
+              MPI_Send(s_stat, strlen(s_stat)+1, MPI_CHAR, 0, BootStatTag, MPI_COMM_WORLD);
+              Free(s_tree);
+              Free(s_stat);
             }
         }
-      else
-        {
-          if(boot_tree->mod->s_opt->opt_subst_param || boot_tree->mod->s_opt->opt_bl)
-            Round_Optimize(boot_tree,ROUND_MAX);
-          else
-            Lk(NULL,boot_tree);
-        }
+    }
+  while(replicate >= 0);
+}
 
-      Free_Bip(boot_tree);
+/*********************************************************/
 
-      Alloc_Bip(boot_tree);
+/* Analyse one bootstrap replicate and add its bipartitions to the
+   support values of tree. When bootstrap trees are printed, the
+   replicate tree and its statistics are returned in s_tree and
+   s_stat. */
 
-      Match_Tip_Numbers(tree,boot_tree);
+void Bootstrap_MPI_Replicate(t_tree *tree, int *site_num, int replicate, int seed, char **s_tree, char **s_stat)
+{
+  calign *boot_data;
+  t_tree *boot_tree;
+  t_mod *boot_mod;
+  unsigned int boot_seed;
 
-      Get_Bip(boot_tree->a_nodes[0],
-              boot_tree->a_nodes[0]->v[0],
-              boot_tree);
+  /* Same generator as the replicates of Bootstrap */
+  boot_seed = (unsigned int)seed;
+  Rand_Set_Thread_Seed(&boot_seed);
 
-      Compare_Bip(tree,boot_tree,NO);
-      
-      Br_Len_Involving_Invar(boot_tree);
+  /* A fresh copy of the data, so that the replicate does not depend
+     on the sequence order left by a previous replicate */
+  boot_data = Copy_Cseq(tree->data,tree->io);
 
-      if(tree->io->print_boot_trees)
-        {
-          s = Write_Tree(boot_tree,NO);
-          t=(char *)mCalloc(T_MAX_LINE,sizeof(char));
-          Print_Fp_Out_Lines_MPI(boot_tree, tree->io, replicate+1, t);
-          
-          // Get bootstrap trees from other process and write to boot file
-          if (Global_myRank == 0) {
-            fprintf(tree->io->fp_out_boot_tree,"%s\n",s);
-            fprintf(tree->io->fp_out_boot_stats,"%s\n",t);
-            bootRecv++;
-            PhyML_Printf(".");
-	    if(!((bootRecv)%tree->io->boot_prog_every)) 
-	      {
-		PhyML_Printf("] %4d/%4d\n  ",bootRecv,tree->mod->bootstrap);
-		if(bootRecv != tree->mod->bootstrap) PhyML_Printf("[");
-	      }
-	    
-            // Compute number of bootstraps to receive
-            if (tree->mod->bootstrap - bootRecv > Global_numTask)
-              nbElem = Global_numTask;
-            else
-              nbElem = tree->mod->bootstrap - bootRecv + 1;
-              
-            bootStr=(char *)mCalloc(T_MAX_LINE,sizeof(char));
-            for (i=1; i<nbElem; i++) 
-	      {
-		MPI_Recv (bootStr, T_MAX_LINE, MPI_CHAR, i, MPI_ANY_TAG, MPI_COMM_WORLD, &Stat);
-#ifdef MPI_DEBUG
-		PhyML_Fprintf (stderr, "\ntask %d, receiving bootstrap from task %d tag %d done\n", Global_myRank, Stat.MPI_SOURCE, Stat.MPI_TAG);
-		fflush(stderr);
-#endif
-		if (Stat.MPI_TAG == BootTreeTag)
-		  fprintf(tree->io->fp_out_boot_tree,"%s\n", bootStr);
-		if (Stat.MPI_TAG == BootStatTag)
-		  fprintf(tree->io->fp_out_boot_stats,"%s\n", bootStr);
-		
-		MPI_Recv (bootStr, T_MAX_LINE, MPI_CHAR, i, MPI_ANY_TAG, MPI_COMM_WORLD, &Stat);
-#ifdef MPI_DEBUG
-		fprintf (stderr, "\ntask %d, receiving bootstrap from task %d tag %d done\n", Global_myRank, Stat.MPI_SOURCE, Stat.MPI_TAG);
-		fflush(stderr);
-#endif
-		if (Stat.MPI_TAG == BootTreeTag)
-		  fprintf(tree->io->fp_out_boot_tree,"%s\n", bootStr);
-		if (Stat.MPI_TAG == BootStatTag)
-		  fprintf(tree->io->fp_out_boot_stats,"%s\n", bootStr);
-		
-		bootRecv++;
-		PhyML_Printf(".");
-		if(!((bootRecv)%tree->io->boot_prog_every)) {
-		  PhyML_Printf("] %4d/%4d\n  ",bootRecv,tree->mod->bootstrap);
-		  if(bootRecv != tree->mod->bootstrap) PhyML_Printf("[");
-		}
-	      }
-            Free(bootStr);
-          }
-          else {
-	    MPI_Ssend (s, T_MAX_LINE, MPI_CHAR, 0, BootTreeTag, MPI_COMM_WORLD);
-	    MPI_Ssend (t, T_MAX_LINE, MPI_CHAR, 0, BootStatTag, MPI_COMM_WORLD);
-#ifdef MPI_DEBUG
-fprintf (stderr, "\ntask %d, sending bootstraps done\n", Global_myRank);
-fflush(stderr);
-#endif
-          }
-          Free(t);
-          Free(s);
-        }
+  Bootstrap_Resample(tree->data,boot_data,site_num,tree->io);
 
-#ifndef QUIET
-fflush(stdout);
-#endif
+  boot_mod        = Copy_Model(tree->mod);
+  boot_mod->s_opt = tree->mod->s_opt; /* WARNING: re-using the same address here instead of creating a copying
+                                         requires to leave the value of s_opt unchanged during the boostrap. */
+  boot_mod->io    = tree->io; /* WARNING: re-using the same address here instead of creating a copying
+                                 requires to leave the value of io unchanged during the boostrap. */
 
-      /* if(boot_tree->mat) Free_Mat(boot_tree->mat); */
-      Free_Tree(boot_tree);
-      Free_Model(boot_mod);
+  boot_tree = Bootstrap_Make_Tree(tree,tree,boot_data,boot_mod);
 
-      //Each process computes the Bip score sum for all its bootstrap trees
-      For(i,2*tree->n_otu-3) score_par[i] = tree->a_edges[i]->bip_score;
+  Bootstrap_Search(boot_tree);
 
-      //Each process sends its Bip score sum. The sums are summed.
-      MPI_Reduce(score_par, score_tot, 2*tree->n_otu - 3, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
-    }
+  Rand_Set_Thread_Seed(NULL);
 
-  
-  if (Global_myRank == 0) 
-    {
-      For(i,2*tree->n_otu-3)
-        tree->a_edges[i]->bip_score = score_tot[i];
-      Free (score_tot);
-    }
-  Free (score_par);
+  Match_Tip_Numbers(tree,boot_tree);
+
+  Get_Bip_Bits(boot_tree,NULL,boot_tree->n_otu);
 
-  if (Global_myRank == 0)
-    if(((bootRecv)%tree->io->boot_prog_every)) PhyML_Printf("] %4d/%4d\n ",bootRecv,tree->mod->bootstrap);
+  Compare_Bip(tree,boot_tree,NO);
 
-PhyML_Printf("\n\n. Exiting bootstrap function normally."); fflush(NULL);
-tree->lock_topo = 1; /* Topology should not be modified afterwards */
+  Check_Br_Lens(boot_tree);
+  Br_Len_Involving_Invar(boot_tree);
 
   if(tree->io->print_boot_trees)
     {
-      fclose(tree->io->fp_out_boot_tree);
-      fclose(tree->io->fp_out_boot_stats);
+      *s_tree = Write_Tree(boot_tree,NO);
+      *s_stat = (char *)mCalloc(T_MAX_LINE,sizeof(char));
+      Print_Fp_Out_Lines_MPI(boot_tree,tree->io,replicate+1,*s_stat);
     }
 
+  Free_Tree(boot_tree);
+  Free_Model(boot_mod);
   Free_Calign(boot_data);
-  Free(site_num);
+}
+
+/*********************************************************/
+
+/* Seed of a given replicate, derived from the seed of the whole
+   analysis only (see Rand_Stream_Seed) */
+
+int Bootstrap_MPI_Seed(int r_seed, int replicate)
+{
+  return Rand_Stream_Seed(r_seed,replicate);
+}
+
+/*********************************************************/
+
+char *Bootstrap_MPI_Recv_String(int source, int tag)
+{
+  MPI_Status Stat;
+  char *s;
+  int len;
+
+  MPI_Probe(source, tag, MPI_COMM_WORLD, &Stat);
+  MPI_Get_count(&Stat, MPI_CHAR, &len);
+
+  s = (char *)mCalloc(len+1,sizeof(char));
+  MPI_Recv(s, len, MPI_CHAR, source, tag, MPI_COMM_WORLD, &Stat);
+
+  return s;
+}
+
+/*********************************************************/
+
+void Bootstrap_MPI_Write(t_tree *tree, char *s_tree, char *s_stat)
+{
+  if(!tree->io->print_boot_trees) return;
+
+  fprintf(tree->io->fp_out_boot_tree,"%s\n",s_tree);
+  fprintf(tree->io->fp_out_boot_stats,"%s\n",s_stat);
+
+  Free(s_tree);
+  Free(s_stat);
+}
+
+/*********************************************************/
+
+void Bootstrap_MPI_Progress(t_tree *tree, int n_done)
+{
+  PhyML_Printf(".");
+  if(!(n_done%tree->io->boot_prog_every))
+    {
+      PhyML_Printf("] %4d/%4d\n  ",n_done,tree->mod->bootstrap);
+      if(n_done != tree->mod->bootstrap) PhyML_Printf("[");
+    }
 }
 
 /*********************************************************/
@@ -392,7 +370,7 @@ void Print_Fp_Out_Lines_MPI(t_tree *tree, option *io, int n_data_set, char *boot
   s = (char *)mCalloc(T_MAX_LINE,sizeof(char));
   tmp=(char *)mCalloc(T_MAX_LINE,sizeof(char));
   
-  if (Global_myRank == 0 && n_data_set == 1) {
+  if (n_data_set == 1) {
     snprintf(tmp, T_MAX_LINE, ". Sequence file : [%s]\n\n", Basename(io->in_align_file)); strncat (s, tmp, T_MAX_LINE);
     
     (tree->mod->io->datatype == NT)?
@@ -475,7 +453,7 @@ void Print_Fp_Out_Lines_MPI(t_tree *tree, option *io, int n_data_set, char *boot
 
   /*line items*/
 
-  snprintf(tmp, T_MAX_LINE, "  #%d\t", (((n_data_set-1)*Global_numTask)+Global_myRank+1));
+  snprintf(tmp, T_MAX_LINE, "  #%d\t", n_data_set);
   strncat (s, tmp, T_MAX_LINE);
   
   snprintf(tmp, T_MAX_LINE, "%d   \t",tree->n_otu); strncat (s, tmp, T_MAX_LINE);
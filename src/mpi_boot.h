@@ -27,11 +27,25 @@ the GNU public licence. See http://www.opensource.org for details.
 
 #define BootTreeTag 0
 #define BootStatTag 1
+#define BootWorkTag 2
+#define BootDoneTag 3
 
-int Global_numTask, Global_myRank;
+/*! Number of replicates handed out in advance to each process other than 0 */
+#define BOOT_MPI_IN_FLIGHT 2
+
+extern int Global_numTask, Global_myRank;
 
 
 void Bootstrap_MPI(t_tree *tree);
+void Bootstrap_MPI_Serial(t_tree *tree, int *site_num);
+void Bootstrap_MPI_Master(t_tree *tree, int *site_num);
+void Bootstrap_MPI_Send_Job(t_tree *tree, int worker, int *n_sent, int *stopped);
+void Bootstrap_MPI_Worker(t_tree *tree, int *site_num);
+void Bootstrap_MPI_Replicate(t_tree *tree, int *site_num, int replicate, int seed, char **s_tree, char **s_stat);
+int Bootstrap_MPI_Seed(int r_seed, int replicate);
+char *Bootstrap_MPI_Recv_String(int source, int tag);
+void Bootstrap_MPI_Write(t_tree *tree, char *s_tree, char *s_stat);
+void Bootstrap_MPI_Progress(t_tree *tree, int n_done);
 void Print_Fp_Out_Lines_MPI(t_tree *tree, option *io, int n_data_set, char *bootStr);
 
 #endif  // MPI
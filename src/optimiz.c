@@ -689,10 +689,14 @@ void Round_Optimize(t_tree *tree, int n_round_max)
          (!tree->io->quiet)) Print_Lk(tree,"[Branch lengths     ]");
 
 
+      /* Optimize_Br_Len_Serie leaves the partial likelihoods up to
+         date: only recompute those that are flagged as invalid */
       Set_Both_Sides(NO,tree);
+      Set_Incr_Lk(YES,tree);
       Lk(NULL,tree);
+      Set_Incr_Lk(NO,tree);
       
-      if(!each)
+      if(!each && Time_Budget_Over(TIME_BUDGET_MODEL,tree->io) == NO)
         {
           each = 1;
           Optimiz_All_Free_Param(tree,(tree->io->quiet)?(0):(tree->verbose > VL2));
@@ -706,16 +710,18 @@ void Round_Optimize(t_tree *tree, int n_round_max)
           PhyML_Printf("\n== lk_new = %f lk_old = %f diff = %f",lk_new,lk_old,lk_new-lk_old);
           Exit("\n== Optimisation failed ! (Round_Optimize)\n");
         }
-      if(FABS(lk_new - lk_old) < tree->mod->s_opt->min_diff_lk_local) break;
+      if(FABS(lk_new - lk_old) < Time_Budget_Tol(tree->mod->s_opt->min_diff_lk_local,tree->io)) break;
       else 
         {
           lk_old  = lk_new;
         }
+      if(Time_Budget_Over(TIME_BUDGET_END,tree->io) == YES) break;
       n_round++;
       each--;
     }
   
-  Optimiz_All_Free_Param(tree,(tree->io->quiet)?(0):(tree->verbose > VL2));
+  if(Time_Budget_Over(TIME_BUDGET_MODEL,tree->io) == NO)
+    Optimiz_All_Free_Param(tree,(tree->io->quiet)?(0):(tree->verbose > VL2));
 
 }
 
@@ -1172,8 +1178,7 @@ void Optimiz_All_Free_Param(t_tree *tree, int verbose)
 #define EPS   3.0e-8
 #define TOLX (4*EPS)
 #define STPMX 100.0
-static phydbl sqrarg;
-#define SQR(a) ((sqrarg=(a)) < SMALL ? 0.0 : sqrarg*sqrarg)
+#define SQR(a) ((a) < SMALL ? 0.0 : (a)*(a))
 
 void BFGS(t_tree *tree,
           phydbl *p,
@@ -1380,8 +1385,7 @@ void BFGS(t_tree *tree,
 #define EPS   3.0e-8
 #define TOLX (4*EPS)
 #define STPMX 100.0
-static phydbl sqrarg;
-#define SQR(a) ((sqrarg=(a)) < SMALL ? 0.0 : sqrarg*sqrarg)
+#define SQR(a) ((a) < SMALL ? 0.0 : (a)*(a))
 
 void BFGS_Nonaligned(t_tree *tree,
                      phydbl **p,
@@ -2271,31 +2275,30 @@ int Optimiz_Alpha_And_Pinv(t_tree *mixt_tree, int verbose)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-phydbl Br_Len_Newton_Raphson(phydbl *l, t_edge *b, int n_iter_max, phydbl tol, t_tree *tree)
+/* Newton-Raphson optimisation of the branch length l. obj_func
+   returns the log-likelihood at l together with its first and second
+   derivatives (in dl and d2l). l is set to the best length found and the
+   corresponding log-likelihood is returned */
+phydbl Generic_Newton_Br_Len(phydbl *l, int n_iter_max, phydbl tol,
+                             phydbl (*obj_func)(phydbl *,phydbl *,phydbl *,void *,t_tree *),
+                             void *arg, t_tree *tree)
 {
   short int converged;
-  phydbl dl,d2l; 
+  phydbl dl,d2l,lnL;
   phydbl init_lnL,old_lnL;
   int iter;
   phydbl best_l, best_lnL;
 
-  // Warning: make sure eigen_lr vectors are already up-to-date 
-
-  Set_Use_Eigen_Lr(YES,tree);
-  dLk(l,b,tree);
+  lnL = (*obj_func)(l,&dl,&d2l,arg,tree);
 
-  best_lnL = old_lnL = init_lnL = tree->c_lnL;
+  best_lnL = old_lnL = init_lnL = lnL;
   best_l = *l;
 
-  /*   PhyML_Printf("\n Begin NR loop (lnL: %f dlnL: %f d2lnL: %f)",tree->c_lnL,tree->c_dlnL,tree->c_d2lnL); */
-
   converged = NO;
   iter = 0;
   do
     {
-      old_lnL = tree->c_lnL;
-      dl      = tree->c_dlnL;
-      d2l     = tree->c_d2lnL;
+      old_lnL = lnL;
 
       if(d2l > 0.0)
         *l *= 0.5;
@@ -2305,39 +2308,49 @@ phydbl Br_Len_Newton_Raphson(phydbl *l, t_edge *b, int n_iter_max, phydbl tol, t
       if(*l < tree->mod->l_min) *l = tree->mod->l_min;
       if(*l > tree->mod->l_max) *l = tree->mod->l_max;
 
-      Set_Use_Eigen_Lr(YES,tree);
-      dLk(l,b,tree);
+      lnL = (*obj_func)(l,&dl,&d2l,arg,tree);
 
       iter++;
       if(iter > n_iter_max) break;
 
-      if(tree->c_lnL > best_lnL)
+      if(lnL > best_lnL)
         {
-          best_lnL = tree->c_lnL;
+          best_lnL = lnL;
           best_l   = *l;
         }
 
-        /* PhyML_Printf("\n %12f %12f %12f %12G %12G %12G %12G", */
-        /*              b->l->v, */
-        /*              old_lnL, */
-        /*              tree->c_lnL, */
-        /*              dl, */
-        /*              d2l, */
-        /*              old_lnL-tree->c_lnL, */
-        /*              tol); */
-
-      if(FABS(tree->c_lnL-old_lnL) < tol) converged = YES;
+      if(FABS(lnL-old_lnL) < tol) converged = YES;
     }
   while(converged == NO);
   
   *l = best_l;
-  tree->c_lnL = best_lnL;
-
-  /* printf("\n. init: %f current: %f l: %f",init_lnL,tree->c_lnL,b->l->v); */
 
   assert(best_lnL > init_lnL-tol);
   
-  /* PhyML_Printf("\n End NR loop"); */
+  return best_lnL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static phydbl Br_Len_Newton_Raphson_dLk(phydbl *l, phydbl *dl, phydbl *d2l, void *b, t_tree *tree)
+{
+  Set_Use_Eigen_Lr(YES,tree);
+  dLk(l,(t_edge *)b,tree);
+  *dl  = tree->c_dlnL;
+  *d2l = tree->c_d2lnL;
+  return tree->c_lnL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+phydbl Br_Len_Newton_Raphson(phydbl *l, t_edge *b, int n_iter_max, phydbl tol, t_tree *tree)
+{
+  // Warning: make sure eigen_lr vectors are already up-to-date 
+
+  tree->c_lnL = Generic_Newton_Br_Len(l,n_iter_max,tol,Br_Len_Newton_Raphson_dLk,b,tree);
+
   return tree->c_lnL;
 }
 
@@ -180,6 +180,9 @@ void Optimize_Free_Rate_Weights(t_tree *tree, int fast, int verbose);
 void Optimize_Free_Rate_Rr(t_tree *tree, int fast, int verbose);
 void Optimize_Br_Len_Multiplier(t_tree *tree, int verbose);
 phydbl Br_Len_Newton_Raphson(phydbl *l, t_edge *b, int n_iter_max, phydbl tol, t_tree *tree);
+phydbl Generic_Newton_Br_Len(phydbl *l, int n_iter_max, phydbl tol,
+                             phydbl (*obj_func)(phydbl *,phydbl *,phydbl *,void *,t_tree *),
+                             void *arg, t_tree *tree);
 
 #endif
 
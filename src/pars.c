@@ -32,12 +32,20 @@ int Pars(t_edge *b, t_tree *tree)
   
   if(b == NULL)
     {
+      /* Site weights may have changed since the last full traversal */
+      Init_Pars_Bits_Weights(tree);
       Post_Order_Pars(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
       if(tree->both_sides == YES) Pre_Order_Pars(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
     }
 
   if(b == NULL) b = tree->a_nodes[0]->b[0];
 
+  if(tree->use_pars_bits == YES && tree->mod->s_opt->general_pars == NO)
+    {
+      tree->c_pars = Pars_Bits_Core(b,tree);
+      return tree->c_pars;
+    }
+
   tree->c_pars = 0;
   For(site,n_patterns)
     {
@@ -231,9 +239,168 @@ void Init_Ui_Tips(t_tree *tree)
     }
   
   
+  Init_Pars_Bits_Tips(tree);
+  Init_Pars_Bits_Weights(tree);
+
   Free(state_v);
 }
 
+/*********************************************************/
+/* Fill the bit-sliced Fitch sets at the tips from the ui vectors. */
+
+void Init_Pars_Bits_Tips(t_tree *tree)
+{
+  int i,j,site,ns,n_words;
+  pars_word *bits;
+
+  ns      = tree->mod->ns;
+  n_words = PARS_N_WORDS(tree->data->crunch_len);
+
+  if(ns > (int)(8*sizeof(unsigned int))) return;
+
+  For(i,tree->n_otu)
+    {
+      bits = tree->a_nodes[i]->b[0]->pars_bits_r;
+      if(bits == NULL) continue;
+
+      For(j,n_words*ns+1) bits[j] = 0;
+
+      For(site,tree->data->crunch_len)
+        For(j,ns)
+          if((tree->a_nodes[i]->b[0]->ui_r[site] >> j) & 1)
+            bits[(site/PARS_WORD_BITS)*ns+j] |= (pars_word)1 << (site%PARS_WORD_BITS);
+    }
+}
+
+/*********************************************************/
+/* Decompose site pattern weights into bit planes so that the weighted
+   number of Fitch steps over a block of sites is a sum of popcounts.
+   Bit-sliced parsimony is only used with Fitch's (unweighted) step
+   matrix and non-negative integer weights. */
+
+void Init_Pars_Bits_Weights(t_tree *tree)
+{
+  int site,p,n_words,n_planes,max_w,w;
+  phydbl wght;
+
+  tree->use_pars_bits = NO;
+
+  if(tree->pars_wght_bits == NULL) return;
+  if(tree->mod->s_opt->general_pars == YES) return;
+  if(tree->mod->ns > (int)(8*sizeof(unsigned int))) return;
+
+  max_w = 0;
+  For(site,tree->n_pattern)
+    {
+      wght = tree->data->wght[site];
+      if(wght < 0.0 || FLOOR(wght) < wght || wght >= (phydbl)(1 << PARS_MAX_WGHT_PLANES)) return;
+      max_w = MAX(max_w,(int)wght);
+    }
+
+  n_planes = 0;
+  while((max_w >> n_planes) > 0) n_planes++;
+
+  n_words = PARS_N_WORDS(tree->data->crunch_len);
+  For(p,n_planes*n_words) tree->pars_wght_bits[p] = 0;
+
+  For(site,tree->n_pattern)
+    {
+      w = (int)tree->data->wght[site];
+      For(p,n_planes)
+        if((w >> p) & 1)
+          tree->pars_wght_bits[p*n_words+site/PARS_WORD_BITS] |= (pars_word)1 << (site%PARS_WORD_BITS);
+    }
+
+  tree->pars_wght_n_planes = n_planes;
+  tree->use_pars_bits      = YES;
+}
+
+/*********************************************************/
+
+int Pars_Popcount(pars_word x)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/*********************************************************/
+/* Sum of the weights of the sites flagged in 'mask' (block 'w') */
+
+int Pars_Bits_Weighted_Count(pars_word mask, int w, int n_words, t_tree *tree)
+{
+  int p,sum;
+
+  sum = 0;
+  For(p,tree->pars_wght_n_planes) sum += Pars_Popcount(mask & tree->pars_wght_bits[p*n_words+w]) << p;
+  return sum;
+}
+
+/*********************************************************/
+/* Fitch's step on PARS_WORD_BITS sites at a time. A site costs one
+   step when the intersection of the two child sets is empty, in which
+   case the union is kept. */
+
+void Update_P_Pars_Bits(pars_word *bits, pars_word *bits_v1, pars_word *bits_v2, t_tree *tree)
+{
+  int s,w,ns,n_words,steps;
+  pars_word any,empty;
+  pars_word *a,*b,*o;
+
+  ns      = tree->mod->ns;
+  n_words = PARS_N_WORDS(tree->data->crunch_len);
+  steps   = 0;
+
+  For(w,n_words)
+    {
+      a = bits_v1 + w*ns;
+      b = bits_v2 + w*ns;
+      o = bits    + w*ns;
+
+      any = 0;
+      For(s,ns) any |= a[s] & b[s];
+      empty = ~any;
+      For(s,ns) o[s] = (a[s] & b[s]) | ((a[s] | b[s]) & empty);
+
+      steps += Pars_Bits_Weighted_Count(empty,w,n_words,tree);
+    }
+
+  bits[n_words*ns] = bits_v1[n_words*ns] + bits_v2[n_words*ns] + (pars_word)steps;
+}
+
+/*********************************************************/
+/* Parsimony score of the tree, computed from the bit-sliced sets on
+   both sides of edge 'b' */
+
+int Pars_Bits_Core(t_edge *b, t_tree *tree)
+{
+  int s,w,ns,n_words,steps;
+  pars_word any;
+  pars_word *l,*r;
+
+  ns      = tree->mod->ns;
+  n_words = PARS_N_WORDS(tree->data->crunch_len);
+  steps   = 0;
+
+  For(w,n_words)
+    {
+      l = b->pars_bits_l + w*ns;
+      r = b->pars_bits_r + w*ns;
+
+      any = 0;
+      For(s,ns) any |= l[s] & r[s];
+
+      steps += Pars_Bits_Weighted_Count(~any,w,n_words,tree);
+    }
+
+  return (int)(b->pars_bits_l[n_words*ns] + b->pars_bits_r[n_words*ns]) + steps;
+}
+
 /*********************************************************/
 
 void Update_P_Pars(t_tree *tree, t_edge *b_fcus, t_node *n)
@@ -253,6 +420,7 @@ void Update_P_Pars(t_tree *tree, t_edge *b_fcus, t_node *n)
   unsigned int *ui, *ui_v1, *ui_v2;
   int *p_pars_v1, *p_pars_v2, *p_pars;
   int *pars, *pars_v1, *pars_v2;
+  pars_word *pars_bits, *pars_bits_v1, *pars_bits_v2;
   int n_patterns;
   int min_v1,min_v2;
   int v;
@@ -274,6 +442,7 @@ void Update_P_Pars(t_tree *tree, t_edge *b_fcus, t_node *n)
   ui = ui_v1 = ui_v2 = NULL;
   p_pars = p_pars_v1 = p_pars_v2 = NULL;
   pars = pars_v1 = pars_v2 = NULL;
+  pars_bits = pars_bits_v1 = pars_bits_v2 = NULL;
 
   n_patterns = tree->n_pattern;
     
@@ -313,6 +482,18 @@ void Update_P_Pars(t_tree *tree, t_edge *b_fcus, t_node *n)
         (n == n->b[b_fcus->l_v2]->left)?
         (n->b[b_fcus->l_v2]->pars_r):
         (n->b[b_fcus->l_v2]->pars_l);
+
+      pars_bits = b_fcus->pars_bits_l;
+
+      pars_bits_v1 =
+        (n == n->b[b_fcus->l_v1]->left)?
+        (n->b[b_fcus->l_v1]->pars_bits_r):
+        (n->b[b_fcus->l_v1]->pars_bits_l);
+
+      pars_bits_v2 =
+        (n == n->b[b_fcus->l_v2]->left)?
+        (n->b[b_fcus->l_v2]->pars_bits_r):
+        (n->b[b_fcus->l_v2]->pars_bits_l);
     }
   else
     {
@@ -350,6 +531,18 @@ void Update_P_Pars(t_tree *tree, t_edge *b_fcus, t_node *n)
         (n == n->b[b_fcus->r_v2]->left)?
         (n->b[b_fcus->r_v2]->pars_r):
         (n->b[b_fcus->r_v2]->pars_l);
+
+      pars_bits = b_fcus->pars_bits_r;
+
+      pars_bits_v1 =
+        (n == n->b[b_fcus->r_v1]->left)?
+        (n->b[b_fcus->r_v1]->pars_bits_r):
+        (n->b[b_fcus->r_v1]->pars_bits_l);
+
+      pars_bits_v2 =
+        (n == n->b[b_fcus->r_v2]->left)?
+        (n->b[b_fcus->r_v2]->pars_bits_r):
+        (n->b[b_fcus->r_v2]->pars_bits_l);
     }
   
   
@@ -376,6 +569,10 @@ void Update_P_Pars(t_tree *tree, t_edge *b_fcus, t_node *n)
             }
         }
     }
+  else if(tree->use_pars_bits == YES)
+    {
+      Update_P_Pars_Bits(pars_bits,pars_bits_v1,pars_bits_v2,tree);
+    }
   else
     {
       For(site,n_patterns)
@@ -452,6 +649,14 @@ int One_Pars_Step(t_edge *b,t_tree *tree)
   tree->mod->s_opt->general_pars = 0;
   Set_Both_Sides(YES,tree);
   Pars(NULL,tree);
+  /* ui vectors are needed below */
+  if(tree->use_pars_bits == YES)
+    {
+      tree->use_pars_bits = NO;
+      Post_Order_Pars(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
+      Pre_Order_Pars(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
+      tree->use_pars_bits = YES;
+    }
 
   For(site,tree->n_pattern)
     {
@@ -474,6 +679,12 @@ int Pars_At_Given_Edge(t_edge *b, t_tree *tree)
 /*   n_patterns = (int)FLOOR(tree->n_pattern*tree->prop_of_sites_to_consider); */
   n_patterns = tree->n_pattern;
 
+  if(tree->use_pars_bits == YES && tree->mod->s_opt->general_pars == NO)
+    {
+      tree->c_pars = Pars_Bits_Core(b,tree);
+      return tree->c_pars;
+    }
+
   tree->c_pars = .0;
   For(site,n_patterns)
     {
@@ -962,14 +1173,26 @@ void Get_Step_Mat(t_tree *tree)
 // Tree should be ready for likelihood analysis when calling
 // this function.
 void Stepwise_Add_Pars(t_tree *tree)
+{
+  Stepwise_Add_Pars_Core(tree,NULL);
+}
+
+/*********************************************************/
+
+// Stepwise addition of the tips, in random order, each one being
+// regrafted at its most parsimonious position. Random numbers are
+// drawn from 'seed' (see Rand_Int_R) when not NULL, from rand()
+// otherwise.
+void Stepwise_Add_Pars_Core(t_tree *tree, unsigned int *seed)
 {
   t_edge **residuals,**targets,*best_target;
-  int *nd_idx,i,j,n_targets,*tg_idx;
+  t_node *tip;
+  int *nd_idx,i,j,n_targets,*tg_idx,cost;
 
   residuals   = (t_edge **)mCalloc(tree->n_otu-3,sizeof(t_edge *));
   targets     = (t_edge **)mCalloc(2*tree->n_otu-3,sizeof(t_edge *));
   best_target = NULL;
-  nd_idx      = Permutate(tree->n_otu-3);
+  nd_idx      = (seed != NULL) ? Permutate_R(tree->n_otu-3,seed) : Permutate(tree->n_otu-3);
 
   // Remove all tips except that corresponding to a_nodes[0], 
   // a_nodes[1] and a_nodes[2].  
@@ -994,47 +1217,59 @@ void Stepwise_Add_Pars(t_tree *tree)
 
       /* printf("\n. [%d/%d]",i,tree->n_otu-3); */
 
+      tip = tree->a_nodes[nd_idx[i]+3];
+
       tree->best_pars = 1E+8;
       best_target = NULL;
-      tg_idx      = Permutate(n_targets);
+      tg_idx      = (seed != NULL) ? Permutate_R(n_targets,seed) : Permutate(n_targets);
 
       For(j,n_targets)
         {
-          Graft_Subtree(targets[tg_idx[j]],
-                        tree->a_nodes[nd_idx[i]+3]->v[0],
-                        residuals[i],
-                        NULL,
-                        tree);
-          
-          Update_P_Pars(tree,
-                        tree->a_nodes[nd_idx[i]+3]->b[0],
-                        tree->a_nodes[nd_idx[i]+3]->v[0]);
-          Pars(tree->a_nodes[nd_idx[i]+3]->b[0],tree);
-          
+          if(tree->mod->s_opt->general_pars == NO && tree->is_mixt_tree == NO)
+            {
+              // Both sides of every edge are up to date: the cost of
+              // each insertion is obtained without grafting the tip.
+              // Partitioned data are scored by grafting, as Pars sums
+              // over all the partition elements
+              cost = Pars_Insertion_Cost(targets[tg_idx[j]],tip,tree);
+            }
+          else
+            {
+              Graft_Subtree(targets[tg_idx[j]],
+                            tip->v[0],
+                            residuals[i],
+                            NULL,
+                            tree);
+              
+              Update_P_Pars(tree,tip->b[0],tip->v[0]);
+              cost = Pars(tip->b[0],tree);
+              
+              Prune_Subtree(tip->v[0],                        
+                            tip,
+                            NULL,
+                            residuals+i,
+                            tree);
+            }
 
-          if(tree->c_pars < tree->best_pars)
+          if(cost < tree->best_pars)
             {
-              tree->best_pars = tree->c_pars;
+              tree->best_pars = cost;
               best_target = targets[tg_idx[j]];
             }
-          
-          Prune_Subtree(tree->a_nodes[nd_idx[i]+3]->v[0],                        
-                        tree->a_nodes[nd_idx[i]+3],
-                        NULL,
-                        residuals+i,
-                        tree);
         }
 
       assert(best_target);
             
       Graft_Subtree(best_target,
-                    tree->a_nodes[nd_idx[i]+3]->v[0],
+                    tip->v[0],
                     residuals[i],
                     NULL,
                     tree);
       
+      tree->c_pars = tree->best_pars;
+
       targets[n_targets]   = residuals[i]; 
-      targets[n_targets+1] = tree->a_nodes[nd_idx[i]+3]->b[0];
+      targets[n_targets+1] = tip->b[0];
       
       Free(tg_idx);
       n_targets+=2;
@@ -1047,3 +1282,139 @@ void Stepwise_Add_Pars(t_tree *tree)
   Free(residuals);
   Free(targets);
 }
+
+/*********************************************************/
+
+// Parsimony of the tree obtained by grafting 'tip' in the middle of
+// edge 'b'. Requires up to date parsimony vectors on both sides of
+// 'b' (see Pars with both_sides set) and Fitch's step matrix. Fitch
+// scores do not depend on the root, so that the tree is scored at the
+// new edge leading to 'tip', whose partial vectors are obtained from
+// those on each side of 'b'.
+int Pars_Insertion_Cost(t_edge *b, t_node *tip, t_tree *tree)
+{
+  int site,s,w,ns,n_words,steps,cost;
+  unsigned int ui;
+  pars_word any,empty,*l,*r,*t;
+
+  assert(tip->tax == YES);
+  assert(tip == tip->b[0]->rght);
+
+  if(tree->use_pars_bits == YES)
+    {
+      ns      = tree->mod->ns;
+      n_words = PARS_N_WORDS(tree->data->crunch_len);
+      steps   = 0;
+
+      For(w,n_words)
+        {
+          l = b->pars_bits_l + w*ns;
+          r = b->pars_bits_r + w*ns;
+          t = tip->b[0]->pars_bits_r + w*ns;
+
+          any = 0;
+          For(s,ns) any |= l[s] & r[s];
+          empty = ~any;
+
+          any = 0;
+          For(s,ns) any |= ((l[s] & r[s]) | ((l[s] | r[s]) & empty)) & t[s];
+
+          steps +=
+            Pars_Bits_Weighted_Count(empty,w,n_words,tree) +
+            Pars_Bits_Weighted_Count(~any,w,n_words,tree);
+        }
+
+      return (int)(b->pars_bits_l[n_words*ns] + 
+                   b->pars_bits_r[n_words*ns] + 
+                   tip->b[0]->pars_bits_r[n_words*ns]) + steps;
+    }
+
+  cost = 0;
+  For(site,tree->n_pattern)
+    {
+      steps = b->pars_l[site] + b->pars_r[site] + tip->b[0]->pars_r[site];
+
+      ui = b->ui_l[site] & b->ui_r[site];
+      if(!ui)
+        {
+          steps++;
+          ui = b->ui_l[site] | b->ui_r[site];
+        }
+      if(!(ui & tip->b[0]->ui_r[site])) steps++;
+
+      cost += steps * tree->data->wght[site];
+    }
+
+  return cost;
+}
+
+/*********************************************************/
+
+// Builds s_opt->n_pars_starts stepwise addition trees, each with its
+// own random order of addition, and keeps the most parsimonious one.
+// Each tree is built on a separate copy (parsimony vectors only) so
+// that the copies can be processed in parallel.
+void Stepwise_Add_Pars_Starts(t_tree *tree)
+{
+  t_pars_start_job job;
+  int i,n_starts,best;
+
+  n_starts = tree->mod->s_opt->n_pars_starts;
+
+  if(n_starts < 2 || tree->is_mixt_tree == YES)
+    {
+      Stepwise_Add_Pars(tree);
+      return;
+    }
+
+  job.trees = (t_tree **)mCalloc(n_starts,sizeof(t_tree *));
+  job.seeds = (unsigned int *)mCalloc(n_starts,sizeof(unsigned int));
+  job.pars  = (int *)mCalloc(n_starts,sizeof(int));
+
+  For(i,n_starts)
+    {
+      job.seeds[i] = (unsigned int)Rand();
+      job.trees[i] = Make_Tree_From_Scratch(tree->n_otu,tree->data);
+      job.trees[i]->mod                  = tree->mod;
+      job.trees[i]->io                   = tree->io;
+      job.trees[i]->n_pattern            = tree->n_pattern;
+      job.trees[i]->update_alias_subpatt = NO;
+      Copy_Tree(tree,job.trees[i]);
+      Connect_CSeqs_To_Nodes(tree->data,tree->io,job.trees[i]);
+      Make_Tree_4_Pars(job.trees[i],tree->data,tree->data->init_len);
+    }
+
+  THREAD_Run(Stepwise_Add_Pars_Job,&job,n_starts,1);
+
+  best = 0;
+  For(i,n_starts) if(job.pars[i] < job.pars[best]) best = i;
+
+  Copy_Tree(job.trees[best],tree);
+  tree->c_pars = job.pars[best];
+
+  For(i,n_starts)
+    {
+      Free_Tree_Pars(job.trees[i]);
+      Free_Tree(job.trees[i]);
+    }
+  Free(job.trees);
+  Free(job.seeds);
+  Free(job.pars);
+}
+
+/*********************************************************/
+
+void Stepwise_Add_Pars_Job(int beg, int end, int thread_id, void *arg)
+{
+  t_pars_start_job *job;
+  int i;
+
+  job = (t_pars_start_job *)arg;
+
+  for(i=beg;i<end;++i)
+    {
+      Stepwise_Add_Pars_Core(job->trees[i],job->seeds+i);
+      Set_Both_Sides(YES,job->trees[i]);
+      job->pars[i] = Pars(NULL,job->trees[i]);
+    }
+}
@@ -21,6 +21,13 @@ the GNU public licence.  See http://www.opensource.org for details.
 #include "models.h"
 #include "free.h"
 
+/*! Arguments passed to the threads that build stepwise addition trees */
+typedef struct __Pars_Start_Job {
+  t_tree          **trees; /*! one copy of the tree per starting point */
+  unsigned int     *seeds; /*! random seed of each starting point */
+  int               *pars; /*! parsimony of the trees once built */
+}t_pars_start_job;
+
 int  Pars(t_edge *b, t_tree *tree);
 void Post_Order_Pars(t_node *a, t_node *d, t_tree *tree);
 void Pre_Order_Pars(t_node *a, t_node *d, t_tree *tree);
@@ -36,5 +43,15 @@ void Get_Step_Mat(t_tree *tree);
 int Pars_Core(t_edge *b, t_tree *tree);
 int One_Pars_Step(t_edge *b,t_tree *tree);
 void Stepwise_Add_Pars(t_tree *tree);
+void Init_Pars_Bits_Tips(t_tree *tree);
+void Init_Pars_Bits_Weights(t_tree *tree);
+int Pars_Popcount(pars_word x);
+int Pars_Bits_Weighted_Count(pars_word mask, int w, int n_words, t_tree *tree);
+void Update_P_Pars_Bits(pars_word *bits, pars_word *bits_v1, pars_word *bits_v2, t_tree *tree);
+int Pars_Bits_Core(t_edge *b, t_tree *tree);
+void Stepwise_Add_Pars_Core(t_tree *tree, unsigned int *seed);
+int Pars_Insertion_Cost(t_edge *b, t_node *tip, t_tree *tree);
+void Stepwise_Add_Pars_Starts(t_tree *tree);
+void Stepwise_Add_Pars_Job(int beg, int end, int thread_id, void *arg);
 
 #endif
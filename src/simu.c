@@ -87,6 +87,10 @@ int Simu(t_tree *tree, int n_step_max)
 
       if(step > n_step_max) break;
 
+      if(Time_Budget_Over(TIME_BUDGET_NNI,tree->io) == YES) break;
+
+      UFBOOT_Update(NULL,tree);
+
       if(tree->io->print_trace)
         {
           char *s = Write_Tree(tree,NO);
@@ -99,7 +103,7 @@ int Simu(t_tree *tree, int n_step_max)
 
       if(tree->verbose > VL2 && tree->io->quiet == NO) Print_Lk(tree,"[Topology           ]");
 
-      if((FABS(old_loglk-tree->c_lnL) < tree->mod->s_opt->min_diff_lk_global) || (n_without_swap > it_lim_without_swap)) break;
+      if((FABS(old_loglk-tree->c_lnL) < Time_Budget_Tol(tree->mod->s_opt->min_diff_lk_global,tree->io)) || (n_without_swap > it_lim_without_swap)) break;
 
       Fix_All(tree);
       n_neg = 0;
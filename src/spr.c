@@ -1271,7 +1271,7 @@ int Est_Lk_Change (t_edge *e_prune, t_node *v_prune, t_tree *tree)
   int     i, j, cand, best_cand, d0, d1, d2, n, pat, cat, ste;
   phydbl  d_uu, best_d_lk, l_connect, l_01, l_02, l_12, l_est[3], new_lk,
           l_simple[3], l_dist[3];
-  phydbl *p_lk1_tmp, *p_lk2_tmp, *p_lk;
+  phyplk *p_lk1_tmp, *p_lk2_tmp, *p_lk;
   int *p_sum;
   t_node   *u_prune, *v_n, *v_nx1, *u1, *u2;
   t_edge   *e_regraft, *e_tmp;
@@ -1807,7 +1807,7 @@ int Best_Lk_Change (t_edge *e_prune, t_node *v_prune, t_tree *tree)
 {
   int     i, j, cand, best_cand, d0, d1, d2, n, pat, cat, ste;
   phydbl  d_uu, best_d_lk, l_connect, l_01, l_02, l_12, l_est[3], new_lk, l_simple[3], l_dist[3];
-  phydbl *p_lk1_tmp, *p_lk2_tmp, *p_lk;
+  phyplk *p_lk1_tmp, *p_lk2_tmp, *p_lk;
   int *p_sum;
   t_node   *u_prune, *v_n, *v_nx1, *u1, *u2;
   t_edge   *e_regraft, *e_tmp;
@@ -2676,7 +2676,7 @@ void Prune (t_edge *e, t_node *v, t_edge **e_connect, t_edge **e_avail, t_tree *
   t_node   *u1, *u2, *tmp_node;
   t_edge   *e1, *e2;
   int *sum_scale_f;
-  phydbl *p_lk;
+  phyplk *p_lk;
   int dim1, dim2;
 
 
@@ -2851,7 +2851,7 @@ void Regraft (t_edge *e, t_node *v, t_edge *avail, t_tree *tree)
 {
   int     dir0, dir1, dir2, i, j, k;
   int *sum_scale_f;
-  phydbl *p_lk;
+  phyplk *p_lk;
   t_node   *u1, *u2;
   int dim1, dim2;
 
@@ -3195,6 +3195,8 @@ int Spr(phydbl init_lnL, phydbl prop_spr, t_tree *tree)
       b = tree->a_edges[br];
       Spr_Subtree(b,b->left,tree);
       Spr_Subtree(b,b->rght,tree);
+
+      if(Time_Budget_Over(TIME_BUDGET_SPR,tree->io) == YES) break;
     }
 
 
@@ -3395,6 +3397,8 @@ int Test_All_Spr_Targets(t_edge *b_pulled, t_node *n_link, t_tree *tree)
 
   if(!(n_v1->tax && n_v2->tax)) /*! Pruning is meaningless otherwise */
     {
+      if(tree->topo_memo != NULL) Topo_Memo_Prepare(b_pulled,n_link,tree);
+
       Prune_Subtree(n_link,n_opp_to_link,&b_target,&b_residual,tree);
 
       if(tree->mod->s_opt->spr_lnL == YES)
@@ -3405,17 +3409,27 @@ int Test_All_Spr_Targets(t_edge *b_pulled, t_node *n_link, t_tree *tree)
       best_found = NO;
       tree->depth_curr_path = 0;
       tree->curr_path[0] = b_target->left;
-      Test_One_Spr_Target_Recur(b_target->rght,
-                                b_target->left,
-                                b_pulled,n_link,b_residual,b_target,&best_found,tree);
+      if(Spr_Par_Targets(tree) == YES)
+        Test_Spr_Targets_Par(b_target->rght,
+                             b_target->left,
+                             b_pulled,n_link,b_residual,b_target,&best_found,tree);
+      else
+        Test_One_Spr_Target_Recur(b_target->rght,
+                                  b_target->left,
+                                  b_pulled,n_link,b_residual,b_target,&best_found,tree);
       
       if(best_found == NO || tree->mod->s_opt->spr_lnL == NO)
         {
           tree->depth_curr_path = 0;
           tree->curr_path[0] = b_target->rght;
-          Test_One_Spr_Target_Recur(b_target->left,
-                                    b_target->rght,
-                                    b_pulled,n_link,b_residual,b_target,&best_found,tree);
+          if(Spr_Par_Targets(tree) == YES)
+            Test_Spr_Targets_Par(b_target->left,
+                                 b_target->rght,
+                                 b_pulled,n_link,b_residual,b_target,&best_found,tree);
+          else
+            Test_One_Spr_Target_Recur(b_target->left,
+                                      b_target->rght,
+                                      b_pulled,n_link,b_residual,b_target,&best_found,tree);
         }
 
       Graft_Subtree(b_target,n_link,b_residual,NULL,tree);
@@ -3520,6 +3534,7 @@ void Test_One_Spr_Target_Recur(t_node *a, t_node *d, t_edge *pulled, t_node *lin
                      (tree->mod->s_opt->spr_pars == YES && move_score < tree->best_pars)) 
                     {
                       *best_found = YES;
+                      tree->depth_curr_path--;
                       return;
                     }
                 }
@@ -3546,6 +3561,7 @@ phydbl Test_One_Spr_Target(t_edge *b_target, t_edge *b_arrow, t_node *n_link, t_
   phydbl init_lnL;
   int init_pars;
   t_spr *move;
+  unsigned long long key;
 
   if(tree->mixt_tree != NULL)
     {
@@ -3553,6 +3569,13 @@ phydbl Test_One_Spr_Target(t_edge *b_target, t_edge *b_arrow, t_node *n_link, t_
       Exit("\n");
     }
 
+  key = 0;
+  if(tree->topo_memo != NULL)
+    {
+      key = Topo_Memo_Spr_Key(tree->curr_path,tree->depth_curr_path,tree);
+      if(Topo_Memo_Skip(key,tree) == YES) return UNLIKELY;
+    }
+
   tree->n_moves++;
 
   init_lnL  = tree->c_lnL;
@@ -3667,6 +3690,8 @@ phydbl Test_One_Spr_Target(t_edge *b_target, t_edge *b_arrow, t_node *n_link, t_
   move->dist          = b_target->topo_dist_btw_edges;
   move->n_opp_to_link = (n_link==b_arrow->left)?(b_arrow->rght):(b_arrow->left);
   
+  if(tree->topo_memo != NULL) Topo_Memo_Insert(key,move->lnL,tree->topo_memo);
+
   Include_One_Spr_To_List_Of_Spr(move,tree);
 
   Copy_Scalar_Dbl(init_target_l,b_target->l);
@@ -3707,6 +3732,498 @@ phydbl Test_One_Spr_Target(t_edge *b_target, t_edge *b_arrow, t_node *n_link, t_
 
 /*********************************************************/
 
+/* Can the likelihood around a regraft position (or around an internal
+   edge, see NNI_Neigh_BL_Local) be calculated by several threads at the
+   same time? Only when this likelihood does not involve anything else
+   than standard partial likelihoods and transition probabilities. The
+   answer does not depend on the number of threads, so that the moves
+   are scored by the same code, and the search ends on the same tree,
+   whatever this number */
+int Spr_Par_Lk(t_tree *tree)
+{
+#if defined(BEAGLE)
+  return NO;
+#else
+  if(tree->eval_alnL == NO) return NO;
+  if(tree->is_mixt_tree == YES || tree->mixt_tree != NULL) return NO;
+  if(tree->mod->use_m4mod == YES || tree->mod->s_opt->greedy == YES) return NO;
+  if(tree->mod->gamma_mgf_bl == YES || tree->io->mod->gamma_mgf_bl == YES) return NO;
+  if(tree->mod->log_l == YES || tree->use_eigen_lr == YES) return NO;
+  if(tree->lowmem != NULL || tree->rates != NULL) return NO;
+  if(tree->n_root != NULL && tree->ignore_root == NO) return NO;
+  return YES;
+#endif
+}
+
+/*********************************************************/
+
+/* Can the regraft positions of a pruned subtree be scored concurrently
+   (see Test_Spr_Targets_Par)? */
+int Spr_Par_Targets(t_tree *tree)
+{
+  if(tree->mod->s_opt->spr_lnL == NO || tree->mod->s_opt->spr_pars == YES) return NO;
+  return Spr_Par_Lk(tree);
+}
+
+/*********************************************************/
+
+/* Lengths of b_target and b_residual once the pruned subtree is
+   grafted on b_target (see Graft_Subtree and Update_PMat_At_Given_Edge) */
+static void Spr_Target_Br_Len(t_edge *b_target, t_edge *b_residual, phydbl *l_t, phydbl *v_t, phydbl *l_r, phydbl *v_r, t_tree *tree)
+{
+  *l_t = b_target->l->v;
+  *v_t = b_target->l_var->v;
+  if(b_target->l->onoff == ON)
+    {
+      *l_t /= 2.;
+      *v_t /= 2.;
+    }
+
+  *l_r = b_residual->l->v;
+  *v_r = b_residual->l_var->v;
+  if(b_residual->l->onoff == ON)
+    {
+      *l_r = *l_t;
+      *v_r = *v_t;
+    }
+
+  *l_t = MIN(MAX(*l_t,tree->mod->l_min),tree->mod->l_max);
+  *l_r = MIN(MAX(*l_r,tree->mod->l_min),tree->mod->l_max);
+}
+
+/*********************************************************/
+
+/* Transition probabilities along an edge of length l, for every
+   class of rate (see Update_PMat_At_Given_Edge) */
+static void Spr_Target_PMat(phydbl l, int has_zero_br_len, phydbl *Pij, t_tree *tree)
+{
+  int catg;
+  phydbl len;
+
+  For(catg,tree->mod->ras->n_catg)
+    {
+      if(has_zero_br_len == YES) len = -1.0;
+      else
+        {
+          len = MAX(0.0,l)*tree->mod->ras->gamma_rr->v[catg];
+          len *= tree->mod->br_len_mult->v;
+          if(len < tree->mod->l_min)      len = tree->mod->l_min;
+          else if(len > tree->mod->l_max) len = tree->mod->l_max;
+        }
+      PMat(len,tree->mod,catg*tree->mod->ns*tree->mod->ns,Pij);
+    }
+}
+
+/*********************************************************/
+
+/* Same as Test_One_Spr_Target_Recur, except that the regraft positions
+   are first collected (and the partial likelihoods on the way updated),
+   then scored concurrently, and finally included in the list of moves
+   in the order in which they were visited. As in the serial version,
+   the list stops growing with the first position that improves upon
+   the best likelihood, so that the moves selected do not depend on the
+   number of threads */
+void Test_Spr_Targets_Par(t_node *a, t_node *d, t_edge *pulled, t_node *link, t_edge *residual, t_edge *init_target, int *best_found, t_tree *tree)
+{
+  t_spr_target *cand;
+  t_spr_job job;
+  int i,n_cand;
+
+  if(*best_found == YES) return;
+
+  cand   = (t_spr_target *)mCalloc(2*tree->n_otu-3,sizeof(t_spr_target));
+  n_cand = 0;
+
+  Collect_Spr_Targets_Recur(a,d,residual,cand,&n_cand,tree);
+
+  Update_PMat_At_Given_Edge(pulled,tree);
+
+  job.tree          = tree;
+  job.cand          = cand;
+  job.b_arrow       = pulled;
+  job.n_opp_to_link = (link == pulled->left)?(pulled->rght):(pulled->left);
+
+  Spr_Arrow_Lk(&job);
+
+  THREAD_Run(Score_Spr_Targets,&job,n_cand,1);
+
+  For(i,n_cand)
+    {
+      if(cand[i].memo_hit == YES) continue;
+
+      Include_One_Spr_Target(cand+i,pulled,link,residual,init_target,tree);
+
+      if(tree->topo_memo != NULL) Topo_Memo_Insert(cand[i].key,cand[i].lnL,tree->topo_memo);
+
+      if(cand[i].lnL > tree->best_lnL + tree->mod->s_opt->min_diff_lk_move)
+        {
+          *best_found = YES;
+          break;
+        }
+    }
+
+  For(i,n_cand)
+    {
+      if(cand[i].Pij_r != cand[i].Pij_t) Free(cand[i].Pij_r);
+      Free(cand[i].Pij_t);
+      Free(cand[i].path);
+    }
+  Free(cand);
+  Free(job.arrow);
+  Free(job.arrow_scale);
+}
+
+/*********************************************************/
+
+/* Visit the regraft positions in the same order as
+   Test_One_Spr_Target_Recur and record those within the allowed
+   range of depths */
+void Collect_Spr_Targets_Recur(t_node *a, t_node *d, t_edge *residual, t_spr_target *cand, int *n_cand, t_tree *tree)
+{
+  int i,j,size;
+  phydbl l_t,v_t,l_r,v_r;
+  t_spr_target *c;
+
+  if(d->tax) return;
+
+  size = tree->mod->ras->n_catg*tree->mod->ns*tree->mod->ns;
+
+  For(i,3)
+    {
+      if(d->v[i] != a)
+        {
+          MIXT_Set_Alias_Subpatt(YES,tree);
+          Update_P_Lk(tree,d->b[i],d);
+          MIXT_Set_Alias_Subpatt(NO,tree);
+
+          tree->depth_curr_path++;
+          tree->curr_path[tree->depth_curr_path] = d->v[i];
+
+          if((tree->depth_curr_path <= tree->mod->s_opt->max_depth_path) &&
+             (tree->depth_curr_path >= tree->mod->s_opt->min_depth_path))
+            {
+              c = cand + *n_cand;
+              (*n_cand)++;
+
+              c->b_target = d->b[i];
+              c->depth    = tree->depth_curr_path;
+              c->path     = (t_node **)mCalloc(c->depth+1,sizeof(t_node *));
+              For(j,c->depth+1) c->path[j] = tree->curr_path[j];
+
+              c->memo_hit = NO;
+              if(tree->topo_memo != NULL)
+                {
+                  c->key      = Topo_Memo_Spr_Key(c->path,c->depth,tree);
+                  c->memo_hit = Topo_Memo_Skip(c->key,tree);
+                }
+
+              if(c->memo_hit == NO)
+                {
+                  Spr_Target_Br_Len(c->b_target,residual,&l_t,&v_t,&l_r,&v_r,tree);
+
+                  c->Pij_t = (phydbl *)mCalloc(size,sizeof(phydbl));
+                  Spr_Target_PMat(l_t,c->b_target->has_zero_br_len,c->Pij_t,tree);
+
+                  if(l_t == l_r && c->b_target->has_zero_br_len == residual->has_zero_br_len)
+                    c->Pij_r = c->Pij_t;
+                  else
+                    {
+                      c->Pij_r = (phydbl *)mCalloc(size,sizeof(phydbl));
+                      Spr_Target_PMat(l_r,residual->has_zero_br_len,c->Pij_r,tree);
+                    }
+                }
+            }
+
+          if(tree->depth_curr_path < tree->mod->s_opt->max_depth_path)
+            Collect_Spr_Targets_Recur(d,d->v[i],residual,cand,n_cand,tree);
+
+          tree->depth_curr_path--;
+        }
+    }
+}
+
+/*********************************************************/
+
+void Score_Spr_Targets(int beg, int end, int thread_id, void *arg)
+{
+  t_spr_job *job;
+  int i;
+
+  job = (t_spr_job *)arg;
+
+  for(i=beg;i<end;i++)
+    if(job->cand[i].memo_hit == NO)
+      job->cand[i].lnL = Spr_Target_Lk(job->cand+i,job);
+}
+
+/*********************************************************/
+
+/* Partial likelihoods of rate class catg at site 'site' of the subtree
+   rooted at d (looking away from b), copied in plk with their largest
+   value in [0.5,1). The true partial likelihoods are plk * 2^-s, where
+   s is the returned value */
+int Spr_Site_P_Lk(t_edge *b, t_node *d, int site, int catg, phydbl *plk, t_tree *tree)
+{
+  int i,ns,scale,exponent;
+  phyplk *p_lk;
+  int *sum_scale;
+  phydbl largest,factor;
+
+  ns = tree->mod->ns;
+
+  if(d->tax == YES)
+    {
+      For(i,ns) plk[i] = (phydbl)d->b[0]->p_lk_tip_r[site*ns+i];
+      return 0;
+    }
+
+  p_lk      = (d == b->left)?(b->p_lk_left):(b->p_lk_rght);
+  sum_scale = (d == b->left)?(b->sum_scale_left):(b->sum_scale_rght);
+
+  p_lk += site*tree->mod->ras->n_catg*ns + catg*ns;
+  scale = (sum_scale != NULL)?(sum_scale[catg*tree->n_pattern+site]):(0);
+
+  largest = .0;
+  For(i,ns)
+    {
+      plk[i]  = (phydbl)p_lk[i];
+      largest = MAX(largest,plk[i]);
+    }
+
+  if(largest > .0)
+    {
+      frexp(largest,&exponent);
+      factor = ldexp(1.,-exponent);
+      For(i,ns) plk[i] *= factor;
+      scale -= exponent;
+    }
+
+  return scale;
+}
+
+/*********************************************************/
+
+/* Log-likelihood at site 'site', where lk is the likelihood of the
+   variable sites part of the model multiplied by 2^scale */
+phydbl Spr_Log_Site_Lk(phydbl lk, int scale, int site, t_tree *tree)
+{
+  phydbl log_site_lk,log_inv_lk,pinv;
+
+  log_site_lk = LOG(lk) - (phydbl)LOG2 * scale;
+
+  if(tree->mod->ras->invar == YES)
+    {
+      pinv = tree->mod->ras->pinvar->v;
+      log_site_lk += LOG(1.-pinv);
+      if(tree->data->invar[site] > -0.5)
+        {
+          log_inv_lk = LOG(pinv * tree->mod->e_frq->pi->v[tree->data->invar[site]]);
+          log_site_lk = MAX(log_site_lk,log_inv_lk) + LOG(1.+EXP(MIN(log_site_lk,log_inv_lk)-MAX(log_site_lk,log_inv_lk)));
+        }
+    }
+
+  return log_site_lk;
+}
+
+/*********************************************************/
+
+/* Contribution of the pruned subtree to the likelihood at the node
+   where it would be attached, which is the same for every regraft
+   position: pi_i * sum_j P(i->j) * p_lk(j) along b_arrow, for every
+   site and rate class */
+void Spr_Arrow_Lk(t_spr_job *job)
+{
+  int site,catg,i,j,ns,n_catg,dim3;
+  phydbl *p_a,*Pij_a,*arrow,*pi;
+  phydbl sum;
+  t_tree *tree;
+
+  tree   = job->tree;
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  dim3   = ns*ns;
+  pi     = tree->mod->e_frq->pi->v;
+
+  job->arrow       = (phydbl *)mCalloc(tree->n_pattern*n_catg*ns,sizeof(phydbl));
+  job->arrow_scale = (int *)mCalloc(tree->n_pattern*n_catg,sizeof(int));
+  p_a              = (phydbl *)mCalloc(ns,sizeof(phydbl));
+
+  For(site,tree->n_pattern)
+    {
+      if(tree->data->wght[site] < SMALL) continue;
+
+      For(catg,n_catg)
+        {
+          job->arrow_scale[site*n_catg+catg] = Spr_Site_P_Lk(job->b_arrow,job->n_opp_to_link,site,catg,p_a,tree);
+
+          Pij_a = job->b_arrow->Pij_rr + catg*dim3;
+          arrow = job->arrow + (site*n_catg+catg)*ns;
+          For(i,ns)
+            {
+              sum = .0;
+              For(j,ns) sum += Pij_a[i*ns+j] * p_a[j];
+              arrow[i] = pi[i] * sum;
+            }
+        }
+    }
+
+  Free(p_a);
+}
+
+/*********************************************************/
+
+/* Log-likelihood of the tree obtained by grafting the pruned subtree
+   (see Spr_Arrow_Lk) on cand->b_target. The tree itself is left
+   untouched: the likelihood is calculated at the node where the
+   subtree would be attached, from the partial likelihoods of the three
+   subtrees around it. Several threads may therefore call this function
+   at the same time. It is also used with a single thread, so that the
+   moves selected do not depend on the number of threads */
+phydbl Spr_Target_Lk(t_spr_target *cand, t_spr_job *job)
+{
+  int site,catg,i,j,ns,n_catg,dim3,min_scale;
+  int *scale;
+  phydbl *p_l,*p_r,*lk_cat,*arrow;
+  phydbl *Pij_l,*Pij_r;
+  phydbl sum_l,sum_r,site_lk,lnL;
+  t_edge *b;
+  t_tree *tree;
+
+  tree   = job->tree;
+  b      = cand->b_target;
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  dim3   = ns*ns;
+
+  p_l    = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  p_r    = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  lk_cat = (phydbl *)mCalloc(n_catg,sizeof(phydbl));
+  scale  = (int *)mCalloc(n_catg,sizeof(int));
+
+  lnL = .0;
+  For(site,tree->n_pattern)
+    {
+      if(tree->data->wght[site] < SMALL) continue;
+
+      min_scale = INT_MAX;
+      For(catg,n_catg)
+        {
+          scale[catg]  = job->arrow_scale[site*n_catg+catg];
+          scale[catg] += Spr_Site_P_Lk(b,b->left,site,catg,p_l,tree);
+          scale[catg] += Spr_Site_P_Lk(b,b->rght,site,catg,p_r,tree);
+
+          /* Graft_Subtree keeps the end of b_target with the smallest
+             number on b_target, the other one goes to the residual edge */
+          arrow = job->arrow + (site*n_catg+catg)*ns;
+          Pij_l = ((b->left->num < b->rght->num)?(cand->Pij_t):(cand->Pij_r)) + catg*dim3;
+          Pij_r = ((b->left->num < b->rght->num)?(cand->Pij_r):(cand->Pij_t)) + catg*dim3;
+
+          lk_cat[catg] = .0;
+          For(i,ns)
+            {
+              sum_l = sum_r = .0;
+              For(j,ns)
+                {
+                  sum_l += Pij_l[i*ns+j] * p_l[j];
+                  sum_r += Pij_r[i*ns+j] * p_r[j];
+                }
+              lk_cat[catg] += arrow[i] * sum_l * sum_r;
+            }
+
+          min_scale = MIN(min_scale,scale[catg]);
+        }
+
+      site_lk = .0;
+      For(catg,n_catg)
+        site_lk += tree->mod->ras->gamma_r_proba->v[catg] * ldexp(lk_cat[catg],-(scale[catg]-min_scale));
+
+      lnL += tree->data->wght[site] * Spr_Log_Site_Lk(site_lk,min_scale,site,tree);
+    }
+
+  Free(p_l);
+  Free(p_r);
+  Free(lk_cat);
+  Free(scale);
+
+  return lnL;
+}
+
+/*********************************************************/
+
+/* Build the move that corresponds to a regraft position scored by
+   Spr_Target_Lk and include it in the list of moves (see
+   Test_One_Spr_Target) */
+void Include_One_Spr_Target(t_spr_target *cand, t_edge *b_arrow, t_node *n_link, t_edge *b_residual, t_edge *init_target, t_tree *tree)
+{
+  t_spr *move;
+  phydbl l_t,v_t,l_r,v_r;
+  int i;
+
+  tree->n_moves++;
+
+  move = tree->spr_list[tree->size_spr_list];
+
+  if(move->init_target_l == NULL)
+    {
+      move->init_target_l = Duplicate_Scalar_Dbl(init_target->l);
+      move->init_target_v = Duplicate_Scalar_Dbl(init_target->l_var);
+    }
+  else
+    {
+      Copy_Scalar_Dbl(init_target->l,    move->init_target_l);
+      Copy_Scalar_Dbl(init_target->l_var,move->init_target_v);
+    }
+
+  if(move->l0 != NULL)
+    {
+      Free_Scalar_Dbl(move->l0);
+      Free_Scalar_Dbl(move->v0);
+    }
+
+  if(move->l1 != NULL)
+    {
+      Free_Scalar_Dbl(move->l1);
+      Free_Scalar_Dbl(move->v1);
+    }
+
+  if(move->l2 != NULL)
+    {
+      Free_Scalar_Dbl(move->l2);
+      Free_Scalar_Dbl(move->v2);
+    }
+
+  Spr_Target_Br_Len(cand->b_target,b_residual,&l_t,&v_t,&l_r,&v_r,tree);
+
+  move->l0 = Duplicate_Scalar_Dbl(b_arrow->l);
+  move->v0 = Duplicate_Scalar_Dbl(b_arrow->l_var);
+
+  move->l1 = Duplicate_Scalar_Dbl(cand->b_target->l);
+  move->v1 = Duplicate_Scalar_Dbl(cand->b_target->l_var);
+  move->l1->v = l_t;
+  move->v1->v = v_t;
+
+  move->l2 = Duplicate_Scalar_Dbl(b_residual->l);
+  move->v2 = Duplicate_Scalar_Dbl(b_residual->l_var);
+  move->l2->v = l_r;
+  move->v2->v = v_r;
+
+  For(i,cand->depth+1) move->path[i] = cand->path[i];
+
+  move->depth_path    = cand->depth;
+  move->pars          = tree->c_pars;
+  move->lnL           = cand->lnL;
+  move->b_target      = cand->b_target;
+  move->n_link        = n_link;
+  move->b_opp_to_link = b_arrow;
+  move->b_init_target = init_target;
+  move->dist          = cand->b_target->topo_dist_btw_edges;
+  move->n_opp_to_link = (n_link==b_arrow->left)?(b_arrow->rght):(b_arrow->left);
+
+  Include_One_Spr_To_List_Of_Spr(move,tree);
+}
+
+/*********************************************************/
+
 void Speed_Spr_Loop(t_tree *tree)
 {
   Spr_List_Of_Trees(tree);
@@ -3749,7 +4266,12 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
 
       Set_Both_Sides(YES,tree);
       Pars(NULL,tree);
-      if(tree->mod->s_opt->spr_pars == NO) Lk(NULL,tree);
+      if(tree->mod->s_opt->spr_pars == NO)
+        {
+          Set_Incr_Lk(YES,tree);
+          Lk(NULL,tree);
+          Set_Incr_Lk(NO,tree);
+        }
       Spr(UNLIKELY,prop_spr,tree);
 
       // Set maximum depth for future spr rounds to deepest spr found so far
@@ -3763,7 +4285,9 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
               Optimize_Br_Len_Serie(tree);
               /* Update partial likelihoods */
               Set_Both_Sides(YES,tree);
+              Set_Incr_Lk(YES,tree);
               Lk(NULL,tree);
+              Set_Incr_Lk(NO,tree);
               /* Print log-likelihood and parsimony scores */
               if(tree->verbose > VL2 && tree->io->quiet == NO) Print_Lk(tree,"[Branch lengths     ]");
             }
@@ -3774,6 +4298,8 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
         }
 
       Pars(NULL,tree);
+
+      if(tree->mod->s_opt->spr_pars == NO) UFBOOT_Update(NULL,tree);
       
       if(tree->io->print_trace)
         {
@@ -3853,7 +4379,9 @@ int Evaluate_List_Of_Regraft_Pos_Triple(t_spr **spr_list, int list_size, t_tree
     }
 
   recorded = NO;
-  For(i,list_size)
+  if(Spr_Par_Triple(spr_list,list_size,tree) == YES)
+    best_move = Evaluate_List_Of_Regraft_Pos_Triple_Par(spr_list,list_size,&better_found,tree);
+  else For(i,list_size)
     {
       move = spr_list[i];
 
@@ -3928,6 +4456,8 @@ int Evaluate_List_Of_Regraft_Pos_Triple(t_spr **spr_list, int list_size, t_tree
           move->lnL = Triple_Dist(move->n_link,tree);
           MIXT_Set_Alias_Subpatt(NO,tree);
 
+          UFBOOT_Update(move->n_link->b[0],tree);
+
           /* printf("\n. %d/%d move->lnL= %f best_lnL=%f absolute_best=%f",i,list_size,move->lnL,best_lnL,tree->best_lnL); */
           
           /* Record updated branch lengths for this move */
@@ -4053,14 +4583,496 @@ int Evaluate_List_Of_Regraft_Pos_Triple(t_spr **spr_list, int list_size, t_tree
     }
 #endif
   
+  if(recorded_l != NULL) Free_Scalar_Dbl(recorded_l);
+  if(recorded_v != NULL) Free_Scalar_Dbl(recorded_v);
+  
+  return best_move;
+}
+
+/*********************************************************/
+
+/* Can the moves in spr_list be evaluated concurrently (see
+   Evaluate_List_Of_Regraft_Pos_Triple_Par)? All the moves must share
+   the same pruned subtree, the transition probabilities must be those
+   given by the eigen decomposition of the rate matrix (see
+   PMat_Empirical) and no edge may have a null length. Moves evaluated
+   concurrently are never grafted, so they cannot be recorded for the
+   RELL bootstrap (see UFBOOT_Update) */
+int Spr_Par_Triple(t_spr **spr_list, int list_size, t_tree *tree)
+{
+  t_spr *first;
+  int i,n_moves;
+
+  if(Spr_Par_Lk(tree) == NO) return NO;
+  if(UFBOOT_Collects(tree) == YES) return NO;
+  if(tree->io->datatype != NT && tree->io->datatype != AA) return NO;
+
+  For(i,2*tree->n_otu-3) if(tree->a_edges[i]->has_zero_br_len == YES) return NO;
+
+  first   = NULL;
+  n_moves = 0;
+  For(i,list_size)
+    {
+      if(spr_list[i] == NULL) return NO;
+      if(spr_list[i]->b_target == NULL) continue;
+
+      if(first == NULL) first = spr_list[i];
+      else if(spr_list[i]->n_link != first->n_link ||
+              spr_list[i]->n_opp_to_link != first->n_opp_to_link) return NO;
+      n_moves++;
+    }
+
+  return (n_moves > 1)?(YES):(NO);
+}
+
+/*********************************************************/
+
+/* Same as the loop over the moves in Evaluate_List_Of_Regraft_Pos_Triple,
+   except that the subtree is pruned only once, the partial likelihoods
+   along the paths to every regraft position are updated beforehand and
+   the three edge lengths around the regraft positions are then
+   optimised concurrently, each thread working on its own copies of the
+   partial likelihoods around the regraft point (see
+   Spr_Triple_Br_Len). The moves are finally examined in the order of
+   the list, with the same stopping rules as in the serial version, so
+   that the move selected does not depend on the number of threads */
+int Evaluate_List_Of_Regraft_Pos_Triple_Par(t_spr **spr_list, int list_size, int *better_found, t_tree *tree)
+{
+  t_spr *move,*first;
+  t_edge *init_target,*b_residual,*b_arrow;
+  t_spr_triple *triple;
+  t_spr_triple_job job;
+  scalar_dbl *recorded_l,*recorded_v;
+  phydbl best_lnL,init_lnL;
+  phydbl l_t,v_t,l_r,v_r;
+  int i,j,n_free,best_move;
+
+  best_lnL      = UNLIKELY;
+  best_move     = -1;
+  init_lnL      = tree->c_lnL;
+  *better_found = NO;
+
+  first = NULL;
+  For(i,list_size) if(spr_list[i]->b_target != NULL) { first = spr_list[i]; break; }
+  assert(first);
+
+  Record_Br_Len(tree);
+
+  Prune_Subtree(first->n_link,
+                first->n_opp_to_link,
+                &init_target,
+                &b_residual,
+                tree);
+
+  /* Rough optimisation of the branch length at prune site */
+  Fast_Br_Len(init_target,tree,NO);
+  recorded_l = Duplicate_Scalar_Dbl(init_target->l);
+  recorded_v = Duplicate_Scalar_Dbl(init_target->l_var);
+
+  Update_PMat_At_Given_Edge(init_target,tree);
+
+  /* Partial likelihoods along the paths from the prune to the regraft
+     positions only depend on the pruned tree */
+  MIXT_Set_Alias_Subpatt(YES,tree);
+  For(i,list_size)
+    if(spr_list[i]->b_target != NULL)
+      Update_P_Lk_Along_A_Path(spr_list[i]->path,spr_list[i]->depth_path+1,tree);
+  MIXT_Set_Alias_Subpatt(NO,tree);
+
+  /* Once grafted, the subtree hangs from the slot of n_link that is
+     still in use, b_target takes the first free slot and b_residual
+     the second one (see Graft_Subtree) */
+  b_arrow = NULL;
+  n_free  = 0;
+  For(j,3)
+    {
+      if(first->n_link->v[j] != NULL)
+        {
+          b_arrow      = first->n_link->b[j];
+          job.order[j] = 0;
+        }
+      else job.order[j] = 1 + n_free++;
+    }
+  assert(b_arrow);
+
+  triple = (t_spr_triple *)mCalloc(list_size,sizeof(t_spr_triple));
+  For(i,list_size) triple[i].move = spr_list[i];
+
+  job.tree          = tree;
+  job.triple        = triple;
+  job.b_arrow       = b_arrow;
+  job.b_residual    = b_residual;
+  job.n_opp_to_link = first->n_opp_to_link;
+
+  THREAD_Run(Optimize_Spr_Triples,&job,list_size,1);
+
+  For(i,list_size)
+    {
+      move = spr_list[i];
+
+      if(move->b_target)
+        {
+          Copy_Scalar_Dbl(recorded_l,move->init_target_l);
+          Copy_Scalar_Dbl(recorded_v,move->init_target_v);
+
+          Spr_Target_Br_Len(move->b_target,b_residual,&l_t,&v_t,&l_r,&v_r,tree);
+
+          Copy_Scalar_Dbl(b_arrow->l,    move->l0);
+          Copy_Scalar_Dbl(b_arrow->l_var,move->v0);
+          move->l0->v = triple[i].l[0];
+
+          Copy_Scalar_Dbl(move->b_target->l,    move->l1);
+          Copy_Scalar_Dbl(move->b_target->l_var,move->v1);
+          move->l1->v = triple[i].l[1];
+          move->v1->v = v_t;
+
+          Copy_Scalar_Dbl(b_residual->l,    move->l2);
+          Copy_Scalar_Dbl(b_residual->l_var,move->v2);
+          move->l2->v = triple[i].l[2];
+          move->v2->v = v_r;
+
+          move->lnL = triple[i].lnL;
+
+          if(move->lnL > best_lnL)
+            {
+              best_lnL  = move->lnL;
+              best_move = i;
+            }
+        }
+
+      if(move->lnL > tree->best_lnL + tree->mod->s_opt->min_diff_lk_move)
+        {
+          *better_found = YES;
+          break;
+        }
+
+      if(move->lnL < tree->best_lnL - 10.)
+        {
+          *better_found = NO;
+          break;
+        }
+    }
+
+  /* Regraft the subtree at its original position */
+  Graft_Subtree(init_target,first->n_link,b_residual,NULL,tree);
+
+  Restore_Br_Len(tree);
+
+  For(j,3) Update_PMat_At_Given_Edge(first->n_link->b[j],tree);
+
+  tree->c_lnL = init_lnL;
+
+  Free(triple);
   Free_Scalar_Dbl(recorded_l);
   Free_Scalar_Dbl(recorded_v);
-  
+
   return best_move;
 }
 
 /*********************************************************/
 
+void Optimize_Spr_Triples(int beg, int end, int thread_id, void *arg)
+{
+  t_spr_triple_job *job;
+  int i;
+
+  job = (t_spr_triple_job *)arg;
+
+  for(i=beg;i<end;i++)
+    if(job->triple[i].move->b_target != NULL)
+      Spr_Triple_Br_Len(job->triple+i,job);
+}
+
+/*********************************************************/
+
+/* Partial likelihoods at the end of an edge of length l, given those
+   at the other end (plk). Same as Update_PMat_At_Given_Edge followed by
+   the product of the transition probability matrices by plk, but
+   using caller-provided scratch space only */
+void Spr_Triple_Transfer(phydbl l, phydbl *plk, phydbl *w, phydbl *Pij, phydbl *expt, phydbl *uexpt, int *skip, t_tree *tree)
+{
+  int site,catg,i,j,ns,n_catg;
+  phydbl len,sum,*P,*v;
+
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+
+  For(catg,n_catg)
+    {
+      len = MAX(0.0,l)*tree->mod->ras->gamma_rr->v[catg];
+      len *= tree->mod->br_len_mult->v;
+      if(len < tree->mod->l_min)      len = tree->mod->l_min;
+      else if(len > tree->mod->l_max) len = tree->mod->l_max;
+      PMat_Empirical_Buff(len,tree->mod,catg*ns*ns,Pij,expt,uexpt);
+    }
+
+  For(site,tree->n_pattern)
+    {
+      if(skip[site] == YES) continue;
+      For(catg,n_catg)
+        {
+          P = Pij + catg*ns*ns;
+          v = plk + (site*n_catg+catg)*ns;
+          For(i,ns)
+            {
+              sum = .0;
+              For(j,ns) sum += P[i*ns+j] * v[j];
+              w[(site*n_catg+catg)*ns+i] = sum;
+            }
+        }
+    }
+}
+
+/*********************************************************/
+
+/* Log-likelihood, and its first and second derivatives, as a function
+   of the length l of one of the three edges around the regraft point.
+   coeff holds, for every site and class of rate, the projections on the
+   eigenvectors of the rate matrix of the partial likelihoods on both
+   sides of that edge (see dLk and Update_Eigen_Lr) */
+phydbl Spr_Triple_dLk(phydbl l, phydbl *coeff, int *scale, int *skip, phydbl *expl, phydbl *dlnL, phydbl *d2lnL, t_tree *tree)
+{
+  int site,catg,m,ns,n_catg,min_scale;
+  phydbl rr,len,log_e_val,fact,lk,dlk,d2lk,lk_c,dlk_c,d2lk_c,log_site_lk,frac,lnL;
+  phydbl *expld,*expld2,*c;
+
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  expld  = expl + n_catg*ns;
+  expld2 = expl + 2*n_catg*ns;
+
+  For(catg,n_catg)
+    {
+      rr  = tree->mod->ras->gamma_rr->v[catg] * tree->mod->br_len_mult->v;
+      len = l * rr;
+      if(len < tree->mod->l_min)      len = tree->mod->l_min;
+      else if(len > tree->mod->l_max) len = tree->mod->l_max;
+
+      For(m,ns)
+        {
+          log_e_val = LOG(tree->mod->eigen->e_val[m]);
+          expl[catg*ns+m]   = (phydbl)POW(tree->mod->eigen->e_val[m],len);
+          expld[catg*ns+m]  = expl[catg*ns+m] * log_e_val * rr;
+          expld2[catg*ns+m] = expld[catg*ns+m] * log_e_val * rr;
+        }
+    }
+
+  lnL = *dlnL = *d2lnL = .0;
+  For(site,tree->n_pattern)
+    {
+      if(skip[site] == YES) continue;
+
+      min_scale = INT_MAX;
+      For(catg,n_catg) min_scale = MIN(min_scale,scale[site*n_catg+catg]);
+
+      lk = dlk = d2lk = .0;
+      For(catg,n_catg)
+        {
+          c = coeff + (site*n_catg+catg)*ns;
+          lk_c = dlk_c = d2lk_c = .0;
+          For(m,ns)
+            {
+              lk_c   += c[m] * expl[catg*ns+m];
+              dlk_c  += c[m] * expld[catg*ns+m];
+              d2lk_c += c[m] * expld2[catg*ns+m];
+            }
+
+          fact  = tree->mod->ras->gamma_r_proba->v[catg];
+          fact  = ldexp(fact,-(scale[site*n_catg+catg]-min_scale));
+          lk   += fact * lk_c;
+          dlk  += fact * dlk_c;
+          d2lk += fact * d2lk_c;
+        }
+
+      /* No correction for SMALL_PIJ here (see dLk) */
+      lk = MAX(lk,SMALL);
+
+      log_site_lk = Spr_Log_Site_Lk(lk,min_scale,site,tree);
+
+      /* Share of the variable sites part of the model in the likelihood */
+      frac = EXP(LOG(lk) - (phydbl)LOG2 * min_scale - log_site_lk);
+      if(tree->mod->ras->invar == YES) frac *= (1.-tree->mod->ras->pinvar->v);
+
+      lnL    += tree->data->wght[site] * log_site_lk;
+      *dlnL  += tree->data->wght[site] * frac * dlk/lk;
+      *d2lnL += tree->data->wght[site] * (frac * d2lk/lk - (frac * dlk/lk) * (frac * dlk/lk));
+    }
+
+  return lnL;
+}
+
+/*********************************************************/
+
+/* Spr_Triple_dLk in the form expected by Generic_Newton_Br_Len */
+phydbl Spr_Triple_Newton_dLk(phydbl *l, phydbl *dl, phydbl *d2l, void *arg, t_tree *tree)
+{
+  t_spr_triple_coeff *c;
+
+  c = (t_spr_triple_coeff *)arg;
+
+  return Spr_Triple_dLk(*l,c->coeff,c->scale,c->skip,c->expl,dl,d2l,tree);
+}
+
+/*********************************************************/
+
+/* Optimise the lengths of the three edges around the regraft point of
+   triple->move, one after the other and in the same order as in
+   Triple_Dist, with the optimiser and number of iterations used there
+   (see Fast_Br_Len and Br_Len_Newton_Raphson). The tree is left untouched: the partial
+   likelihoods around the regraft point are read from it and the
+   calculations are carried out on private copies, so that several
+   threads can call this function at the same time */
+void Spr_Triple_Br_Len(t_spr_triple *triple, t_spr_triple_job *job)
+{
+  t_tree *tree;
+  t_edge *b,*edge[3];
+  t_node *d[3];
+  phydbl *plk,*w,*coeff,*Pij,*expt,*uexpt,*expl,*r,*right,*left,*pi,*U,*V;
+  phydbl l[3],v_t,v_r,new_l,lk_c,site_lk,lnL;
+  t_spr_triple_coeff c;
+  int *scale,*skip;
+  int site,catg,i,j,m,e,k,o,ns,n_catg,n_patt,dim,min_scale;
+
+  tree   = job->tree;
+  b      = triple->move->b_target;
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  n_patt = tree->n_pattern;
+  dim    = n_patt*n_catg*ns;
+  pi     = tree->mod->e_frq->pi->v;
+  U      = tree->mod->eigen->r_e_vect;
+  V      = tree->mod->eigen->l_e_vect;
+
+  /* Edge to the pruned subtree, b_target (whose end with the smallest
+     number stays on it) and b_residual (see Graft_Subtree) */
+  edge[0] = job->b_arrow;
+  edge[1] = b;
+  edge[2] = job->b_residual;
+
+  d[0] = job->n_opp_to_link;
+  d[1] = (b->left->num < b->rght->num)?(b->left):(b->rght);
+  d[2] = (b->left->num < b->rght->num)?(b->rght):(b->left);
+
+  plk   = (phydbl *)mCalloc(3*dim,sizeof(phydbl));
+  w     = (phydbl *)mCalloc(3*dim,sizeof(phydbl));
+  coeff = (phydbl *)mCalloc(dim,sizeof(phydbl));
+  scale = (int *)mCalloc(n_patt*n_catg,sizeof(int));
+  skip  = (int *)mCalloc(n_patt,sizeof(int));
+  Pij   = (phydbl *)mCalloc(n_catg*ns*ns,sizeof(phydbl));
+  expt  = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  uexpt = (phydbl *)mCalloc(ns*ns,sizeof(phydbl));
+  expl  = (phydbl *)mCalloc(3*n_catg*ns,sizeof(phydbl));
+  r     = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  right = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  left  = (phydbl *)mCalloc(ns,sizeof(phydbl));
+
+  c.coeff = coeff;
+  c.scale = scale;
+  c.skip  = skip;
+  c.expl  = expl;
+
+  For(site,n_patt)
+    {
+      skip[site] = (tree->data->wght[site] < SMALL)?(YES):(NO);
+      if(skip[site] == YES) continue;
+
+      For(catg,n_catg)
+        {
+          scale[site*n_catg+catg]  = Spr_Site_P_Lk(job->b_arrow,d[0],site,catg,plk+0*dim+(site*n_catg+catg)*ns,tree);
+          scale[site*n_catg+catg] += Spr_Site_P_Lk(b,d[1],site,catg,plk+1*dim+(site*n_catg+catg)*ns,tree);
+          scale[site*n_catg+catg] += Spr_Site_P_Lk(b,d[2],site,catg,plk+2*dim+(site*n_catg+catg)*ns,tree);
+        }
+    }
+
+  l[0] = MIN(MAX(job->b_arrow->l->v,tree->mod->l_min),tree->mod->l_max);
+  Spr_Target_Br_Len(b,job->b_residual,l+1,&v_t,l+2,&v_r,tree);
+
+  For(e,3) Spr_Triple_Transfer(l[e],plk+e*dim,w+e*dim,Pij,expt,uexpt,skip,tree);
+
+  For(o,3)
+    {
+      k = job->order[o];
+
+      if(edge[k]->l->onoff == OFF) continue;
+
+      /* Projections on the eigenvectors of the partial likelihoods
+         at both ends of edge k */
+      For(site,n_patt)
+        {
+          if(skip[site] == YES) continue;
+          For(catg,n_catg)
+            {
+              i = (site*n_catg+catg)*ns;
+
+              For(j,ns)
+                {
+                  r[j] = pi[j];
+                  For(e,3) if(e != k) r[j] *= w[e*dim+i+j];
+                }
+
+              For(m,ns)
+                {
+                  left[m] = right[m] = .0;
+                  For(j,ns)
+                    {
+                      left[m]  += r[j] * U[j*ns+m];
+                      right[m] += V[m*ns+j] * plk[k*dim+i+j];
+                    }
+                  coeff[i+m] = left[m] * right[m];
+                }
+            }
+        }
+
+      new_l = l[k];
+      Generic_Newton_Br_Len(&new_l,1,tree->mod->s_opt->min_diff_lk_local,Spr_Triple_Newton_dLk,&c,tree);
+
+      if(new_l != l[k])
+        {
+          l[k] = new_l;
+          Spr_Triple_Transfer(l[k],plk+k*dim,w+k*dim,Pij,expt,uexpt,skip,tree);
+        }
+    }
+
+  /* Log-likelihood at the regraft point */
+  lnL = .0;
+  For(site,n_patt)
+    {
+      if(skip[site] == YES) continue;
+
+      min_scale = INT_MAX;
+      For(catg,n_catg) min_scale = MIN(min_scale,scale[site*n_catg+catg]);
+
+      site_lk = .0;
+      For(catg,n_catg)
+        {
+          i = (site*n_catg+catg)*ns;
+          lk_c = .0;
+          For(j,ns) lk_c += pi[j] * w[0*dim+i+j] * w[1*dim+i+j] * w[2*dim+i+j];
+          site_lk += tree->mod->ras->gamma_r_proba->v[catg] * ldexp(lk_c,-(scale[site*n_catg+catg]-min_scale));
+        }
+
+      lnL += tree->data->wght[site] * Spr_Log_Site_Lk(site_lk,min_scale,site,tree);
+    }
+
+  For(e,3) triple->l[e] = l[e];
+  triple->lnL = lnL;
+
+  Free(plk);
+  Free(w);
+  Free(coeff);
+  Free(scale);
+  Free(skip);
+  Free(Pij);
+  Free(expt);
+  Free(uexpt);
+  Free(expl);
+  Free(r);
+  Free(right);
+  Free(left);
+}
+
+/*********************************************************/
+
 int Try_One_Spr_Move_Triple(t_spr *move, t_tree *tree)
 {
   t_edge *init_target, *b_residual;
@@ -4125,7 +5137,9 @@ int Try_One_Spr_Move_Triple(t_spr *move, t_tree *tree)
       Pars(NULL,tree);
       Set_Both_Sides(YES,tree);
       MIXT_Set_Alias_Subpatt(YES,tree);
+      Set_Incr_Lk(YES,tree);
       Lk(NULL,tree);
+      Set_Incr_Lk(NO,tree);
       MIXT_Set_Alias_Subpatt(NO,tree);
 
       if(FABS(tree->c_lnL - move->lnL) > tree->mod->s_opt->min_diff_lk_move)
@@ -4180,7 +5194,9 @@ int Try_One_Spr_Move_Triple(t_spr *move, t_tree *tree)
   
   Set_Both_Sides(YES,tree);
   MIXT_Set_Alias_Subpatt(YES,tree);
+  Set_Incr_Lk(YES,tree);
   Lk(NULL,tree);
+  Set_Incr_Lk(NO,tree);
   MIXT_Set_Alias_Subpatt(NO,tree);
   Pars(NULL,tree);
   return 0;
@@ -4772,7 +5788,7 @@ void Spr_Random_Explore(t_tree *tree, phydbl anneal_temp, phydbl prop_spr, int d
 
 void Spr_List_Of_Trees(t_tree *tree)
 {
-  int i,list_size,max_list_size,*rk,list_size_first_round,list_size_second_round;
+  int i,list_size,max_list_size,*rk,list_size_first_round,list_size_second_round,n_built;
   t_tree **tree_list;
   phydbl *lnL_list,best_lnL;
 
@@ -4809,7 +5825,7 @@ void Spr_List_Of_Trees(t_tree *tree)
   list_size = 1;
   do
     {
-      Stepwise_Add_Pars(tree);  
+      Stepwise_Add_Pars_Starts(tree);  
       Spr_Pars(0,10,tree);
 
       /* printf("\n. 1????????? %d lnL: %f tree: %d",Global_myRank,Lk(NULL,tree),list_size); fflush(NULL); */
@@ -4824,13 +5840,18 @@ void Spr_List_Of_Trees(t_tree *tree)
           best_lnL = tree->c_lnL;
           if(tree->verbose > VL0 && tree->io->quiet == NO) PhyML_Printf("\n. Best tree found so far has lnL: %12.2f (%d more trees to examine)",best_lnL,list_size_first_round-list_size);
           if(tree->io->print_json_trace == YES) JSON_Tree_Io(tree,tree->io->fp_out_json_trace); 
+          Time_Budget_Save(tree,NO);
         }
 
       tree_list[list_size] = Make_Tree_From_Scratch(tree->n_otu,tree->data);
       Copy_Tree(tree,tree_list[list_size]);
       lnL_list[list_size] = tree->c_lnL;
     }
-  while(++list_size < list_size_first_round);
+  while(++list_size < list_size_first_round && Time_Budget_Over(TIME_BUDGET_STARTS,tree->io) == NO);
+
+  /* Fewer starting trees are built when the time budget is short */
+  n_built = list_size;
+  list_size_second_round = MIN(list_size_second_round,n_built-1);
   
   rk = Ranks(lnL_list,max_list_size);
     
@@ -4843,6 +5864,12 @@ void Spr_List_Of_Trees(t_tree *tree)
 
 
   if(tree->verbose > VL0 && tree->io->quiet == NO) PhyML_Printf("\n\n. Improving the best trees (%d trees to process)...",list_size_second_round);
+
+  /* Topologies already examined, from this tree or the previous ones,
+     and found no better than the current one are not examined again
+     (--topo_memo only) */
+  if(tree->mod->s_opt->topo_memo == YES) tree->topo_memo = Make_Topo_Memo(tree);
+
   list_size = 0;
   do
     {
@@ -4867,7 +5894,7 @@ void Spr_List_Of_Trees(t_tree *tree)
           Spr(tree->c_lnL,1.0,tree);
           tree->mod->s_opt->max_depth_path = tree->max_spr_depth;
         }
-      while(tree->n_improvements > 5);
+      while(tree->n_improvements > 5 && Time_Budget_Over(TIME_BUDGET_SPR,tree->io) == NO);
       
       
       Set_Both_Sides(NO,tree);
@@ -4879,12 +5906,16 @@ void Spr_List_Of_Trees(t_tree *tree)
           best_lnL = tree->c_lnL;
           if(tree->verbose > VL0 && tree->io->quiet == NO) PhyML_Printf("\n. Better tree found so far has lnL: %12.2f (%d more trees to examine)",best_lnL,list_size_second_round-list_size);
           if(tree->io->print_json_trace == YES) JSON_Tree_Io(tree,tree->io->fp_out_json_trace); 
+          Time_Budget_Save(tree,NO);
         }
       
       Copy_Tree(tree,tree_list[rk[list_size]]);
       lnL_list[rk[list_size]] = tree->c_lnL;
     }
-  while(++list_size <= list_size_second_round);
+  while(++list_size <= list_size_second_round && Time_Budget_Over(TIME_BUDGET_SPR,tree->io) == NO);
+
+  if(tree->topo_memo != NULL) Free_Topo_Memo(tree->topo_memo);
+  tree->topo_memo = NULL;
   
   Free(rk);
   rk = Ranks(lnL_list,max_list_size);
@@ -4906,12 +5937,13 @@ void Spr_List_Of_Trees(t_tree *tree)
           best_lnL = tree->c_lnL;
           if(tree->verbose > VL0 && tree->io->quiet == NO) PhyML_Printf("\n. Better tree found -> lnL: %12.2f (%d more trees to examine)",best_lnL,list_size_second_round-list_size);
           if(tree->io->print_json_trace == YES) JSON_Tree_Io(tree,tree->io->fp_out_json_trace); 
+          Time_Budget_Save(tree,NO);
         }
 
       Copy_Tree(tree,tree_list[rk[list_size]]);
       lnL_list[rk[list_size]] = tree->c_lnL;
     }
-  while(++list_size <= list_size_second_round);
+  while(++list_size <= list_size_second_round && Time_Budget_Over(TIME_BUDGET_NNI,tree->io) == NO);
 
 
   /* Free(rk); */
@@ -4968,19 +6000,202 @@ void Spr_List_Of_Trees(t_tree *tree)
 
       tree->mod->s_opt->fast_nni = NO;
       Round_Optimize(tree,ROUND_MAX);
+      Time_Budget_Save(tree,NO);
+      if(Time_Budget_Over(TIME_BUDGET_END,tree->io) == YES) break;
       if(!Check_NNI_Five_Branches(tree)) break;
     }
   while(1);
 
   /* printf("\n. 5????????? %d lnL: %f",Global_myRank,Lk(NULL,tree)); fflush(NULL); */
 
-  For(i,list_size_first_round) Free_Tree(tree_list[i]);
+  For(i,n_built) Free_Tree(tree_list[i]);
 
   Free(tree_list);
   Free(lnL_list);
   Free(rk);
 }
 
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* splitmix64 finaliser */
+unsigned long long Topo_Memo_Mix(unsigned long long x)
+{
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Hash of the bipartition one side of which is made of the taxa
+   whose keys xor to 'side'. Both sides give the same value */
+unsigned long long Topo_Memo_Bip(unsigned long long side, t_topo_memo *memo)
+{
+  return Topo_Memo_Mix(MIN(side,side^memo->all));
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Record the side of every edge in the subtree rooted at d (looking
+   away from a) and add their bipartitions to memo->hash. Returns the
+   xor of the keys of the taxa in that subtree */
+unsigned long long Topo_Memo_Sides(t_node *a, t_node *d, t_edge *b, t_topo_memo *memo)
+{
+  unsigned long long h;
+  int i;
+
+  h = 0;
+  if(d->tax) h = memo->tax[d->num];
+  else For(i,3) if(d->v[i] != a) h ^= Topo_Memo_Sides(d,d->v[i],d->b[i],memo);
+
+  memo->side[b->num] = (d == b->rght)?(h):(h^memo->all);
+  memo->hash += Topo_Memo_Bip(h,memo);
+
+  return h;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Hash the current topology before the subtree on the n_opp_to_link
+   side of b_pulled is pruned at n_link */
+void Topo_Memo_Prepare(t_edge *b_pulled, t_node *n_link, t_tree *tree)
+{
+  t_topo_memo *memo;
+  t_node *n_opp_to_link;
+  int i,k;
+
+  memo = tree->topo_memo;
+
+  memo->hash = 0;
+  Topo_Memo_Sides(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree->a_nodes[0]->b[0],memo);
+
+  n_opp_to_link = (n_link == b_pulled->rght)?(b_pulled->left):(b_pulled->rght);
+  memo->pruned  = (n_opp_to_link == b_pulled->rght)?(memo->side[b_pulled->num]):(memo->side[b_pulled->num]^memo->all);
+
+  k = 0;
+  For(i,3)
+    if(n_link->v[i] != n_opp_to_link)
+      {
+        memo->v[k]     = n_link->v[i];
+        memo->v_bip[k] = Topo_Memo_Bip(memo->side[n_link->b[i]->num],memo);
+        k++;
+      }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Hash of the topology obtained by grafting the pruned subtree on the
+   edge between path[depth-1] and path[depth], path[0] being one of
+   the nodes next to the pruning point (see Test_One_Spr_Target_Recur).
+   Only the bipartitions defined by the edges along the path change:
+   the pruned taxa move to the far side of each of them */
+unsigned long long Topo_Memo_Spr_Key(t_node **path, int depth, t_tree *tree)
+{
+  t_topo_memo *memo;
+  t_edge *b;
+  unsigned long long key,far;
+  int i,j;
+
+  memo = tree->topo_memo;
+
+  key = memo->hash;
+
+  if(path[0] == memo->v[0])      key -= memo->v_bip[0];
+  else if(path[0] == memo->v[1]) key -= memo->v_bip[1];
+  else assert(FALSE);
+
+  For(i,depth)
+    {
+      b = NULL;
+      For(j,3) if(path[i]->v[j] == path[i+1]) { b = path[i]->b[j]; break; }
+      assert(b);
+
+      far = (path[i+1] == b->rght)?(memo->side[b->num]):(memo->side[b->num]^memo->all);
+
+      key += Topo_Memo_Bip(far^memo->pruned,memo);
+      if(i < depth-1) key -= Topo_Memo_Bip(far,memo);
+    }
+
+  return (key == 0)?(1):(key);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Was the topology with hash 'key' already examined and found no
+   better than the current one? */
+int Topo_Memo_Skip(unsigned long long key, t_tree *tree)
+{
+  t_topo_memo *memo;
+  int i;
+
+  memo = tree->topo_memo;
+
+  if(Are_Equal(tree->annealing_temp,0.0,1.E-3) == NO) return NO;
+
+  i = (int)(key & (unsigned long long)(memo->size-1));
+  while(memo->key[i] != 0)
+    {
+      if(memo->key[i] == key) return (memo->lnL[i] > tree->best_lnL + tree->mod->s_opt->min_diff_lk_move)?(NO):(YES);
+      i = (i+1) & (memo->size-1);
+    }
+
+  return NO;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Topo_Memo_Insert(unsigned long long key, phydbl lnL, t_topo_memo *memo)
+{
+  unsigned long long *old_key;
+  phydbl *old_lnL;
+  int i,j,old_size;
+
+  if(memo->n_items >= TOPO_MEMO_MAX_ITEMS)
+    {
+      For(i,memo->size) memo->key[i] = 0;
+      memo->n_items = 0;
+    }
+  else if(2*(memo->n_items+1) > memo->size)
+    {
+      old_key  = memo->key;
+      old_lnL  = memo->lnL;
+      old_size = memo->size;
+
+      memo->size *= 2;
+      memo->key   = (unsigned long long *)mCalloc(memo->size,sizeof(unsigned long long));
+      memo->lnL   = (phydbl *)mCalloc(memo->size,sizeof(phydbl));
+
+      For(i,old_size)
+        if(old_key[i] != 0)
+          {
+            j = (int)(old_key[i] & (unsigned long long)(memo->size-1));
+            while(memo->key[j] != 0) j = (j+1) & (memo->size-1);
+            memo->key[j] = old_key[i];
+            memo->lnL[j] = old_lnL[i];
+          }
+
+      Free(old_key);
+      Free(old_lnL);
+    }
+
+  i = (int)(key & (unsigned long long)(memo->size-1));
+  while(memo->key[i] != 0 && memo->key[i] != key) i = (i+1) & (memo->size-1);
+
+  if(memo->key[i] == 0) memo->n_items++;
+  memo->key[i] = key;
+  memo->lnL[i] = lnL;
+}
+
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
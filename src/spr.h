@@ -15,6 +15,11 @@
 #define BEST  2
 #define ONE   3
 
+/*! Initial number of slots in the hash table of topologies (see Make_Topo_Memo) */
+#define TOPO_MEMO_MIN_SIZE  4096
+/*! Largest number of topologies recorded. The table is emptied once it is reached */
+#define TOPO_MEMO_MAX_ITEMS (1<<18)
+
 /*
 ** _move_: Structure for holding the relevant information for candidate SPR moves.
 */
@@ -27,6 +32,54 @@ typedef struct
   int     dist, rgrft_rank, optim_rank, globl_rank;
 } _move_;
 
+/*! Regraft position collected by Collect_Spr_Targets_Recur and scored by Score_Spr_Targets */
+typedef struct __Spr_Target {
+  t_edge      *b_target;
+  t_node          **path; /*! path from the pruning point to b_target */
+  int              depth; /*! depth of that path */
+  phydbl          *Pij_t; /*! transition probabilities along b_target once the subtree is grafted on it */
+  phydbl          *Pij_r; /*! same along the residual edge (may be equal to Pij_t) */
+  phydbl             lnL;
+  unsigned long long key; /*! hash of the topology obtained by grafting on b_target (see Topo_Memo_Spr_Key) */
+  short int     memo_hit; /*! YES if this topology was already examined and found no better than the current one */
+}t_spr_target;
+
+/*! Arguments passed to the threads that score regraft positions */
+typedef struct __Spr_Job {
+  t_tree          *tree;
+  t_spr_target    *cand;
+  t_edge       *b_arrow; /*! edge that leads to the pruned subtree */
+  t_node  *n_opp_to_link; /*! root of the pruned subtree */
+  phydbl          *arrow; /*! pi_i * sum_j P(i->j) * partial likelihood of the pruned subtree in state j, for every site and rate class (see Spr_Arrow_Lk) */
+  int       *arrow_scale; /*! the true values of arrow are arrow * 2^-arrow_scale */
+}t_spr_job;
+
+/*! A move from the list of moves, with the lengths of the three edges
+    around the regraft point once optimised (see Spr_Triple_Br_Len) */
+typedef struct __Spr_Triple {
+  t_spr           *move;
+  phydbl           l[3]; /*! edge to the pruned subtree, b_target and b_residual */
+  phydbl            lnL;
+}t_spr_triple;
+
+/*! Arguments passed to the threads that optimise the lengths of the
+    three edges around regraft points */
+typedef struct __Spr_Triple_Job {
+  t_tree           *tree;
+  t_spr_triple   *triple;
+  t_edge        *b_arrow; /*! edge that leads to the pruned subtree */
+  t_edge     *b_residual; /*! edge freed by the pruning */
+  t_node  *n_opp_to_link; /*! root of the pruned subtree */
+  int           order[3]; /*! order in which the three edges are optimised (as in Triple_Dist) */
+}t_spr_triple_job;
+
+/*! Arguments of Spr_Triple_dLk, passed to Generic_Newton_Br_Len */
+typedef struct __Spr_Triple_Coeff {
+  phydbl        *coeff;
+  int           *scale;
+  int            *skip;
+  phydbl        *expl;
+}t_spr_triple_coeff;
 
 
 void Init_SPR          (t_tree *tree);
@@ -66,6 +119,16 @@ int Test_All_Spr_Targets(t_edge *pulled, t_node *link, t_tree *tree);
 void Randomize_Spr_List(t_tree *tree);
 void Test_One_Spr_Target_Recur(t_node *a, t_node *d, t_edge *pulled, t_node *link, t_edge *residual, t_edge *init_target, int *best_found, t_tree *tree);
 phydbl Test_One_Spr_Target(t_edge *target, t_edge *arrow, t_node *link, t_edge *residual, t_edge *init_target, t_tree *tree);
+int Spr_Par_Lk(t_tree *tree);
+int Spr_Par_Targets(t_tree *tree);
+int Spr_Site_P_Lk(t_edge *b, t_node *d, int site, int catg, phydbl *plk, t_tree *tree);
+phydbl Spr_Log_Site_Lk(phydbl lk, int scale, int site, t_tree *tree);
+void Test_Spr_Targets_Par(t_node *a, t_node *d, t_edge *pulled, t_node *link, t_edge *residual, t_edge *init_target, int *best_found, t_tree *tree);
+void Collect_Spr_Targets_Recur(t_node *a, t_node *d, t_edge *residual, t_spr_target *cand, int *n_cand, t_tree *tree);
+void Score_Spr_Targets(int beg, int end, int thread_id, void *arg);
+void Spr_Arrow_Lk(t_spr_job *job);
+phydbl Spr_Target_Lk(t_spr_target *cand, t_spr_job *job);
+void Include_One_Spr_Target(t_spr_target *cand, t_edge *b_arrow, t_node *n_link, t_edge *b_residual, t_edge *init_target, t_tree *tree);
 void Apply_Spr_Moves_One_By_One(t_tree *tree);
 int Try_One_Spr_Move_Triple(t_spr *move, t_tree *tree);
 int Try_One_Spr_Move_Full(t_spr *move, t_tree *tree);
@@ -74,6 +137,13 @@ void Random_Spr(int n_moves, t_tree *tree);
 void Include_One_Spr_To_List_Of_Spr(t_spr *move, t_tree *tree);
 void Reset_Spr_List(t_tree *tree);
 int Evaluate_List_Of_Regraft_Pos_Triple(t_spr **spr_list, int list_size, t_tree *tree);
+int Spr_Par_Triple(t_spr **spr_list, int list_size, t_tree *tree);
+int Evaluate_List_Of_Regraft_Pos_Triple_Par(t_spr **spr_list, int list_size, int *better_found, t_tree *tree);
+void Optimize_Spr_Triples(int beg, int end, int thread_id, void *arg);
+void Spr_Triple_Br_Len(t_spr_triple *triple, t_spr_triple_job *job);
+void Spr_Triple_Transfer(phydbl l, phydbl *plk, phydbl *w, phydbl *Pij, phydbl *expt, phydbl *uexpt, int *skip, t_tree *tree);
+phydbl Spr_Triple_dLk(phydbl l, phydbl *coeff, int *scale, int *skip, phydbl *expl, phydbl *dlnL, phydbl *d2lnL, t_tree *tree);
+phydbl Spr_Triple_Newton_dLk(phydbl *l, phydbl *dl, phydbl *d2l, void *arg, t_tree *tree);
 void Best_Spr(t_tree *tree);
 int Check_Spr_Move_Validity(t_spr *this_spr_move, t_tree *tree);
 void Spr_Subtree(t_edge *b, t_node *link, t_tree *tree);
@@ -84,6 +154,13 @@ void Sort_Spr_List_LnL(t_tree *tree);
 void Spr_Random_Explore(t_tree *tree, phydbl anneal_temp, phydbl prop_spr, int do_rnd, int max_cycles);
 void Sort_Spr_List_Pars(t_tree *tree);
 void Spr_List_Of_Trees(t_tree *tree);
+unsigned long long Topo_Memo_Mix(unsigned long long x);
+unsigned long long Topo_Memo_Bip(unsigned long long side, t_topo_memo *memo);
+unsigned long long Topo_Memo_Sides(t_node *a, t_node *d, t_edge *b, t_topo_memo *memo);
+void Topo_Memo_Prepare(t_edge *b_pulled, t_node *n_link, t_tree *tree);
+unsigned long long Topo_Memo_Spr_Key(t_node **path, int depth, t_tree *tree);
+int Topo_Memo_Skip(unsigned long long key, t_tree *tree);
+void Topo_Memo_Insert(unsigned long long key, phydbl lnL, t_topo_memo *memo);
 
 
 
@@ -73,11 +73,63 @@ phydbl tt800()
 
 /*********************************************************************/
 
+/* State of the private generator of the calling thread (see
+   Rand_Set_Thread_Seed). NULL when draws are taken from rand() */
+#ifdef HAVE_LIBPTHREAD
+static __thread unsigned int *rand_thread_seed = NULL;
+#else
+static unsigned int *rand_thread_seed = NULL;
+#endif
+
+/* Same as rand(), unless the calling thread was given its own
+   generator with Rand_Set_Thread_Seed, in which case the value is
+   drawn from that generator (a linear congruential one, as in
+   Rand_Int_R) */
+int Rand()
+{
+  if(rand_thread_seed == NULL) return rand();
+
+  *rand_thread_seed = *rand_thread_seed * 1103515245U + 12345U;
+
+  if(RAND_MAX > 0x7fff) return (int)((*rand_thread_seed >> 1) & RAND_MAX);
+  else                  return (int)((*rand_thread_seed >> 16) & RAND_MAX);
+}
+
+/*********************************************************************/
+
+/* From now on, Rand, Uni and Rand_Int draw from the generator whose
+   state is 'seed' in the calling thread, or from rand() again if seed
+   is NULL. Several threads can thus draw random numbers at the same
+   time, each one from a stream that does not depend on the others */
+void Rand_Set_Thread_Seed(unsigned int *seed)
+{
+  rand_thread_seed = seed;
+}
+
+/*********************************************************************/
+
+/* Seed of the stream of random numbers number 'stream' (e.g., a
+   bootstrap replicate or a random starting tree), derived from the seed
+   of the whole analysis only */
+int Rand_Stream_Seed(int r_seed, int stream)
+{
+  unsigned int h;
+
+  h  = (unsigned int)r_seed ^ ((unsigned int)(stream+1) * 2654435761U);
+  h ^= h >> 16;
+  h *= 2246822519U;
+  h ^= h >> 13;
+
+  return (int)(h & 0x7fffffff);
+}
+
+/*********************************************************************/
+
 phydbl Uni()
 {
   phydbl r,mx;
   mx = (phydbl)RAND_MAX;
-  r  = (phydbl)rand();
+  r  = (phydbl)Rand();
   r /= mx;
   /* r = tt800(); */
   return r;
@@ -96,7 +148,7 @@ int Rand_Int(int min, int max)
 
   int u;
   /* if(max < min) Generic_Exit(__FILE__,__LINE__,__FUNCTION__); */
-  u = rand();
+  u = Rand();
   return (u%(max+1-min)+min);
 
 }
@@ -4981,6 +5033,43 @@ int *Permutate(int len)
 
   return(x);
 } 
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+// Same as Rand_Int but draws from a private linear congruential
+// generator whose state is 'seed'. Can be called from several
+// threads, each with its own seed.
+
+int Rand_Int_R(int min, int max, unsigned int *seed)
+{
+  *seed = *seed * 1103515245U + 12345U;
+  return (int)((*seed >> 16) % (unsigned int)(max+1-min)) + min;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+// Same as Permutate, using Rand_Int_R.
+
+int *Permutate_R(int len, unsigned int *seed)
+{
+  int i,pos,tmp;
+  int *x;
+
+  x = (int *)mCalloc(len,sizeof(int));
+
+  For(i,len) x[i] = i;
+
+  For(i,len)
+    {
+      pos = Rand_Int_R(i,len-1,seed);
+      
+      tmp    = x[i];
+      x[i]   = x[pos];
+      x[pos] = tmp;
+    }
+
+  return(x);
+}
  
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
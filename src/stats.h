@@ -29,6 +29,9 @@ void   Recurr_Hessian(t_node *a, t_node *b, int plus_minus, phydbl *inc, phydbl
 phydbl stdnormal_inv(phydbl p);
 phydbl Uni();
 int    Rand_Int(int min, int max);
+int    Rand();
+void   Rand_Set_Thread_Seed(unsigned int *seed);
+int    Rand_Stream_Seed(int r_seed, int stream);
 phydbl Ahrensdietergamma(phydbl alpha);
 phydbl Rgamma(phydbl shape, phydbl scale);
 phydbl Rexp(phydbl lambda);
@@ -102,6 +105,8 @@ phydbl Prob(phydbl *x, int len, phydbl z);
 phydbl Inverse_Truncated_Normal(phydbl y, phydbl mu, phydbl sigma, phydbl lim_inf, phydbl lim_sup);
 phydbl Progressive_EXP(phydbl x);
 int *Permutate(int len);
+int Rand_Int_R(int min, int max, unsigned int *seed);
+int *Permutate_R(int len, unsigned int *seed);
 phydbl Mantel(phydbl *x, phydbl *y, int nrow, int ncol);
 phydbl Weighted_Mean(phydbl *x, phydbl *w, int l);
 int Sum_Bits(int value, int range);
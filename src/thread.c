@@ -0,0 +1,232 @@
+/*
+
+PHYML :  a program that  computes maximum likelihood  phylogenies from
+DNA or AA homologous sequences
+
+Copyright (C) Stephane Guindon. Oct 2003 onward
+
+All parts of  the source except where indicated  are distributed under
+the GNU public licence.  See http://www.opensource.org for details.
+
+*/
+
+/*
+
+Persistent pool of worker threads. A job is a function that processes
+a contiguous range of items (typically site patterns). The range
+[0,n_items) is split into chunks that are handed out to the workers
+(and to the calling thread) on demand. Each item is processed exactly
+once, whatever the number of threads, so jobs that write their results
+in per-item slots and reduce them afterwards in item order are
+deterministic.
+
+*/
+
+#include "thread.h"
+
+static t_thread_pool THREAD_pool = {1,NO,NO,0,0,0,0,0,NULL,NULL};
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+#ifdef HAVE_LIBPTHREAD
+static void THREAD_Process_Chunks(int thread_id)
+{
+  int beg,end;
+
+  while(1)
+    {
+      pthread_mutex_lock(&THREAD_pool.lock);
+      beg = THREAD_pool.next_item;
+      THREAD_pool.next_item += THREAD_pool.chunk;
+      pthread_mutex_unlock(&THREAD_pool.lock);
+
+      if(beg >= THREAD_pool.n_items) break;
+      end = MIN(beg + THREAD_pool.chunk,THREAD_pool.n_items);
+
+      THREAD_pool.job(beg,end,thread_id,THREAD_pool.arg);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+static void *THREAD_Worker(void *arg)
+{
+  int thread_id,generation;
+
+  thread_id  = (int)(size_t)arg;
+  generation = 0;
+
+  pthread_mutex_lock(&THREAD_pool.lock);
+  while(1)
+    {
+      while(THREAD_pool.generation == generation && THREAD_pool.quit == NO)
+        pthread_cond_wait(&THREAD_pool.work_ready,&THREAD_pool.lock);
+
+      if(THREAD_pool.quit == YES) break;
+
+      generation = THREAD_pool.generation;
+      pthread_mutex_unlock(&THREAD_pool.lock);
+
+      THREAD_Process_Chunks(thread_id);
+
+      pthread_mutex_lock(&THREAD_pool.lock);
+      THREAD_pool.n_active--;
+      if(THREAD_pool.n_active == 0) pthread_cond_signal(&THREAD_pool.work_done);
+    }
+  pthread_mutex_unlock(&THREAD_pool.lock);
+
+  return NULL;
+}
+#endif
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Start n_threads-1 workers. The thread that posts a job
+   takes part in its processing */
+
+void THREAD_Init_Pool(int n_threads)
+{
+  if(n_threads < 1)
+    {
+      PhyML_Printf("\n== Number of threads must be at least 1 (value given: %d).",n_threads);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  THREAD_Free_Pool();
+
+#ifdef HAVE_LIBPTHREAD
+  int i;
+
+  THREAD_pool.n_threads  = n_threads;
+  THREAD_pool.busy       = NO;
+  THREAD_pool.quit       = NO;
+  THREAD_pool.generation = 0;
+  THREAD_pool.n_active   = 0;
+
+  if(n_threads == 1) return;
+
+  pthread_mutex_init(&THREAD_pool.lock,NULL);
+  pthread_cond_init(&THREAD_pool.work_ready,NULL);
+  pthread_cond_init(&THREAD_pool.work_done,NULL);
+
+  THREAD_pool.workers = (pthread_t *)mCalloc(n_threads-1,sizeof(pthread_t));
+
+  For(i,n_threads-1)
+    {
+      if(pthread_create(THREAD_pool.workers+i,NULL,THREAD_Worker,(void *)(size_t)(i+1)) != 0)
+        {
+          PhyML_Printf("\n== Could not start thread %d.",i+1);
+          PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+          Exit("\n");
+        }
+    }
+#else
+  if(n_threads > 1)
+    PhyML_Printf("\n. PhyML was compiled without thread support. Running on a single thread.\n");
+  THREAD_pool.n_threads = 1;
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void THREAD_Free_Pool()
+{
+#ifdef HAVE_LIBPTHREAD
+  int i;
+
+  if(THREAD_pool.workers != NULL)
+    {
+      pthread_mutex_lock(&THREAD_pool.lock);
+      THREAD_pool.quit = YES;
+      pthread_cond_broadcast(&THREAD_pool.work_ready);
+      pthread_mutex_unlock(&THREAD_pool.lock);
+
+      For(i,THREAD_pool.n_threads-1) pthread_join(THREAD_pool.workers[i],NULL);
+
+      Free(THREAD_pool.workers);
+      THREAD_pool.workers = NULL;
+
+      pthread_cond_destroy(&THREAD_pool.work_ready);
+      pthread_cond_destroy(&THREAD_pool.work_done);
+      pthread_mutex_destroy(&THREAD_pool.lock);
+    }
+#endif
+  THREAD_pool.n_threads = 1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+int THREAD_N_Threads()
+{
+  return THREAD_pool.n_threads;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Apply job to the items in [0,n_items), chunk by chunk. The job
+   runs on the calling thread only when the pool has a single thread,
+   when there is no more than one chunk to process or when the pool
+   is already busy (i.e., THREAD_Run was called from within a job) */
+
+void THREAD_Run(thread_job job, void *arg, int n_items, int chunk)
+{
+  if(n_items <= 0) return;
+
+  chunk = MAX(1,chunk);
+
+#ifdef HAVE_LIBPTHREAD
+  if(THREAD_pool.n_threads > 1 && n_items > chunk)
+    {
+      pthread_mutex_lock(&THREAD_pool.lock);
+      if(THREAD_pool.busy == NO)
+        {
+          THREAD_pool.busy      = YES;
+          THREAD_pool.job       = job;
+          THREAD_pool.arg       = arg;
+          THREAD_pool.n_items   = n_items;
+          THREAD_pool.chunk     = chunk;
+          THREAD_pool.next_item = 0;
+          THREAD_pool.n_active  = THREAD_pool.n_threads-1;
+          THREAD_pool.generation++;
+          pthread_cond_broadcast(&THREAD_pool.work_ready);
+          pthread_mutex_unlock(&THREAD_pool.lock);
+
+          THREAD_Process_Chunks(0);
+
+          pthread_mutex_lock(&THREAD_pool.lock);
+          while(THREAD_pool.n_active > 0) pthread_cond_wait(&THREAD_pool.work_done,&THREAD_pool.lock);
+          THREAD_pool.busy = NO;
+          pthread_mutex_unlock(&THREAD_pool.lock);
+          return;
+        }
+      pthread_mutex_unlock(&THREAD_pool.lock);
+    }
+#endif
+
+  job(0,n_items,0,arg);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Number of site patterns per chunk, so that the partial likelihoods
+   of one chunk (on each side of an edge) fit in THREAD_CHUNK_BYTES */
+
+int THREAD_Site_Chunk(t_tree *tree)
+{
+  int site_bytes;
+
+  site_bytes = tree->mod->ras->n_catg * tree->mod->ns * sizeof(phyplk);
+
+  return MAX(THREAD_MIN_CHUNK,THREAD_CHUNK_BYTES / MAX(1,site_bytes));
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
@@ -0,0 +1,56 @@
+/*
+
+PHYML :  a program that  computes maximum likelihood  phylogenies from
+DNA or AA homologous sequences
+
+Copyright (C) Stephane Guindon. Oct 2003 onward
+
+All parts of  the source except where indicated  are distributed under
+the GNU public licence.  See http://www.opensource.org for details.
+
+*/
+
+#include <config.h>
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "utilities.h"
+
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+/*! Target size (in bytes) of the partial likelihood block processed by one chunk */
+#define THREAD_CHUNK_BYTES  32768
+/*! Smallest number of site patterns in a chunk */
+#define THREAD_MIN_CHUNK       16
+
+typedef void (*thread_job)(int beg, int end, int thread_id, void *arg);
+
+typedef struct __Thread_Pool {
+  int                    n_threads; /*! number of threads, including the calling one */
+  int                         busy; /*! YES while a job is being processed */
+  int                         quit; /*! YES when workers must terminate */
+  int                   generation; /*! incremented each time a new job is posted */
+  int                     n_active; /*! number of workers still processing the current job */
+  int                    next_item; /*! first item of the next chunk to be processed */
+  int                      n_items; /*! total number of items in the current job */
+  int                        chunk; /*! number of items per chunk */
+  thread_job                   job;
+  void                        *arg;
+#ifdef HAVE_LIBPTHREAD
+  pthread_t               *workers;
+  pthread_mutex_t             lock;
+  pthread_cond_t        work_ready;
+  pthread_cond_t         work_done;
+#endif
+}t_thread_pool;
+
+void THREAD_Init_Pool(int n_threads);
+void THREAD_Free_Pool();
+int THREAD_N_Threads();
+void THREAD_Run(thread_job job, void *arg, int n_items, int chunk);
+int THREAD_Site_Chunk(t_tree *tree);
+
+#endif
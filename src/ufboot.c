@@ -0,0 +1,324 @@
+/*
+
+PHYML :  a program that  computes maximum likelihood  phylogenies from
+DNA or AA homologous sequences
+
+Copyright (C) Stephane Guindon. Oct 2003 onward
+
+All parts of  the source except where indicated  are distributed under
+the GNU public licence.  See http://www.opensource.org for details.
+
+*/
+
+/*
+
+RELL bootstrap collected during the tree search (--ufboot). Bootstrap
+replicates are drawn once, before the search, as counts of site
+patterns. Each time the search has the per-site log-likelihoods of a
+tree at hand (NNI and SPR candidates, trees obtained at the end of a
+round), the log-likelihood of that tree under each replicate is
+obtained by reweighting them (RELL). The tree with the highest RELL
+log-likelihood is recorded for each replicate. Supports are the number
+of replicates whose recorded tree displays the corresponding
+bipartition. No tree search is performed on the replicates
+themselves. Branch lengths are not reoptimised for each replicate
+either, so supports tend to be higher than standard bootstrap ones.
+
+*/
+
+#include "ufboot.h"
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* The replicates are drawn from their own stream of the random number
+   generator, so that the draws taken by the tree search, and hence
+   the tree it returns, are the same with and without --ufboot. Counts
+   are stored as unsigned shorts unless the alignment has more than
+   USHRT_MAX sites (as in Make_Rell_Cnt) */
+t_ufboot *UFBOOT_Make(calign *data, int n_boot, int r_seed)
+{
+  t_ufboot *ufb;
+  int *site_num;
+  int b,i,j,n_site;
+  unsigned int seed;
+
+  ufb = (t_ufboot *)mCalloc(1,sizeof(t_ufboot));
+
+  ufb->data   = data;
+  ufb->n_boot = n_boot;
+  ufb->n_patt = data->crunch_len;
+
+  n_site = 0;
+  For(i,data->crunch_len) n_site += (int)data->wght[i];
+
+  site_num = (int *)mCalloc(n_site,sizeof(int));
+
+  n_site = 0;
+  For(i,data->crunch_len) For(j,(int)data->wght[i]) site_num[n_site++] = i;
+
+  seed = (unsigned int)Rand_Stream_Seed(r_seed,UFBOOT_STREAM);
+  Rand_Set_Thread_Seed(&seed);
+
+  if(n_site <= USHRT_MAX) ufb->cnt     = (unsigned short **)mCalloc(n_boot,sizeof(unsigned short *));
+  else                    ufb->cnt_int = (int **)mCalloc(n_boot,sizeof(int *));
+
+  For(b,n_boot)
+    {
+      if(ufb->cnt != NULL)
+        {
+          ufb->cnt[b] = (unsigned short *)mCalloc(ufb->n_patt,sizeof(unsigned short));
+          For(j,n_site) ufb->cnt[b][site_num[Rand_Int(0,n_site-1)]]++;
+        }
+      else
+        {
+          ufb->cnt_int[b] = (int *)mCalloc(ufb->n_patt,sizeof(int));
+          For(j,n_site) ufb->cnt_int[b][site_num[Rand_Int(0,n_site-1)]]++;
+        }
+    }
+
+  Rand_Set_Thread_Seed(NULL);
+
+  ufb->best_lnL  = (phydbl *)mCalloc(n_boot,sizeof(phydbl));
+  ufb->best_tree = (int *)mCalloc(n_boot,sizeof(int));
+  ufb->trees     = (char **)mCalloc(n_boot,sizeof(char *));
+  ufb->n_ref     = (int *)mCalloc(n_boot,sizeof(int));
+  ufb->site_lnL  = (phydbl *)mCalloc(ufb->n_patt,sizeof(phydbl));
+  ufb->rell      = (phydbl *)mCalloc(n_boot,sizeof(phydbl));
+  ufb->n_trees   = 0;
+  ufb->n_eval    = 0;
+
+  For(b,n_boot)
+    {
+      ufb->best_lnL[b]  = UNLIKELY;
+      ufb->best_tree[b] = -1;
+    }
+
+  Free(site_num);
+
+  return ufb;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void UFBOOT_Free(t_ufboot *ufb)
+{
+  int i;
+
+  For(i,ufb->n_boot)
+    {
+      if(ufb->cnt != NULL) Free(ufb->cnt[i]);
+      else                 Free(ufb->cnt_int[i]);
+    }
+  For(i,ufb->n_trees) if(ufb->trees[i] != NULL) Free(ufb->trees[i]);
+
+  if(ufb->cnt != NULL) Free(ufb->cnt);
+  else                 Free(ufb->cnt_int);
+  Free(ufb->best_lnL);
+  Free(ufb->best_tree);
+  Free(ufb->trees);
+  Free(ufb->n_ref);
+  Free(ufb->site_lnL);
+  Free(ufb->rell);
+  Free(ufb);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Are the trees examined by the search on 'tree' to be recorded?
+   Trees built on other alignments (e.g., standard bootstrap
+   replicates) are not */
+int UFBOOT_Collects(t_tree *tree)
+{
+  if(tree->io == NULL || tree->io->ufboot == NULL) return NO;
+  if(tree->is_mixt_tree == YES)                    return NO;
+  if(tree->data != tree->io->ufboot->data)         return NO;
+  if(tree->n_pattern != tree->io->ufboot->n_patt)  return NO;
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Record the current topology of 'tree' for the replicates under
+   which it is more likely than the trees examined so far. Site
+   log-likelihoods are taken from tree->c_lnL_sorted, i.e., from the
+   last call to Lk on 'tree', or from a new call to Lk on edge b when
+   b is not NULL (branch length optimisation only updates c_lnL). They
+   are ignored if they do not add up to tree->c_lnL. tree->c_lnL is
+   left as it was on entry, so that collecting supports does not
+   interfere with the decisions taken by the search. */
+void UFBOOT_Update(t_edge *b_lk, t_tree *tree)
+{
+  t_ufboot *ufb;
+  phydbl sum,c_lnL;
+  int b,i,slot,old;
+
+  if(UFBOOT_Collects(tree) == NO) return;
+
+  ufb = tree->io->ufboot;
+
+  c_lnL = tree->c_lnL;
+
+  if(b_lk != NULL) Lk(b_lk,tree);
+
+  sum = 0.0;
+  For(i,ufb->n_patt)
+    {
+      if(tree->data->wght[i] > SMALL)
+        {
+          ufb->site_lnL[i] = tree->c_lnL_sorted[i] / tree->data->wght[i];
+          sum += tree->c_lnL_sorted[i];
+        }
+      else ufb->site_lnL[i] = 0.0;
+    }
+
+  if(FABS(sum - tree->c_lnL) > MAX(1.E-3,1.E-6*FABS(tree->c_lnL)))
+    {
+      tree->c_lnL = c_lnL;
+      return;
+    }
+
+  tree->c_lnL = c_lnL;
+
+  ufb->n_eval++;
+
+  THREAD_Run(UFBOOT_Rell_Job,ufb,ufb->n_boot,UFBOOT_CHUNK);
+
+  slot = -1;
+  For(b,ufb->n_boot)
+    {
+      if(ufb->rell[b] > ufb->best_lnL[b])
+        {
+          if(slot < 0)
+            {
+              For(slot,ufb->n_trees) if(ufb->trees[slot] == NULL) break;
+              if(slot == ufb->n_trees) ufb->n_trees++;
+              ufb->trees[slot] = Write_Tree(tree,NO);
+              ufb->n_ref[slot] = 0;
+            }
+
+          old = ufb->best_tree[b];
+          if(old > -1 && --ufb->n_ref[old] == 0)
+            {
+              Free(ufb->trees[old]);
+              ufb->trees[old] = NULL;
+            }
+
+          ufb->best_tree[b] = slot;
+          ufb->best_lnL[b]  = ufb->rell[b];
+          ufb->n_ref[slot]++;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* RELL log-likelihoods of replicates beg to end-1 */
+void UFBOOT_Rell_Job(int beg, int end, int thread_id, void *arg)
+{
+  t_ufboot *ufb;
+  phydbl lnL;
+  int b,i;
+
+  ufb = (t_ufboot *)arg;
+
+  for(b=beg;b<end;b++)
+    {
+      lnL = 0.0;
+      if(ufb->cnt != NULL) For(i,ufb->n_patt) lnL += ufb->cnt[b][i] * ufb->site_lnL[i];
+      else                 For(i,ufb->n_patt) lnL += ufb->cnt_int[b][i] * ufb->site_lnL[i];
+      ufb->rell[b] = lnL;
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Amount of memory taken by the replicates drawn by UFBOOT_Make */
+long int UFBOOT_Cnt_Bytes(calign *data, int n_boot)
+{
+  int i,n_site;
+
+  n_site = 0;
+  For(i,data->crunch_len) n_site += (int)data->wght[i];
+
+  return (long int)n_boot * data->crunch_len * ((n_site <= USHRT_MAX)?(sizeof(unsigned short)):(sizeof(int)));
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Count, for each edge of 'tree', the number of replicates whose best
+   tree displays the same bipartition (bip_score) */
+void UFBOOT_Supports(t_tree *tree)
+{
+  t_ufboot *ufb;
+  t_tree *boot_tree;
+  int b,i;
+
+  ufb = tree->io->ufboot;
+
+  Get_Bip_Bits(tree,NULL,tree->n_otu);
+
+  For(i,ufb->n_trees)
+    {
+      if(ufb->trees[i] == NULL) continue;
+
+      boot_tree = Read_Tree(&(ufb->trees[i]));
+      Match_Tip_Numbers(tree,boot_tree);
+      Get_Bip_Bits(boot_tree,NULL,boot_tree->n_otu);
+      For(b,ufb->n_ref[i]) Compare_Bip(tree,boot_tree,NO);
+      Free_Tree(boot_tree);
+    }
+
+  if(tree->io->print_boot_trees && tree->io->fp_out_boot_tree != NULL)
+    {
+      For(b,ufb->n_boot)
+        if(ufb->best_tree[b] > -1)
+          PhyML_Fprintf(tree->io->fp_out_boot_tree,"%s\n",ufb->trees[ufb->best_tree[b]]);
+      fflush(tree->io->fp_out_boot_tree);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+char *UFBOOT_From_String(char *s_tree, calign *cdata, t_mod *mod, option *io)
+{
+  t_tree *tree;
+
+  tree = Read_Tree(&s_tree);
+
+  if(!tree)
+    {
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s') \n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("");
+    }
+
+  tree->n_root         = NULL;
+  tree->e_root         = NULL;
+  tree->mod            = mod;
+  tree->io             = io;
+  tree->data           = cdata;
+  tree->n_pattern      = tree->data->crunch_len;
+  tree->print_boot_val = YES;
+  tree->print_alrt_val = NO;
+
+  if(!io->quiet) PhyML_Printf("\n\n. Computing RELL bootstrap supports (%ld trees examined)...",io->ufboot->n_eval);
+
+  UFBOOT_Supports(tree);
+
+  Free(s_tree);
+  s_tree = Write_Tree(tree,NO);
+
+  Free_Tree(tree);
+
+  return s_tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
@@ -0,0 +1,36 @@
+/*
+
+PHYML :  a program that  computes maximum likelihood  phylogenies from
+DNA or AA homologous sequences
+
+Copyright (C) Stephane Guindon. Oct 2003 onward
+
+All parts of  the source except where indicated  are distributed under
+the GNU public licence.  See http://www.opensource.org for details.
+
+*/
+
+#include <config.h>
+
+#ifndef UFBOOT_H
+#define UFBOOT_H
+
+#include "utilities.h"
+
+/*! Number of replicates processed by a thread at once when computing RELL log-likelihoods */
+#define UFBOOT_CHUNK  16
+/*! Stream of the random number generator the replicates are drawn from
+    (see Rand_Stream_Seed). Negative, so that it differs from the streams
+    of the random starts and of the standard bootstrap replicates */
+#define UFBOOT_STREAM -1
+
+t_ufboot *UFBOOT_Make(calign *data, int n_boot, int r_seed);
+long int UFBOOT_Cnt_Bytes(calign *data, int n_boot);
+void UFBOOT_Free(t_ufboot *ufb);
+int UFBOOT_Collects(t_tree *tree);
+void UFBOOT_Update(t_edge *b, t_tree *tree);
+void UFBOOT_Rell_Job(int beg, int end, int thread_id, void *arg);
+void UFBOOT_Supports(t_tree *tree);
+char *UFBOOT_From_String(char *s_tree, calign *cdata, t_mod *mod, option *io);
+
+#endif
@@ -1270,6 +1270,11 @@ void Share_Lk_Struct(t_tree *t_full, t_tree *t_empt)
       b_e = t_empt->a_edges[i];
 
       b_e->Pij_rr = b_f->Pij_rr;
+      b_e->Pij_rr_old = b_f->Pij_rr_old;
+      b_e->tip_lk = b_f->tip_lk;
+
+      b_e->update_tip_lk = YES;
+      b_f->update_tip_lk = YES;
 
       b_e->nni = b_f->nni;
     }
@@ -1346,6 +1351,15 @@ void Share_Lk_Struct(t_tree *t_full, t_tree *t_empt)
           Generic_Exit(__FILE__,__LINE__,__FUNCTION__);    
         }
     }
+
+  /* Vectors computed for one tree are overwritten by the other */
+  Set_All_P_Lk_Invalid(t_full);
+  Set_All_P_Lk_Invalid(t_empt);
+
+  /* Vectors taken from the pool are not shared: t_empt gets the pool
+     and recomputes them */
+  t_empt->lowmem = t_full->lowmem;
+  LOWMEM_Attach(t_empt);
 }
 
 //////////////////////////////////////////////////////////////
@@ -1367,6 +1381,7 @@ void Share_Pars_Struct(t_tree *t_full, t_tree *t_empt)
 
   t_empt->site_pars = t_full->site_pars;
   t_empt->step_mat  = t_full->step_mat;
+  t_empt->pars_wght_bits = t_full->pars_wght_bits;
 
   For(i,2*t_full->n_otu-3)
     {
@@ -1378,6 +1393,9 @@ void Share_Pars_Struct(t_tree *t_full, t_tree *t_empt)
 
       t_empt->a_edges[i]->p_pars_l = t_full->a_edges[i]->p_pars_l;
       t_empt->a_edges[i]->p_pars_r = t_full->a_edges[i]->p_pars_r;
+
+      t_empt->a_edges[i]->pars_bits_l = t_full->a_edges[i]->pars_bits_l;
+      t_empt->a_edges[i]->pars_bits_r = t_full->a_edges[i]->pars_bits_r;
     }
 }
 
@@ -1517,6 +1535,8 @@ void NNI(t_tree *tree, t_edge *b_fcus, int do_swap)
       PhyML_Printf("\n== Err. in NNI (1)");
     }
 
+  UFBOOT_Update(b_fcus,tree);
+
   len1 = Duplicate_Scalar_Dbl(b_fcus->l);
   var1 = Duplicate_Scalar_Dbl(b_fcus->l_var);
   Swap(v3,b_fcus->left,b_fcus->rght,v2,tree);
@@ -1556,6 +1576,8 @@ void NNI(t_tree *tree, t_edge *b_fcus, int do_swap)
       PhyML_Printf("\n== Err. in NNI (2)");
    }
 
+  UFBOOT_Update(b_fcus,tree);
+
   len2 = Duplicate_Scalar_Dbl(b_fcus->l);
   var2 = Duplicate_Scalar_Dbl(b_fcus->l_var);
   Swap(v4,b_fcus->left,b_fcus->rght,v2,tree);
@@ -2033,6 +2055,9 @@ void Swap(t_node *a, t_node *b, t_node *c, t_node *d, t_tree *tree)
       tree->n_root->b[2]->rght = tree->e_root->rght;
     }
 
+  Set_P_Lk_Invalid_Around(b,NULL,tree);
+  Set_P_Lk_Invalid_Around(c,NULL,tree);
+
   if(tree->next)
     Swap(a->next,b->next,c->next,d->next,tree->next);
 }
@@ -2869,12 +2894,10 @@ void Bootstrap(t_tree *tree)
 {
   int *site_num, n_site;
   int replicate,j,k;
-  int position,init_len;
   calign *boot_data;
   t_tree *boot_tree;
   t_mod *boot_mod;
-  matrix *boot_mat;
-  char *s;
+  unsigned int seed;
 /*   phydbl rf; */
 
 
@@ -2890,9 +2913,7 @@ void Bootstrap(t_tree *tree)
 
   site_num = (int *)mCalloc(tree->data->init_len,sizeof(int));
 
-  Free_Bip(tree);
-  Alloc_Bip(tree);
-  Get_Bip(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
+  Get_Bip_Bits(tree,NULL,tree->n_otu);
 
   n_site = 0;
   For(j,tree->data->crunch_len) For(k,tree->data->wght[j])
@@ -2901,173 +2922,429 @@ void Bootstrap(t_tree *tree)
       n_site++;
     }
 
-  boot_data = Copy_Cseq(tree->data,tree->io);
-
   PhyML_Printf("\n\n. Non parametric bootstrap analysis \n\n");
   PhyML_Printf("  [");
 
-  For(replicate,tree->mod->bootstrap)
+  tree->io->print_site_lnl   = NO;
+  tree->io->print_trace      = NO;
+  tree->io->print_json_trace = NO;
+
+  if(Bootstrap_Threadable(tree->io) == YES)
+    {
+      Bootstrap_Threaded(tree,site_num);
+      replicate = tree->mod->bootstrap;
+    }
+  else
     {
-      For(j,boot_data->crunch_len) boot_data->wght[j] = 0;
+      boot_data = Copy_Cseq(tree->data,tree->io);
 
-      init_len = 0;
-      For(j,boot_data->init_len)
+      For(replicate,tree->mod->bootstrap)
         {
-          position = Rand_Int(0,(int)(tree->data->init_len-1.0));
-          boot_data->wght[site_num[position]] += 1;
-          init_len++;
+          /* Same stream as in Bootstrap_Threaded */
+          seed = (unsigned int)Rand_Stream_Seed(tree->io->r_seed,replicate);
+          Rand_Set_Thread_Seed(&seed);
+
+          Bootstrap_Resample(tree->data,boot_data,site_num,tree->io);
+
+          boot_mod        = Copy_Model(tree->mod);
+
+          boot_mod->s_opt = tree->mod->s_opt; /* WARNING: re-using the same address here instead of creating a copying
+                                                 requires to leave the value of s_opt unchanged during the boostrap. */
+          boot_mod->io    = tree->io; /* WARNING: re-using the same address here instead of creating a copying
+                                         requires to leave the value of io unchanged during the boostrap. */
+
+          boot_tree = Bootstrap_Make_Tree(tree,tree,boot_data,boot_mod);
+
+          Bootstrap_Search(boot_tree);
+
+          Rand_Set_Thread_Seed(NULL);
+
+          Bootstrap_Record(tree,boot_tree,replicate);
+
+          Free_Tree(boot_tree);
+          Free_Model(boot_mod);
         }
 
-      if(init_len != tree->data->init_len) Exit("\n== Pb. when copying sequences\n");
+      Free_Calign(boot_data);
+    }
 
-      init_len = 0;
-      For(j,boot_data->crunch_len) init_len += boot_data->wght[j];
+  if(((replicate)%tree->io->boot_prog_every)) PhyML_Printf("] %4d/%4d\n ",replicate,tree->mod->bootstrap);
 
-      if(init_len != tree->data->init_len) Exit("\n== Pb. when copying sequences\n");
+  tree->lock_topo = YES; /* Topology should not be modified afterwards */
 
-      if(tree->io->datatype == NT)      Get_Base_Freqs(boot_data);
-      else if(tree->io->datatype == AA) Get_AA_Freqs(boot_data);
+  if(tree->io->print_boot_trees)
+    {
+      fclose(tree->io->fp_out_boot_tree);
+      fclose(tree->io->fp_out_boot_stats);
+    }
+
+  Free(site_num);
+}
 
-      if(tree->io->random_boot_seq_order) Randomize_Sequence_Order(boot_data);
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Draw a new set of site weights, with replacement, from the sites
+// of data listed in site_num. boot_data only receives the patterns
+// drawn at least once, in their original order, so that the
+// likelihood and parsimony kernels never visit a pattern with zero
+// weight. boot_data must have been obtained from Copy_Cseq on data.
+void Bootstrap_Resample(calign *data, calign *boot_data, int *site_num, option *io)
+{
+  int i,j,k,position,init_len,n_patt,state_len;
+  int *patt;
 
-      Set_D_States(boot_data,tree->io->datatype,tree->io->state_len);
+  state_len = io->state_len;
 
-      boot_mod        = Copy_Model(tree->mod);
+  patt = (int *)mCalloc(data->crunch_len,sizeof(int));
 
-      boot_mod->s_opt = tree->mod->s_opt; /* WARNING: re-using the same address here instead of creating a copying
-                                             requires to leave the value of s_opt unchanged during the boostrap. */
-      boot_mod->io    = tree->io; /* WARNING: re-using the same address here instead of creating a copying
-                                     requires to leave the value of io unchanged during the boostrap. */
+  init_len = 0;
+  For(j,boot_data->init_len)
+    {
+      position = Rand_Int(0,(int)(data->init_len-1.0));
+      patt[site_num[position]] += 1;
+      init_len++;
+    }
 
-      Init_Model(boot_data,boot_mod,tree->io);
+  if(init_len != data->init_len) Exit("\n== Pb. when copying sequences\n");
 
-      if(tree->io->mod->use_m4mod) M4_Init_Model(boot_mod->m4mod,boot_data,boot_mod);
+  /* Sequences in boot_data may have been shuffled by
+     Randomize_Sequence_Order for a previous replicate. Put them back
+     in the order of data, so that the order of the sequences of this
+     replicate only depends on the random numbers drawn for it */
+  For(i,data->n_otu)
+    if(strcmp(boot_data->c_seq[i]->name,data->c_seq[i]->name))
+      {
+        for(k=i+1;k<data->n_otu;k++) if(!strcmp(boot_data->c_seq[k]->name,data->c_seq[i]->name)) break;
+        assert(k < data->n_otu);
+        Swap_Cseq_Content(boot_data,i,k);
+      }
 
-      if(tree->io->in_tree == 2)
+  n_patt = 0;
+  For(j,data->crunch_len)
+    {
+      if(patt[j] == 0)
         {
-          rewind(tree->io->fp_in_tree);
-          boot_tree = Read_Tree_File_Phylip(tree->io->fp_in_tree);
+          patt[j] = -1;
+          continue;
         }
-      else
+
+      For(i,data->n_otu)
         {
-          boot_mat = ML_Dist(boot_data,boot_mod);
-          boot_mat->tree = Make_Tree_From_Scratch(boot_data->n_otu,boot_data);
-          Fill_Missing_Dist(boot_mat);
-          Bionj(boot_mat);
-          boot_tree = boot_mat->tree;
-          boot_tree->mat = boot_mat;
+          For(k,state_len) boot_data->c_seq[i]->state[n_patt*state_len+k] = data->c_seq[i]->state[j*state_len+k];
+          boot_data->c_seq[i]->is_ambigu[n_patt] = data->c_seq[i]->is_ambigu[j];
+          boot_data->c_seq[i]->d_state[n_patt]   = data->c_seq[i]->d_state[j];
         }
 
-      boot_tree->mod                  = boot_mod;
-      boot_tree->io                   = tree->io;
-      boot_tree->data                 = boot_data;
-      boot_tree->verbose              = VL0;
-      boot_tree->n_pattern            = boot_tree->data->crunch_len;
-      boot_tree->io->print_site_lnl   = NO;
-      boot_tree->io->print_trace      = NO;
-      boot_tree->io->print_json_trace = NO;
-      boot_tree->n_root               = NULL;
-      boot_tree->e_root               = NULL;
+      boot_data->wght[n_patt]   = (phydbl)patt[j];
+      boot_data->ambigu[n_patt] = data->ambigu[j];
+      boot_data->invar[n_patt]  = data->invar[j];
+
+      patt[j] = n_patt;
+      n_patt++;
+    }
+
+  /* Sites that were not drawn are mapped to no pattern */
+  For(j,data->init_len) boot_data->sitepatt[j] = patt[data->sitepatt[j]];
+
+  boot_data->crunch_len = n_patt;
+  For(i,data->n_otu)
+    {
+      boot_data->c_seq[i]->len = n_patt;
+      boot_data->c_seq[i]->state[n_patt*state_len] = '\0';
+    }
+
+  init_len = 0;
+  For(j,boot_data->crunch_len) init_len += boot_data->wght[j];
+
+  if(init_len != data->init_len) Exit("\n== Pb. when copying sequences\n");
+
+  if(io->datatype == NT)      Get_Base_Freqs(boot_data);
+  else if(io->datatype == AA) Get_AA_Freqs(boot_data);
+
+  if(io->random_boot_seq_order) Randomize_Sequence_Order(boot_data);
+
+  Set_D_States(boot_data,io->datatype,io->state_len);
+
+  Free(patt);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Starting tree of a bootstrap replicate, ready for likelihood
+// calculations. Partial likelihood, parsimony and SPR structures are
+// borrowed from hold, which is either tree itself or a tree
+// dedicated to the thread that analyses the replicate.
+t_tree *Bootstrap_Make_Tree(t_tree *tree, t_tree *hold, calign *boot_data, t_mod *boot_mod)
+{
+  t_tree *boot_tree;
+  matrix *boot_mat;
+
+  Init_Model(boot_data,boot_mod,boot_mod->io);
+
+  if(tree->io->mod->use_m4mod) M4_Init_Model(boot_mod->m4mod,boot_data,boot_mod);
+
+  if(tree->io->in_tree == 2)
+    {
+      rewind(tree->io->fp_in_tree);
+      boot_tree = Read_Tree_File_Phylip(tree->io->fp_in_tree);
+    }
+  else
+    {
+      boot_mat = ML_Dist(boot_data,boot_mod);
+      boot_mat->tree = Make_Tree_From_Scratch(boot_data->n_otu,boot_data);
+      Fill_Missing_Dist(boot_mat);
+      Bionj(boot_mat);
+      boot_tree = boot_mat->tree;
+      boot_tree->mat = boot_mat;
+    }
 
-      Set_Both_Sides(YES,boot_tree);
+  boot_tree->mod       = boot_mod;
+  boot_tree->io        = boot_mod->io;
+  boot_tree->data      = boot_data;
+  boot_tree->verbose   = VL0;
+  boot_tree->n_pattern = boot_tree->data->crunch_len;
+  boot_tree->n_root    = NULL;
+  boot_tree->e_root    = NULL;
 
-      if((boot_tree->mod->s_opt->random_input_tree) && (boot_tree->mod->s_opt->topo_search == SPR_MOVE)) Random_Tree(boot_tree);
+  Set_Both_Sides(YES,boot_tree);
 
-      Connect_CSeqs_To_Nodes(boot_data,tree->io,boot_tree);
-      Check_Br_Lens(boot_tree);
-      Share_Lk_Struct(tree,boot_tree);
-      Share_Spr_Struct(tree,boot_tree);
-      Share_Pars_Struct(tree,boot_tree);
-      Update_Dirs(boot_tree);
+  if((boot_tree->mod->s_opt->random_input_tree) && (boot_tree->mod->s_opt->topo_search == SPR_MOVE)) Random_Tree(boot_tree);
 
-      if(tree->mod->s_opt->greedy) Init_P_Lk_Tips_Double(boot_tree);
-      else                         Init_P_Lk_Tips_Int(boot_tree);
-      Init_Ui_Tips(boot_tree);
-      Init_P_Pars_Tips(boot_tree);
-      Br_Len_Not_Involving_Invar(boot_tree);
+  Connect_CSeqs_To_Nodes(boot_data,boot_tree->io,boot_tree);
+  Check_Br_Lens(boot_tree);
+  Share_Lk_Struct(hold,boot_tree);
+  Share_Spr_Struct(hold,boot_tree);
+  Share_Pars_Struct(hold,boot_tree);
+  Update_Dirs(boot_tree);
 
-      if(boot_tree->io->do_alias_subpatt)
+  if(tree->mod->s_opt->greedy) Init_P_Lk_Tips_Double(boot_tree);
+  else                         Init_P_Lk_Tips_Int(boot_tree);
+  Init_Ui_Tips(boot_tree);
+  Init_P_Pars_Tips(boot_tree);
+  Br_Len_Not_Involving_Invar(boot_tree);
+
+  if(boot_tree->io->do_alias_subpatt)
+    {
+      MIXT_Set_Alias_Subpatt(YES,boot_tree);
+      Lk(NULL,boot_tree);
+      MIXT_Set_Alias_Subpatt(NO,boot_tree);
+    }
+
+  return boot_tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Bootstrap_Search(t_tree *boot_tree)
+{
+  if(boot_tree->mod->s_opt->opt_topo)
+    {
+      if(boot_tree->mod->s_opt->topo_search == NNI_MOVE)
         {
-          MIXT_Set_Alias_Subpatt(YES,boot_tree);
-          Lk(NULL,boot_tree);
-          MIXT_Set_Alias_Subpatt(NO,boot_tree);
+          Simu_Loop(boot_tree);
         }
-      
-      
-      if(boot_tree->mod->s_opt->opt_topo)
+      else if((boot_tree->mod->s_opt->topo_search == SPR_MOVE) ||
+              (boot_tree->mod->s_opt->topo_search == BEST_OF_NNI_AND_SPR))
         {
-          if(boot_tree->mod->s_opt->topo_search == NNI_MOVE)
-            {
-              Simu_Loop(boot_tree);
-            }
-          else if((boot_tree->mod->s_opt->topo_search == SPR_MOVE) ||
-                  (boot_tree->mod->s_opt->topo_search == BEST_OF_NNI_AND_SPR))
-            {
-              Speed_Spr_Loop(boot_tree);
-            }
+          Speed_Spr_Loop(boot_tree);
         }
+    }
+  else
+    {
+      if(boot_tree->mod->s_opt->opt_subst_param || boot_tree->mod->s_opt->opt_bl)
+        Round_Optimize(boot_tree,ROUND_MAX);
       else
-        {
-          if(boot_tree->mod->s_opt->opt_subst_param || boot_tree->mod->s_opt->opt_bl)
-            Round_Optimize(boot_tree,ROUND_MAX);
-          else
-            Lk(NULL,boot_tree);
-        }
+        Lk(NULL,boot_tree);
+    }
+}
 
-      Free_Bip(boot_tree);
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
-      Alloc_Bip(boot_tree);
+// Add the bipartitions of replicate tree boot_tree to the support
+// values of tree, print it and report progress
+void Bootstrap_Record(t_tree *tree, t_tree *boot_tree, int replicate)
+{
+  char *s;
 
-      Match_Tip_Numbers(tree,boot_tree);
+  Match_Tip_Numbers(tree,boot_tree);
 
-      Get_Bip(boot_tree->a_nodes[0],
-              boot_tree->a_nodes[0]->v[0],
-              boot_tree);
+  Get_Bip_Bits(boot_tree,NULL,boot_tree->n_otu);
 
-      Compare_Bip(tree,boot_tree,NO);
+  Compare_Bip(tree,boot_tree,NO);
 
-      Check_Br_Lens(boot_tree);
-      Br_Len_Involving_Invar(boot_tree);
+  Check_Br_Lens(boot_tree);
+  Br_Len_Involving_Invar(boot_tree);
 
-      if(tree->io->print_boot_trees)
-        {
-          s = Write_Tree(boot_tree,NO);
-          PhyML_Fprintf(tree->io->fp_out_boot_tree,"%s\n",s);
-          Free(s);
-          Print_Fp_Out_Lines(tree->io->fp_out_boot_stats,0,0,boot_tree,tree->io,replicate+1);
-        }
+  if(tree->io->print_boot_trees)
+    {
+      s = Write_Tree(boot_tree,NO);
+      PhyML_Fprintf(tree->io->fp_out_boot_tree,"%s\n",s);
+      Free(s);
+      Print_Fp_Out_Lines(tree->io->fp_out_boot_stats,0,0,boot_tree,tree->io,replicate+1);
+    }
 
-      /*       rf = .0; */
-      /*       For(j,2*tree->n_otu-3)  */
-      /* 	rf += tree->a_edges[j]->bip_score; */
+  /*       rf = .0; */
+  /*       For(j,2*tree->n_otu-3)  */
+  /* 	rf += tree->a_edges[j]->bip_score; */
 
 
-      PhyML_Printf(".");
+  PhyML_Printf(".");
 #ifndef QUIET
-      fflush(stdout);
+  fflush(stdout);
 #endif
-      if(!((replicate+1)%tree->io->boot_prog_every))
+  if(!((replicate+1)%tree->io->boot_prog_every))
+    {
+      PhyML_Printf("] %4d/%4d\n  ",replicate+1,tree->mod->bootstrap);
+      if(replicate != tree->mod->bootstrap-1) PhyML_Printf("[");
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Bootstrap replicates can be analysed concurrently when each
+// thread can be given its own likelihood and parsimony structures
+// and the model is fully carried over by Copy_Model.
+int Bootstrap_Threadable(option *io)
+{
+#ifdef BEAGLE
+  return NO;
+#endif
+
+  if(THREAD_N_Threads() < 2)                                       return NO;
+  if(io->max_memory > 0.0 || strlen(io->scratch_dir) > 0)          return NO;
+  if(io->mod->use_m4mod == YES || io->mod->whichmodel == CUSTOMAA) return NO;
+  if(io->do_alias_subpatt == YES)                                  return NO;
+
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Analyse the bootstrap replicates in batches of one replicate per
+// thread. Resampling, starting trees and the update of support
+// values are done in the calling thread, in replicate order, so
+// that only the tree searches run concurrently. Each thread has its
+// own alignment and likelihood, parsimony and SPR structures, which
+// are allocated once and reused by all the replicates it analyses.
+// Each replicate has its own model and optimisation settings, and
+// draws its random numbers (resampling included) from a stream seeded
+// with Rand_Stream_Seed(r_seed,replicate), as in the serial loop of
+// Bootstrap and in the MPI version (see Bootstrap_MPI_Seed), so that
+// supports do not depend on the number of threads.
+void Bootstrap_Threaded(t_tree *tree, int *site_num)
+{
+  t_boot_job job;
+  t_tree *boot_tree;
+  t_tree **a_hold;
+  calign **a_data;
+  t_mod **a_mod;
+  option **a_io;
+  int n_thr,n_batch,first,replicate,i;
+
+  n_thr = THREAD_N_Threads();
+
+  job.trees = (t_tree **)mCalloc(n_thr,sizeof(t_tree *));
+  job.seed  = (unsigned int *)mCalloc(n_thr,sizeof(unsigned int));
+  a_hold    = (t_tree **)mCalloc(n_thr,sizeof(t_tree *));
+  a_data    = (calign **)mCalloc(n_thr,sizeof(calign *));
+  a_mod     = (t_mod **)mCalloc(n_thr,sizeof(t_mod *));
+  a_io      = (option **)mCalloc(n_thr,sizeof(option *));
+
+  For(i,n_thr)
+    {
+      a_data[i] = Copy_Cseq(tree->data,tree->io);
+
+      a_hold[i]            = Make_Tree_From_Scratch(tree->n_otu,a_data[i]);
+      Copy_Tree(tree,a_hold[i]);
+      a_hold[i]->mod       = tree->mod;
+      a_hold[i]->io        = tree->io;
+      a_hold[i]->data      = a_data[i];
+      a_hold[i]->n_pattern = a_data[i]->crunch_len;
+      Prepare_Tree_For_Lk(a_hold[i]);
+    }
+
+  for(first=0;first<tree->mod->bootstrap;first+=n_thr)
+    {
+      n_batch = MIN(n_thr,tree->mod->bootstrap-first);
+
+      For(i,n_batch)
         {
-          PhyML_Printf("] %4d/%4d\n  ",replicate+1,tree->mod->bootstrap);
-          if(replicate != tree->mod->bootstrap-1) PhyML_Printf("[");
+          job.seed[i] = (unsigned int)Rand_Stream_Seed(tree->io->r_seed,first+i);
+          Rand_Set_Thread_Seed(job.seed+i);
+
+          Bootstrap_Resample(tree->data,a_data[i],site_num,tree->io);
+
+          a_mod[i]           = Copy_Model(tree->mod);
+          a_mod[i]->s_opt    = Make_Optimiz();
+          *(a_mod[i]->s_opt) = *(tree->mod->s_opt);
+
+          a_io[i]            = (option *)mCalloc(1,sizeof(option));
+          *(a_io[i])         = *(tree->io);
+          a_io[i]->mod       = a_mod[i];
+          a_io[i]->quiet     = YES;
+          a_mod[i]->io       = a_io[i];
+
+          job.trees[i] = Bootstrap_Make_Tree(tree,a_hold[i],a_data[i],a_mod[i]);
+
+          Rand_Set_Thread_Seed(NULL);
         }
 
-      Free_Tree(boot_tree);
-      Free_Model(boot_mod);
-    }
+      THREAD_Run(Bootstrap_Job,&job,n_batch,1);
 
-  if(((replicate)%tree->io->boot_prog_every)) PhyML_Printf("] %4d/%4d\n ",replicate,tree->mod->bootstrap);
+      For(i,n_batch)
+        {
+          replicate = first+i;
+          boot_tree = job.trees[i];
 
-  tree->lock_topo = YES; /* Topology should not be modified afterwards */
+          Bootstrap_Record(tree,boot_tree,replicate);
 
-  if(tree->io->print_boot_trees)
+          Free_Tree(boot_tree);
+          Free_Optimiz(a_mod[i]->s_opt);
+          Free_Model(a_mod[i]);
+          Free(a_io[i]);
+        }
+    }
+
+  For(i,n_thr)
     {
-      fclose(tree->io->fp_out_boot_tree);
-      fclose(tree->io->fp_out_boot_stats);
+      Free_Spr_List(a_hold[i]);
+      Free_Triplet(a_hold[i]->triplet_struct);
+      Free_Tree_Pars(a_hold[i]);
+      Free_Tree_Lk(a_hold[i]);
+      Free_Tree(a_hold[i]);
+      Free_Calign(a_data[i]);
     }
 
-  Free_Calign(boot_data);
-  Free(site_num);
+  Free(job.trees);
+  Free(job.seed);
+  Free(a_hold);
+  Free(a_data);
+  Free(a_mod);
+  Free(a_io);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Bootstrap_Job(int beg, int end, int thread_id, void *arg)
+{
+  t_boot_job *job;
+  int i;
+
+  job = (t_boot_job *)arg;
+
+  for(i=beg;i<end;i++)
+    {
+      Rand_Set_Thread_Seed(job->seed+i);
+      Bootstrap_Search(job->trees[i]);
+      Rand_Set_Thread_Seed(NULL);
+    }
 }
 
 //////////////////////////////////////////////////////////////
@@ -3507,6 +3784,7 @@ void Record_Model(t_mod *ori, t_mod *cpy)
 
   strcpy(cpy->modelname->s,ori->modelname->s);
   strcpy(cpy->custom_mod_string->s,ori->custom_mod_string->s);
+  strcpy(cpy->aa_rate_mat_file->s,ori->aa_rate_mat_file->s);
 
   cpy->mod_num              = ori->mod_num;
   cpy->whichmodel           = ori->whichmodel;
@@ -3519,6 +3797,8 @@ void Record_Model(t_mod *ori, t_mod *cpy)
   cpy->log_l                = ori->log_l;
   cpy->ras->free_mixt_rates = ori->ras->free_mixt_rates;
   cpy->ras->gamma_median    = ori->ras->gamma_median;
+  cpy->gamma_mgf_bl         = ori->gamma_mgf_bl;
+  cpy->e_frq->user_state_freq = ori->e_frq->user_state_freq;
 
 
   if((ori->whichmodel == CUSTOM) || (ori->whichmodel == GTR))
@@ -3787,18 +4067,20 @@ int Sort_String(const void *a, const void *b)
 
 int Compare_Bip(t_tree *tree1, t_tree *tree2, int on_existing_edges_only)
 {
-  int i,j,k;
+  int i,j,size,*slot;
   t_edge *b1,*b2;
-/*   char **bip1,**bip2; */
-/*   int *bip1,*bip2; */
-  t_node **bip1, **bip2;
-  int bip_size1, bip_size2, bip_size;
-  int different,identical;
+  int n_words,identical;
   int n_edges;
 
-  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
-  /* WARNING: call Match_Tip_Numbers and Get_Bip before using this function. */
-  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+  /* WARNING: call Match_Tip_Numbers and Get_Bip_Bits before using this function. */
+  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+
+  if(tree1->bip_n_words == 0 || tree1->bip_n_words != tree2->bip_n_words)
+    {
+      PhyML_Printf("\n== Bipartitions of both trees must be computed on the same taxa.");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
 
   if(on_existing_edges_only == YES)
     {
@@ -3812,107 +4094,185 @@ int Compare_Bip(t_tree *tree1, t_tree *tree2, int on_existing_edges_only)
       n_edges = tree1->n_otu-3;
     }
 
+  n_words = tree1->bip_n_words;
+
+  /* Open-addressing table of the non-trivial bipartitions of tree2.
+     When two edges define the same bipartition, the first one is kept */
+  size = 1;
+  while(size < 2*(2*tree2->n_otu-3)) size *= 2;
+  slot = (int *)mCalloc(size,sizeof(int));
+  For(i,size) slot[i] = -1;
+
+  For(j,2*tree2->n_otu-3)
+    {
+      b2 = tree2->a_edges[j];
+
+      if(b2->bip_n > 1 && ((on_existing_edges_only == YES && b2->does_exist) || (on_existing_edges_only == NO)))
+        {
+          i = (int)(b2->bip_hash & (size-1));
+          while(slot[i] > -1)
+            {
+              b1 = tree2->a_edges[slot[i]];
+              if(b1->bip_hash == b2->bip_hash && !memcmp(b1->bip_bits,b2->bip_bits,n_words*sizeof(bip_word))) break;
+              i = (i+1) & (size-1);
+            }
+          if(slot[i] < 0) slot[i] = j;
+        }
+    }
 
   identical = 0;
-  different = 0;
   For(i,2*tree1->n_otu-3)
     {
       b1 = tree1->a_edges[i];
-      bip_size1 = MIN(b1->left->bip_size[b1->l_r],b1->rght->bip_size[b1->r_l]);
-      
-      if(bip_size1 > 1 && ((on_existing_edges_only == YES && b1->does_exist) || (on_existing_edges_only == NO)))
+
+      if(b1->bip_n > 1 && ((on_existing_edges_only == YES && b1->does_exist) || (on_existing_edges_only == NO)))
         {
-          For(j,2*tree2->n_otu-3)
+          j = (int)(b1->bip_hash & (size-1));
+          while(slot[j] > -1)
             {
-              b2 = tree2->a_edges[j];
-              bip_size2 = MIN(b2->left->bip_size[b2->l_r],b2->rght->bip_size[b2->r_l]);
-              
-              if(bip_size2 > 1 && ((on_existing_edges_only == YES && b2->does_exist) || (on_existing_edges_only == NO)))
+              b2 = tree2->a_edges[slot[j]];
+              if(b1->bip_hash == b2->bip_hash && !memcmp(b1->bip_bits,b2->bip_bits,n_words*sizeof(bip_word)))
                 {
-                  if(bip_size1 == bip_size2)
-                    {
-                      bip_size = bip_size1;
-                      
-                      if(b1->left->bip_size[b1->l_r] == b1->rght->bip_size[b1->r_l])
-                        {
-                          /* 			  if(b1->left->bip_name[b1->l_r][0][0] < b1->rght->bip_name[b1->r_l][0][0]) */
-                          if(b1->left->bip_node[b1->l_r][0]->num < b1->rght->bip_node[b1->r_l][0]->num)
-                            {
-                              /* 			      bip1 = b1->left->bip_name[b1->l_r]; */
-                              bip1 = b1->left->bip_node[b1->l_r];
-                            }
-                          else
-                            {
-                              /* 			      bip1 = b1->rght->bip_name[b1->r_l]; */
-                              bip1 = b1->rght->bip_node[b1->r_l];
-                            }
-                        }
-                      else if(b1->left->bip_size[b1->l_r] < b1->rght->bip_size[b1->r_l])
-                        {
-                          /* 			  bip1 = b1->left->bip_name[b1->l_r]; */
-                          bip1 = b1->left->bip_node[b1->l_r];
-                        }
-                      else
-                        {
-                          /* 			  bip1 = b1->rght->bip_name[b1->r_l]; */
-                          bip1 = b1->rght->bip_node[b1->r_l];
-                        }
-                      
-                      
-                      if(b2->left->bip_size[b2->l_r] == b2->rght->bip_size[b2->r_l])
-                        {
-                          /* 			  if(b2->left->bip_name[b2->l_r][0][0] < b2->rght->bip_name[b2->r_l][0][0]) */
-                          if(b2->left->bip_node[b2->l_r][0]->num < b2->rght->bip_node[b2->r_l][0]->num)
-                            {
-                              /* 			      bip2 = b2->left->bip_name[b2->l_r]; */
-                              bip2 = b2->left->bip_node[b2->l_r];
-                            }
-                          else
-                            {
-                              /* 			      bip2 = b2->rght->bip_name[b2->r_l]; */
-                              bip2 = b2->rght->bip_node[b2->r_l];
-                            }
-                        }
-                      else if(b2->left->bip_size[b2->l_r] < b2->rght->bip_size[b2->r_l])
-                        {
-                          /* 			  bip2 = b2->left->bip_name[b2->l_r]; */
-                          bip2 = b2->left->bip_node[b2->l_r];
-                        }
-                      else
-                        {
-                          /* 			  bip2 = b2->rght->bip_name[b2->r_l]; */
-                          bip2 = b2->rght->bip_node[b2->r_l];
-                        }
-                      
-                      if(bip_size == 1) Warn_And_Exit("\n. Problem in Compare_Bip\n");
-                      
-                      For(k,bip_size)
-                        {
-                          /* 			  if(strcmp(bip1[k],bip2[k])) break; */
-                          if(bip1[k]->num != bip2[k]->num) break;
-                        }
-                      
-                      if(k == bip_size) /* Branches b1 and b2 define the same bipartition */
-                        {
-                          b1->bip_score++;
-                          b2->bip_score++;
-                          identical++;
-                          goto out;
-                        }
-                      else
-                        {
-                          different++; // Bipartitions have identical sizes but distinct elements
-                        }
-                    }
-                  else different++; // Biparition have different sizes
+                  /* Branches b1 and b2 define the same bipartition */
+                  b1->bip_score++;
+                  b2->bip_score++;
+                  identical++;
+                  break;
                 }
+              j = (j+1) & (size-1);
             }
         }
-    out: ;
     }
 
+  Free(slot);
+
   return n_edges - identical;
-  /* return different; */
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Bipartitions as packed bitsets. For every edge b, bit tip_bit[d->num]
+   of b->bip_bits is set when tip d lies on the side of b that does not
+   hold the tip with the smallest bit index. Tips with a negative
+   tip_bit are left out. With tip_bit == NULL, the bit of a tip is its
+   number (see Match_Tip_Numbers) and tips with common == 0 are left out.
+   Unlike Get_Bip, the cost is linear in the number of edges times
+   n_bits/BIP_WORD_BITS */
+void Get_Bip_Bits(t_tree *tree, int *tip_bit, int n_bits)
+{
+  int i,w,n_words,first,n_tips,n_side;
+  bip_word *all;
+  t_node *r;
+  t_edge *b;
+
+  n_words = BIP_N_WORDS(n_bits);
+
+  if(tree->bip_n_words != n_words)
+    {
+      Free_Bip_Bits(tree);
+      For(i,2*tree->n_otu-3) tree->a_edges[i]->bip_bits = (bip_word *)mCalloc(n_words,sizeof(bip_word));
+      tree->bip_n_words = n_words;
+    }
+
+  r = tree->a_nodes[0];
+  Get_Bip_Bits_Post(r,r->v[0],r->b[0],tip_bit,tree);
+
+  /* Taxa of the whole tree */
+  all = (bip_word *)mCalloc(n_words,sizeof(bip_word));
+  For(w,n_words) all[w] = r->b[0]->bip_bits[w];
+  i = (tip_bit != NULL)?(tip_bit[r->num]):((r->common)?(r->num):(-1));
+  if(i > -1) all[i/BIP_WORD_BITS] |= (bip_word)1 << (i%BIP_WORD_BITS);
+
+  first  = -1;
+  n_tips = 0;
+  For(w,n_words)
+    {
+      if(first < 0 && all[w]) first = w*BIP_WORD_BITS + __builtin_ctzll(all[w]);
+      n_tips += Pars_Popcount(all[w]);
+    }
+
+  For(i,2*tree->n_otu-3)
+    {
+      b = tree->a_edges[i];
+
+      if(first > -1 && (b->bip_bits[first/BIP_WORD_BITS] >> (first%BIP_WORD_BITS)) & 1)
+        For(w,n_words) b->bip_bits[w] = all[w] & ~b->bip_bits[w];
+
+      n_side      = 0;
+      b->bip_hash = 0;
+      For(w,n_words)
+        {
+          n_side += Pars_Popcount(b->bip_bits[w]);
+          b->bip_hash = Topo_Memo_Mix(b->bip_hash ^ b->bip_bits[w]);
+        }
+      b->bip_n = MIN(n_side,n_tips-n_side);
+    }
+
+  Free(all);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Set b->bip_bits to the taxa in the subtree rooted at d (looking away from a) */
+bip_word *Get_Bip_Bits_Post(t_node *a, t_node *d, t_edge *b, int *tip_bit, t_tree *tree)
+{
+  int i,w,k;
+  bip_word *sub;
+
+  For(w,tree->bip_n_words) b->bip_bits[w] = 0;
+
+  if(d->tax)
+    {
+      k = (tip_bit != NULL)?(tip_bit[d->num]):((d->common)?(d->num):(-1));
+      if(k > -1) b->bip_bits[k/BIP_WORD_BITS] |= (bip_word)1 << (k%BIP_WORD_BITS);
+    }
+  else
+    {
+      For(i,3)
+        if(d->v[i] != a)
+          {
+            sub = Get_Bip_Bits_Post(d,d->v[i],d->b[i],tip_bit,tree);
+            For(w,tree->bip_n_words) b->bip_bits[w] |= sub[w];
+          }
+    }
+
+  return b->bip_bits;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+int Sort_Node_Name(const void *a, const void *b)
+{
+  return(strcmp((*(t_node * const *)(a))->name, (*(t_node * const *)(b))->name));
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* For every tip d of tree2, map[d->num] is the number of the tip of
+   tree1 with the same name, or -1 if there is none */
+int *Get_Tip_Map(t_tree *tree1, t_tree *tree2)
+{
+  t_node **sorted,**hit;
+  int *map,i;
+
+  sorted = (t_node **)mCalloc(tree1->n_otu,sizeof(t_node *));
+  For(i,tree1->n_otu) sorted[i] = tree1->a_nodes[i];
+  qsort(sorted,tree1->n_otu,sizeof(t_node *),Sort_Node_Name);
+
+  map = (int *)mCalloc(tree2->n_otu,sizeof(int));
+  For(i,tree2->n_otu)
+    {
+      hit = (t_node **)bsearch(&(tree2->a_nodes[i]),sorted,tree1->n_otu,sizeof(t_node *),Sort_Node_Name);
+      map[tree2->a_nodes[i]->num] = (hit != NULL)?((*hit)->num):(-1);
+    }
+
+  Free(sorted);
+
+  return map;
 }
 
 //////////////////////////////////////////////////////////////
@@ -3923,7 +4283,7 @@ int Compare_Bip(t_tree *tree1, t_tree *tree2, int on_existing_edges_only)
    also have the same tip numbering */
 void Match_Tip_Numbers(t_tree *tree1, t_tree *tree2)
 {
-  int i,j;
+  int i,*map;
 
   if(tree1->n_otu != tree2->n_otu)
     {
@@ -3934,18 +4294,13 @@ void Match_Tip_Numbers(t_tree *tree1, t_tree *tree2)
       Generic_Exit(__FILE__,__LINE__,__FUNCTION__);    
     }
 
-  For(i,tree1->n_otu)
-    {
-      For(j,tree2->n_otu)
-    {
-      if(!strcmp(tree1->a_nodes[i]->name,tree2->a_nodes[j]->name))
-        {
-          tree2->a_nodes[j]->num = tree1->a_nodes[i]->num;
-          break;
-        }
-    }
-    }
+  map = Get_Tip_Map(tree1,tree2);
+
+  For(i,tree2->n_otu)
+    if(map[tree2->a_nodes[i]->num] > -1)
+      tree2->a_nodes[i]->num = map[tree2->a_nodes[i]->num];
 
+  Free(map);
 }
 
 //////////////////////////////////////////////////////////////
@@ -4680,6 +5035,8 @@ void Copy_Tree(t_tree *ori, t_tree *cpy)
   cpy->t_beg                     = ori->t_beg;
   cpy->verbose                   = ori->verbose;
 
+  Set_All_P_Lk_Invalid(cpy);
+
 
 #ifdef BEAGLE
   cpy->b_inst = ori->b_inst;
@@ -4696,10 +5053,11 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
   t_node *v1, *v2, *buff_nd;
   t_edge *b1, *b2;
   int dir_v1, dir_v2;
-  int i;
-  phydbl *buff_p_lk;
+  int i,valid_v2;
+  phyplk *buff_p_lk;
   int *buff_scale;
   int *buff_p_pars, *buff_pars, *buff_p_lk_loc, *buff_patt_id;
+  pars_word *buff_pars_bits;
   unsigned int *buff_ui;
   short int *buff_p_lk_tip;
 
@@ -4752,6 +5110,9 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
   if(target)   (*target)   = b1;
   if(residual) (*residual) = b2;
 
+  /* Partial likelihoods of the subtree rooted at v2 move from b2 to b1 */
+  valid_v2 = P_Lk_Is_Valid(b2,v2);
+
 
   a->v[dir_v1] = NULL;
   a->v[dir_v2] = NULL;
@@ -4802,6 +5163,10 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
               buff_p_pars          = b1->p_pars_r;
               b1->p_pars_r         = b2->p_pars_l;
               b2->p_pars_l         = buff_p_pars;
+
+              buff_pars_bits       = b1->pars_bits_r;
+              b1->pars_bits_r      = b2->pars_bits_l;
+              b2->pars_bits_l      = buff_pars_bits;
               
               buff_p_lk_loc        = b1->p_lk_loc_rght;
               b1->p_lk_loc_rght    = b2->p_lk_loc_left;
@@ -4845,6 +5210,10 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
               buff_p_pars          = b1->p_pars_r;
               b1->p_pars_r         = b2->p_pars_r;
               b2->p_pars_r         = buff_p_pars;
+
+              buff_pars_bits       = b1->pars_bits_r;
+              b1->pars_bits_r      = b2->pars_bits_r;
+              b2->pars_bits_r      = buff_pars_bits;
               
               buff_p_lk_loc        = b1->p_lk_loc_rght;
               b1->p_lk_loc_rght    = b2->p_lk_loc_rght;
@@ -4895,6 +5264,10 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
               buff_p_pars          = b1->p_pars_l;
               b1->p_pars_l         = b2->p_pars_l;
               b2->p_pars_l         = buff_p_pars;
+
+              buff_pars_bits       = b1->pars_bits_l;
+              b1->pars_bits_l      = b2->pars_bits_l;
+              b2->pars_bits_l      = buff_pars_bits;
               
               buff_p_lk_loc        = b1->p_lk_loc_left;
               b1->p_lk_loc_left    = b2->p_lk_loc_left;
@@ -4942,6 +5315,10 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
               buff_p_pars          = b1->p_pars_l;
               b1->p_pars_l         = b2->p_pars_r;
               b2->p_pars_r         = buff_p_pars;
+
+              buff_pars_bits       = b1->pars_bits_l;
+              b1->pars_bits_l      = b2->pars_bits_r;
+              b2->pars_bits_r      = buff_pars_bits;
               
               buff_p_lk_loc        = b1->p_lk_loc_left;
               b1->p_lk_loc_left    = b2->p_lk_loc_rght;
@@ -4996,6 +5373,14 @@ void Prune_Subtree(t_node *a, t_node *d, t_edge **target, t_edge **residual, t_t
     (Set_Edge_Dirs(b1,v1,v2,tree)):
     (Set_Edge_Dirs(b1,v2,v1,tree));
 
+  if(v2 == b1->left) b1->valid_left = valid_v2;
+  else               b1->valid_rght = valid_v2;
+  b2->valid_left = b2->valid_rght = NO;
+
+  Set_P_Lk_Invalid_Around(v1,b1,tree);
+  Set_P_Lk_Invalid_Around(v2,b1,tree);
+  Set_P_Lk_Invalid_Around(a,NULL,tree);
+
 
   if(tree->n_root != NULL)
     {
@@ -5065,12 +5450,14 @@ void Graft_Subtree(t_edge *target, t_node *link, t_edge *residual, t_node *targe
 {
   t_node *v1, *v2;
   int i, dir_v1, dir_v2;
-  phydbl *buff_p_lk;
+  phyplk *buff_p_lk;
   int *buff_scale;
   int *buff_p_pars, *buff_pars, *buff_p_lk_loc, *buff_patt_id;
+  pars_word *buff_pars_bits;
   short int *buff_p_lk_tip;
   unsigned int *buff_ui;
   t_edge *b_up;
+  int valid_v2;
 
   assert(link);
   assert(tree);
@@ -5115,6 +5502,7 @@ void Graft_Subtree(t_edge *target, t_node *link, t_edge *residual, t_node *targe
     {
       v1 = target->left;
       v2 = target->rght;
+      valid_v2 = P_Lk_Is_Valid(target,v2);
 
       if(tree->is_mixt_tree == NO)
         {
@@ -5155,6 +5543,10 @@ void Graft_Subtree(t_edge *target, t_node *link, t_edge *residual, t_node *targe
           buff_p_pars                  = residual->p_pars_r;
           residual->p_pars_r           = target->p_pars_r;
           target->p_pars_r             = buff_p_pars;
+
+          buff_pars_bits               = residual->pars_bits_r;
+          residual->pars_bits_r        = target->pars_bits_r;
+          target->pars_bits_r          = buff_pars_bits;
           
           buff_p_lk_loc                = residual->p_lk_loc_rght;
           residual->p_lk_loc_rght      = target->p_lk_loc_rght;
@@ -5169,6 +5561,7 @@ void Graft_Subtree(t_edge *target, t_node *link, t_edge *residual, t_node *targe
     {
       v1 = target->rght;
       v2 = target->left;
+      valid_v2 = P_Lk_Is_Valid(target,v2);
 
       if(tree->is_mixt_tree == NO)
         {
@@ -5205,6 +5598,10 @@ void Graft_Subtree(t_edge *target, t_node *link, t_edge *residual, t_node *targe
           buff_p_pars                  = residual->p_pars_r;
           residual->p_pars_r           = target->p_pars_l;
           target->p_pars_l             = buff_p_pars;
+
+          buff_pars_bits               = residual->pars_bits_r;
+          residual->pars_bits_r        = target->pars_bits_l;
+          target->pars_bits_l          = buff_pars_bits;
           
           buff_p_lk_loc                = residual->p_lk_loc_rght;
           residual->p_lk_loc_rght      = target->p_lk_loc_left;
@@ -5262,6 +5659,12 @@ void Graft_Subtree(t_edge *target, t_node *link, t_edge *residual, t_node *targe
   Set_Edge_Dirs(residual,residual->left,residual->rght,tree);
   Set_Edge_Dirs(b_up,b_up->left,b_up->rght,tree);
 
+  /* Partial likelihoods of the subtree rooted at v2 moved from target
+     to residual */
+  residual->valid_rght = valid_v2;
+  residual->valid_left = NO;
+  Set_P_Lk_Invalid_Around(link,NULL,tree);
+
   /* printf("\n here %p target: %d [%p] eroot: %d [%p] target_nd: %d [%p] root: %d [%p]", */
   /*        tree, */
   /*        target?target->num:-1,target, */
@@ -6318,6 +6721,8 @@ void Reorganize_Edges_Given_Lk_Struct(t_tree *tree)
             }
         }
     }
+
+  Set_All_P_Lk_Invalid(tree);
 }
 
 //////////////////////////////////////////////////////////////
@@ -6325,9 +6730,10 @@ void Reorganize_Edges_Given_Lk_Struct(t_tree *tree)
 
 void Swap_Partial_Lk(t_edge *a, t_edge *b, int side_a, int side_b, t_tree *tree)
 {
-  phydbl *buff_p_lk;
+  phyplk *buff_p_lk;
   int *buff_scale;
   int *buff_p_pars, *buff_pars, *buff_p_lk_loc, *buff_patt_id;
+  pars_word *buff_pars_bits;
   short int *buff_p_lk_tip;
   unsigned int *buff_ui;
   
@@ -6365,6 +6771,10 @@ void Swap_Partial_Lk(t_edge *a, t_edge *b, int side_a, int side_b, t_tree *tree)
       buff_p_pars = b->p_pars_l;
       b->p_pars_l = a->p_pars_l;
       a->p_pars_l = buff_p_pars;
+
+      buff_pars_bits = b->pars_bits_l;
+      b->pars_bits_l = a->pars_bits_l;
+      a->pars_bits_l = buff_pars_bits;
       
       buff_ui = b->ui_l;
       b->ui_l = a->ui_l;
@@ -6414,6 +6824,10 @@ void Swap_Partial_Lk(t_edge *a, t_edge *b, int side_a, int side_b, t_tree *tree)
       buff_p_pars = b->p_pars_r;
       b->p_pars_r = a->p_pars_l;
       a->p_pars_l = buff_p_pars;
+
+      buff_pars_bits = b->pars_bits_r;
+      b->pars_bits_r = a->pars_bits_l;
+      a->pars_bits_l = buff_pars_bits;
       
       buff_ui = b->ui_r;
       b->ui_r = a->ui_l;
@@ -6463,6 +6877,10 @@ void Swap_Partial_Lk(t_edge *a, t_edge *b, int side_a, int side_b, t_tree *tree)
       buff_p_pars = b->p_pars_l;
       b->p_pars_l = a->p_pars_r;
       a->p_pars_r = buff_p_pars;
+
+      buff_pars_bits = b->pars_bits_l;
+      b->pars_bits_l = a->pars_bits_r;
+      a->pars_bits_r = buff_pars_bits;
       
       buff_ui = b->ui_l;
       b->ui_l = a->ui_r;
@@ -6512,6 +6930,10 @@ void Swap_Partial_Lk(t_edge *a, t_edge *b, int side_a, int side_b, t_tree *tree)
       buff_p_pars = b->p_pars_r;
       b->p_pars_r = a->p_pars_r;
       a->p_pars_r = buff_p_pars;
+
+      buff_pars_bits = b->pars_bits_r;
+      b->pars_bits_r = a->pars_bits_r;
+      a->pars_bits_r = buff_pars_bits;
       
       buff_ui = b->ui_r;
       b->ui_r = a->ui_r;
@@ -6688,7 +7110,7 @@ void Check_Memory_Amount(t_tree *tree)
 {
   /* Rough estimate of the amount of memory that has to be used */
 
-  long int nbytes;
+  long int nbytes,plk_bytes;
   int n_otu;
   t_mod *mod;
 
@@ -6705,12 +7127,24 @@ void Check_Memory_Amount(t_tree *tree)
   nbytes += (2*n_otu-3) * mod->ras->n_catg * mod->ns * mod->ns * sizeof(phydbl);
 
 
-  /* Partial Lk */
-  nbytes += ((2*n_otu-3) * 2 - tree->n_otu) * tree->data->crunch_len * mod->ras->n_catg * mod->ns * sizeof(phydbl);
+  /* Partial Lk (bounded by --max_memory) */
+  plk_bytes = ((2*n_otu-3) * 2 - tree->n_otu) * tree->data->crunch_len * mod->ras->n_catg * mod->ns * sizeof(phyplk);
+  if(tree->io->max_memory > 0.0) plk_bytes = MIN(plk_bytes,(long int)(tree->io->max_memory*1024.*1024.));
+  if(strlen(tree->io->scratch_dir) > 0) plk_bytes = 0; /* In the scratch file */
+  nbytes += plk_bytes;
 
 
   /* Scaling factors */
-  nbytes += ((2*n_otu-3) * 2 - tree->n_otu) * tree->data->crunch_len * sizeof(int);
+  if(strlen(tree->io->scratch_dir) == 0)
+    nbytes += ((2*n_otu-3) * 2 - tree->n_otu) * tree->data->crunch_len * sizeof(int);
+
+  /* RELL replicates of the SH-like supports */
+  if(tree->io->ratio_test == SH || tree->io->ratio_test == MINALRTCHI2SH)
+    nbytes += Rell_Cnt_Bytes(tree);
+
+  /* RELL replicates of --ufboot */
+  if(tree->io->n_ufboot > 0)
+    nbytes += UFBOOT_Cnt_Bytes(tree->data,tree->io->n_ufboot);
 
 
 
@@ -6886,29 +7320,40 @@ void Randomize_Sequence_Order(calign *cdata)
 {
   int i,exchange_with;
   phydbl buff_dbl;
-  char *buff_name,*buff_state;
-  short int *buff_ambigu;
 
   exchange_with = -1;
   For(i,cdata->n_otu)
     {
-      buff_dbl  = rand();
+      buff_dbl  = Rand();
       buff_dbl /= (RAND_MAX+1.);
       buff_dbl *= cdata->n_otu;
       exchange_with = (int)FLOOR(buff_dbl);
 
-      buff_name                         = cdata->c_seq[i]->name;
-      cdata->c_seq[i]->name             = cdata->c_seq[exchange_with]->name;
-      cdata->c_seq[exchange_with]->name = buff_name;
+      Swap_Cseq_Content(cdata,i,exchange_with);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Exchange the names and sequences of the i-th and j-th sequences
+// of cdata
+void Swap_Cseq_Content(calign *cdata, int i, int j)
+{
+  char *buff_name,*buff_state;
+  short int *buff_ambigu;
 
-      buff_state                         = cdata->c_seq[i]->state;
-      cdata->c_seq[i]->state             = cdata->c_seq[exchange_with]->state;
-      cdata->c_seq[exchange_with]->state = buff_state;
+  buff_name             = cdata->c_seq[i]->name;
+  cdata->c_seq[i]->name = cdata->c_seq[j]->name;
+  cdata->c_seq[j]->name = buff_name;
 
-      buff_ambigu                            = cdata->c_seq[i]->is_ambigu;
-      cdata->c_seq[i]->is_ambigu             = cdata->c_seq[exchange_with]->is_ambigu;
-      cdata->c_seq[exchange_with]->is_ambigu = buff_ambigu;
-    }
+  buff_state             = cdata->c_seq[i]->state;
+  cdata->c_seq[i]->state = cdata->c_seq[j]->state;
+  cdata->c_seq[j]->state = buff_state;
+
+  buff_ambigu                = cdata->c_seq[i]->is_ambigu;
+  cdata->c_seq[i]->is_ambigu = cdata->c_seq[j]->is_ambigu;
+  cdata->c_seq[j]->is_ambigu = buff_ambigu;
 }
 
 //////////////////////////////////////////////////////////////
@@ -7048,6 +7493,9 @@ void Add_Root(t_edge *target, t_tree *tree)
       
       b1->p_pars_r = tree->e_root->p_pars_l;
       b2->p_pars_r = tree->e_root->p_pars_r;
+
+      b1->pars_bits_r = tree->e_root->pars_bits_l;
+      b2->pars_bits_r = tree->e_root->pars_bits_r;
       
       b1->p_lk_loc_rght = tree->e_root->p_lk_loc_left;
       b2->p_lk_loc_rght = tree->e_root->p_lk_loc_rght;
@@ -8235,6 +8683,343 @@ char *aLRT_From_String(char *s_tree, calign *cdata, t_mod *mod, option *io)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+// Random starts (and the final start from the BioNJ tree) can be
+// searched concurrently when the search writes to no shared file
+// and the model is fully carried over by Copy_Model.
+int Rand_Starts_Threadable(option *io)
+{
+#ifdef BEAGLE
+  return NO;
+#endif
+
+  if(THREAD_N_Threads() < 2)                                    return NO;
+  if(io->mod->s_opt->random_input_tree == NO)                   return NO;
+  if(io->fp_in_constraint_tree != NULL)                         return NO;
+  if(io->print_trace == YES || io->print_json_trace == YES)     return NO;
+  if(io->max_memory > 0.0 || strlen(io->scratch_dir) > 0)       return NO;
+  if(io->mod->use_m4mod == YES || io->mod->whichmodel == CUSTOMAA) return NO;
+  if(io->time_budget > 0.0)                                     return NO;
+  if(io->n_ufboot > 0)                                          return NO;
+
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Run the searches from n_rand_starts random trees plus the BioNJ
+// tree, one start per thread. Each start has its own model and
+// optimisation settings, while the compressed alignment is shared.
+// Each start also has its own tip partial likelihoods: Swap exchanges
+// these vectors between edges and Free_Tree_Lk frees them, and they
+// are small compared to the other partial likelihoods.
+// Random numbers for start i, including those used to build the
+// random starting tree, come from a stream seeded with
+// Rand_Stream_Seed(r_seed,i), as in the sequential loop of main().
+// The results therefore do not depend on the number of threads, nor on
+// whether the starts are searched concurrently. Starting trees are built and results are
+// reported in the calling thread, in the same order as in the
+// sequential loop of main().
+char *Rand_Starts_Threaded(calign *cdata, t_mod *mod, option *io, int num_data_set, int num_tree, phydbl *best_lnL, char *most_likely_tree)
+{
+  t_rand_start_job job;
+  t_tree *tree;
+  t_mod **a_mod;
+  option **a_io;
+  time_t *t_beg;
+  int n_rand_starts,n_starts,n_thr,n_batch,first,num_rand_tree,i;
+
+  n_rand_starts = mod->s_opt->n_rand_starts;
+  n_starts      = n_rand_starts+1;
+  n_thr         = THREAD_N_Threads();
+  tree          = NULL;
+
+  job.trees = (t_tree **)mCalloc(n_thr,sizeof(t_tree *));
+  job.t_end = (time_t *)mCalloc(n_thr,sizeof(time_t));
+  job.seed  = (unsigned int *)mCalloc(n_thr,sizeof(unsigned int));
+  t_beg     = (time_t *)mCalloc(n_thr,sizeof(time_t));
+  a_mod     = (t_mod **)mCalloc(n_thr,sizeof(t_mod *));
+  a_io      = (option **)mCalloc(n_thr,sizeof(option *));
+
+  /* No more than n_thr trees are held in memory at once */
+  for(first=0;first<n_starts;first+=n_thr)
+    {
+      n_batch = MIN(n_thr,n_starts-first);
+
+      For(i,n_batch)
+        {
+          num_rand_tree = first+i;
+
+          job.seed[i] = (unsigned int)Rand_Stream_Seed(io->r_seed,num_rand_tree);
+          Rand_Set_Thread_Seed(job.seed+i);
+
+          mod->s_opt->random_input_tree = (num_rand_tree < n_rand_starts)?(YES):(NO);
+
+          Init_Model(cdata,mod,io);
+
+          a_mod[i]           = Copy_Model(mod);
+          a_mod[i]->s_opt    = Make_Optimiz();
+          *(a_mod[i]->s_opt) = *(mod->s_opt);
+
+          a_io[i]            = (option *)mCalloc(1,sizeof(option));
+          *(a_io[i])         = *io;
+          a_io[i]->mod       = a_mod[i];
+          a_io[i]->quiet     = YES;
+          a_mod[i]->io       = a_io[i];
+
+          Init_Model(cdata,a_mod[i],a_io[i]);
+
+          switch(io->in_tree)
+            {
+            case 0 : case 1 : { tree = Dist_And_BioNJ(cdata,a_mod[i],io); break; }
+            case 2 :          { tree = Read_User_Tree(cdata,a_mod[i],io); break; }
+            }
+
+          if(!tree)
+            {
+              PhyML_Printf("\n== Err. in file %s at line %d (function '%s') \n",__FILE__,__LINE__,__FUNCTION__);
+              Exit("");
+            }
+
+          time(&(t_beg[i]));
+          time(&(tree->t_beg));
+
+          tree->mod       = a_mod[i];
+          tree->io        = io;
+          tree->data      = cdata;
+          tree->n_pattern = tree->data->crunch_len;
+          tree->n_root    = NULL;
+          tree->e_root    = NULL;
+
+          Set_Both_Sides(YES,tree);
+
+          if(tree->mod->s_opt->random_input_tree) Random_Tree(tree);
+
+          if((!num_data_set) && (!num_tree) && (!num_rand_tree)) Check_Memory_Amount(tree);
+
+          Prepare_Tree_For_Lk(tree);
+          Br_Len_Not_Involving_Invar(tree);
+          Unscale_Br_Len_Multiplier_Tree(tree);
+
+          tree->io      = a_io[i];
+          tree->verbose = VL0;
+
+          job.trees[i] = tree;
+
+          Rand_Set_Thread_Seed(NULL);
+        }
+
+      THREAD_Run(Rand_Start_Job,&job,n_batch,1);
+
+      For(i,n_batch)
+        {
+          num_rand_tree = first+i;
+          tree          = job.trees[i];
+          tree->io      = io;
+
+          mod->s_opt->random_input_tree = (num_rand_tree < n_rand_starts)?(YES):(NO);
+
+          if(mod->s_opt->random_input_tree && mod->s_opt->topo_search != NNI_MOVE)
+            if(!io->quiet) PhyML_Printf("\n\n. [Random start %3d/%3d]",num_rand_tree+1,n_rand_starts);
+
+          PhyML_Printf("\n\n. Log likelihood of the current tree: %f.",tree->c_lnL);
+
+          if(io->ancestral == YES) Ancestral_Sequences(tree,YES);
+
+          Check_Br_Lens(tree);
+          Br_Len_Involving_Invar(tree);
+          Rescale_Br_Len_Multiplier_Tree(tree);
+
+          if(!tree->n_root) Get_Best_Root_Position(tree);
+
+          Print_Tree(io->fp_out_trees,tree);
+          fflush(NULL);
+
+          if(tree->c_lnL > *best_lnL)
+            {
+              *best_lnL = tree->c_lnL;
+              if(most_likely_tree) Free(most_likely_tree);
+              most_likely_tree = Write_Tree(tree,NO);
+            }
+
+          Print_Fp_Out(io->fp_out_stats,t_beg[i],job.t_end[i],tree,
+                       io,num_data_set+1,num_rand_tree,
+                       (num_rand_tree >= n_rand_starts-1)?(YES):(NO));
+
+          if(io->print_site_lnl) Print_Site_Lk(tree,io->fp_out_lk);
+
+          /* Leave the model in the state the sequential loop leaves it in */
+          if(num_rand_tree == n_starts-1)
+            {
+              Record_Model(a_mod[i],mod);
+              *(mod->s_opt) = *(a_mod[i]->s_opt);
+            }
+
+          Free_Spr_List(tree);
+          Free_Triplet(tree->triplet_struct);
+          Free_Tree_Pars(tree);
+          Free_Tree_Lk(tree);
+          Free_Tree(tree);
+          Free_Optimiz(a_mod[i]->s_opt);
+          Free_Model(a_mod[i]);
+          Free(a_io[i]);
+        }
+    }
+
+  mod->s_opt->n_rand_starts     = n_starts;
+  mod->s_opt->random_input_tree = NO;
+
+  Free(job.trees);
+  Free(job.t_end);
+  Free(job.seed);
+  Free(t_beg);
+  Free(a_mod);
+  Free(a_io);
+
+  return most_likely_tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Rand_Start_Job(int beg, int end, int thread_id, void *arg)
+{
+  t_rand_start_job *job;
+  t_tree *tree;
+  int i;
+
+  job = (t_rand_start_job *)arg;
+
+  for(i=beg;i<end;i++)
+    {
+      tree = job->trees[i];
+
+      Rand_Set_Thread_Seed(job->seed+i);
+
+      if(tree->mod->s_opt->opt_topo)
+        {
+          if(tree->mod->s_opt->topo_search      == NNI_MOVE) Simu_Loop(tree);
+          else if(tree->mod->s_opt->topo_search == SPR_MOVE) Speed_Spr_Loop(tree);
+          else                                               Best_Of_NNI_And_SPR(tree);
+
+          if(tree->n_root) Add_Root(tree->a_edges[0],tree);
+        }
+      else
+        {
+          if(tree->mod->s_opt->opt_subst_param || tree->mod->s_opt->opt_bl) Round_Optimize(tree,ROUND_MAX);
+          else Lk(NULL,tree);
+        }
+
+      if(tree->mod->gamma_mgf_bl) Best_Root_Position_IL_Model(tree);
+
+      Set_Both_Sides(YES,tree);
+      Lk(NULL,tree);
+      Pars(NULL,tree);
+      Get_Tree_Size(tree);
+
+      Rand_Set_Thread_Seed(NULL);
+
+      time(&(job->t_end[i]));
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Share of the time budget used so far (0.0 when no budget was set)
+phydbl Time_Budget_Used(option *io)
+{
+  time_t t_curr;
+
+  if(io == NULL || io->time_budget < 0.0) return 0.0;
+
+  time(&t_curr);
+  return (phydbl)difftime(t_curr,io->t_budget_beg)/io->time_budget;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+int Time_Budget_Over(phydbl frac, option *io)
+{
+  if(io == NULL || io->time_budget < 0.0) return NO;
+  return (Time_Budget_Used(io) > frac)?(YES):(NO);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Convergence threshold 'tol' once SPR rounds are over: it grows
+// geometrically up to 100 x tol at the end of the time budget, so
+// that optimisation rounds finish earlier and earlier
+phydbl Time_Budget_Tol(phydbl tol, option *io)
+{
+  phydbl used;
+
+  used = Time_Budget_Used(io);
+  if(used < TIME_BUDGET_SPR) return tol;
+
+  used = MIN(1.0,(used-TIME_BUDGET_SPR)/(TIME_BUDGET_END-TIME_BUDGET_SPR));
+  return tol * POW(10.,2.*used);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Write the current tree in out_budget_file if it is at least as
+// likely as the one saved there, so that the best tree found so
+// far is available whenever the budget runs out. During the search
+// (br_len_scaled == NO), branch lengths do not account for invariant
+// sites and the branch length multiplier yet. They are then written
+// as they are at the end of the search (see main), and restored
+// exactly afterwards.
+void Time_Budget_Save(t_tree *tree, int br_len_scaled)
+{
+  FILE *fp;
+  char *s;
+  scalar_dbl **l;
+  int i;
+
+  if(tree->io == NULL || tree->io->time_budget < 0.0) return;
+  if(tree->c_lnL < tree->io->budget_best_lnL) return;
+
+  tree->io->budget_best_lnL = tree->c_lnL;
+
+  l = NULL;
+  if(br_len_scaled == NO)
+    {
+      l = (scalar_dbl **)mCalloc(2*tree->n_otu-1,sizeof(scalar_dbl *));
+      For(i,2*tree->n_otu-1) l[i] = Duplicate_Scalar_Dbl(tree->a_edges[i]->l);
+      Br_Len_Involving_Invar(tree);
+      Rescale_Br_Len_Multiplier_Tree(tree);
+    }
+
+  s  = Write_Tree(tree,NO);
+
+  if(br_len_scaled == NO)
+    {
+      For(i,2*tree->n_otu-1)
+        {
+          Copy_Scalar_Dbl(l[i],tree->a_edges[i]->l);
+          Free_Scalar_Dbl(l[i]);
+        }
+      Free(l);
+    }
+
+  fp = Openfile(tree->io->out_budget_file,WRITE);
+  if(fp == NULL)
+    {
+      PhyML_Printf("\n== Cannot write file '%s'.",tree->io->out_budget_file);
+      Exit("\n");
+    }
+  PhyML_Fprintf(fp,"[%f]%s\n",tree->c_lnL,s);
+  fclose(fp);
+  Free(s);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 void Prepare_Tree_For_Lk(t_tree *tree)
 {
   Connect_CSeqs_To_Nodes(tree->data,tree->io,tree);
@@ -9681,46 +10466,57 @@ int Check_Topo_Constraints(t_tree *big_tree, t_tree *small_tree)
       Exit("\n");
     }
 
-  t_tree *big_tree_cpy;
-  int diffs,i;
-
-  big_tree_cpy = Make_Tree_From_Scratch(big_tree->n_otu,NULL);
-  Copy_Tree(big_tree,big_tree_cpy);
-
-
-  Prune_Tree(big_tree_cpy,small_tree);
-
-  /* For(i,2*small_tree->n_otu-3) printf("\nz %d . %d . %d", */
-  /* 				      big_tree->a_edges[i]->does_exist, */
-  /* 				      big_tree_cpy->a_edges[i]->does_exist, */
-  /* 				      small_tree->a_edges[i]->does_exist); */
+  int *tip_bit,diffs,i,n_edges,n_words,*bip_n,*bip_score;
+  bip_word **bip_bits;
+  unsigned long long *bip_hash;
 
-  Free_Bip(small_tree);
-  Alloc_Bip(small_tree);
-  Get_Bip(small_tree->a_nodes[0],small_tree->a_nodes[0]->v[0],small_tree);
+  /* The bipartitions of big_tree, restricted to the taxa of
+     small_tree, are compared to those of small_tree. Bits are indexed
+     by the tip numbers of small_tree, so that big_tree does not have
+     to be copied and pruned. The bipartition fields of big_tree are
+     set aside first and restored at the end, so that the caller's
+     bipartitions (e.g., those of the input tree) are left untouched */
+  n_edges   = 2*big_tree->n_otu-3;
+  n_words   = big_tree->bip_n_words;
+  bip_bits  = (bip_word **)mCalloc(n_edges,sizeof(bip_word *));
+  bip_hash  = (unsigned long long *)mCalloc(n_edges,sizeof(unsigned long long));
+  bip_n     = (int *)mCalloc(n_edges,sizeof(int));
+  bip_score = (int *)mCalloc(n_edges,sizeof(int));
 
-  Free_Bip(big_tree_cpy);
-  Alloc_Bip(big_tree_cpy);
-  Match_Tip_Numbers(small_tree,big_tree_cpy);
-  Get_Bip(big_tree_cpy->a_nodes[0],big_tree_cpy->a_nodes[0]->v[0],big_tree_cpy);
+  For(i,n_edges)
+    {
+      bip_bits[i]  = big_tree->a_edges[i]->bip_bits;
+      bip_hash[i]  = big_tree->a_edges[i]->bip_hash;
+      bip_n[i]     = big_tree->a_edges[i]->bip_n;
+      bip_score[i] = big_tree->a_edges[i]->bip_score;
+      big_tree->a_edges[i]->bip_bits = NULL;
+    }
+  big_tree->bip_n_words = 0;
 
-  For(i,2*big_tree_cpy->n_otu-3) big_tree_cpy->a_edges[i]->bip_score = 0;
-  For(i,2*small_tree->n_otu-3)   small_tree->a_edges[i]->bip_score = 0;
+  tip_bit = Get_Tip_Map(small_tree,big_tree);
+  Get_Bip_Bits(big_tree,tip_bit,small_tree->n_otu);
+  Free(tip_bit);
 
-  diffs = Compare_Bip(small_tree,big_tree_cpy,NO);
+  Get_Bip_Bits(small_tree,NULL,small_tree->n_otu);
 
-  /* printf("\n"); */
-  /* printf("\n. %s",Write_Tree(big_tree_cpy,NO)); */
-  /* printf("\n. %s",Write_Tree(small_tree,NO)); */
-  /* printf("\n. diffs=%d",diffs); */
+  For(i,2*small_tree->n_otu-3) small_tree->a_edges[i]->bip_score = 0;
 
+  diffs = Compare_Bip(small_tree,big_tree,NO);
 
-  Free_Tree(big_tree_cpy);
+  Free_Bip_Bits(big_tree);
+  For(i,n_edges)
+    {
+      big_tree->a_edges[i]->bip_bits  = bip_bits[i];
+      big_tree->a_edges[i]->bip_hash  = bip_hash[i];
+      big_tree->a_edges[i]->bip_n     = bip_n[i];
+      big_tree->a_edges[i]->bip_score = bip_score[i];
+    }
+  big_tree->bip_n_words = n_words;
 
-  t_tree *big_tree_cpy_bis;
-  big_tree_cpy_bis = Make_Tree_From_Scratch(big_tree->n_otu,NULL);
-  Copy_Tree(big_tree,big_tree_cpy_bis);
-  Free_Tree(big_tree_cpy_bis);
+  Free(bip_bits);
+  Free(bip_hash);
+  Free(bip_n);
+  Free(bip_score);
 
   if(diffs == 0) return 1; /* Constraint is satisfied */
   else           return 0;
@@ -10204,6 +11000,26 @@ void Set_Both_Sides(int yesno, t_tree *mixt_tree)
 
 }
 
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Turn incremental likelihood calculations on or off. When they are
+   on, Lk only recomputes partial likelihoods flagged as invalid */
+void Set_Incr_Lk(int yesno, t_tree *mixt_tree)
+{
+  t_tree *tree;
+
+  assert(!mixt_tree->prev);
+
+  tree = mixt_tree;
+  do
+    {
+      tree->incr_lk = yesno;
+      tree = tree->next;
+    }
+  while(tree);
+}
+
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
@@ -10436,7 +11252,7 @@ void Random_SPRs_On_Rooted_Tree(t_tree *tree)
   Returns p_lk and sum_scale for subtree with x as root, Pij for edge b
 */
 
-void Set_P_Lk_One_Side(phydbl **Pij, phydbl **p_lk,  int **sum_scale, t_node *d, t_edge *b, t_tree *tree
+void Set_P_Lk_One_Side(phydbl **Pij, phyplk **p_lk,  int **sum_scale, t_node *d, t_edge *b, t_tree *tree
 #ifdef BEAGLE
                        , int* child_p_idx, int* Pij_idx
 #endif
@@ -10501,9 +11317,9 @@ void Set_P_Lk_One_Side(phydbl **Pij, phydbl **p_lk,  int **sum_scale, t_node *d,
 */
 
 void Set_All_P_Lk(t_node **n_v1, t_node **n_v2,
-                  phydbl **p_lk, int **sum_scale, int **p_lk_loc,
-                  phydbl **Pij1, phydbl **p_lk_v1, int **sum_scale_v1,
-                  phydbl **Pij2, phydbl **p_lk_v2, int **sum_scale_v2,
+                  phyplk **p_lk, int **sum_scale, int **p_lk_loc,
+                  phydbl **Pij1, phyplk **p_lk_v1, int **sum_scale_v1,
+                  phydbl **Pij2, phyplk **p_lk_v2, int **sum_scale_v2,
                   t_node *d, t_edge *b, t_tree *tree
 #ifdef BEAGLE
                   , int *dest_p_idx, int *child1_p_idx, int* child2_p_idx, int* Pij1_idx, int* Pij2_idx
@@ -31,7 +31,7 @@ the GNU public licence. See http://www.opensource.org for details.
 /* #include <malloc/malloc.h> */
 #include <malloc.h>
 
-#if (defined(__AVX__))
+#if (defined(__AVX__) || defined(CPU_DISPATCH))
 #include <xmmintrin.h>
 #include <pmmintrin.h>
 #include <immintrin.h>
@@ -40,6 +40,21 @@ the GNU public licence. See http://www.opensource.org for details.
 #include <pmmintrin.h>
 #endif
 
+/* Families of likelihood kernels compiled in. With CPU_DISPATCH, all
+   of them are compiled and the fastest one supported by the CPU is
+   selected at run time (see Init_Lk_Kernel). With PLK_FLOAT, vectorized
+   kernels widen partial likelihoods to double precision on load (see
+   AVX_LOAD_PLK) */
+#if (defined(__AVX512F__) || defined(CPU_DISPATCH))
+#define AVX512_KERNELS
+#endif
+#if (defined(__AVX__) || defined(CPU_DISPATCH))
+#define AVX_KERNELS
+#endif
+#if ((defined(__SSE3__) && !defined(__AVX__)) || defined(CPU_DISPATCH))
+#define SSE_KERNELS
+#endif
+
 
 extern int n_sec1;
 extern int n_sec2;
@@ -94,7 +109,9 @@ static inline int isinf_ld (long double x) { return isnan (x - x); }
 #define CT 4
 #define GT 5
 
-#if (defined __AVX__)
+#if (defined __AVX512F__ || defined CPU_DISPATCH)
+#define BYTE_ALIGN 64
+#elif (defined __AVX__)
 #define BYTE_ALIGN 32
 #elif (defined __SSE3__)
 #define BYTE_ALIGN 16
@@ -102,6 +119,22 @@ static inline int isinf_ld (long double x) { return isnan (x - x); }
 #define BYTE_ALIGN 1
 #endif
 
+#define LK_KERNEL_AUTO   -1
+#define LK_KERNEL_SCALAR  0
+#define LK_KERNEL_SSE3    1
+#define LK_KERNEL_AVX     2
+#define LK_KERNEL_AVX512  3
+
+/* Shares of the time budget (--time_budget) after which the search
+   stops building starting trees, stops SPR and NNI rounds, and stops
+   optimising model parameters. The remainder goes to branch lengths
+   and output */
+#define TIME_BUDGET_STARTS   0.25
+#define TIME_BUDGET_SPR      0.70
+#define TIME_BUDGET_NNI      0.80
+#define TIME_BUDGET_MODEL    0.90
+#define TIME_BUDGET_END      0.95
+
 #ifndef M_1_SQRT_2PI
 #define M_1_SQRT_2PI	0.398942280401432677939946059934	/* 1/sqrt(2pi) */
 #endif
@@ -384,6 +417,32 @@ typedef	double phydbl;
 #define BL_MAX 1.
 #endif
 
+/* Storage type of partial likelihoods. With PLK_FLOAT, partial
+   likelihoods are stored in single precision (computations are still
+   done in double precision). Sites for which single precision is not
+   sufficient are flagged and their likelihood recomputed in double
+   precision (see Lk_Guarded_Sites) */
+#if defined(PLK_FLOAT)
+typedef float phyplk;
+#define  PLK_FLT_LIM_INF   2.328306e-10 /* 2^-32 */
+#define  PLK_FLT_GUARD     FLT_MIN
+#else
+typedef phydbl phyplk;
+#endif
+
+/* Word of the bit-sliced Fitch parsimony vectors (see pars.c): bit k
+   of word w in the vector of state s is set if state s belongs to the
+   Fitch set of site pattern w*PARS_WORD_BITS+k */
+typedef unsigned long long pars_word;
+#define  PARS_WORD_BITS       64
+#define  PARS_MAX_WGHT_PLANES 24
+#define  PARS_N_WORDS(n_site) (((n_site)+PARS_WORD_BITS-1)/PARS_WORD_BITS)
+
+/* Word of the bipartition bitsets (see Get_Bip_Bits): one bit per taxon */
+typedef unsigned long long bip_word;
+#define  BIP_WORD_BITS        64
+#define  BIP_N_WORDS(n_tax)   (((n_tax)+BIP_WORD_BITS-1)/BIP_WORD_BITS)
+
 // Do *not* change the values below and leave the lines with
 // curr_scaler_pow = (int)(-XXX.-LOG(smallest_p_lk))/LOG2;
 // as XXX depends on what the value of P_LK_LIM_INF is 
@@ -561,11 +620,19 @@ typedef struct __Edge {
   int                           bip_score; /*! score of the bipartition generated by the corresponding edge
                           bip_score = 1 iif the branch is found in both trees to be compared,
                           bip_score = 0 otherwise. */
+  bip_word                      *bip_bits; /*! taxa on the side of the edge that does not hold the first taxon (see Get_Bip_Bits) */
+  unsigned long long             bip_hash; /*! hash of bip_bits */
+  int                               bip_n; /*! number of taxa on the smallest side of the edge */
 
   int                         num_st_left; /*! number of the subtree on the left side */
   int                         num_st_rght; /*! number of the subtree on the right side */
 
   phydbl                          *Pij_rr; /*! matrix of change probabilities and its first and secnd derivates (rate*state*state) */
+  phydbl                      *Pij_rr_old; /*! copy of Pij_rr taken before it is updated (see Update_PMat_At_Given_Edge) */
+  phydbl                          *tip_lk; /*! Pij_rr times each possible tip vector, i.e., one column of Pij_rr per state plus the row sums for fully ambiguous characters (code*rate*state) */
+  short int                 update_tip_lk; /*! YES if tip_lk is not up to date with Pij_rr */
+  short int                    valid_left; /*! NO -> p_lk_left has to be recomputed (see Update_Invalid_P_Lk) */
+  short int                    valid_rght; /*! NO -> p_lk_rght has to be recomputed */
 #ifdef BEAGLE
   int                          Pij_rr_idx;
 #endif
@@ -576,7 +643,7 @@ typedef struct __Edge {
 
 
 
-  phydbl            *p_lk_left,*p_lk_rght; /*! likelihoods of the subtree on the left and right side (for each site and each relative rate category) */
+  phyplk            *p_lk_left,*p_lk_rght; /*! likelihoods of the subtree on the left and right side (for each site and each relative rate category) */
   short int      *p_lk_tip_r, *p_lk_tip_l;
 #ifdef BEAGLE
   int        p_lk_left_idx, p_lk_rght_idx;
@@ -591,6 +658,7 @@ typedef struct __Edge {
   int                     *pars_l,*pars_r; /*! parsimony of the subtree on the left and right sides (for each site) */
   unsigned int               *ui_l, *ui_r; /*! union - intersection vectors used in Fitch's parsimony algorithm */
   int                *p_pars_l, *p_pars_r; /*! conditional parsimony vectors */
+  pars_word    *pars_bits_l, *pars_bits_r; /*! bit-sliced Fitch sets, one word per state and block of sites. The last word is the parsimony of the subtree */
 
   /*! Below are the likelihood scaling factors (used in functions
      `Get_All_Partial_Lk_Scale' in lk.c. */
@@ -658,6 +726,7 @@ typedef struct __Tree{
   struct __Node                   **curr_path; /*! list of nodes that form a path in the tree */
   struct __SPR                     **spr_list;
   struct __SPR                      *best_spr;
+  struct __Topo_Memo               *topo_memo; /*! log-likelihoods of the topologies already examined during SPR searches. NULL -> not recorded */
   struct __Tdraw                     *ps_tree; /*! structure for drawing trees in postscript format */
   struct __T_Rate                       *rates; /*! structure for handling rates of evolution */
   struct __Tmcmc                        *mcmc;
@@ -678,6 +747,7 @@ typedef struct __Tree{
   int                         depth_curr_path; /*! depth of the t_node path defined by curr_path */
   int                                 has_bip; /*!if has_bip=1, then the structure to compare
                          tree topologies is allocated, has_bip=0 otherwise */
+  int                             bip_n_words; /*! number of words in the bipartition bitsets of the edges. 0 -> not allocated */
   int                                   n_otu; /*! number of taxa */
   int                               curr_site; /*! current site of the alignment to be processed */
   int                               curr_catg; /*! current class of the discrete gamma rate distribution */
@@ -689,6 +759,8 @@ typedef struct __Tree{
   int                              both_sides; /*! both_sides=1 -> a pre-order and a post-order tree
                           traversals are required to compute the likelihood
                           of every subtree in the phylogeny*/
+  int                                 incr_lk; /*! incr_lk=1 -> Lk only recomputes the partial likelihoods
+                          flagged as invalid (see Update_Invalid_P_Lk) */
   int               num_curr_branch_available; /*!gives the number of the next cell in a_edges that is free to receive a pointer to a branch */
   short int                            *t_dir;
   int                          n_improvements;
@@ -714,6 +786,11 @@ typedef struct __Tree{
   phydbl                    sum_min_sum_scale; /*! common factor of scaling factors */
   phydbl                        *c_lnL_sorted; /*! used to compute c_lnL by adding sorted terms to minimize CPU errors */
   phydbl                         *cur_site_lk; /*! vector of loglikelihoods at individual sites */
+#if defined(PLK_FLOAT)
+  short int                        *plk_guard; /*! plk_guard[site] = YES -> site likelihood is computed in double precision (see Lk_Guarded_Sites) */
+#endif
+  struct __Lowmem                   *lowmem; /*! pool of partial likelihood vectors when their memory is limited (--max_memory). NULL -> one vector per edge side */
+  struct __Plk_Map                 *plk_map; /*! scratch file that holds the partial likelihoods (--scratch_dir). NULL -> vectors are in memory */
   phydbl                         *old_site_lk; /*! vector of likelihoods at individual sites */
   phydbl                       annealing_temp; /*! annealing temperature in simulated annealing optimization algo */
   phydbl                               c_dlnL; /*! First derivative of the log-likelihood with respect to the length of a branch */
@@ -723,14 +800,22 @@ typedef struct __Tree{
   phydbl                *unscaled_site_lk_cat; /*! partially scaled site likelihood at individual sites */
 
   phydbl                         *site_lk_cat; /*! loglikelihood at a single site and for each class of rate*/
+  phydbl                     *site_lk_cat_thr; /*! one copy of site_lk_cat per thread of the pool (see Lk_Sites) */
+  int                      *sum_scale_cat_thr; /*! one copy of sum_scale_left_cat and sum_scale_rght_cat per thread of the pool */
+  int                           n_thr_scratch; /*! number of threads site_lk_cat_thr and sum_scale_cat_thr were allocated for */
   phydbl                      unconstraint_lk; /*! unconstrained (or multinomial) likelihood  */
   int                         *fact_sum_scale;
   phydbl                       **log_lks_aLRT; /*! used to compute several branch supports */
+  unsigned short               *rell_cnt_aLRT; /*! rell_cnt_aLRT[i*N_RELL_ALRT+b]: number of times site pattern i is drawn in the RELL replicate b of the SH-like test (see Make_Rell_Cnt) */
+  int                      *rell_cnt_aLRT_int; /*! same as rell_cnt_aLRT, used instead when the alignment has more than USHRT_MAX sites */
   phydbl                           n_root_pos; /*! position of the root on its t_edge */
   phydbl                                 size; /*! tree size */
   int                              *site_pars;
   int                                  c_pars;
   int                               *step_mat;
+  pars_word                   *pars_wght_bits; /*! bit planes of site pattern weights (bit-sliced parsimony) */
+  int                      pars_wght_n_planes;
+  short int                     use_pars_bits; /*! YES when Fitch parsimony is computed on bit-sliced vectors */
   
 
   int                           size_spr_list;
@@ -763,6 +848,9 @@ typedef struct __Tree{
   phydbl                                   *K; /*! a vector of the norm.constants for the node times prior. */
 
   short int                       ignore_root;
+
+  void  (*update_p_lk)(struct __Tree *,struct __Edge *,struct __Node *,int,int); /*! kernel updating partial likelihoods (see Bind_Lk_Kernels) */
+  phydbl    (*lk_core)(int,int,struct __Edge *,struct __Tree *); /*! kernel computing site likelihoods. NULL -> Lk_Core */
 #ifdef BEAGLE
   int                                  b_inst; /*! The BEAGLE instance id associated with this tree. */
 #endif
@@ -1208,10 +1296,65 @@ typedef struct __Option { /*! mostly used in 'help.c' */
 
   int                       ancestral;
   int                  has_io_weights;
+  int                       n_threads; /*! number of threads used in likelihood calculations */
+  int                       lk_kernel; /*! likelihood kernels: LK_KERNEL_AUTO, LK_KERNEL_SCALAR, LK_KERNEL_SSE3, ... */
+  phydbl                   max_memory; /*! memory (in MB) available for partial likelihood vectors. 0 -> no limit */
+  char                   *scratch_dir; /*! directory of the scratch file holding the partial likelihoods. Empty string -> in memory */
+  phydbl                  time_budget; /*! wall-clock time (in seconds) allotted to the tree search. < 0 -> no limit */
+  time_t                 t_budget_beg; /*! time at which the budget started running */
+  phydbl              budget_best_lnL; /*! log-likelihood of the tree last saved in out_budget_file */
+  char               *out_budget_file; /*! best tree found so far when a time budget is set */
+  int                        n_ufboot; /*! number of RELL bootstrap replicates collected during the tree search. 0 -> none */
+  struct __UFBoot             *ufboot; /*! RELL replicates and their best trees (see ufboot.c) */
 }option;
 
 /*!********************************************************/
 
+typedef struct __Lowmem {
+  struct __Tree                *tree; /*! tree whose edges currently hold the vectors of the pool */
+  phyplk                      **buff; /*! partial likelihood vectors */
+  phyplk                    ***owner; /*! owner[i]: edge field (p_lk_left or p_lk_rght) last known to point to buff[i]. NULL -> buff[i] is free */
+  unsigned long int           *stamp; /*! time of last use of each vector (least recently used ones are recycled first) */
+  int                           *pin; /*! pin[i] > 0 -> buff[i] is being used and cannot be recycled */
+  int                         n_buff; /*! number of vectors allocated */
+  int                       max_buff; /*! number of vectors that fit in the memory budget */
+  int                      size_buff; /*! size of the arrays above */
+  size_t                   buff_size; /*! number of elements in a vector */
+  unsigned long int            clock;
+  long int                  n_recomp; /*! number of partial likelihood vectors recomputed so far */
+}t_lowmem;
+
+/*!********************************************************/
+
+typedef struct __UFBoot {
+  struct __Calign              *data; /*! alignment the replicates are drawn from */
+  int                         n_boot; /*! number of replicates */
+  int                         n_patt; /*! number of site patterns in data */
+  unsigned short               **cnt; /*! cnt[b][i]: number of times pattern i is drawn in replicate b */
+  int                      **cnt_int; /*! same as cnt, used instead when the alignment has more than USHRT_MAX sites */
+  phydbl                   *best_lnL; /*! highest RELL log-likelihood found for each replicate */
+  int                     *best_tree; /*! index in 'trees' of the tree that reached best_lnL, for each replicate */
+  char                       **trees; /*! trees that are the best for at least one replicate. NULL -> free slot */
+  int                         *n_ref; /*! number of replicates for which trees[i] is the best */
+  int                        n_trees; /*! number of slots in 'trees' */
+  phydbl                   *site_lnL; /*! log-likelihood of each site pattern for the tree being examined */
+  phydbl                       *rell; /*! RELL log-likelihood of the tree being examined, for each replicate */
+  long int                    n_eval; /*! number of trees examined so far */
+}t_ufboot;
+
+/*!********************************************************/
+
+typedef struct __Plk_Map {
+  char                         *addr; /*! start of the memory-mapped scratch file */
+  size_t                        size; /*! size of the mapping (bytes) */
+  size_t                        used; /*! bytes already handed out to edges */
+  size_t                       block; /*! vectors are aligned on block bytes (page size) */
+  struct __Node              *next_a; /*! update that follows the current one in a tree traversal: partial likelihoods of next_d looking away from next_a (see LOWMEM_Map_Next_Post) */
+  struct __Node              *next_d;
+}t_plk_map;
+
+/*!********************************************************/
+
 typedef struct __Optimiz { /*! parameters to be optimised (mostly used in 'optimiz.c') */
   int                opt_alpha; /*! =1 -> the gamma shape parameter is optimised */
   int                opt_kappa; /*! =1 -> the ts/tv ratio parameter is optimised */
@@ -1236,6 +1379,8 @@ typedef struct __Optimiz { /*! parameters to be optimised (mostly used in 'optim
                                        tree topology remains fixed */
   int        random_input_tree; /*! boolean */
   int            n_rand_starts; /*! number of random starting points */
+  int            n_pars_starts; /*! number of stepwise addition trees built for each parsimony starting tree */
+  int                topo_memo; /*! YES -> topologies already examined in the SPR search are not examined again (see Topo_Memo_Skip). NO by default */
   int             brent_it_max;
   int                steph_spr;
   int          opt_five_branch;
@@ -1341,6 +1486,28 @@ typedef struct __SPR{
 
 /*!********************************************************/
 
+/*! Hash table of the topologies examined during an SPR search. A topology is
+    identified by the sum, over its edges, of a hash of the bipartition defined
+    by each edge. Each bipartition is represented by the xor of the random keys
+    of the taxa on one of its sides. */
+typedef struct __Topo_Memo{
+  unsigned long long        *key; /*! hash of the topologies recorded. 0 -> empty slot */
+  phydbl                    *lnL; /*! log-likelihood of these topologies when last examined */
+  int                       size; /*! number of slots (a power of 2) */
+  int                    n_items; /*! number of slots in use */
+
+  unsigned long long        *tax; /*! random key of each taxon */
+  unsigned long long       *side; /*! for each edge, xor of the keys of the taxa on its right-hand side */
+  unsigned long long         all; /*! xor of the keys of all the taxa */
+  unsigned long long        hash; /*! hash of the current topology */
+
+  unsigned long long      pruned; /*! xor of the keys of the taxa in the subtree being pruned */
+  struct __Node          *v[2]; /*! nodes on each side of the pruning point */
+  unsigned long long    v_bip[2]; /*! hash of the bipartitions defined by the edges between the pruning point and v */
+}t_topo_memo;
+
+/*!********************************************************/
+
 typedef struct __Triplet{
   int    size;
   phydbl *F_bc;
@@ -1899,6 +2066,23 @@ typedef struct __JSON_Array {
   struct __JSON_Object *object;
 }json_a;
 
+/*!********************************************************/
+
+/*! Arguments passed to the threads that search from independent starting trees */
+typedef struct __Rand_Start_Job {
+  struct __Tree     **trees; /*! tree of each starting point in the current batch */
+  time_t            *t_end; /*! time at which each search completed */
+  unsigned int       *seed; /*! state of the random number generator of each starting point (see Rand_Set_Thread_Seed) */
+}t_rand_start_job;
+
+/*!********************************************************/
+
+/*! Arguments passed to the threads that analyse bootstrap replicates */
+typedef struct __Boot_Job {
+  struct __Tree     **trees; /*! tree of each replicate in the current batch */
+  unsigned int       *seed; /*! state of the random number generator of each replicate (see Rand_Set_Thread_Seed) */
+}t_boot_job;
+
 /*!********************************************************/
 /*!********************************************************/
 /*!********************************************************/
@@ -1961,6 +2145,13 @@ char Reciproc_Assign_State(int i_state,int datatype);
 int Assign_State_With_Ambiguity(char *c,int datatype,int stepsize);
 void Clean_Tree_Connections(t_tree *tree);
 void Bootstrap(t_tree *tree);
+void Bootstrap_Resample(calign *data,calign *boot_data,int *site_num,option *io);
+t_tree *Bootstrap_Make_Tree(t_tree *tree,t_tree *hold,calign *boot_data,t_mod *boot_mod);
+void Bootstrap_Search(t_tree *boot_tree);
+void Bootstrap_Record(t_tree *tree,t_tree *boot_tree,int replicate);
+int Bootstrap_Threadable(option *io);
+void Bootstrap_Threaded(t_tree *tree,int *site_num);
+void Bootstrap_Job(int beg,int end,int thread_id,void *arg);
 void Br_Len_Involving_Invar(t_tree *tree);
 void Br_Len_Not_Involving_Invar(t_tree *tree);
 void Getstring_Stdin(char *s);
@@ -1987,6 +2178,10 @@ void Alloc_Bip(t_tree *tree);
 int Sort_Phydbl_Increase(const void *a,const void *b);
 int Sort_String(const void *a,const void *b);
 int Compare_Bip(t_tree *tree1,t_tree *tree2,int on_existing_edges_only);
+void Get_Bip_Bits(t_tree *tree,int *tip_bit,int n_bits);
+bip_word *Get_Bip_Bits_Post(t_node *a,t_node *d,t_edge *b,int *tip_bit,t_tree *tree);
+int *Get_Tip_Map(t_tree *tree1,t_tree *tree2);
+int Sort_Node_Name(const void *a,const void *b);
 void Match_Tip_Numbers(t_tree *tree1,t_tree *tree2);
 void Test_Multiple_Data_Set_Format(option *io);
 int Are_Compatible(char *statea,char *stateb,int stepsize,int datatype);
@@ -2036,6 +2231,7 @@ int Get_State_From_P_Pars(short int *p_pars,int pos,t_tree *tree);
 void Check_Dirs(t_tree *tree);
 void Warn_And_Exit(const char *s);
 void Randomize_Sequence_Order(calign *cdata);
+void Swap_Cseq_Content(calign *cdata, int i, int j);
 void Update_Root_Pos(t_tree *tree);
 void Add_Root(t_edge *target,t_tree *tree);
 void Update_Ancestors(t_node *a,t_node *d,t_tree *tree);
@@ -2064,6 +2260,13 @@ t_tree *Dist_And_BioNJ(calign *cdata,t_mod *mod,option *io);
 void Add_BioNJ_Branch_Lengths(t_tree *tree,calign *cdata,t_mod *mod);
 char *Bootstrap_From_String(char *s_tree,calign *cdata,t_mod *mod,option *io);
 char *aLRT_From_String(char *s_tree,calign *cdata,t_mod *mod,option *io);
+int Rand_Starts_Threadable(option *io);
+char *Rand_Starts_Threaded(calign *cdata,t_mod *mod,option *io,int num_data_set,int num_tree,phydbl *best_lnL,char *most_likely_tree);
+void Rand_Start_Job(int beg,int end,int thread_id,void *arg);
+phydbl Time_Budget_Used(option *io);
+int Time_Budget_Over(phydbl frac,option *io);
+phydbl Time_Budget_Tol(phydbl tol,option *io);
+void Time_Budget_Save(t_tree *tree, int br_len_scaled);
 void Prepare_Tree_For_Lk(t_tree *tree);
 void Find_Common_Tips(t_tree *tree1,t_tree *tree2);
 phydbl Get_Tree_Size(t_tree *tree);
@@ -2132,6 +2335,7 @@ void Joint_Proba_States_Left_Right(phydbl *Pij, phydbl *p_lk_left, phydbl *p_lk_
                    vect_dbl *pi, int scale_left, int scale_rght,
                    phydbl *F, int n, int site, t_tree *tree);
 void Set_Both_Sides(int yesno, t_tree *tree);
+void Set_Incr_Lk(int yesno, t_tree *tree);
 void Set_D_States(calign *data, int datatype, int stepsize);
 void Branch_To_Time(t_tree *tree);
 void Branch_To_Time_Pre(t_node *a, t_node *d, t_tree *tree);
@@ -2140,7 +2344,7 @@ phydbl *Dist_Btw_Tips(t_tree *tree);
 void Random_SPRs_On_Rooted_Tree(t_tree *tree);
 
 
-void Set_P_Lk_One_Side(phydbl **Pij, phydbl **p_lk,  int **sum_scale, t_node *d, t_edge *b, t_tree *tree
+void Set_P_Lk_One_Side(phydbl **Pij, phyplk **p_lk,  int **sum_scale, t_node *d, t_edge *b, t_tree *tree
 #ifdef BEAGLE
                        , int* child_p_idx, int* Pij_idx
 #endif
@@ -2148,9 +2352,9 @@ void Set_P_Lk_One_Side(phydbl **Pij, phydbl **p_lk,  int **sum_scale, t_node *d,
 
 
 void Set_All_P_Lk(t_node **n_v1, t_node **n_v2,
-                                 phydbl **p_lk , int **sum_scale , int **p_lk_loc,
-                  phydbl **Pij1, phydbl **p_lk1, int **sum_scale1,
-                  phydbl **Pij2, phydbl **p_lk2, int **sum_scale2,
+                                 phyplk **p_lk , int **sum_scale , int **p_lk_loc,
+                  phydbl **Pij1, phyplk **p_lk1, int **sum_scale1,
+                  phydbl **Pij2, phyplk **p_lk2, int **sum_scale2,
                   t_node *d, t_edge *b, t_tree *tree
 #ifdef BEAGLE
                   , int *dest_p_idx, int *child1_p_idx, int* child2_p_idx, int* Pij1_idx, int* Pij2_idx
@@ -2214,6 +2418,8 @@ void Set_Use_Eigen_Lr(short int yn, t_tree *tree);
 #include "help.h"
 #include "io.h"
 #include "make.h"
+#include "lowmem.h"
+#include "ufboot.h"
 #include "nexus.h"
 #include "init.h"
 #include "mcmc.h"